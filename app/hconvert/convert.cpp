@@ -0,0 +1,49 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "hypergraph/compact.hpp"
+#include "hypergraph/io.hpp"
+
+using namespace hypergraphlib;
+
+// Writes the hypergraph in the format that the input is not in
+template<typename HypergraphType>
+void convert(const std::string &input_filename, std::ofstream &output) {
+  if (BinaryHypergraphFile::is_binary_file(input_filename)) {
+    const BinaryHypergraphFile file(input_filename);
+    if (file.has_planted_cut()) {
+      std::cerr << "hMETIS files cannot hold the planted cut of " << input_filename << ", so it is dropped" << std::endl;
+    }
+    output << std::setprecision(std::numeric_limits<double>::max_digits10) << file.hypergraph<HypergraphType>();
+  } else {
+    output << as_binary(read_hmetis_file<HypergraphType>(input_filename));
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input file> <output file>" << std::endl;
+    std::cerr << "Converts an hMETIS file to the binary format, or a binary file to hMETIS." << std::endl;
+    return 1;
+  }
+
+  try {
+    std::ofstream output(argv[2], std::ios::binary);
+    if (!output) {
+      std::cerr << "Could not open " << argv[2] << std::endl;
+      return 1;
+    }
+    if (is_unweighted_hypergraph_file(argv[1])) {
+      convert<CompactHypergraph>(argv[1], output);
+    } else {
+      convert<CompactWeightedHypergraph<double>>(argv[1], output);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
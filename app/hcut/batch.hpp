@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tclap/CmdLine.h>
+
+#include "builder.hpp"
+
+// The names of the algorithms that can be run on hypergraphs of this type
+template<typename HypergraphType>
+std::vector<std::string> algorithm_names() {
+  std::vector<std::string> names;
+  for (const auto &builder : cut_funcs<HypergraphType>) {
+    names.emplace_back(builder->name());
+  }
+  return names;
+}
+
+/**
+ * The flags that tune how a cut is computed. They can be given on the command line, and again on each line of a batch
+ * file, where they override the command line.
+ */
+struct QueryFlags {
+  explicit QueryFlags(TCLAP::CmdLine &cmd) :
+      runs("r", "runs", "Number of runs to repeat contraction algorithm", false, 0, "A positive integer", cmd),
+      epsilon("e", "epsilon", "Approximation factor", false, 0.0, "A positive float", cmd),
+      discover("d",
+               "discover",
+               "Measure time needed to discover a cut with this value",
+               false,
+               0.0,
+               "A non-negative number",
+               cmd),
+      threads("t",
+              "threads",
+              "Number of threads to spread contraction runs over, 0 for all hardware threads",
+              false,
+              1,
+              "A non-negative integer",
+              cmd),
+      memory("m",
+             "memory",
+             "Memory in MiB that contraction algorithms should stay within. FPZ explores branches depth first rather "
+             "than copying them once it gets close.",
+             false,
+             0,
+             "A positive integer",
+             cmd),
+      random_seed("s", "seed", "Random seed", false, 0, "Random seed for randomized algorithms", cmd) {}
+
+  // Copies the flags that were given into `options`
+  void fill(Options &options) {
+    if (runs.isSet()) {
+      options.runs = runs.getValue();
+    }
+    if (epsilon.isSet()) {
+      options.epsilon = epsilon.getValue();
+    }
+    if (discover.isSet()) {
+      options.discover = discover.getValue();
+    }
+    if (threads.isSet()) {
+      options.threads = threads.getValue();
+    }
+    if (memory.isSet()) {
+      options.memory_limit = memory.getValue() << 20;
+    }
+    if (random_seed.isSet()) {
+      options.random_seed = random_seed.getValue(); // TODO make optional
+    }
+  }
+
+  TCLAP::ValueArg<size_t> runs;
+  TCLAP::ValueArg<double> epsilon;
+  TCLAP::ValueArg<double> discover;
+  TCLAP::ValueArg<size_t> threads;
+  TCLAP::ValueArg<size_t> memory;
+  TCLAP::ValueArg<uint32_t> random_seed;
+};
+
+/**
+ * Parses a line of a batch file. A line holds the arguments of one query the way they are given on the command line,
+ * `<k> <algorithm> [flags]`. Options that the line does not give are taken from `defaults`.
+ *
+ * Returns false and sets `error` on failure, true otherwise.
+ */
+inline bool read_query(const std::string &line, const Options &defaults, Options &query, std::string &error) {
+  try {
+    TCLAP::CmdLine cmd("Query", ' ', "", false);
+    cmd.setExceptionHandling(false);
+
+    TCLAP::UnlabeledValueArg<size_t> kArg("k", "Compute the k-cut", true, 0, "An integer greater than 1", cmd);
+
+    std::vector<std::string> allowed = algorithm_names<Hypergraph>();
+    TCLAP::ValuesConstraint<std::string> allowedAlgorithms(allowed);
+    TCLAP::UnlabeledValueArg<std::string>
+        algorithmArg("algorithm", "Algorithm to use", true, "", &allowedAlgorithms, cmd);
+
+    QueryFlags flags(cmd);
+
+    std::vector<std::string> args = {"query"};
+    std::istringstream tokens(line);
+    std::string token;
+    while (tokens >> token) {
+      args.push_back(token);
+    }
+    cmd.parse(args);
+
+    query = defaults;
+    query.k = kArg.getValue();
+    query.algorithm = algorithmArg.getValue();
+    flags.fill(query);
+    return true;
+  } catch (const TCLAP::ArgException &e) {
+    error = e.error() + " for arg " + e.argId();
+    return false;
+  }
+}
+
+// Writes `s` to `os` as a JSON string
+inline void write_json_string(std::ostream &os, const std::string &s) {
+  os << '"';
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+      os << escaped;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+/**
+ * Runs the queries in `queries`, one per line, on `instance` and writes one JSON object per query to standard out as
+ * each query finishes. Blank lines and lines starting with `#` are skipped. Up to `options.jobs` queries run at once,
+ * and all of them share the instance.
+ *
+ * Returns 0 if every query succeeded, 1 otherwise.
+ */
+template<typename HypergraphType>
+int run_batch(const Instance<HypergraphType> &instance, const Options &options, std::istream &queries) {
+  struct Query {
+    size_t line_number;
+    std::string line;
+    Options options;
+    CutFunc<HypergraphType> func;
+    std::string error;
+  };
+
+  // Queries are checked up front, so that a bad line is reported before anything runs
+  std::vector<Query> batch;
+  std::string line;
+  for (size_t line_number = 1; std::getline(queries, line); ++line_number) {
+    const auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+
+    Query &query = batch.emplace_back(Query{line_number, line, {}, nullptr, {}});
+    if (!read_query(line, options, query.options, query.error)) {
+      continue;
+    }
+    // Anything the queries write other than their results would garble the output
+    query.options.verbosity = 0;
+
+    const auto it = std::find_if(cut_funcs<HypergraphType>.cbegin(),
+                                 cut_funcs<HypergraphType>.cend(),
+                                 [&query](const auto &builder) {
+                                   return builder->name() == query.options.algorithm;
+                                 });
+    if (it == cut_funcs<HypergraphType>.cend()) {
+      query.error = "Unknown algorithm '" + query.options.algorithm + "'";
+      continue;
+    }
+    try {
+      (*it)->check(query.options);
+      query.func = (*it)->build_cached(query.options);
+    } catch (const std::invalid_argument &e) {
+      query.error = e.what();
+    }
+  }
+
+  std::atomic<size_t> next_query = 0;
+  std::atomic<bool> all_succeeded = true;
+  std::mutex output_mutex;
+
+  const auto work = [&]() {
+    for (size_t i = next_query.fetch_add(1); i < batch.size(); i = next_query.fetch_add(1)) {
+      Query &query = batch[i];
+
+      std::ostringstream result;
+      result << std::setprecision(std::numeric_limits<double>::max_digits10);
+      result << "{\"line\": " << query.line_number << ", \"query\": ";
+      write_json_string(result, query.line);
+
+      if (query.func) {
+        try {
+          util::ContractionStats stats{};
+          const auto start = std::chrono::high_resolution_clock::now();
+          auto cut = query.func(instance, stats);
+          const auto stop = std::chrono::high_resolution_clock::now();
+
+          std::string error;
+          const bool valid = cut_is_valid(cut, instance.hypergraph(), query.options.k, error);
+          if (!valid) {
+            all_succeeded = false;
+          }
+
+          result << ", \"k\": " << query.options.k << ", \"algorithm\": ";
+          write_json_string(result, query.options.algorithm);
+          result << ", \"value\": " << cut.value << ", \"valid\": " << (valid ? "true" : "false")
+                 << ", \"time_ms\": " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+                 << ", \"stats\": {\"num_contractions\": " << stats.num_contractions
+                 << ", \"time_elapsed_ms\": " << stats.time_elapsed_ms
+                 << ", \"num_runs\": " << stats.num_runs
+                 << ", \"peak_memory_bytes\": " << stats.peak_memory_bytes << "}, \"partitions\": [";
+          for (size_t p = 0; p < cut.partitions.size(); ++p) {
+            auto &partition = cut.partitions[p];
+            std::sort(std::begin(partition), std::end(partition));
+            result << (p == 0 ? "[" : ", [");
+            for (size_t j = 0; j < partition.size(); ++j) {
+              result << (j == 0 ? "" : ", ") << partition[j];
+            }
+            result << "]";
+          }
+          result << "]";
+        } catch (const std::exception &e) {
+          query.error = e.what();
+        }
+      }
+
+      if (!query.error.empty()) {
+        all_succeeded = false;
+        result << ", \"error\": ";
+        write_json_string(result, query.error);
+      }
+      result << "}\n";
+
+      std::lock_guard lock(output_mutex);
+      std::cout << result.str() << std::flush;
+    }
+  };
+
+  size_t num_jobs = options.jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : options.jobs;
+  num_jobs = std::max<size_t>(std::min(num_jobs, batch.size()), 1);
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < num_jobs; ++t) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  return all_succeeded ? 0 : 1;
+}
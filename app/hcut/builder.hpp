@@ -1,7 +1,12 @@
 #pragma once
 
+#include <iostream>
+#include <memory>
+#include <mutex>
+
 #include <hypergraph/kk.hpp>
 #include <hypergraph/approx.hpp>
+#include <hypergraph/cache.hpp>
 #include <hypergraph/cxy.hpp>
 #include <hypergraph/fpz.hpp>
 
@@ -17,18 +22,69 @@ struct Options {
   // These options are for contraction algorithms
   std::optional<size_t> runs; // Number of runs to repeat contraction algo for
   std::optional<double> discover; // Discovery value
+  size_t threads = 1; // Number of threads to spread runs over, 0 for one per hardware thread
+  std::optional<size_t> memory_limit; // Bytes that the search should stay within
   uint32_t random_seed = 0;
   uint8_t verbosity = 2; // Verbose output
+
+  // These options are for batch mode
+  std::optional<std::string> batch; // File to read queries from, "-" for stdin
+  size_t jobs = 0; // Number of queries to run at once, 0 for one per hardware thread
+
+  std::optional<std::filesystem::path> cache; // Directory of cached cuts of exact algorithms
+  bool coalesce = false; // Merge hyperedges with the same vertices into one weighted hyperedge on load
+
+  // These options are for farming the runs of contraction algorithms out to other processes
+  std::optional<uint16_t> coordinator; // Port to hand out runs on
+  std::optional<std::string> worker; // <host>:<port> of the coordinator to do runs for
+};
+
+/**
+ * The hypergraph that cut functions run on, along with its k-trimmed certificates. The certificates are built the
+ * first time a cut function asks for them. Cut functions only read the instance, so any number of them can run on it
+ * at once and share the certificates.
+ */
+template<typename HypergraphType>
+class Instance {
+public:
+  explicit Instance(HypergraphType hypergraph) : hypergraph_(std::move(hypergraph)) {}
+
+  const HypergraphType &hypergraph() const { return hypergraph_; }
+
+  std::shared_ptr<const certificate_t<HypergraphType>> certificates() const {
+    std::call_once(certificates_built_, [this] {
+      certificates_ = std::make_shared<const certificate_t<HypergraphType>>(hypergraph_);
+    });
+    return certificates_;
+  }
+
+private:
+  const HypergraphType hypergraph_;
+  mutable std::once_flag certificates_built_;
+  mutable std::shared_ptr<const certificate_t<HypergraphType>> certificates_;
 };
 
 /**
  * A hypergraph cut function with all of the necessary arguments baked in except for the hypergraph. So this may be a
  * k-cut function where k > 2, or an approximation algorithm
  *
- * It takes in a reference to a hypergraph (so it may modify the hypergraph!) and returns a cut with partitions
+ * It takes in the instance to cut, which it does not modify, and returns a cut with partitions. Contraction algorithms
+ * also fill in the stats of their runs.
+ */
+template<typename HypergraphType>
+using CutFunc = std::function<HypergraphCut<typename HypergraphType::EdgeWeight>(const Instance<HypergraphType> &,
+                                                                                util::ContractionStats &)>;
+
+/**
+ * Does the runs of a contraction algorithm within `budget`, from a random generator seeded with `seed`. This lets
+ * the runs of one search be split between several processes.
  */
 template<typename HypergraphType>
-using CutFunc = std::function<HypergraphCut<typename HypergraphType::EdgeWeight>(HypergraphType &)>;
+using RunsFunc = std::function<HypergraphCut<typename HypergraphType::EdgeWeight>(
+    const Instance<HypergraphType> &,
+    uint64_t seed,
+    const util::Budget<typename HypergraphType::EdgeWeight> &,
+    util::ContractionStats &)>;
 
 template<typename HypergraphType>
 struct CutFuncBuilder {
@@ -41,6 +97,36 @@ struct CutFuncBuilder {
 
   virtual CutFunc<HypergraphType> build(const Options &options) = 0;
 
+  // Whether the algorithm always finds the same minimum cut, so that its cuts can be cached
+  virtual bool exact() const { return false; }
+
+  /// For contraction algorithms, does the given runs. Empty for the other algorithms, whose work cannot be split.
+  virtual RunsFunc<HypergraphType> build_runs(const Options &) { return nullptr; }
+
+  /// The number of runs a contraction algorithm does unless told otherwise
+  virtual size_t default_num_runs(const HypergraphType &, size_t) const { return 1; }
+
+  /// Like build, but if options.cache is set and the algorithm is exact, the cut is looked up in the cache first and
+  /// stored there when it is not
+  CutFunc<HypergraphType> build_cached(const Options &options) {
+    CutFunc<HypergraphType> func = build(options);
+    if (!options.cache || !exact()) {
+      return func;
+    }
+    return [func, cache = CutCache(options.cache.value()), name = name_, k = options.k](
+        const Instance<HypergraphType> &instance,
+        util::ContractionStats &stats) {
+      if (auto cut = cache.find(instance.hypergraph(), name, k)) {
+        return std::move(cut.value());
+      }
+      auto cut = func(instance, stats);
+      if (!cache.store(instance.hypergraph(), name, k, cut)) {
+        std::cerr << "Failed to cache the cut in " << cache.directory() << std::endl;
+      }
+      return cut;
+    };
+  }
+
   virtual ~CutFuncBuilder() = default;
 
   explicit CutFuncBuilder(std::string name) : name_(std::move(name)) {}
@@ -64,37 +150,65 @@ struct ContractionFuncBuilder : CutFuncBuilder<HypergraphType> {
 
   CutFunc<HypergraphType> build(const Options &options) override {
     if (options.verbosity == 0) {
-      return [options](HypergraphType &h) {
-        util::ContractionStats stats;
-        return util::repeat_contraction<HypergraphType, ContractImpl, true, 0>(h,
+      return [options](const Instance<HypergraphType> &instance, util::ContractionStats &stats) {
+        return util::repeat_contraction<HypergraphType, ContractImpl, true, 0>(instance.hypergraph(),
                                                                                options.k,
                                                                                std::mt19937_64(options.random_seed),
                                                                                stats,
                                                                                options.runs,
-                                                                               options.discover);
+                                                                               options.discover,
+                                                                               std::nullopt,
+                                                                               options.threads,
+                                                                               options.memory_limit);
       };
     } else if (options.verbosity == 1) {
-      return [options](HypergraphType &h) {
-        util::ContractionStats stats;
-        return util::repeat_contraction<HypergraphType, ContractImpl, true, 1>(h,
+      return [options](const Instance<HypergraphType> &instance, util::ContractionStats &stats) {
+        return util::repeat_contraction<HypergraphType, ContractImpl, true, 1>(instance.hypergraph(),
                                                                                options.k,
                                                                                std::mt19937_64(options.random_seed),
                                                                                stats,
                                                                                options.runs,
-                                                                               options.discover);
+                                                                               options.discover,
+                                                                               std::nullopt,
+                                                                               options.threads,
+                                                                               options.memory_limit);
       };
     } else {
-      return [options](HypergraphType &h) {
-        util::ContractionStats stats;
-        return util::repeat_contraction<HypergraphType, ContractImpl, true, 2>(h,
+      return [options](const Instance<HypergraphType> &instance, util::ContractionStats &stats) {
+        return util::repeat_contraction<HypergraphType, ContractImpl, true, 2>(instance.hypergraph(),
                                                                                options.k,
                                                                                std::mt19937_64(options.random_seed),
                                                                                stats,
                                                                                options.runs,
-                                                                               options.discover);
+                                                                               options.discover,
+                                                                               std::nullopt,
+                                                                               options.threads,
+                                                                               options.memory_limit);
       };
     }
   }
+
+  RunsFunc<HypergraphType> build_runs(const Options &options) override {
+    return [k = options.k, threads = options.threads, memory_limit = options.memory_limit](
+        const Instance<HypergraphType> &instance,
+        const uint64_t seed,
+        const util::Budget<typename HypergraphType::EdgeWeight> &budget,
+        util::ContractionStats &stats) {
+      // Like the number of threads, the memory limit is up to the process doing the runs
+      auto limited = budget;
+      limited.memory_limit = memory_limit;
+      return ContractImpl::template anytime_minimum_cut<HypergraphType>(instance.hypergraph(),
+                                                                        k,
+                                                                        limited,
+                                                                        stats,
+                                                                        seed,
+                                                                        threads);
+    };
+  }
+
+  size_t default_num_runs(const HypergraphType &hypergraph, const size_t k) const override {
+    return ContractImpl::default_num_runs(hypergraph, k);
+  }
 };
 
 template<typename HypergraphType, ordering_t<HypergraphType> Ordering>
@@ -117,8 +231,12 @@ struct OrderingBasedMinCutFuncBuilder : CutFuncBuilder<HypergraphType> {
     // TODO random_seed, verbosity
   }
 
+  bool exact() const override { return true; }
+
   CutFunc<HypergraphType> build(const Options &options) override {
-    return [](HypergraphType &hypergraph) {
+    return [](const Instance<HypergraphType> &instance, util::ContractionStats &) {
+      // The phases contract the hypergraph, so they run on a copy
+      HypergraphType hypergraph(instance.hypergraph());
       return vertex_ordering_mincut<HypergraphType, Ordering, true>(hypergraph);
     };
   }
@@ -144,9 +262,16 @@ struct CXMinCutBuilder : CutFuncBuilder<HypergraphType> {
 // TODO random_seed, verbosity
   }
 
+  bool exact() const override { return true; }
+
   CutFunc<HypergraphType> build(const Options &options) override {
-    return [options](HypergraphType &hypergraph) {
-      return certificate_minimum_cut<HypergraphType, true>(hypergraph, MW_min_cut<HypergraphType>);
+    return [](const Instance<HypergraphType> &instance, util::ContractionStats &) {
+      if constexpr (is_weighted<HypergraphType>) {
+        return certificate_minimum_cut<HypergraphType, true>(*instance.certificates(), MW_min_cut<HypergraphType>);
+      } else {
+        return certificate_minimum_cut<HypergraphType, true>(IncrementalCertificate(instance.certificates()),
+                                                             MW_min_cut<HypergraphType>);
+      }
     };
   }
 };
@@ -172,12 +297,43 @@ struct ApproxMinCutBuilder : CutFuncBuilder<HypergraphType> {
 
   CutFunc<HypergraphType> build(const Options &options) override {
     const double epsilon = options.epsilon.value();
-    return [epsilon](HypergraphType &hypergraph) {
+    return [epsilon](const Instance<HypergraphType> &instance, util::ContractionStats &) {
+      HypergraphType hypergraph(instance.hypergraph());
       return Func(hypergraph, epsilon);
     };
   }
 };
 
+// apxCertCX, using the certificates shared by everything that runs on the instance
+template<typename HypergraphType, auto MinCutFunc>
+struct ApproxCertificateMinCutBuilder : CutFuncBuilder<HypergraphType> {
+  using CutFuncBuilder<HypergraphType>::CutFuncBuilder;
+
+  void check(const Options &options) override {
+    if (options.k != 2) {
+      throw std::invalid_argument("k must be 2");
+    }
+    if (!options.epsilon) {
+      throw std::invalid_argument("epsilon required");
+    }
+    if (options.runs) {
+      throw std::invalid_argument("runs option not valid");
+    }
+    if (options.discover) {
+      throw std::invalid_argument("discovery option not valid");
+    }
+  }
+
+  bool exact() const override { return true; }
+
+  CutFunc<HypergraphType> build(const Options &options) override {
+    const double epsilon = options.epsilon.value();
+    return [epsilon](const Instance<HypergraphType> &instance, util::ContractionStats &) {
+      return apxCertCX_with_certificates<MinCutFunc>(instance.hypergraph(), *instance.certificates(), epsilon);
+    };
+  }
+};
+
 template<typename HypergraphType>
 const std::vector<typename CutFuncBuilder<HypergraphType>::Ptr> cut_funcs = {
     std::make_shared<ContractionFuncBuilder<HypergraphType, cxy>>("CXY"),
@@ -186,23 +342,7 @@ const std::vector<typename CutFuncBuilder<HypergraphType>::Ptr> cut_funcs = {
     std::make_shared<OrderingBasedMinCutFuncBuilder<HypergraphType, tight_ordering>>("MW"),
     std::make_shared<OrderingBasedMinCutFuncBuilder<HypergraphType, queyranne_ordering>>("Q"),
     std::make_shared<OrderingBasedMinCutFuncBuilder<HypergraphType, maximum_adjacency_ordering>>("KW"),
-    std::make_shared<ApproxMinCutBuilder<HypergraphType, approximate_minimizer<HypergraphType>>>("apxCX")
+    std::make_shared<ApproxMinCutBuilder<HypergraphType, approximate_minimizer<HypergraphType>>>("apxCX"),
+    std::make_shared<CXMinCutBuilder<HypergraphType>>("CX"),
+    std::make_shared<ApproxCertificateMinCutBuilder<HypergraphType, MW_min_cut<HypergraphType>>>("apxCertCX")
 };
-
-// Specialization: certificates are not supported by weighted hypergraphs yet
-// TODO there should probably some kind of warning if someone tries to run CX on a weighted hypergraph
-template<>
-const std::vector<typename CutFuncBuilder<Hypergraph>::Ptr> cut_funcs<Hypergraph> = {
-    std::make_shared<ContractionFuncBuilder<Hypergraph, cxy>>("CXY"),
-    std::make_shared<ContractionFuncBuilder<Hypergraph, fpz>>("FPZ"),
-    std::make_shared<ContractionFuncBuilder<Hypergraph, kk>>("KK"),
-    std::make_shared<OrderingBasedMinCutFuncBuilder<Hypergraph, tight_ordering>>("MW"),
-    std::make_shared<OrderingBasedMinCutFuncBuilder<Hypergraph, queyranne_ordering>>("Q"),
-    std::make_shared<OrderingBasedMinCutFuncBuilder<Hypergraph, maximum_adjacency_ordering>>("KW"),
-    std::make_shared<ApproxMinCutBuilder<Hypergraph, approximate_minimizer<Hypergraph>>>("apxCX"),
-
-    std::make_shared<CXMinCutBuilder<Hypergraph>>("CX"),
-    std::make_shared<ApproxMinCutBuilder<Hypergraph, apxCertCX<MW_min_cut<Hypergraph>>>>("apxCertCX")
-};
-
-
@@ -0,0 +1,588 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define HCUT_HAVE_SOCKETS
+#endif
+
+#include "builder.hpp"
+
+/**
+ * Farming the runs of a contraction algorithm out to worker processes, which may be on other machines.
+ *
+ * The coordinator splits the runs into blocks and hands a block to each worker that asks for one. Block i is seeded
+ * with the i-th number drawn from a generator seeded with the seed of the search, the way the threads of a search are
+ * seeded. A block whose worker goes away is handed to the next worker.
+ *
+ * Workers report each improvement as soon as they find it, and the coordinator passes the best value on to every
+ * worker, where FPZ prunes the branches that cannot beat it. Once a cut with the discovery value has been found, every
+ * worker stops its block and the search ends. Since what a block prunes and when it stops depend on the values other
+ * blocks have found by then, the cut that is found depends on the timing of the workers as well as on the seed.
+ *
+ * Everything is sent over TCP as lines of text:
+ *
+ *   coordinator to worker:  task <k> <algorithm> <coalesce> <discovery value or -> <path>
+ *                           block <id> <seed> <number of runs>
+ *                           bound <value>
+ *                           stop
+ *   worker to coordinator:  improved <block id> <value>
+ *                           done <block id> <runs> <contractions> <value> <number of partitions> (<size> <vertices>)*
+ *
+ * Workers read the hypergraph from the path they are given, so it has to be on a file system they share with the
+ * coordinator.
+ */
+namespace distributed {
+
+// At most this many blocks, so that the blocks of long searches are not too small
+constexpr size_t kMaxBlocks = 1024;
+
+struct Block {
+  size_t id;
+  uint64_t seed;
+  size_t num_runs;
+};
+
+/**
+ * Splits `num_runs` runs into blocks and seeds them from `seed`.
+ */
+inline std::vector<Block> make_blocks(const size_t num_runs, const uint32_t seed) {
+  std::mt19937_64 random_generator(seed);
+  const size_t block_size = std::max<size_t>((num_runs + kMaxBlocks - 1) / kMaxBlocks, 1);
+  std::vector<Block> blocks;
+  for (size_t first = 0; first < num_runs; first += block_size) {
+    blocks.push_back({blocks.size(), random_generator(), std::min(block_size, num_runs - first)});
+  }
+  return blocks;
+}
+
+/**
+ * A TCP connection that sends and receives lines. Lines can be sent from several threads at once.
+ */
+class Connection {
+public:
+  explicit Connection(const int fd) : fd_(fd) {}
+
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  ~Connection() {
+#ifdef HCUT_HAVE_SOCKETS
+    ::close(fd_);
+#endif
+  }
+
+  /**
+   * Connects to `<host>:<port>`. Throws std::runtime_error on failure.
+   */
+  static std::unique_ptr<Connection> connect(const std::string &address) {
+#ifdef HCUT_HAVE_SOCKETS
+    const auto colon = address.rfind(':');
+    if (colon == std::string::npos) {
+      throw std::runtime_error("expected <host>:<port>, got " + address);
+    }
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+      throw std::runtime_error("could not resolve " + address);
+    }
+    int fd = -1;
+    for (const addrinfo *it = addresses; it != nullptr && fd == -1; it = it->ai_next) {
+      fd = ::socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+      if (fd != -1 && ::connect(fd, it->ai_addr, it->ai_addrlen) != 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    ::freeaddrinfo(addresses);
+    if (fd == -1) {
+      throw std::runtime_error("could not connect to " + address);
+    }
+    return std::make_unique<Connection>(fd);
+#else
+    throw std::runtime_error("distributed runs need POSIX sockets");
+#endif
+  }
+
+  /**
+   * Sends a line, without its newline. Returns false if the other end has gone away.
+   */
+  bool send(const std::string &line) {
+#ifdef HCUT_HAVE_SOCKETS
+    const std::string message = line + "\n";
+    std::lock_guard lock(send_mutex_);
+    for (size_t sent = 0; sent < message.size();) {
+#ifdef MSG_NOSIGNAL
+      const ssize_t n = ::send(fd_, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+#else
+      const ssize_t n = ::send(fd_, message.data() + sent, message.size() - sent, 0);
+#endif
+      if (n <= 0) {
+        return false;
+      }
+      sent += static_cast<size_t>(n);
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Receives the next line, without its newline. Returns false once the other end has closed the connection. Must
+   * only be called from one thread at a time.
+   */
+  bool receive(std::string &line) {
+#ifdef HCUT_HAVE_SOCKETS
+    while (true) {
+      if (const auto newline = buffer_.find('\n'); newline != std::string::npos) {
+        line = buffer_.substr(0, newline);
+        buffer_.erase(0, newline + 1);
+        return true;
+      }
+      char chunk[4096];
+      const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        return false;
+      }
+      buffer_.append(chunk, static_cast<size_t>(n));
+    }
+#else
+    return false;
+#endif
+  }
+
+private:
+  const int fd_;
+  std::mutex send_mutex_;
+  // Received but not yet returned
+  std::string buffer_;
+};
+
+/**
+ * A TCP socket that workers connect to.
+ */
+class Listener {
+public:
+  /**
+   * Listens on `port` on every interface, or on a free port if it is 0. Throws std::runtime_error on failure.
+   */
+  explicit Listener(const uint16_t port) {
+#ifdef HCUT_HAVE_SOCKETS
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int yes = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (fd_ == -1 || ::bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || ::listen(fd_, SOMAXCONN) != 0
+        || ::getsockname(fd_, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+      if (fd_ != -1) {
+        ::close(fd_);
+      }
+      throw std::runtime_error("could not listen on port " + std::to_string(port));
+    }
+    port_ = ntohs(address.sin_port);
+#else
+    throw std::runtime_error("distributed runs need POSIX sockets");
+#endif
+  }
+
+  Listener(const Listener &) = delete;
+  Listener &operator=(const Listener &) = delete;
+
+  ~Listener() {
+#ifdef HCUT_HAVE_SOCKETS
+    ::close(fd_);
+#endif
+  }
+
+  uint16_t port() const { return port_; }
+
+  /**
+   * Waits up to `timeout` for a worker to connect. Empty if none did.
+   */
+  std::unique_ptr<Connection> accept(const std::chrono::milliseconds timeout) {
+#ifdef HCUT_HAVE_SOCKETS
+    pollfd request{fd_, POLLIN, 0};
+    if (::poll(&request, 1, static_cast<int>(timeout.count())) <= 0) {
+      return nullptr;
+    }
+    const int fd = ::accept(fd_, nullptr, nullptr);
+    if (fd == -1) {
+      return nullptr;
+    }
+    return std::make_unique<Connection>(fd);
+#else
+    return nullptr;
+#endif
+  }
+
+private:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+};
+
+// Numbers are written with enough digits to be read back exactly
+inline std::ostringstream message() {
+  std::ostringstream stream;
+  stream.precision(std::numeric_limits<double>::max_digits10);
+  return stream;
+}
+
+template<typename EdgeWeight>
+void write_cut(std::ostream &os, const HypergraphCut<EdgeWeight> &cut) {
+  os << cut.value << " " << cut.partitions.size();
+  for (const auto &partition : cut.partitions) {
+    os << " " << partition.size();
+    for (const int v : partition) {
+      os << " " << v;
+    }
+  }
+}
+
+template<typename EdgeWeight>
+bool read_cut(std::istream &is, HypergraphCut<EdgeWeight> &cut) {
+  size_t num_partitions = 0;
+  if (!(is >> cut.value >> num_partitions)) {
+    return false;
+  }
+  cut.partitions.resize(num_partitions);
+  for (auto &partition : cut.partitions) {
+    size_t size = 0;
+    if (!(is >> size)) {
+      return false;
+    }
+    partition.resize(size);
+    for (auto &v : partition) {
+      if (!(is >> v)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Does `num_runs` runs of the contraction algorithm in `options` on the workers that connect to `options.coordinator`,
+ * and returns the best cut they found. The stats are summed over the workers.
+ *
+ * Throws std::runtime_error if it cannot listen for workers.
+ */
+template<typename HypergraphType>
+HypergraphCut<typename HypergraphType::EdgeWeight> coordinate(const Options &options,
+                                                              const size_t num_runs,
+                                                              util::ContractionStats &stats) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+  const auto discovery_value = static_cast<EdgeWeight>(options.discover.value_or(0));
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<Block> pending;
+  const std::vector<Block> blocks = make_blocks(num_runs, options.random_seed);
+  pending.assign(std::begin(blocks), std::end(blocks));
+  size_t num_finished = 0;
+  size_t num_running = 0;
+  // Set once a cut with the discovery value has been found, or every block is done
+  bool stopping = false;
+  auto best = HypergraphCut<EdgeWeight>::max();
+  EdgeWeight bound = best.value;
+  std::vector<std::shared_ptr<Connection>> connections;
+
+  const auto finished = [&] { return num_finished == blocks.size() || (stopping && num_running == 0); };
+
+  const auto broadcast = [&](const std::string &line) {
+    std::vector<std::shared_ptr<Connection>> recipients;
+    {
+      std::lock_guard lock(mutex);
+      recipients = connections;
+    }
+    for (const auto &connection : recipients) {
+      connection->send(line);
+    }
+  };
+
+  auto task = message();
+  task << "task " << options.k << " " << options.algorithm << " " << options.coalesce << " ";
+  if (options.discover) {
+    task << options.discover.value();
+  } else {
+    task << "-";
+  }
+  task << " " << std::filesystem::absolute(options.filename).string();
+
+  // Hands blocks to one worker until there are none left
+  const auto serve = [&](const std::shared_ptr<Connection> &connection) {
+    if (!connection->send(task.str())) {
+      return;
+    }
+    while (true) {
+      Block block{};
+      {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (stopping) {
+          break;
+        }
+        block = pending.front();
+        pending.pop_front();
+        ++num_running;
+      }
+
+      bool done = false;
+      auto request = message();
+      request << "block " << block.id << " " << block.seed << " " << block.num_runs;
+      std::string line;
+      if (connection->send(request.str())) {
+        while (!done && connection->receive(line)) {
+          std::istringstream reply(line);
+          std::string kind;
+          size_t id = 0;
+          reply >> kind >> id;
+          if (kind == "improved") {
+            EdgeWeight value{};
+            reply >> value;
+            bool improved = false;
+            {
+              std::lock_guard lock(mutex);
+              if (value < bound) {
+                bound = value;
+                improved = true;
+                if (bound <= discovery_value) {
+                  stopping = true;
+                }
+              }
+            }
+            if (improved) {
+              auto update = message();
+              update << "bound " << value;
+              broadcast(update.str());
+              if (options.verbosity >= 1) {
+                std::cout << "Block " << id << " found a cut of value " << value << std::endl;
+              }
+            }
+          } else if (kind == "done") {
+            util::ContractionStats block_stats{};
+            HypergraphCut<EdgeWeight> cut(0);
+            if (!(reply >> block_stats.num_runs >> block_stats.num_contractions) || !read_cut(reply, cut)) {
+              break;
+            }
+            std::lock_guard lock(mutex);
+            best = std::min(best, cut);
+            bound = std::min(bound, best.value);
+            if (best.value <= discovery_value) {
+              stopping = true;
+            }
+            stats.num_runs += block_stats.num_runs;
+            stats.num_contractions += block_stats.num_contractions;
+            ++num_finished;
+            done = true;
+          }
+        }
+      }
+
+      std::lock_guard lock(mutex);
+      --num_running;
+      if (!done) {
+        // The worker went away, so another worker does the block
+        if (!stopping) {
+          pending.push_front(block);
+        }
+        changed.notify_all();
+        return;
+      }
+      if (num_finished == blocks.size()) {
+        stopping = true;
+      }
+      changed.notify_all();
+    }
+    connection->send("stop");
+  };
+
+  Listener listener(options.coordinator.value());
+  std::cout << "Handing out " << num_runs << " runs in " << blocks.size() << " blocks on port " << listener.port()
+            << std::endl;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> servers;
+  while (true) {
+    {
+      std::lock_guard lock(mutex);
+      if (finished()) {
+        stopping = true;
+        changed.notify_all();
+        break;
+      }
+    }
+    if (auto connection = listener.accept(std::chrono::milliseconds(100))) {
+      std::shared_ptr<Connection> shared = std::move(connection);
+      {
+        std::lock_guard lock(mutex);
+        connections.push_back(shared);
+      }
+      if (options.verbosity >= 1) {
+        std::cout << "Worker " << servers.size() + 1 << " connected" << std::endl;
+      }
+      servers.emplace_back(serve, shared);
+    }
+
+    bool stop_workers = false;
+    {
+      std::lock_guard lock(mutex);
+      stop_workers = stopping && num_running > 0;
+    }
+    if (stop_workers) {
+      // Cut the blocks that are still running short
+      broadcast("stop");
+    }
+  }
+  for (auto &server : servers) {
+    server.join();
+  }
+  const auto stop = std::chrono::high_resolution_clock::now();
+  stats.time_elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+  return best;
+}
+
+/**
+ * Does the blocks that the coordinator on `connection` hands out with `runs`, until it says to stop.
+ */
+template<typename HypergraphType>
+void work(Connection &connection,
+          const Instance<HypergraphType> &instance,
+          const Options &options,
+          const RunsFunc<HypergraphType> &runs) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+  const auto discovery_value = static_cast<EdgeWeight>(options.discover.value_or(0));
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<Block> blocks;
+  bool stopped = false;
+  std::atomic<bool> cancelled = false;
+  // The best value found by any worker
+  std::atomic<EdgeWeight> bound = std::numeric_limits<EdgeWeight>::max();
+
+  std::thread reader([&] {
+    std::string line;
+    while (connection.receive(line)) {
+      std::istringstream request(line);
+      std::string kind;
+      request >> kind;
+      if (kind == "block") {
+        Block block{};
+        request >> block.id >> block.seed >> block.num_runs;
+        std::lock_guard lock(mutex);
+        blocks.push_back(block);
+        changed.notify_all();
+      } else if (kind == "bound") {
+        EdgeWeight value{};
+        request >> value;
+        util::update_minimum(bound, value);
+        if (value <= discovery_value) {
+          cancelled = true;
+        }
+      } else if (kind == "stop") {
+        break;
+      }
+    }
+    // Also stop if the coordinator went away
+    cancelled = true;
+    std::lock_guard lock(mutex);
+    stopped = true;
+    changed.notify_all();
+  });
+
+  while (true) {
+    Block block{};
+    {
+      std::unique_lock lock(mutex);
+      changed.wait(lock, [&] { return stopped || !blocks.empty(); });
+      if (blocks.empty()) {
+        break;
+      }
+      block = blocks.front();
+      blocks.pop_front();
+    }
+
+    util::Budget<EdgeWeight> budget;
+    budget.max_num_runs = block.num_runs;
+    budget.discovery_value = discovery_value;
+    budget.cancelled = &cancelled;
+    budget.bound = &bound;
+    budget.on_improvement = [&](const util::Improvement<EdgeWeight> &improvement) {
+      // Values that another worker has already beaten would not change the bound
+      if (improvement.value < bound.load()) {
+        util::update_minimum(bound, improvement.value);
+        auto update = message();
+        update << "improved " << block.id << " " << improvement.value;
+        connection.send(update.str());
+      }
+    };
+
+    util::ContractionStats stats{};
+    const auto cut = runs(instance, block.seed, budget, stats);
+    auto reply = message();
+    reply << "done " << block.id << " " << stats.num_runs << " " << stats.num_contractions << " ";
+    write_cut(reply, cut);
+    connection.send(reply.str());
+    if (options.verbosity >= 1) {
+      std::cout << "Did " << stats.num_runs << " runs of block " << block.id << ", got " << cut.value << std::endl;
+    }
+  }
+  reader.join();
+}
+
+/**
+ * Receives the task of a worker from the coordinator on `connection`, and fills in the options it sets. Throws
+ * std::runtime_error if the coordinator sends anything else.
+ */
+inline void receive_task(Connection &connection, Options &options) {
+  std::string line;
+  if (!connection.receive(line)) {
+    throw std::runtime_error("the coordinator closed the connection");
+  }
+  std::istringstream task(line);
+  std::string kind;
+  std::string discover;
+  if (!(task >> kind >> options.k >> options.algorithm >> options.coalesce >> discover) || kind != "task") {
+    throw std::runtime_error("expected a task from the coordinator, got '" + line + "'");
+  }
+  options.discover.reset();
+  if (discover != "-") {
+    options.discover = std::stod(discover);
+  }
+  std::getline(task >> std::ws, options.filename);
+}
+
+}
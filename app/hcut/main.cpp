@@ -8,76 +8,133 @@
 #include <tclap/CmdLine.h>
 
 #include <hypergraph/hypergraph.hpp>
+#include <hypergraph/io.hpp>
 #include <hypergraph/certificate.hpp>
 #include <hypergraph/order.hpp>
 
+#include "batch.hpp"
 #include "builder.hpp"
+#include "distributed.hpp"
 
 /**
  * Parses command line arguments. Returns false on failure, true otherwise.
  *
+ * In batch mode the queries come from a file, so k and the algorithm are not given on the command line. A worker gets
+ * the hypergraph, k and the algorithm from its coordinator, so none of them are given on the command line.
+ *
  * @param argc
  * @param argv
  * @param options
  * @return
  */
 bool read_options(int argc, char **argv, Options &options) {
+  // TCLAP cannot make arguments depend on one another, so look for the batch flag before setting up the arguments
+  const bool batch = std::any_of(argv + 1, argv + argc, [](const std::string &arg) {
+    return arg == "-b" || arg == "--batch" || arg.rfind("--batch=", 0) == 0;
+  });
+  const bool worker = std::any_of(argv + 1, argv + argc, [](const std::string &arg) {
+    return arg == "-w" || arg == "--worker" || arg.rfind("--worker=", 0) == 0;
+  });
+
   try {
     TCLAP::CmdLine cmd("Hypergraph cut tool", ' ', "0.1");
 
-    TCLAP::UnlabeledValueArg<std::string>
-        filenameArg("filename", "Filename for the input hypergraph", true, "", "A file path", cmd);
-
-    TCLAP::UnlabeledValueArg<size_t> kArg("k", "Compute the k-cut", true, 0, "An integer greater than 1", cmd);
+    std::optional<TCLAP::UnlabeledValueArg<std::string>> filenameArg;
+    if (!worker) {
+      filenameArg.emplace("filename", "Filename for the input hypergraph", true, "", "A file path", cmd);
+    }
 
     // Only allow names in the string_to_algorithm map
-    std::vector<std::string> allowed;
-    for (const auto &builder : cut_funcs<Hypergraph>) {
-      allowed.emplace_back(builder->name());
-    }
+    std::vector<std::string> allowed = algorithm_names<Hypergraph>();
     TCLAP::ValuesConstraint<std::string> allowedAlgorithms(allowed);
 
-    TCLAP::UnlabeledValueArg<std::string>
-        algorithmArg("algorithm", "Algorithm to use", true, "", &allowedAlgorithms, cmd);
-
-    TCLAP::ValueArg<size_t>
-        numRunsArg("r", "runs", "Number of runs to repeat contraction algorithm", false, 0, "A positive integer", cmd);
-
-    TCLAP::ValueArg<double> epsilonArg("e", "epsilon", "Approximation factor", false, 0.0, "A positive float", cmd);
+    std::optional<TCLAP::UnlabeledValueArg<size_t>> kArg;
+    std::optional<TCLAP::UnlabeledValueArg<std::string>> algorithmArg;
+    if (!batch && !worker) {
+      kArg.emplace("k", "Compute the k-cut", true, 0, "An integer greater than 1", cmd);
+      algorithmArg.emplace("algorithm", "Algorithm to use", true, "", &allowedAlgorithms, cmd);
+    }
 
-    TCLAP::ValueArg<double> discoveryArg("d",
-                                         "discover",
-                                         "Measure time needed to discover a cut with this value",
-                                         false,
-                                         0.0,
-                                         "A non-negative number",
-                                         cmd);
+    QueryFlags flags(cmd);
 
     std::vector<size_t> verbosityLevels = {0, 1, 2};
     TCLAP::ValuesConstraint<size_t> allowedVerbosityLevels(verbosityLevels);
     TCLAP::ValueArg<size_t> verbosityArg("v", "verbosity", "Verbose output", false, 2, &allowedVerbosityLevels, cmd);
 
-    TCLAP::ValueArg<uint32_t>
-        randomSeedArg("s", "seed", "Random seed", false, 0, "Random seed for randomized algorithms", cmd);
+    TCLAP::ValueArg<std::string> batchArg("b",
+                                          "batch",
+                                          "Run the queries in this file ('-' for standard input), one '<k> <algorithm> "
+                                          "[flags]' per line, and print the results as JSON lines",
+                                          false,
+                                          "",
+                                          "A file path",
+                                          cmd);
 
-    cmd.parse(argc, argv);
+    TCLAP::ValueArg<size_t> jobsArg("j",
+                                    "jobs",
+                                    "Number of batch queries to run at once, 0 for all hardware threads",
+                                    false,
+                                    0,
+                                    "A non-negative integer",
+                                    cmd);
 
-    // Fill in options
-    options.algorithm = algorithmArg.getValue();
-    options.filename = filenameArg.getValue();
-    options.k = kArg.getValue();
+    TCLAP::ValueArg<std::string> cacheArg("c",
+                                          "cache",
+                                          "Look up the cuts of exact algorithms in this directory, and store them there",
+                                          false,
+                                          "",
+                                          "A directory path",
+                                          cmd);
 
-    constexpr auto
-        flag_to_optional = [](auto &flag) -> std::optional<std::remove_reference_t<decltype(flag.getValue())>> {
-      return flag.isSet() ? std::make_optional(flag.getValue()) : std::nullopt;
-    };
+    TCLAP::SwitchArg coalesceArg("C",
+                                 "coalesce",
+                                 "Merge hyperedges with the same vertices into one weighted hyperedge on load",
+                                 cmd,
+                                 false);
+
+    TCLAP::ValueArg<uint16_t> coordinatorArg("",
+                                             "coordinator",
+                                             "Hand the runs of a contraction algorithm out to the workers that connect "
+                                             "to this port (0 for any free port)",
+                                             false,
+                                             0,
+                                             "A port",
+                                             cmd);
 
-    options.epsilon = flag_to_optional(epsilonArg);
+    TCLAP::ValueArg<std::string> workerArg("w",
+                                           "worker",
+                                           "Do runs for the coordinator at this address",
+                                           false,
+                                           "",
+                                           "<host>:<port>",
+                                           cmd);
 
-    options.runs = flag_to_optional(numRunsArg);
-    options.discover = flag_to_optional(discoveryArg);
-    options.random_seed = randomSeedArg.getValue(); // TODO make optional
+    cmd.parse(argc, argv);
+
+    // Fill in options
+    if (!worker) {
+      options.filename = filenameArg->getValue();
+    }
+    if (!batch && !worker) {
+      options.algorithm = algorithmArg->getValue();
+      options.k = kArg->getValue();
+    }
+    flags.fill(options);
     options.verbosity = verbosityArg.getValue(); // TODO make optional;
+    if (batchArg.isSet()) {
+      options.batch = batchArg.getValue();
+    }
+    options.jobs = jobsArg.getValue();
+    if (cacheArg.isSet()) {
+      options.cache = cacheArg.getValue();
+    }
+    options.coalesce = coalesceArg.getValue();
+    if (coordinatorArg.isSet()) {
+      options.coordinator = coordinatorArg.getValue();
+    }
+    if (workerArg.isSet()) {
+      options.worker = workerArg.getValue();
+    }
     return true;
   } catch (TCLAP::ArgException &e) {
     std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
@@ -86,23 +143,76 @@ bool read_options(int argc, char **argv, Options &options) {
 }
 
 bool hmetis_file_is_unweighted(const std::string &filename) {
-  std::ifstream input;
-  input.open(filename);
-  return is_unweighted_hmetis_file(input);
+  try {
+    return is_unweighted_hypergraph_file(filename);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
 }
 
 // Attempts to read a hypergraph from a file
 template<typename HypergraphType>
 bool parse_hypergraph(const std::string &filename, HypergraphType &hypergraph) {
-  std::ifstream input;
-  input.open(filename);
-  input >> hypergraph;
+  try {
+    hypergraph = read_hypergraph_file<HypergraphType>(filename);
+    return true;
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
+}
+
+/* Reads the hypergraph that the cut functions run on. Coalescing gives a weighted hypergraph, so the file is read as an
+ * unweighted hypergraph if HypergraphType is WeightedHypergraph<size_t>.
+ */
+template<typename HypergraphType>
+bool load_hypergraph(const Options &options, HypergraphType &hypergraph) {
+  if (is_unweighted<HypergraphType> || !options.coalesce) {
+    return parse_hypergraph(options.filename, hypergraph);
+  }
+  using FileHypergraph = std::conditional_t<std::is_same_v<HypergraphType, WeightedHypergraph<size_t>>,
+                                            Hypergraph,
+                                            HypergraphType>;
+  FileHypergraph read;
+  if (!parse_hypergraph(options.filename, read)) {
+    return false;
+  }
+  if constexpr (is_weighted<HypergraphType>) {
+    hypergraph = coalesce_parallel_edges(read);
+  }
   return true;
 }
 
+// Runs the queries of a batch file
+template<typename HypergraphType>
+int dispatch_batch(const Options &options) {
+  // Results go to standard out, so everything else goes to standard error
+  HypergraphType hypergraph;
+  if (!load_hypergraph(options, hypergraph)) {
+    std::cerr << "Failed to parse hypergraph in " << options.filename << std::endl;
+    return 1;
+  }
+  const Instance<HypergraphType> instance(std::move(hypergraph));
+
+  if (options.batch.value() == "-") {
+    return run_batch(instance, options, std::cin);
+  }
+  std::ifstream queries(options.batch.value());
+  if (!queries) {
+    std::cerr << "Could not open " << options.batch.value() << std::endl;
+    return 1;
+  }
+  return run_batch(instance, options, queries);
+}
+
 // Runs algorithm
 template<typename HypergraphType>
 int dispatch(Options options) {
+  if (options.batch) {
+    return dispatch_batch<HypergraphType>(options);
+  }
+
   // Prepare function
   const auto it = std::find_if(cut_funcs<HypergraphType>.cbegin(),
                                cut_funcs<HypergraphType>.cend(),
@@ -114,11 +224,21 @@ int dispatch(Options options) {
     return 1;
   }
   (*it)->check(options);
-  const auto func = (*it)->build(options);
+  auto func = (*it)->build_cached(options);
+  if (options.coordinator) {
+    if (!(*it)->build_runs(options)) {
+      std::cout << "Only the runs of contraction algorithms can be handed out to workers" << std::endl;
+      return 1;
+    }
+    func = [options, builder = *it](const Instance<HypergraphType> &instance, util::ContractionStats &stats) {
+      const size_t num_runs = options.runs.value_or(builder->default_num_runs(instance.hypergraph(), options.k));
+      return distributed::coordinate<HypergraphType>(options, num_runs, stats);
+    };
+  }
 
   // Read hypergraph
   HypergraphType hypergraph;
-  if (!parse_hypergraph(options.filename, hypergraph)) {
+  if (!load_hypergraph(options, hypergraph)) {
     std::cout << "Failed to parse hypergraph in " << options.filename << std::endl;
     return 1;
   }
@@ -130,12 +250,13 @@ int dispatch(Options options) {
   std::cout << hypergraph.num_vertices() << " vertices and "
             << hypergraph.num_edges() << " edges" << std::endl;
 
-  // To check the results later we need a copy of the hypergraph since the cut function may modify it
-  HypergraphType copy(hypergraph);
+  // The cut function does not modify the instance, so the cut can be checked against it later
+  const Instance<HypergraphType> instance(std::move(hypergraph));
 
   // Run function
+  util::ContractionStats stats;
   const auto start = std::chrono::high_resolution_clock::now();
-  auto cut = func(hypergraph);
+  auto cut = func(instance, stats);
   const auto stop = std::chrono::high_resolution_clock::now();
 
   // Report results
@@ -144,17 +265,48 @@ int dispatch(Options options) {
                 start)
                 .count()
             << " milliseconds\n";
+  if (options.verbosity >= 1) {
+    std::cout << "Runs: " << stats.num_runs << ", contractions: " << stats.num_contractions
+              << ", peak memory: " << stats.peak_memory_bytes << " bytes\n";
+    if constexpr (instrument::enabled) {
+      std::cout << "Counters: " << stats.counters << "\n";
+    }
+  }
   for (auto &partition : cut.partitions) {
     std::sort(std::begin(partition), std::end(partition));
   }
   std::cout << cut;
   std::string error;
-  if (!cut_is_valid(cut, copy, options.k, error)) {
+  if (!cut_is_valid(cut, instance.hypergraph(), options.k, error)) {
     std::cout << "ERROR: CUT IS NOT VALID " << "(" << error << ")" << std::endl;
   }
   return 0;
 }
 
+// Does runs for a coordinator
+template<typename HypergraphType>
+int dispatch_worker(const Options &options, distributed::Connection &connection) {
+  const auto it = std::find_if(cut_funcs<HypergraphType>.cbegin(),
+                               cut_funcs<HypergraphType>.cend(),
+                               [&options](const auto &builder) {
+                                 return builder->name() == options.algorithm;
+                               });
+  const auto runs = it == cut_funcs<HypergraphType>.cend() ? nullptr : (*it)->build_runs(options);
+  if (!runs) {
+    std::cerr << "Cannot do runs of '" << options.algorithm << "'" << std::endl;
+    return 1;
+  }
+
+  HypergraphType hypergraph;
+  if (!load_hypergraph(options, hypergraph)) {
+    std::cerr << "Failed to parse hypergraph in " << options.filename << std::endl;
+    return 1;
+  }
+  const Instance<HypergraphType> instance(std::move(hypergraph));
+  distributed::work(connection, instance, options, runs);
+  return 0;
+}
+
 int main(int argc, char **argv) {
   Options options;
 
@@ -162,7 +314,28 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  std::unique_ptr<distributed::Connection> coordinator;
+  if (options.worker) {
+    try {
+      coordinator = distributed::Connection::connect(options.worker.value());
+      distributed::receive_task(*coordinator, options);
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+    if (hmetis_file_is_unweighted(options.filename)) {
+      if (options.coalesce) {
+        return dispatch_worker<WeightedHypergraph<size_t>>(options, *coordinator);
+      }
+      return dispatch_worker<Hypergraph>(options, *coordinator);
+    }
+    return dispatch_worker<WeightedHypergraph<double>>(options, *coordinator);
+  }
+
   if (hmetis_file_is_unweighted(options.filename)) {
+    if (options.coalesce) {
+      return dispatch<WeightedHypergraph<size_t>>(options);
+    }
     return dispatch<Hypergraph>(options);
   } else {
     return dispatch<WeightedHypergraph<double>>(options);
@@ -0,0 +1,62 @@
+#include "buildinfo.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <hypergraph/instrument.hpp>
+
+// Set by CMake for this file
+#ifndef HEXPERIMENT_COMMIT
+#define HEXPERIMENT_COMMIT "unknown"
+#endif
+#ifndef HEXPERIMENT_COMPILER_FLAGS
+#define HEXPERIMENT_COMPILER_FLAGS "unknown"
+#endif
+
+namespace {
+
+// The value of the first line of a file of "key : value" lines, like those in /proc, whose key starts with `key`.
+// Empty if there is none.
+std::string proc_field(const char *path, const std::string &key) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, key.size(), key) != 0) {
+      continue;
+    }
+    const auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      return {};
+    }
+    const auto begin = line.find_first_not_of(" \t", colon + 1);
+    return begin == std::string::npos ? std::string() : line.substr(begin);
+  }
+  return {};
+}
+
+std::string hardware_fingerprint() {
+  std::ostringstream out;
+  const std::string cpu = proc_field("/proc/cpuinfo", "model name");
+  out << (cpu.empty() ? "unknown CPU" : cpu) << ", " << std::thread::hardware_concurrency() << " threads";
+  // In kB
+  const std::string memory = proc_field("/proc/meminfo", "MemTotal");
+  if (!memory.empty()) {
+    out << ", " << (std::stoull(memory) + (1 << 19)) / (1 << 20) << " GiB";
+  }
+  return out.str();
+}
+
+}
+
+const BuildInfo &build_info() {
+  static const BuildInfo info = [] {
+    std::string flags = HEXPERIMENT_COMPILER_FLAGS;
+    // The counters slow the algorithms down, so instrumented builds are not comparable with the others
+    if constexpr (hypergraphlib::instrument::enabled) {
+      flags += " -DHYPERGRAPH_INSTRUMENT";
+    }
+    return BuildInfo{HEXPERIMENT_COMMIT, flags, hardware_fingerprint()};
+  }();
+  return info;
+}
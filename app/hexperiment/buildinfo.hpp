@@ -0,0 +1,21 @@
+#ifndef HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_BUILDINFO_HPP
+#define HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_BUILDINFO_HPP
+
+#include <string>
+
+/**
+ * What a run was timed with, recorded with every run so that run times from different builds and machines can be told
+ * apart and compared.
+ */
+struct BuildInfo {
+  std::string commit; // Commit the binary was built from, with "-dirty" if the tree had changes when configured
+  std::string compiler_flags; // Compiler, build type and flags
+  std::string hardware; // CPU model, number of hardware threads and memory of this machine
+};
+
+/**
+ * The build info of this binary on this machine. The commit and flags are recorded when the build is configured.
+ */
+const BuildInfo &build_info();
+
+#endif //HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_BUILDINFO_HPP
@@ -11,6 +11,7 @@
 
 #include <hypergraph/hypergraph.hpp>
 #include <hypergraph/cut.hpp>
+#include <hypergraph/instrument.hpp>
 
 /**
  * Return partitions so that they are sorted by size and lexographic order (and each partition is sorted)
@@ -94,6 +95,9 @@ struct CutRunInfo {
   std::string machine; // ID for machine this was run on
   uint64_t time;
   std::string commit; // Commit this was taken on
+  std::string compiler_flags; // Compiler and flags of the build this was taken with
+  std::string hardware; // Fingerprint of the hardware of the machine
+  hypergraphlib::instrument::Counters counters; // Empty unless built with HYPERGRAPH_INSTRUMENT
 
   inline static std::string csv_header() {
     using namespace std::literals::string_literals;
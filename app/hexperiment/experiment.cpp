@@ -50,9 +50,40 @@ HyGenPtr ring_generator_from_config(const YAML::Node &local_config, const YAML::
   );
 }
 
+HyGenPtr planted_generator_from_config(const YAML::Node &local_config, const YAML::Node &global_config) {
+  FallbackNode config(local_config, global_config);
+  return std::make_unique<PlantedHypergraph>(
+      config["num_vertices"].as<size_t>(),
+      config["m1"].as<size_t>(),
+      config["p1"].as<double>(),
+      config["m2"].as<size_t>(),
+      config["p2"].as<double>(),
+      config["k"].as<size_t>(),
+      config["seed"].as<size_t>()
+  );
+}
+
+HyGenPtr planted_constant_rank_generator_from_config(const YAML::Node &local_config, const YAML::Node &global_config) {
+  FallbackNode config(local_config, global_config);
+  return std::make_unique<UniformPlantedHypergraph>(
+      config["num_vertices"].as<size_t>(),
+      config["k"].as<size_t>(),
+      config["rank"].as<size_t>(),
+      config["m1"].as<size_t>(),
+      config["m2"].as<size_t>(),
+      config["seed"].as<size_t>()
+  );
+}
+
+// The generators take the parameters that hgen takes for the same type of instance
 HyGenPtr generator_from_config(const YAML::Node &local_config, const YAML::Node &global_config) {
-  if (FallbackNode(local_config, global_config)["type"].as<std::string>() == "ring") {
+  const auto type = FallbackNode(local_config, global_config)["type"].as<std::string>();
+  if (type == "ring") {
     return ring_generator_from_config(local_config, global_config);
+  } else if (type == "planted") {
+    return planted_generator_from_config(local_config, global_config);
+  } else if (type == "planted_constant_rank") {
+    return planted_constant_rank_generator_from_config(local_config, global_config);
   } else {
     throw NoSuchHypergraphType{};
   }
@@ -1,4 +1,5 @@
 #include <filesystem>
+#include <fstream>
 #include <memory>
 #include <cstdlib>
 
@@ -10,17 +11,24 @@
 #include <hypergraph/order.hpp>
 #include <hypergraph/cxy.hpp>
 #include <hypergraph/approx.hpp>
+#include <hypergraph/cache.hpp>
 
 #include "store.hpp"
 #include "runner.hpp"
 #include "experiment.hpp"
+#include "buildinfo.hpp"
+#include "regression.hpp"
 
 using namespace hypergraphlib;
 namespace fs = std::filesystem;
 
 int run_experiment(const fs::path &config_path,
                    const fs::path &output_path = {},
-                   const std::optional<size_t> &num_runs = {});
+                   const std::optional<size_t> &num_runs = {},
+                   const std::optional<size_t> &num_threads = {},
+                   bool resume = false,
+                   const fs::path &baseline_path = {});
+int report_regressions(const fs::path &baseline_path, const fs::path &output_path, const YAML::Node &node);
 int list_sizes(const fs::path &config_path);
 int check_cuts(const fs::path &config_path);
 int check_approx(const fs::path &config_path);
@@ -34,14 +42,20 @@ struct Executor {
   static std::unique_ptr<Executor> factory(bool list_sizes,
                                            bool check_cuts,
                                            bool check_approx,
-                                           const std::optional<size_t> &num_runs);
+                                           const std::optional<size_t> &num_runs,
+                                           const std::optional<size_t> &num_threads,
+                                           bool resume,
+                                           const fs::path &baseline_path);
 };
 
 struct ExperimentExecutor : public Executor {
   std::optional<size_t> num_runs;
+  std::optional<size_t> num_threads;
+  bool resume = false;
+  fs::path baseline_path;
 
   int operator()(const fs::path &config_path, const fs::path &output_path) const override {
-    return run_experiment(config_path, output_path, num_runs);
+    return run_experiment(config_path, output_path, num_runs, num_threads, resume, baseline_path);
   }
 };
 
@@ -67,7 +81,10 @@ struct CheckApproxExecutor : public Executor {
 std::unique_ptr<Executor> Executor::factory(const bool list_sizes,
                                             const bool check_cuts,
                                             const bool check_approx,
-                                            const std::optional<size_t> &num_runs) {
+                                            const std::optional<size_t> &num_runs,
+                                            const std::optional<size_t> &num_threads,
+                                            const bool resume,
+                                            const fs::path &baseline_path) {
   if (list_sizes)
     return std::make_unique<ListSizesExecutor>();
   else if (check_cuts)
@@ -77,6 +94,9 @@ std::unique_ptr<Executor> Executor::factory(const bool list_sizes,
   else {
     auto exec = std::make_unique<ExperimentExecutor>();
     exec->num_runs = num_runs;
+    exec->num_threads = num_threads;
+    exec->resume = resume;
+    exec->baseline_path = baseline_path;
     return exec;
   }
 }
@@ -122,15 +142,37 @@ int main(int argc, char **argv) {
   TCLAP::ValueArg<size_t>
       numRunsArg("n", "runs", "Override number of runs for configs", false, 0, "A positive integer", cmd);
 
+  TCLAP::ValueArg<size_t> numThreadsArg("t",
+                                        "threads",
+                                        "Override number of worker threads for configs (0 for one per core)",
+                                        false,
+                                        1,
+                                        "A non-negative integer",
+                                        cmd);
+
   TCLAP::SwitchArg recursiveArg("r", "recursive", "Run hexperiment for all configs in the tree");
 
   TCLAP::SwitchArg forceArg("f", "force", "Remove any files already in the output path");
 
+  TCLAP::SwitchArg resumeArg("R",
+                             "resume",
+                             "Resume an interrupted experiment in the output path, skipping the runs it already has");
+
+  TCLAP::ValueArg<std::string> baselineArg("B",
+                                           "baseline",
+                                           "Compare the run times with those of an earlier run of the experiment, and "
+                                           "exit with status 2 if an algorithm got significantly slower",
+                                           false,
+                                           "",
+                                           "An output directory or its data.db",
+                                           cmd);
+
   std::vector<TCLAP::Arg *> xor_list = {&destArg, &listSizesArg, &checkCutsArg, &checkApproxArg};
 
   cmd.xorAdd(xor_list);
   cmd.add(recursiveArg);
   cmd.add(forceArg);
+  cmd.add(resumeArg);
 
   cmd.parse(argc, argv);
 
@@ -140,11 +182,15 @@ int main(int argc, char **argv) {
   const auto execute = Executor::factory(listSizesArg.isSet(),
                                          checkCutsArg.isSet(),
                                          checkApproxArg.isSet(),
-                                         numRunsArg.isSet() ? std::make_optional(numRunsArg.getValue()) : std::nullopt);
+                                         numRunsArg.isSet() ? std::make_optional(numRunsArg.getValue()) : std::nullopt,
+                                         numThreadsArg.isSet() ? std::make_optional(numThreadsArg.getValue())
+                                                               : std::nullopt,
+                                         resumeArg.isSet(),
+                                         baselineArg.getValue());
 
   try {
     if (recursiveArg.isSet()) {
-      if (fs::exists(output_path)) {
+      if (fs::exists(output_path) && !resumeArg.isSet()) {
         if (forceArg.isSet()) {
           fs::remove_all(output_path);
         } else {
@@ -155,16 +201,20 @@ int main(int argc, char **argv) {
       }
       recursively_execute(config_path, output_path, *execute);
     } else {
-      (*execute)(config_path, output_path);
+      return (*execute)(config_path, output_path);
     }
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
   }
 }
 
 int run_experiment(const fs::path &config_path,
                    const fs::path &output_path,
-                   const std::optional<size_t> &num_runs) {
+                   const std::optional<size_t> &num_runs,
+                   const std::optional<size_t> &num_threads,
+                   const bool resume,
+                   const fs::path &baseline_path) {
   using namespace std::string_literals;
 
   if (!fs::is_regular_file(config_path)) {
@@ -183,7 +233,9 @@ int run_experiment(const fs::path &config_path,
   }
 
   // Prepare output directory
-  if (fs::exists(output_path)) {
+  if (resume && fs::exists(output_path / "data.db")) {
+    std::cout << "Resuming experiment in " << output_path << std::endl;
+  } else if (fs::exists(output_path)) {
     std::cout << output_path << " already exists. Overwrite? [yN]" << std::endl;
 
     char c;
@@ -199,30 +251,32 @@ int run_experiment(const fs::path &config_path,
 
     fs::remove_all(output_path);
   }
-  if (!fs::create_directories(output_path)) {
+  if (!fs::exists(output_path) && !fs::create_directories(output_path)) {
     std::cerr << "Failed to create output directory '" << output_path << "'" << std::endl;
     return 1;
   }
   fs::path db_path = output_path / "data.db";
 
   // Prepare logger
-  auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(output_path / "log.txt", true);
+  auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(output_path / "log.txt", !resume);
   auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
 
   std::shared_ptr<spdlog::logger> logger(new spdlog::logger("multi_sink", {file_sink, console_sink}));
 
   spdlog::set_default_logger(logger);
 
-  fs::copy_file(config_path, output_path / "config.yaml");
+  fs::copy_file(config_path, output_path / "config.yaml", fs::copy_options::overwrite_existing);
 
-  // Prepare sqlite database
-  auto store = std::make_shared<SqliteStore>();
-  if (!store->open(db_path)) {
+  // Prepare sqlite database, all reports go through a single writer thread
+  auto sqlite_store = std::make_shared<SqliteStore>();
+  if (!sqlite_store->open(db_path)) {
     std::cerr << "Failed to open store" << std::endl;
     return 1;
   }
+  auto store = std::make_shared<BatchingStore>(sqlite_store);
 
   size_t runs = num_runs.has_value() ? num_runs.value() : node["num_runs"].as<size_t>();
+  size_t threads = num_threads.has_value() ? num_threads.value() : node["threads"].as<size_t>(1);
 
   const auto factory = [&](bool cutoff, Experiment &&experiment) -> std::unique_ptr<ExperimentRunner> {
     auto &[name, generators, planted] = experiment;
@@ -234,28 +288,98 @@ int run_experiment(const fs::path &config_path,
                                             runs,
                                             algos,
                                             node["percentages"].as<std::vector<double>>(),
-                                            output_path);
+                                            output_path,
+                                            threads);
     } else {
       return std::make_unique<DiscoveryRunner>(name,
                                                std::move(generators),
                                                store,
                                                planted,
                                                runs,
-                                               algos);
+                                               algos,
+                                               threads);
     }
   };
 
   // Run experiment
   std::unique_ptr<ExperimentRunner> runner = factory(cutoff, std::move(experiment));
+  runner->set_generate_ahead(node["generate_ahead"].as<size_t>(1));
+  const fs::path cache_directory = node["cache"] ? fs::path(node["cache"].as<std::string>())
+                                                      : default_cache_directory();
+  if (!cache_directory.empty()) {
+    runner->set_cut_cache(cache_directory);
+  }
+  const BuildInfo &build = build_info();
+  spdlog::info("Built from {} with {} on {}", build.commit, build.compiler_flags, build.hardware);
   runner->run();
 
   fs::path here = fs::absolute(__FILE__).remove_filename();
 
   std::cout << "Done, writing artifacts to " << output_path << std::endl;
 
+  if (!baseline_path.empty()) {
+    return report_regressions(baseline_path, output_path, node);
+  }
   return 0;
 }
 
+std::string join(const std::set<std::string> &strings, const std::string &separator) {
+  std::string joined;
+  for (const auto &s : strings) {
+    joined += (joined.empty() ? "" : separator) + s;
+  }
+  return joined;
+}
+
+/**
+ * Compare the run times in `output_path` with those in `baseline_path`, log them and write them to `regressions.csv`.
+ * Returns 2 if an algorithm is significantly slower than in the baseline.
+ */
+int report_regressions(const fs::path &baseline_path, const fs::path &output_path, const YAML::Node &node) {
+  const fs::path baseline_db = fs::is_directory(baseline_path) ? baseline_path / "data.db" : baseline_path;
+  const RegressionOptions options = RegressionOptions::from_yaml(node["regression"]);
+
+  // Run times from other machines or builds with other flags say little about the commits
+  const BuildInfo &build = build_info();
+  const RunProvenance baseline = run_provenance(baseline_db);
+  spdlog::info("Comparing with the runs in {}, from commits {}",
+               baseline_db.string(),
+               join(baseline.commits, ", "));
+  if (baseline.hardware.size() != 1 || *std::begin(baseline.hardware) != build.hardware) {
+    spdlog::warn("The baseline was not run on this hardware ({})",
+                 baseline.hardware.empty() ? "not recorded" : join(baseline.hardware, "; "));
+  }
+  if (baseline.compiler_flags.size() != 1 || *std::begin(baseline.compiler_flags) != build.compiler_flags) {
+    spdlog::warn("The baseline was not built with these flags ({})",
+                 baseline.compiler_flags.empty() ? "not recorded" : join(baseline.compiler_flags, "; "));
+  }
+
+  const auto comparisons = compare_with_baseline(baseline_db, output_path / "data.db", options);
+  bool regressed = false;
+  for (const auto &comparison : comparisons) {
+    const auto num_slower = std::count_if(std::begin(comparison.hypergraphs),
+                                          std::end(comparison.hypergraphs),
+                                          [](const auto &hypergraph) { return hypergraph.slower; });
+    if (comparison.regressed) {
+      spdlog::warn("{}: significantly slower on {} of {} hypergraphs, {:.3f}x the median time of the baseline",
+                   comparison.algorithm,
+                   num_slower,
+                   comparison.hypergraphs.size(),
+                   comparison.median_ratio);
+    } else {
+      spdlog::info("{}: no significant slowdown on {} hypergraphs, {:.3f}x the median time of the baseline",
+                   comparison.algorithm,
+                   comparison.hypergraphs.size(),
+                   comparison.median_ratio);
+    }
+    regressed = regressed || comparison.regressed;
+  }
+
+  std::ofstream csv(output_path / "regressions.csv");
+  write_comparisons(csv, comparisons);
+  return regressed ? 2 : 0;
+}
+
 int list_sizes(const fs::path &config_path) {
   Experiment experiment = experiment_from_config_file(config_path);
   for (const auto &gen : experiment.generators) {
@@ -0,0 +1,208 @@
+#include "regression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include <sqlite3.h>
+
+namespace {
+
+using Database = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>;
+using Statement = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
+
+Database open_read_only(const std::filesystem::path &path) {
+  sqlite3 *db = nullptr;
+  const int err = sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+  Database database(db, &sqlite3_close);
+  if (err != SQLITE_OK) {
+    throw std::runtime_error("Cannot open database " + path.string());
+  }
+  return database;
+}
+
+// Prepare a query, or return null if it fails, such as for columns that are not there
+Statement prepare(sqlite3 *db, const char *sql) {
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return {nullptr, &sqlite3_finalize};
+  }
+  return {stmt, &sqlite3_finalize};
+}
+
+std::string column_text(sqlite3_stmt *stmt, const int column) {
+  const auto *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, column));
+  return text == nullptr ? std::string() : std::string(text);
+}
+
+// The run times in milliseconds of each algorithm on each hypergraph
+using RunTimes = std::map<std::string, std::map<std::string, std::vector<double>>>;
+
+RunTimes read_run_times(const std::filesystem::path &path) {
+  const Database db = open_read_only(path);
+  const Statement stmt = prepare(db.get(), "SELECT algo, hypergraph_id, time_elapsed_ms FROM runs");
+  if (stmt == nullptr) {
+    throw std::runtime_error("Cannot read the runs in " + path.string() + ": " + sqlite3_errmsg(db.get()));
+  }
+  RunTimes times;
+  while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    times[column_text(stmt.get(), 0)][column_text(stmt.get(), 1)].push_back(sqlite3_column_double(stmt.get(), 2));
+  }
+  return times;
+}
+
+double median(std::vector<double> values) {
+  const size_t middle = values.size() / 2;
+  std::nth_element(std::begin(values), std::begin(values) + middle, std::end(values));
+  if (values.size() % 2 == 1) {
+    return values[middle];
+  }
+  return (values[middle] + *std::max_element(std::begin(values), std::begin(values) + middle)) / 2;
+}
+
+}
+
+RegressionOptions RegressionOptions::from_yaml(const YAML::Node &node) {
+  RegressionOptions options;
+  if (node) {
+    options.alpha = node["alpha"].as<double>(options.alpha);
+    options.min_slowdown = node["min_slowdown"].as<double>(options.min_slowdown);
+    options.min_time_ms = node["min_time_ms"].as<double>(options.min_time_ms);
+  }
+  return options;
+}
+
+double slowdown_p_value(const std::vector<double> &baseline, const std::vector<double> &times) {
+  if (baseline.empty() || times.empty()) {
+    return 1;
+  }
+
+  // Rank the samples together, giving tied samples the mean of their ranks
+  std::vector<std::pair<double, bool>> samples; // (sample, whether it is from `times`)
+  for (const double t : baseline) {
+    samples.emplace_back(t, false);
+  }
+  for (const double t : times) {
+    samples.emplace_back(t, true);
+  }
+  std::sort(std::begin(samples), std::end(samples));
+
+  const auto n = static_cast<double>(samples.size());
+  double rank_sum = 0;
+  double ties = 0; // Sum of t^3 - t over the groups of t tied samples
+  for (size_t begin = 0; begin < samples.size();) {
+    size_t end = begin;
+    while (end < samples.size() && samples[end].first == samples[begin].first) {
+      ++end;
+    }
+    const double rank = static_cast<double>(begin + 1 + end) / 2;
+    for (size_t i = begin; i < end; ++i) {
+      if (samples[i].second) {
+        rank_sum += rank;
+      }
+    }
+    const auto t = static_cast<double>(end - begin);
+    ties += t * t * t - t;
+    begin = end;
+  }
+
+  const auto n1 = static_cast<double>(times.size());
+  const auto n2 = static_cast<double>(baseline.size());
+  const double u = rank_sum - n1 * (n1 + 1) / 2;
+  const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) {
+    // Every sample is the same
+    return 1;
+  }
+  const double z = (u - n1 * n2 / 2 - 0.5) / std::sqrt(variance);
+  return std::erfc(z / std::sqrt(2.)) / 2;
+}
+
+std::vector<AlgorithmComparison> compare_with_baseline(const std::filesystem::path &baseline_path,
+                                                       const std::filesystem::path &db_path,
+                                                       const RegressionOptions &options) {
+  const RunTimes baseline = read_run_times(baseline_path);
+  const RunTimes current = read_run_times(db_path);
+
+  std::vector<AlgorithmComparison> comparisons;
+  for (const auto &[algorithm, hypergraphs] : current) {
+    const auto it = baseline.find(algorithm);
+    if (it == std::end(baseline)) {
+      continue;
+    }
+
+    AlgorithmComparison comparison;
+    comparison.algorithm = algorithm;
+    for (const auto &[hypergraph_id, times] : hypergraphs) {
+      const auto baseline_times = it->second.find(hypergraph_id);
+      if (baseline_times == std::end(it->second)) {
+        continue;
+      }
+      HypergraphComparison hypergraph;
+      hypergraph.hypergraph_id = hypergraph_id;
+      hypergraph.baseline_runs = baseline_times->second.size();
+      hypergraph.runs = times.size();
+      hypergraph.baseline_median_ms = median(baseline_times->second);
+      hypergraph.median_ms = median(times);
+      hypergraph.p_value = slowdown_p_value(baseline_times->second, times);
+      comparison.hypergraphs.push_back(hypergraph);
+    }
+
+    // Bonferroni correction over the hypergraphs that are not too fast to compare
+    const auto comparable = [&](const HypergraphComparison &hypergraph) {
+      return hypergraph.baseline_median_ms >= options.min_time_ms;
+    };
+    const auto num_comparable = static_cast<size_t>(std::count_if(std::begin(comparison.hypergraphs),
+                                                                  std::end(comparison.hypergraphs),
+                                                                  comparable));
+    double log_ratios = 0;
+    for (auto &hypergraph : comparison.hypergraphs) {
+      if (!comparable(hypergraph)) {
+        continue;
+      }
+      const double ratio = hypergraph.median_ms / hypergraph.baseline_median_ms;
+      log_ratios += std::log(std::max(ratio, 1e-9));
+      hypergraph.slower = hypergraph.p_value < options.alpha / static_cast<double>(num_comparable)
+          && ratio > 1 + options.min_slowdown;
+      comparison.regressed = comparison.regressed || hypergraph.slower;
+    }
+    if (num_comparable > 0) {
+      comparison.median_ratio = std::exp(log_ratios / static_cast<double>(num_comparable));
+    }
+    comparisons.push_back(std::move(comparison));
+  }
+  return comparisons;
+}
+
+RunProvenance run_provenance(const std::filesystem::path &db_path) {
+  const Database db = open_read_only(db_path);
+  RunProvenance provenance;
+  const Statement stmt = prepare(db.get(), "SELECT DISTINCT commit_hash, compiler_flags, hardware FROM runs");
+  if (stmt == nullptr) {
+    return provenance;
+  }
+  while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    for (auto [column, values] : {std::pair{0, &provenance.commits},
+                                  std::pair{1, &provenance.compiler_flags},
+                                  std::pair{2, &provenance.hardware}}) {
+      if (auto value = column_text(stmt.get(), column); !value.empty()) {
+        values->insert(std::move(value));
+      }
+    }
+  }
+  return provenance;
+}
+
+void write_comparisons(std::ostream &out, const std::vector<AlgorithmComparison> &comparisons) {
+  out << "algorithm,hypergraph_id,baseline_runs,runs,baseline_median_ms,median_ms,p_value,slower" << std::endl;
+  for (const auto &comparison : comparisons) {
+    for (const auto &hypergraph : comparison.hypergraphs) {
+      out << comparison.algorithm << "," << hypergraph.hypergraph_id << "," << hypergraph.baseline_runs << ","
+          << hypergraph.runs << "," << hypergraph.baseline_median_ms << "," << hypergraph.median_ms << ","
+          << hypergraph.p_value << "," << hypergraph.slower << std::endl;
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_REGRESSION_HPP
+#define HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_REGRESSION_HPP
+
+#include <filesystem>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+/**
+ * When to flag an algorithm as slower than in a baseline.
+ */
+struct RegressionOptions {
+  // Significance level for each algorithm, which is split evenly over the hypergraphs it is compared on
+  double alpha = 0.01;
+  // Slowdowns of the median run time by less than this fraction are not flagged, however significant
+  double min_slowdown = 0.05;
+  // Hypergraphs that the baseline takes less time on are not compared, since run times are recorded in milliseconds
+  double min_time_ms = 10;
+
+  // Read from the `regression` map of an experiment config, with the defaults for anything missing
+  static RegressionOptions from_yaml(const YAML::Node &node);
+};
+
+/**
+ * The run times of an algorithm on one hypergraph, in the baseline and now.
+ */
+struct HypergraphComparison {
+  std::string hypergraph_id;
+  size_t baseline_runs = 0;
+  size_t runs = 0;
+  double baseline_median_ms = 0;
+  double median_ms = 0;
+  // One-sided p-value of the Mann-Whitney U test, for the runs being slower than those of the baseline
+  double p_value = 1;
+  bool slower = false;
+};
+
+/**
+ * The run times of an algorithm on all the hypergraphs that both the baseline and now have runs on.
+ */
+struct AlgorithmComparison {
+  std::string algorithm;
+  std::vector<HypergraphComparison> hypergraphs;
+  // Geometric mean of the ratios of the medians, over the hypergraphs that are not too fast to compare. 0 if none are.
+  double median_ratio = 0;
+  // Whether the algorithm is significantly slower on any hypergraph
+  bool regressed = false;
+};
+
+/**
+ * The builds and machines that the runs in a database were taken with.
+ */
+struct RunProvenance {
+  std::set<std::string> commits;
+  std::set<std::string> compiler_flags;
+  std::set<std::string> hardware;
+};
+
+/**
+ * One-sided p-value of the Mann-Whitney U test for the samples in `times` tending to be larger than those in
+ * `baseline`, with the normal approximation corrected for ties and continuity. 1 if either is empty.
+ */
+double slowdown_p_value(const std::vector<double> &baseline, const std::vector<double> &times);
+
+/**
+ * Compare the run times of every algorithm in the runs table of the database at `db_path` with those in the database
+ * at `baseline_path`, hypergraph by hypergraph. Algorithms are sorted by name.
+ *
+ * Throws std::runtime_error if either database cannot be read.
+ */
+std::vector<AlgorithmComparison> compare_with_baseline(const std::filesystem::path &baseline_path,
+                                                       const std::filesystem::path &db_path,
+                                                       const RegressionOptions &options);
+
+/**
+ * The commits, flags and hardware recorded with the runs in a database. Empty for databases from before they were
+ * recorded. Throws std::runtime_error if the database cannot be read.
+ */
+RunProvenance run_provenance(const std::filesystem::path &db_path);
+
+/**
+ * Write the comparisons as CSV, one line per algorithm and hypergraph.
+ */
+void write_comparisons(std::ostream &out, const std::vector<AlgorithmComparison> &comparisons);
+
+#endif //HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_REGRESSION_HPP
@@ -8,6 +8,7 @@
 
 #include "runner.hpp"
 #include "store.hpp"
+#include "buildinfo.hpp"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
@@ -32,6 +33,15 @@ std::string hostname() {
   return {hostname.data()};
 }
 
+// Record the machine and the build a run was taken on
+void set_machine_and_build(CutRunInfo &run_info) {
+  const BuildInfo &build = build_info();
+  run_info.machine = hostname();
+  run_info.commit = build.commit;
+  run_info.compiler_flags = build.compiler_flags;
+  run_info.hardware = build.hardware;
+}
+
 // TODO putting this in certificate.hpp breaks the build and IDK why
 /**
  * Find minimum cut through certificates, use CXY with discovery to early-exit the guessing stage.
@@ -40,11 +50,11 @@ template<typename HypergraphType, bool ReturnsPartitions = true>
 Cut<HypergraphType, ReturnsPartitions> CXY_certificate_minimum_cut(const HypergraphType &hypergraph,
                                                                    uint64_t seed,
                                                                    size_t discovery) {
-  KTrimmedCertificate gen(hypergraph);
+  IncrementalCertificate gen(hypergraph);
   size_t k = 1;
 
   while (true) {
-    Hypergraph certificate = gen.certificate(k);
+    Hypergraph certificate = gen.grow(k);
     util::ContractionStats stats;
     auto cut = util::repeat_contraction<HypergraphType, cxy, false, 1>(certificate,
                                                                        2,
@@ -76,30 +86,67 @@ ExperimentRunner::ExperimentRunner(std::string id,
 void ExperimentRunner::run() {
   spdlog::info("Beginning experiment");
 
-  // Log the sizes of each hypergraph so we can decide whether or not we want to do this...
-  for (const auto &gen : src_) {
-    const auto[hgraph, planted_cut_optional] = gen->generate();
-    spdlog::info("size of {}: {}", gen->name(), hgraph.size());
-  }
-
-  for (const auto &gen : src_) {
-    const auto init = doInitialize(*gen);
-    if (!init) {
-      spdlog::error("Failed to initialize {}", gen->name());
-      continue;
-    }
-    const auto &[k, cut_value, planted_cut_id, hypergraph, planted_cut] = init.value();
+  const auto process = [this](const HypergraphGenerator &gen, const InitializeRet &init) {
+    const auto &[k, cut_value, planted_cut_id, hypergraph, planted_cut] = init;
 
     spdlog::info("[{}] Collecting data for hypergraph", hypergraph.name);
 
     // This part is different
-    doProcessHypergraph(*gen, hypergraph, k, cut_value, planted_cut, planted_cut_id);
+    doProcessHypergraph(gen, hypergraph, k, cut_value, planted_cut, planted_cut_id);
+  };
+
+  if (generate_ahead_ == 0) {
+    for (const auto &gen : src_) {
+      const auto init = doInitialize(*gen);
+      if (!init) {
+        spdlog::error("Failed to initialize {}", gen->name());
+        continue;
+      }
+      process(*gen, init.value());
+    }
+  } else {
+    // Generating, solving and persisting the next hypergraphs overlaps with processing the current one
+    Channel<std::pair<const HypergraphGenerator *, InitializeRet>> initialized(generate_ahead_);
+    std::thread producer([this, &initialized] {
+      for (const auto &gen : src_) {
+        std::optional<InitializeRet> init;
+        try {
+          init = doInitialize(*gen);
+        } catch (const std::exception &e) {
+          spdlog::error("{}", e.what());
+        }
+        if (!init) {
+          spdlog::error("Failed to initialize {}", gen->name());
+          continue;
+        }
+        if (!initialized.push({gen.get(), std::move(init.value())})) {
+          break;
+        }
+      }
+      initialized.close();
+    });
+
+    try {
+      while (const auto next = initialized.pop()) {
+        process(*next->first, next->second);
+      }
+    } catch (...) {
+      // Unblock the producer before giving up
+      initialized.close();
+      producer.join();
+      throw;
+    }
+    producer.join();
   }
+
+  doFinish();
+  store_->flush();
 }
 
 std::optional<ExperimentRunner::InitializeRet> ExperimentRunner::doInitialize(const HypergraphGenerator &gen) {
   const auto[hgraph, planted_cut_optional] = gen.generate();
   HypergraphWrapper hypergraph = {.name = gen.name(), .h = hgraph};
+  spdlog::info("size of {}: {}", gen.name(), hgraph.size());
 
   ReportStatus status = store_->report(hypergraph);
   if (status == ReportStatus::ERROR) {
@@ -112,14 +159,24 @@ std::optional<ExperimentRunner::InitializeRet> ExperimentRunner::doInitialize(co
   }
   // Need to do this since planted_cut does not have a default constructor
   HypergraphCut<size_t> cut = planted_ ? planted_cut_optional.value() :
-                              [&hypergraph]() {
+                              [this, &hypergraph]() {
                                 Hypergraph *hypergraph_ptr = std::get_if<Hypergraph>(&hypergraph.h);
                                 if (hypergraph_ptr == nullptr) {
                                   throw std::runtime_error("Hypergraph is null");
                                 }
+                                if (cut_cache_) {
+                                  if (auto cached = cut_cache_->find(*hypergraph_ptr, "MW", 2)) {
+                                    spdlog::info("Found the min cut of {} in the cache", hypergraph.name);
+                                    return std::move(cached.value());
+                                  }
+                                }
                                 // Copy to call MW_min_cut since it can write to the hypergraph
                                 Hypergraph temp(*hypergraph_ptr);
-                                return MW_min_cut(temp);
+                                auto cut = MW_min_cut(temp);
+                                if (cut_cache_ && !cut_cache_->store(*hypergraph_ptr, "MW", 2, cut)) {
+                                  spdlog::warn("Failed to cache the min cut of {}", hypergraph.name);
+                                }
+                                return cut;
                               }();
 
   // TODO we shouldn't need CutInfo if we can get k from HypergraphCut
@@ -251,57 +308,68 @@ DiscoveryRunner::DiscoveryRunner(std::string id,
                                  std::shared_ptr<CutInfoStore> store,
                                  bool planted,
                                  size_t num_runs,
-                                 std::vector<std::string> func_names) : ExperimentRunner(std::move(id),
-                                                                                         std::move(source),
-                                                                                         std::move(store),
-                                                                                         planted,
-                                                                                         num_runs),
-                                                                        funcnames_(std::move(func_names)) {}
+                                 std::vector<std::string> func_names,
+                                 size_t num_threads) : ExperimentRunner(std::move(id),
+                                                                        std::move(source),
+                                                                        std::move(store),
+                                                                        planted,
+                                                                        num_runs),
+                                                       funcnames_(std::move(func_names)),
+                                                       scheduler_(num_threads) {}
 
 template<bool ReturnsPartitions>
-void DiscoveryRunner::doRunDiscovery(const HypergraphGenerator &gen,
+void DiscoveryRunner::doRunDiscovery(const std::shared_ptr<const Instance> &instance,
                                      const std::string &func_name,
-                                     CutFunc <ReturnsPartitions> func,
-                                     const CutInfo &planted_cut,
-                                     const uint64_t planted_cut_id,
-                                     size_t k) {
+                                     CutFunc <ReturnsPartitions> func) {
   // Make sources of randomness
   std::random_device rd;
   std::mt19937_64 rgen(rd());
   std::uniform_int_distribution<uint64_t> dis;
 
-  const auto[hgraph, planted_cut_optional] = gen.generate();
-  HypergraphWrapper hypergraph;
-  hypergraph.h = hgraph;
-  hypergraph.name = gen.name();
-  // TODO make this unnecessary
-  // Avoid this variant foolishness for now
-  Hypergraph *hypergraph_ptr = std::get_if<Hypergraph>(&hypergraph.h);
-  assert(hypergraph_ptr != nullptr);
-
-  spdlog::info("[{} / {}] Starting", hypergraph.name, func_name);
-  for (int i = 0; i < num_runs(); ++i) {
-    spdlog::info("[{} / {}] Run {}/{}", hypergraph.name, func_name, i + 1, num_runs());
-
-    // We have to make a copy of the hypergraph since some algorithms write to it
-    Hypergraph temp(*hypergraph_ptr);
-    util::ContractionStats stats{};
-    // TODO probably need to put this in more places
-    temp.remove_singleton_and_empty_hyperedges();
-
-    auto start = std::chrono::high_resolution_clock::now();
-    auto cut = func(&temp, dis(rgen), stats);
-    auto stop = std::chrono::high_resolution_clock::now();
-
-    CutInfo found_cut_info(k, cut);
-
-    CutRunInfo run_info(id(), found_cut_info);
-    run_info.algorithm = func_name;
-    run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
-    run_info.machine = hostname();
-    run_info.commit = "n/a";
-
-    doReportCutAndRun<ReturnsPartitions>(hypergraph, found_cut_info, planted_cut, planted_cut_id, run_info, stats);
+  // Runs already in the store are from an interrupted attempt at this experiment
+  const size_t num_done = store().num_completed_runs(instance->hypergraph.name, func_name, id());
+  if (num_done >= num_runs()) {
+    spdlog::info("[{} / {}] Already done", instance->hypergraph.name, func_name);
+    return;
+  }
+  spdlog::info("[{} / {}] Starting at run {}", instance->hypergraph.name, func_name, num_done + 1);
+  for (int i = num_done; i < num_runs(); ++i) {
+    scheduler_.submit([this, instance, func_name, func, i, seed = dis(rgen)] {
+      const auto &hypergraph = instance->hypergraph;
+      spdlog::info("[{} / {}] Run {}/{}", hypergraph.name, func_name, i + 1, num_runs());
+
+      // TODO make this unnecessary
+      // Avoid this variant foolishness for now
+      const Hypergraph *hypergraph_ptr = std::get_if<Hypergraph>(&hypergraph.h);
+      assert(hypergraph_ptr != nullptr);
+
+      // We have to make a copy of the hypergraph since some algorithms write to it
+      Hypergraph temp(*hypergraph_ptr);
+      util::ContractionStats stats{};
+      // TODO probably need to put this in more places
+      temp.remove_singleton_and_empty_hyperedges();
+
+      // The algorithms run on this thread, so this also counts the vertex orderings, which do not fill in stats
+      const instrument::Section section;
+      auto start = std::chrono::high_resolution_clock::now();
+      auto cut = func(&temp, seed, stats);
+      auto stop = std::chrono::high_resolution_clock::now();
+
+      CutInfo found_cut_info(instance->k, cut);
+
+      CutRunInfo run_info(id(), found_cut_info);
+      run_info.algorithm = func_name;
+      run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+      set_machine_and_build(run_info);
+      run_info.counters = section.collect();
+
+      doReportCutAndRun<ReturnsPartitions>(hypergraph,
+                                           found_cut_info,
+                                           instance->planted_cut,
+                                           instance->planted_cut_id,
+                                           run_info,
+                                           stats);
+    });
   }
 }
 
@@ -311,14 +379,19 @@ void DiscoveryRunner::doProcessHypergraph(const HypergraphGenerator &gen,
                                           const size_t cut_value,
                                           const CutInfo &planted_cut,
                                           const size_t planted_cut_id) {
+  const auto instance = std::make_shared<const Instance>(Instance{hypergraph, planted_cut, planted_cut_id, k});
   for (const auto &[func_name, func] : getCutAlgos(k, cut_value)) {
-    doRunDiscovery<true>(gen, func_name, func, planted_cut, planted_cut_id, k);
+    doRunDiscovery<true>(instance, func_name, func);
   }
   for (const auto &[func_name, func] : getCutValAlgos(hypergraph, k, cut_value)) {
-    doRunDiscovery<false>(gen, func_name, func, planted_cut, planted_cut_id, k);
+    doRunDiscovery<false>(instance, func_name, func);
   }
 }
 
+void DiscoveryRunner::doFinish() {
+  scheduler_.wait();
+}
+
 std::vector<std::pair<std::string, HypergraphCutFunc>> DiscoveryRunner::getCutAlgos(const size_t k,
                                                                                     const size_t cut_value) {
   // TODO I should be checking somehow to make sure that ordering based functions are not called for k != 2
@@ -459,14 +532,16 @@ CutoffRunner::CutoffRunner(std::string id,
                            size_t num_runs,
                            std::vector<std::string> algos,
                            std::vector<double> cutoff_percentages,
-                           std::filesystem::path output_dir) : ExperimentRunner(std::move(id),
-                                                                                std::move(source),
-                                                                                std::move(store),
-                                                                                planted,
-                                                                                num_runs),
+                           std::filesystem::path output_dir,
+                           size_t num_threads) : ExperimentRunner(std::move(id),
+                                                                  std::move(source),
+                                                                  std::move(store),
+                                                                  planted,
+                                                                  num_runs),
     // cutoff_percentages_(std::move(cutoff_percentages)),
-                                                               output_dir_(std::move(output_dir)),
-                                                               algos_(std::move(algos)) {
+                                                 output_dir_(std::move(output_dir)),
+                                                 algos_(std::move(algos)),
+                                                 scheduler_(num_threads) {
   // Just hardcode cutoff_percentages for now
   cutoff_percentages_ = {};
   for (double i = 0.1; i <= 30; i += 0.1) {
@@ -569,7 +644,7 @@ std::chrono::duration<double> CutoffRunner::computeCutoffTime(const HypergraphWr
 
     CutRunInfo run_info(id(), {2, cut});
     run_info.algorithm = "MW";
-    run_info.machine = hostname();
+    set_machine_and_build(run_info);
     run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
     store().report(hypergraph.name, run_info, 0, 0);
@@ -590,84 +665,74 @@ void CutoffRunner::doRunCutoff(const HypergraphWrapper &hypergraph,
                                std::ofstream &output) {
   // Make sources of randomness
   std::random_device rd;
-  std::uniform_int_distribution<uint64_t> dis;
 
   // CALCULATE TIME LIMITS
-  // A vector of tuples (percentage, time limit, cut factor) where time limit the duration of how much *longer* the algorithm should
-  // run in order to reach a *total* runtime of the percentage
-  std::vector<std::tuple<double, std::chrono::duration<double>, double>>
-      time_limits = {{cutoff_percentages_.front(), cutoff_percentages_.front() * cutoff_time, 0}};
-
-  auto previous_percentage = std::get<0>(time_limits.front());
-  std::transform(cutoff_percentages_.begin() + 1,
+  // A vector of tuples (percentage, time limit, cut factor) where time limit is the total runtime at the percentage
+  std::vector<std::tuple<double, std::chrono::duration<double>, double>> time_limits;
+  std::transform(cutoff_percentages_.begin(),
                  cutoff_percentages_.end(),
                  std::back_inserter(time_limits),
-                 [&previous_percentage, cutoff_time](auto &&percentage) {
-                   auto next = percentage - previous_percentage;
-                   previous_percentage = percentage;
-                   return std::make_tuple(percentage, next * cutoff_time, 0.0);
+                 [cutoff_time](auto &&percentage) {
+                   return std::make_tuple(percentage, percentage * cutoff_time, 0.0);
                  });
-
-  if (cutoff_percentages_.size() != time_limits.size()) {
-    throw std::runtime_error("Internal error: cutoff_percentages_ and differences should be the same size");
+  auto max_time_limit = std::chrono::duration<double>::zero();
+  for (const auto &[percentage, time_limit, cut_factor] : time_limits) {
+    max_time_limit = std::max(max_time_limit, time_limit);
   }
 
+  // Each trial records the improvements it finds, and the cut factors at every cutoff are read off the traces once all
+  // trials are done, so nothing samples the trials while they run
+  std::vector<util::ImprovementTrace<size_t>> traces(num_runs());
+
   auto hypergraph_ptr = std::get_if<Hypergraph>(&hypergraph.h);
   for (int i = 0; i < num_runs(); ++i) {
-    Hypergraph temp(*hypergraph_ptr);
-    typename ContractImpl::template Context<Hypergraph> ctx(temp,
-                                                            k,
-                                                            std::mt19937_64(rd()),
-                                                            discovery_value,
-                                                            std::nullopt);
-
-    std::atomic_bool contraction_done = false;
-    // Start two threads, one to run the contraction algorithm and one to monitor the minimum so far
-    auto start = std::chrono::high_resolution_clock::now();
-    std::thread contraction_runner([&contraction_done, &time_limits, &ctx]() {
+    scheduler_.submit([this, &hypergraph, hypergraph_ptr, &trace = traces[i], k, discovery_value, max_time_limit,
+                          seed = rd()] {
+      Hypergraph temp(*hypergraph_ptr);
+      typename ContractImpl::template Context<Hypergraph> ctx(temp,
+                                                              k,
+                                                              std::mt19937_64(seed),
+                                                              discovery_value,
+                                                              std::nullopt);
+      ctx.on_improvement = trace.recorder();
+
+      auto start = std::chrono::high_resolution_clock::now();
+      ctx.start = std::chrono::steady_clock::now();
+      // Nothing found after the last cutoff counts
+      ctx.deadline = ctx.start + std::chrono::ceil<std::chrono::steady_clock::duration>(max_time_limit);
       util::repeat_contraction<Hypergraph, ContractImpl, false, 0>(ctx);
-      contraction_done.store(true);
-    });
-    std::thread monitor([&contraction_done, &time_limits, &ctx, discovery_value]() {
-      for (auto &[percentage, time_limit, cut_factor] : time_limits) {
-        if (contraction_done.load()) {
-          cut_factor += 1.0; // Cut factor is 1 since the value has been discovered
-          continue;
-        }
-        auto start = std::chrono::high_resolution_clock::now();
-        std::this_thread::sleep_for(time_limit);
-        auto stop = std::chrono::high_resolution_clock::now();
-        auto min_so_far = ctx.min_val_so_far.load();
-        spdlog::info("{}: At {} got {} after running for {} milliseconds, actual {}",
-                     ContractImpl::name,
-                     percentage,
-                     min_so_far,
-                     std::chrono::duration_cast<std::chrono::milliseconds>(time_limit).count(),
-                     std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
-        cut_factor += static_cast<double>(min_so_far) / discovery_value;
-      }
-    });
-
-    contraction_runner.join();
-    auto stop = std::chrono::high_resolution_clock::now();
-    monitor.join();
+      auto stop = std::chrono::high_resolution_clock::now();
 
-    size_t k = 2; // TODO hardcode for now
-    CutInfo cut_info(k, ctx.min_so_far);
+      size_t k = 2; // TODO hardcode for now
+      CutInfo cut_info(k, ctx.min_so_far);
 
-    std::string hypergraph_id;
-    size_t num_runs_for_discovery;
-    size_t num_contractions = 0;
+      std::string hypergraph_id;
+      size_t num_runs_for_discovery;
+      size_t num_contractions = 0;
 
-    // TODO Constructor for this
-    CutRunInfo run_info(id(), cut_info);
-    run_info.algorithm = ContractImpl::name;
-    run_info.machine = hostname();
-    run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
-    run_info.commit = "";
+      // TODO Constructor for this
+      CutRunInfo run_info(id(), cut_info);
+      run_info.algorithm = ContractImpl::name;
+      set_machine_and_build(run_info);
+      run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+      run_info.counters = ctx.stats.counters;
 
-    if (store().report(hypergraph.name, run_info, num_runs_for_discovery, num_contractions) == ReportStatus::ERROR) {
-      spdlog::error("Failed to report run");
+      if (store().report(hypergraph.name, run_info, num_runs_for_discovery, num_contractions) == ReportStatus::ERROR) {
+        spdlog::error("Failed to report run");
+      }
+    });
+  }
+  scheduler_.wait();
+
+  for (const auto &trace : traces) {
+    for (auto &[percentage, time_limit, cut_factor] : time_limits) {
+      const size_t min_so_far = trace.best_within(time_limit).value_or(std::numeric_limits<size_t>::max());
+      spdlog::info("{}: At {} got {} after running for {} milliseconds",
+                   ContractImpl::name,
+                   percentage,
+                   min_so_far,
+                   std::chrono::duration_cast<std::chrono::milliseconds>(time_limit).count());
+      cut_factor += static_cast<double>(min_so_far) / discovery_value;
     }
   }
 
@@ -704,8 +769,10 @@ void CutoffRunner::doRunDiscovery(const HypergraphGenerator &gen,
 
   constexpr int NUM_RUNS = 5;
 
-  spdlog::info("[{} / {}] Starting", hypergraph.name, func_name);
-  for (int i = 0; i < NUM_RUNS; ++i) { // TODO number of runs for deterministic algorithms is hardcoded
+  // Runs already in the store are from an interrupted attempt at this experiment
+  const size_t num_done = store().num_completed_runs(hypergraph.name, func_name, id());
+  spdlog::info("[{} / {}] Starting at run {}", hypergraph.name, func_name, num_done + 1);
+  for (int i = num_done; i < NUM_RUNS; ++i) { // TODO number of runs for deterministic algorithms is hardcoded
     spdlog::info("[{} / {}] Run {}/{}", hypergraph.name, func_name, i + 1, NUM_RUNS);
 
     // We have to make a copy of the hypergraph since some algorithms write to it
@@ -714,6 +781,8 @@ void CutoffRunner::doRunDiscovery(const HypergraphGenerator &gen,
     // TODO probably need to put this in more places
     temp.remove_singleton_and_empty_hyperedges();
 
+    // The algorithms run on this thread, so this also counts the vertex orderings, which do not fill in stats
+    const instrument::Section section;
     auto start = std::chrono::high_resolution_clock::now();
     auto cut = func(&temp, dis(rgen), stats);
     auto stop = std::chrono::high_resolution_clock::now();
@@ -723,8 +792,8 @@ void CutoffRunner::doRunDiscovery(const HypergraphGenerator &gen,
     CutRunInfo run_info(id(), found_cut_info);
     run_info.algorithm = func_name;
     run_info.time = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
-    run_info.machine = hostname();
-    run_info.commit = "n/a";
+    set_machine_and_build(run_info);
+    run_info.counters = section.collect();
 
     doReportCutAndRun<ReturnsPartitions>(hypergraph, found_cut_info, planted_cut, planted_cut_id, run_info, stats);
   }
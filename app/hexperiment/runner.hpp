@@ -11,7 +11,10 @@
 #include <filesystem>
 #include <optional>
 
+#include <hypergraph/cache.hpp>
+
 #include "common.hpp"
+#include "scheduler.hpp"
 
 // TODO don't forward declare things from external libraries
 namespace hypergraphlib::util {
@@ -38,6 +41,21 @@ public:
                    size_t num_runs);
   void run();
 
+  /**
+   * Generate and report up to `depth` upcoming hypergraphs on a background thread while the current one is processed,
+   * or none if 0. The store must be safe to report to from several threads when `depth` is not 0.
+   */
+  void set_generate_ahead(size_t depth) {
+    generate_ahead_ = depth;
+  }
+
+  /**
+   * Look up the minimum cuts of hypergraphs whose cuts are not planted in a cache in `directory`, and store them there.
+   */
+  void set_cut_cache(const std::filesystem::path &directory) {
+    cut_cache_.emplace(directory);
+  }
+
   virtual ~ExperimentRunner() = default;
 
 protected:
@@ -96,14 +114,24 @@ private:
                                    const CutInfo &planted_cut,
                                    size_t planted_cut_id) = 0;
 
+  // Wait for any work that doProcessHypergraph left running
+  virtual void doFinish() {}
+
   std::string id_;
   std::vector<std::unique_ptr<HypergraphGenerator>> src_;
   std::shared_ptr<CutInfoStore> store_;
   size_t num_runs_;
   bool planted_;
+  size_t generate_ahead_ = 0;
+  std::optional<hypergraphlib::CutCache> cut_cache_;
 
 };
 
+/**
+ * Runs every algorithm on every hypergraph `num_runs` times. The (hypergraph, algorithm, run) tasks are spread over
+ * `num_threads` worker threads, so the store must be safe to report to from several threads when there is more than
+ * one.
+ */
 class DiscoveryRunner : public ExperimentRunner {
   // Add relevant data point to database
 public:
@@ -112,7 +140,8 @@ public:
                   std::shared_ptr<CutInfoStore> store,
                   bool planted,
                   size_t num_runs,
-                  std::vector<std::string> func_names);
+                  std::vector<std::string> func_names,
+                  size_t num_threads = 1);
 
   void doProcessHypergraph(const HypergraphGenerator &gen,
                            const HypergraphWrapper &hypergraph,
@@ -123,16 +152,27 @@ public:
 
 private:
 
+  // A hypergraph and its planted cut, shared by the tasks that run on it
+  struct Instance {
+    HypergraphWrapper hypergraph;
+    CutInfo planted_cut;
+    uint64_t planted_cut_id;
+    size_t k;
+  };
+
+  void doFinish() override;
+
   // The functions to use. If empty then use all functions
   std::vector<std::string> funcnames_;
 
+  // Declared last so that it waits for its tasks before the rest of the runner is destroyed
+  Scheduler scheduler_;
+
+  // Queue the runs of an algorithm on the scheduler
   template<bool ReturnsPartitions>
-  void doRunDiscovery(const HypergraphGenerator &gen,
+  void doRunDiscovery(const std::shared_ptr<const Instance> &instance,
                       const std::string &func_name,
-                      CutFunc <ReturnsPartitions> func,
-                      const CutInfo &planted_cut,
-                      uint64_t planted_cut_id,
-                      size_t k);
+                      CutFunc <ReturnsPartitions> func);
 
   template<typename T>
   bool notInFuncNames(T &&f);
@@ -155,7 +195,8 @@ public:
                size_t num_runs,
                std::vector<std::string> algos,
                std::vector<double> cutoff_percentages,
-               std::filesystem::path output_dir);
+               std::filesystem::path output_dir,
+               size_t num_threads = 1);
 
   void doProcessHypergraph(const HypergraphGenerator &gen,
                            const HypergraphWrapper &hypergraph,
@@ -187,6 +228,10 @@ private:
   std::filesystem::path output_dir_;
 
   std::vector<std::string> algos_;
+
+  // Runs the trials of the contraction algorithms. Declared last so that it waits for its tasks before the rest of the
+  // runner is destroyed.
+  Scheduler scheduler_;
 };
 
 #endif //HYPERGRAPHPARTITIONING_EXPERIMENT_EVALUATOR_HPP
@@ -0,0 +1,114 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// The cores the process may run on, in order
+std::vector<int> available_cores() {
+  std::vector<int> cores;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cores.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cores;
+}
+
+// Pin a thread to a core, does nothing where that is not supported
+void pin_to_core(std::thread &thread, const int core) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+    spdlog::warn("Failed to pin worker to core {}", core);
+  }
+#endif
+}
+
+}
+
+Scheduler::Scheduler(size_t num_threads, const size_t max_pending) {
+  const std::vector<int> cores = available_cores();
+  if (num_threads == 0) {
+    num_threads = std::max<size_t>(cores.size(), 1);
+  }
+  max_pending_ = max_pending > 0 ? max_pending : 4 * num_threads;
+
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&Scheduler::work, this, i);
+    if (!cores.empty()) {
+      pin_to_core(workers_.back(), cores[i % cores.size()]);
+    }
+  }
+}
+
+Scheduler::~Scheduler() {
+  wait();
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void Scheduler::submit(std::function<void()> task) {
+  {
+    std::unique_lock lock(mutex_);
+    progressed_.wait(lock, [this] { return tasks_.size() < max_pending_; });
+    tasks_.push_back(std::move(task));
+    ++unfinished_;
+  }
+  queued_.notify_one();
+}
+
+void Scheduler::wait() {
+  std::unique_lock lock(mutex_);
+  progressed_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+void Scheduler::work(const size_t index) {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      queued_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    progressed_.notify_all();
+
+    try {
+      task();
+    } catch (const std::exception &e) {
+      spdlog::error("Worker {} failed a task: {}", index, e.what());
+    }
+
+    {
+      std::lock_guard lock(mutex_);
+      --unfinished_;
+    }
+    progressed_.notify_all();
+  }
+}
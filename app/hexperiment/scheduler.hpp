@@ -0,0 +1,126 @@
+#ifndef HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_SCHEDULER_HPP
+#define HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_SCHEDULER_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/**
+ * A pool of worker threads that runs tasks in the order they are submitted.
+ *
+ * On Linux every worker is pinned to its own core (out of the cores the process may run on) so that the timings of
+ * the runs do not suffer from threads migrating between cores. With more workers than cores, workers share cores.
+ */
+class Scheduler {
+public:
+  /**
+   * @param num_threads number of workers, one per core if 0
+   * @param max_pending submit() blocks while this many tasks are waiting, 4 per worker if 0
+   */
+  explicit Scheduler(size_t num_threads, size_t max_pending = 0);
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // Waits for all submitted tasks
+  ~Scheduler();
+
+  /**
+   * Queue a task, blocking while too many tasks are waiting. A task that throws is logged and dropped.
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * Block until every submitted task has finished.
+   */
+  void wait();
+
+  [[nodiscard]]
+  size_t num_threads() const { return workers_.size(); }
+
+private:
+  void work(size_t index);
+
+  std::vector<std::thread> workers_;
+  size_t max_pending_;
+
+  std::mutex mutex_;
+  // Signalled when a task is queued or the scheduler stops
+  std::condition_variable queued_;
+  // Signalled when a task is taken off the queue or finishes
+  std::condition_variable progressed_;
+  std::deque<std::function<void()>> tasks_;
+  // Tasks queued or running
+  size_t unfinished_ = 0;
+  bool stopping_ = false;
+};
+
+/**
+ * A bounded queue between producer and consumer threads.
+ */
+template<typename T>
+class Channel {
+public:
+  explicit Channel(const size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  /**
+   * Add a value, blocking while the channel is full. Returns false and drops the value if the channel is closed.
+   */
+  bool push(T value) {
+    {
+      std::unique_lock lock(mutex_);
+      popped_.wait(lock, [this] { return closed_ || values_.size() < capacity_; });
+      if (closed_) {
+        return false;
+      }
+      values_.push_back(std::move(value));
+    }
+    pushed_.notify_one();
+    return true;
+  }
+
+  /**
+   * Take the oldest value, blocking while the channel is empty. Empty once the channel is closed and drained.
+   */
+  std::optional<T> pop() {
+    std::optional<T> value;
+    {
+      std::unique_lock lock(mutex_);
+      pushed_.wait(lock, [this] { return closed_ || !values_.empty(); });
+      if (values_.empty()) {
+        return {};
+      }
+      value = std::move(values_.front());
+      values_.pop_front();
+    }
+    popped_.notify_one();
+    return value;
+  }
+
+  /**
+   * Stop accepting values. Values already in the channel can still be popped.
+   */
+  void close() {
+    {
+      std::lock_guard lock(mutex_);
+      closed_ = true;
+    }
+    pushed_.notify_all();
+    popped_.notify_all();
+  }
+
+private:
+  size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable pushed_;
+  std::condition_variable popped_;
+  std::deque<T> values_;
+  bool closed_ = false;
+};
+
+#endif //HYPERGRAPHPARTITIONING_APP_HEXPERIMENT_SCHEDULER_HPP
@@ -37,3 +37,22 @@ std::string sqlutil::InsertStatementBuilder::string() {
 
   return oss.str();
 }
+
+std::string sqlutil::prepared_insert_statement(const std::string &table_name,
+                                               const std::vector<std::string> &columns,
+                                               const std::string &time_column) {
+  std::vector<std::string> names(columns);
+  std::vector<std::string> vals(columns.size(), "?");
+  if (!time_column.empty()) {
+    names.push_back(time_column);
+    vals.push_back(_impl::sql_val_str(TimeNow{}));
+  }
+
+  std::string names_str = _impl::comma_delimit(std::begin(names), std::end(names));
+  std::string vals_str = _impl::comma_delimit(std::begin(vals), std::end(vals));
+
+  std::ostringstream oss;
+  oss << "INSERT INTO " << table_name << " (" << names_str << ") VALUES (" << vals_str << ")";
+
+  return oss.str();
+}
@@ -80,6 +80,23 @@ std::string insert_statement(const std::string &table_name, Ts &&... args) {
   return oss.str();
 }
 
+/**
+ * Create a SQL insert statement with a `?` parameter for each column, to be prepared once and then bound for each row.
+ * If `time_column` is not empty, that column is also set, to `time('now')`.
+ *
+ * Example usage:
+ *
+ * ```
+ * std::string stmt = prepared_insert_statement("runs", {"num_runs", "hypergraph_id"}, "time_taken");
+ *
+ * // INSERT INTO runs (num_runs, hypergraph_id, time_taken) VALUES (?, ?, time('now'))
+ *
+ * ```
+ */
+std::string prepared_insert_statement(const std::string &table_name,
+                                      const std::vector<std::string> &columns,
+                                      const std::string &time_column = {});
+
 /**
  * Builds a sqlite3 insert statement one column at a time
  */
@@ -3,6 +3,7 @@
 //
 
 #include <iostream>
+#include <future>
 
 #include <sqlite3.h>
 #include <generators/generators.hpp>
@@ -31,13 +32,71 @@ std::string partition_to_str(const std::vector<int> &v) {
   return ret.substr(0, ret.size() - 1);
 }
 
-// *M*ake string-*I*nt *T*uple
-constexpr auto mit = std::make_tuple<std::string, int>;
-// *M*ake string-*S*tring *T*uple
-std::tuple<std::string, std::string> mst(const std::string &name, const std::string &val) {
-  return std::make_tuple(std::string(name), std::string(val));
+// The columns of the runs table for the instrumentation counters, in the order of the counters and then the phases
+std::vector<std::string> counter_columns() {
+  using namespace hypergraphlib::instrument;
+  std::vector<std::string> columns(std::begin(kCounterNames), std::end(kCounterNames));
+  for (const char *phase : kPhaseNames) {
+    columns.push_back(std::string(phase) + "_us");
+  }
+  return columns;
+}
+
+// Add the build and instrumentation counter columns to a runs table that was created without them. Fails for columns
+// that are already there, which is fine.
+void add_missing_columns(sqlite3 *db) {
+  for (const char *column : {"compiler_flags", "hardware"}) {
+    const std::string stmt = "ALTER TABLE runs ADD COLUMN " + std::string(column) + " TEXT";
+    sqlite3_exec(db, stmt.c_str(), null_callback, nullptr, nullptr);
+  }
+  for (const auto &column : counter_columns()) {
+    const std::string stmt = "ALTER TABLE runs ADD COLUMN " + column + " INT";
+    sqlite3_exec(db, stmt.c_str(), null_callback, nullptr, nullptr);
+  }
+}
+
+// Execute SQL that returns no rows, printing any error
+bool execute(sqlite3 *db, const char *sql) {
+  char *zErrMsg{};
+  int err = sqlite3_exec(db, sql, null_callback, nullptr, &zErrMsg);
+  if (err != SQLITE_OK) {
+    fprintf(stderr, "SQL error: %s\n", zErrMsg);
+    sqlite3_free(zErrMsg);
+    return false;
+  }
+  return true;
+}
+
+// Step a statement that returns no rows, printing any error other than a failed primary key constraint
+int step(sqlite3 *db, sqlite3_stmt *stmt) {
+  int err = sqlite3_step(stmt);
+  if (err != SQLITE_DONE && sqlite3_extended_errcode(db) != SQLITE_CONSTRAINT_PRIMARYKEY) {
+    fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+  }
+  return err;
+}
+
+void bind_text(sqlite3_stmt *stmt, int index, const std::string &text) {
+  sqlite3_bind_text(stmt, index, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+}
+
+// Bind the instrumentation counters of a run to the parameters from `index` on, in the order of counter_columns().
+// They stay NULL when the counters are not compiled in.
+void bind_counters(sqlite3_stmt *stmt, int index, const hypergraphlib::instrument::Counters &counters) {
+  using namespace hypergraphlib::instrument;
+  if constexpr (!enabled) {
+    return;
+  }
+
+  for (const auto count : counters.counts) {
+    sqlite3_bind_int64(stmt, index++, static_cast<sqlite3_int64>(count));
+  }
+  for (const auto time : counters.times) {
+    sqlite3_bind_int64(stmt, index++, std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+  }
 }
 
+
 }
 
 ReportStatus SqliteStore::report(const HypergraphGenerator &h) {
@@ -67,6 +126,12 @@ bool SqliteStore::open(const std::filesystem::path &db_path) {
     return false;
   }
 
+  // With a write-ahead log, commits append to the log rather than rewrite pages of the database, and readers of the
+  // database do not block the writer
+  if (!execute(db_, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;")) {
+    return false;
+  }
+
   static constexpr char kInitialize[] = R"(
 CREATE TABLE IF NOT EXISTS hypergraphs (
   id TEXT PRIMARY KEY,
@@ -176,10 +241,23 @@ CREATE TABLE IF NOT EXISTS runs (
   time_elapsed_ms INTEGER NOT NULL,
   machine TEXT NOT NULL,
   commit_hash TEXT,
+  compiler_flags TEXT,
+  hardware TEXT,
   time_taken INT NOT NULL,
   num_runs_for_discovery INT,
   num_contractions INT,
   experiment_id TEXT,
+  pins_touched INT,
+  engine_allocations INT,
+  engine_copies INT,
+  hypergraph_copies INT,
+  branches INT,
+  max_branch_depth INT,
+  heap_operations INT,
+  sampling_us INT,
+  contraction_us INT,
+  spanning_edge_removal_us INT,
+  copying_us INT,
   FOREIGN KEY (hypergraph_id)
     REFERENCES hypergraphs (id),
   FOREIGN KEY (cut_id)
@@ -188,19 +266,40 @@ CREATE TABLE IF NOT EXISTS runs (
 )";
 
   std::string sql_command = std::string(kInitialize) + PlantedHypergraph::make_table_sql_command();
-  char *zErrMsg{};
-  err = sqlite3_exec(db_, sql_command.c_str(), null_callback, nullptr, &zErrMsg);
-  if (err != SQLITE_OK) {
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
+  if (!execute(db_, sql_command.c_str())) {
     return false;
   }
+  add_missing_columns(db_);
 
   std::cout << "Opened database at " << db_path << std::endl;
 
   return true;
 }
 
+
+sqlite3_stmt *SqliteStore::statement(const std::string &sql) {
+  auto it = statements_.find(sql);
+  if (it == statements_.end()) {
+    sqlite3_stmt *stmt{};
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+      fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_));
+      return nullptr;
+    }
+    it = statements_.emplace(sql, stmt).first;
+  }
+  sqlite3_reset(it->second);
+  sqlite3_clear_bindings(it->second);
+  return it->second;
+}
+
+bool SqliteStore::begin_batch() {
+  return execute(db_, "BEGIN");
+}
+
+bool SqliteStore::commit_batch() {
+  return execute(db_, "COMMIT");
+}
+
 ReportStatus SqliteStore::report(const HypergraphWrapper &hypergraph) {
   size_t num_vertices = std::visit([](auto &&h) { return h.num_vertices(); }, hypergraph.h);
   size_t num_hyperedges = std::visit([](auto &&h) { return h.num_edges(); }, hypergraph.h);
@@ -208,25 +307,22 @@ ReportStatus SqliteStore::report(const HypergraphWrapper &hypergraph) {
   std::stringstream blob;
   std::visit([&blob](auto &&h) { blob << h; }, hypergraph.h);
 
-  // Make statement
-  const std::string stmt = sqlutil::insert_statement(
-      "hypergraphs",
-      mst("id", hypergraph.name),
-      mit("num_vertices", num_vertices),
-      mit("num_hyperedges", num_hyperedges),
-      mit("size", size),
-      mst("blob", blob.str())
-  );
-
-  char *zErrMsg{};
-  int err = sqlite3_exec(db_, stmt.c_str(), null_callback, nullptr, &zErrMsg);
-  if (err != SQLITE_OK) {
-    // May not be the best way to do this..
-    if (std::string(zErrMsg) == "UNIQUE constraint failed: hypergraphs.id") {
+  static const std::string kInsert =
+      sqlutil::prepared_insert_statement("hypergraphs", {"id", "num_vertices", "num_hyperedges", "size", "blob"});
+  sqlite3_stmt *stmt = statement(kInsert);
+  if (stmt == nullptr) {
+    return ReportStatus::ERROR;
+  }
+  bind_text(stmt, 1, hypergraph.name);
+  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(num_vertices));
+  sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(num_hyperedges));
+  sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(size));
+  bind_text(stmt, 5, blob.str());
+
+  if (step(db_, stmt) != SQLITE_DONE) {
+    if (sqlite3_extended_errcode(db_) == SQLITE_CONSTRAINT_PRIMARYKEY) {
       return ReportStatus::ALREADY_THERE;
     }
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
     return ReportStatus::ERROR;
   }
 
@@ -253,21 +349,24 @@ std::tuple<ReportStatus, uint64_t> SqliteStore::report(const std::string &hyperg
   }
 
   // Cut not in store, need to add it
-  sqlutil::InsertStatementBuilder builder("cuts"s + std::to_string(info.k));
-  builder.add("hypergraph_id", hypergraph_id);
-  builder.add("val", info.cut_value);
-  builder.add("planted", planted ? 1 : 0);
+  std::vector<std::string> columns = {"hypergraph_id", "val", "planted"};
+  for (int i = 0; i < info.partitions.size(); ++i) {
+    columns.push_back("size_p"s + std::to_string(i + 1));
+    columns.push_back("blob_p"s + std::to_string(i + 1));
+  }
+  sqlite3_stmt *stmt = statement(sqlutil::prepared_insert_statement("cuts"s + std::to_string(info.k), columns));
+  if (stmt == nullptr) {
+    return {ReportStatus::ERROR, {}};
+  }
+  bind_text(stmt, 1, hypergraph_id);
+  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(info.cut_value));
+  sqlite3_bind_int(stmt, 3, planted ? 1 : 0);
   for (int i = 0; i < info.partitions.size(); ++i) {
-    builder.add("size_p"s + std::to_string(i + 1), info.partitions.at(i).size());
-    builder.add("blob_p"s + std::to_string(i + 1), partition_to_str(info.partitions.at(i)));
+    sqlite3_bind_int64(stmt, 4 + 2 * i, static_cast<sqlite3_int64>(info.partitions.at(i).size()));
+    bind_text(stmt, 5 + 2 * i, partition_to_str(info.partitions.at(i)));
   }
-  const auto insert_stmt = builder.string();
 
-  char *zErrMsg{};
-  int err = sqlite3_exec(db_, insert_stmt.c_str(), null_callback, nullptr, &zErrMsg);
-  if (err != SQLITE_OK) {
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
+  if (step(db_, stmt) != SQLITE_DONE) {
     return {ReportStatus::ERROR, {}};
   }
   sqlite3_int64 rowid = sqlite3_last_insert_rowid(db_);
@@ -275,65 +374,81 @@ std::tuple<ReportStatus, uint64_t> SqliteStore::report(const std::string &hyperg
   return {ReportStatus::OK, {static_cast<unsigned long long>(rowid)}};
 }
 
+ReportStatus SqliteStore::insert_run(const std::string &hypergraph_id,
+                                     const std::optional<uint64_t> &cut_id,
+                                     const CutRunInfo &info,
+                                     const size_t num_runs_for_discovery,
+                                     const size_t num_contractions) {
+  static const std::string kInsert = [] {
+    std::vector<std::string> columns = {"algo", "k", "hypergraph_id", "cut_id", "time_elapsed_ms", "machine",
+                                        "experiment_id", "num_runs_for_discovery", "num_contractions", "commit_hash",
+                                        "compiler_flags", "hardware"};
+    const auto counters = counter_columns();
+    columns.insert(std::end(columns), std::begin(counters), std::end(counters));
+    return sqlutil::prepared_insert_statement("runs", columns, "time_taken");
+  }();
+  sqlite3_stmt *stmt = statement(kInsert);
+  if (stmt == nullptr) {
+    return ReportStatus::ERROR;
+  }
+  bind_text(stmt, 1, info.algorithm);
+  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(info.info.k));
+  bind_text(stmt, 3, hypergraph_id);
+  if (cut_id.has_value()) {
+    sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(cut_id.value()));
+  }
+  sqlite3_bind_int64(stmt, 5, static_cast<sqlite3_int64>(info.time));
+  bind_text(stmt, 6, info.machine);
+  bind_text(stmt, 7, info.experiment_id);
+  sqlite3_bind_int64(stmt, 8, static_cast<sqlite3_int64>(num_runs_for_discovery));
+  sqlite3_bind_int64(stmt, 9, static_cast<sqlite3_int64>(num_contractions));
+  bind_text(stmt, 10, info.commit);
+  bind_text(stmt, 11, info.compiler_flags);
+  bind_text(stmt, 12, info.hardware);
+  bind_counters(stmt, 13, info.counters);
+
+  if (step(db_, stmt) != SQLITE_DONE) {
+    return ReportStatus::ERROR;
+  }
+  return ReportStatus::OK;
+}
+
 ReportStatus SqliteStore::report(const std::string &hypergraph_id,
                                  const uint64_t cut_id,
                                  const CutRunInfo &info,
                                  const size_t num_runs_for_discovery,
                                  const size_t num_contractions) {
-  // TODO git hash
-  const std::string stmt = sqlutil::insert_statement(
-      "runs",
-      mst("algo", info.algorithm),
-      mit("k", info.info.k),
-      mst("hypergraph_id", hypergraph_id),
-      mit("cut_id", cut_id),
-      mit("time_elapsed_ms", info.time),
-      mst("machine", info.machine),
-      std::make_tuple<std::string, sqlutil::TimeNow>("time_taken", {}),
-      mst("experiment_id", info.experiment_id),
-      mit("num_runs_for_discovery", num_runs_for_discovery),
-      mit("num_contractions", num_contractions)
-  );
-
-  char *zErrMsg{};
-  int err = sqlite3_exec(db_, stmt.c_str(), null_callback, nullptr, &zErrMsg);
-  if (err != SQLITE_OK) {
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
-    return ReportStatus::ERROR;
-  }
-
-  return ReportStatus::OK;
+  return insert_run(hypergraph_id, cut_id, info, num_runs_for_discovery, num_contractions);
 }
 
 ReportStatus SqliteStore::report(const std::string &hypergraph_id,
                                  const CutRunInfo &info,
                                  size_t num_runs_for_discovery,
                                  size_t num_contractions) {
-  const std::string stmt = sqlutil::insert_statement(
-      "runs",
-      mst("algo", info.algorithm),
-      mit("k", info.info.k),
-      mst("hypergraph_id", hypergraph_id),
-      mit("time_elapsed_ms", info.time),
-      mst("machine", info.machine),
-      std::make_tuple<std::string, sqlutil::TimeNow>("time_taken", {}),
-      mst("experiment_id", info.experiment_id),
-      mit("num_runs_for_discovery", num_runs_for_discovery),
-      mit("num_contractions", num_contractions)
-  );
+  return insert_run(hypergraph_id, std::nullopt, info, num_runs_for_discovery, num_contractions);
+}
 
-  char *zErrMsg{};
-  int err = sqlite3_exec(db_, stmt.c_str(), null_callback, nullptr, &zErrMsg);
-  if (err != SQLITE_OK) {
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
-    return ReportStatus::ERROR;
+size_t SqliteStore::num_completed_runs(const std::string &hypergraph_id,
+                                       const std::string &algorithm,
+                                       const std::string &experiment_id) {
+  sqlite3_stmt *stmt = statement("SELECT COUNT(*) FROM runs WHERE hypergraph_id = ? AND algo = ? AND experiment_id = ?");
+  if (stmt == nullptr) {
+    return 0;
   }
-  return ReportStatus::OK;
+  bind_text(stmt, 1, hypergraph_id);
+  bind_text(stmt, 2, algorithm);
+  bind_text(stmt, 3, experiment_id);
+  if (sqlite3_step(stmt) != SQLITE_ROW) {
+    fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_));
+    return 0;
+  }
+  return static_cast<size_t>(sqlite3_column_int64(stmt, 0));
 }
 
 SqliteStore::~SqliteStore() {
+  for (auto &[sql, stmt] : statements_) {
+    sqlite3_finalize(stmt);
+  }
   sqlite3_close(db_);
 }
 
@@ -344,39 +459,148 @@ std::optional<std::tuple<bool, uint64_t>> SqliteStore::has_cut(const std::string
   std::string table_name = "cuts"s + std::to_string(info.k);
 
   std::stringstream query;
-  query << "SELECT id FROM " << table_name << " WHERE hypergraph_id = '" << hypergraph_id << "'" << " AND val = "
-        << info.cut_value;
+  query << "SELECT id FROM " << table_name << " WHERE hypergraph_id = ? AND val = ?";
   for (int i = 0; i < info.partitions.size(); ++i) {
-    const auto &partition = info.partitions[i];
-    query << " AND " << "size_p" << std::to_string(i + 1) << " = " << partition.size()
-          << " AND " << "blob_p" << std::to_string(i + 1) << " = '" << partition_to_str(partition) << "'";
+    query << " AND " << "size_p" << std::to_string(i + 1) << " = ?"
+          << " AND " << "blob_p" << std::to_string(i + 1) << " = ?";
   }
   query << " LIMIT 1;";
 
-  std::tuple<bool, uint64_t> result;
+  sqlite3_stmt *stmt = statement(query.str());
+  if (stmt == nullptr) {
+    return {};
+  }
+  bind_text(stmt, 1, hypergraph_id);
+  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(info.cut_value));
+  for (int i = 0; i < info.partitions.size(); ++i) {
+    sqlite3_bind_int64(stmt, 3 + 2 * i, static_cast<sqlite3_int64>(info.partitions[i].size()));
+    bind_text(stmt, 4 + 2 * i, partition_to_str(info.partitions[i]));
+  }
+
+  switch (sqlite3_step(stmt)) {
+    case SQLITE_ROW:
+      return {{true, static_cast<uint64_t>(sqlite3_column_int64(stmt, 0))}};
+    case SQLITE_DONE:
+      return {{false, 0}};
+    default:
+      fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_));
+      return {};
+  }
+}
+
+BatchingStore::BatchingStore(std::shared_ptr<CutInfoStore> store, const size_t max_batch_size)
+    : store_(std::move(store)), max_batch_size_(max_batch_size), writer_(&BatchingStore::work, this) {}
 
-  char *zErrMsg{};
-  int err = sqlite3_exec(db_, query.str().c_str(), [](void *input, int argc, char **argv, char **col_names) {
-    using RetT = std::tuple<bool, uint64_t>;
-    RetT &result = *reinterpret_cast<RetT *>(input);
-    if (argc == 0) {
-      result = {false, 0};
+BatchingStore::~BatchingStore() {
+  flush();
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_one();
+  writer_.join();
+}
+
+void BatchingStore::enqueue(Write write) {
+  {
+    std::lock_guard lock(mutex_);
+    writes_.push_back(std::move(write));
+    ++unfinished_;
+  }
+  queued_.notify_one();
+}
+
+template<typename T>
+T BatchingStore::call(std::function<T(CutInfoStore &)> write) {
+  // Shared, since the writer may still be in set_value when the future is ready
+  auto result = std::make_shared<std::promise<T>>();
+  auto future = result->get_future();
+  enqueue([result, &write](CutInfoStore &store) { result->set_value(write(store)); });
+  return future.get();
+}
+
+void BatchingStore::flush() {
+  std::unique_lock lock(mutex_);
+  written_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+void BatchingStore::work() {
+  std::vector<Write> batch;
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      queued_.wait(lock, [this] { return stopping_ || !writes_.empty(); });
+      if (writes_.empty()) {
+        return;
+      }
+      while (!writes_.empty() && batch.size() < max_batch_size_) {
+        batch.push_back(std::move(writes_.front()));
+        writes_.pop_front();
+      }
     }
 
-    // Otherwise parse ID
-    std::stringstream ss;
-    ss << argv[0];
-    uint64_t id;
-    ss >> id;
+    const bool in_batch = store_->begin_batch();
+    for (auto &write : batch) {
+      write(*store_);
+    }
+    if (in_batch && !store_->commit_batch()) {
+      std::cerr << "Failed to commit a batch of " << batch.size() << " reports" << std::endl;
+    }
 
-    result = {true, id};
-    return 0;
-  }, &result, &zErrMsg);
-  if (err != SQLITE_OK) {
-    fprintf(stderr, "SQL error: %s\n", zErrMsg);
-    sqlite3_free(zErrMsg);
-    return {};
+    {
+      std::lock_guard lock(mutex_);
+      unfinished_ -= batch.size();
+    }
+    batch.clear();
+    written_.notify_all();
   }
+}
+
+ReportStatus BatchingStore::report(const HypergraphWrapper &hypergraph) {
+  return call<ReportStatus>([&hypergraph](CutInfoStore &store) { return store.report(hypergraph); });
+}
+
+ReportStatus BatchingStore::report(const HypergraphGenerator &hypergraph) {
+  return call<ReportStatus>([&hypergraph](CutInfoStore &store) { return store.report(hypergraph); });
+}
+
+std::tuple<ReportStatus, uint64_t> BatchingStore::report(const std::string &hypergraph_id,
+                                                         const CutInfo &info,
+                                                         bool planted) {
+  return call<std::tuple<ReportStatus, uint64_t>>([&](CutInfoStore &store) {
+    return store.report(hypergraph_id, info, planted);
+  });
+}
+
+ReportStatus BatchingStore::report(const std::string &hypergraph_id,
+                                   const uint64_t cut_id,
+                                   const CutRunInfo &info,
+                                   const size_t num_runs_for_discovery,
+                                   const size_t num_contractions) {
+  enqueue([=](CutInfoStore &store) {
+    if (store.report(hypergraph_id, cut_id, info, num_runs_for_discovery, num_contractions) == ReportStatus::ERROR) {
+      std::cerr << "Failed to report a run of " << info.algorithm << " on " << hypergraph_id << std::endl;
+    }
+  });
+  return ReportStatus::OK;
+}
+
+ReportStatus BatchingStore::report(const std::string &hypergraph_id,
+                                   const CutRunInfo &info,
+                                   const size_t num_runs_for_discovery,
+                                   const size_t num_contractions) {
+  enqueue([=](CutInfoStore &store) {
+    if (store.report(hypergraph_id, info, num_runs_for_discovery, num_contractions) == ReportStatus::ERROR) {
+      std::cerr << "Failed to report a run of " << info.algorithm << " on " << hypergraph_id << std::endl;
+    }
+  });
+  return ReportStatus::OK;
+}
 
-  return {result};
+size_t BatchingStore::num_completed_runs(const std::string &hypergraph_id,
+                                         const std::string &algorithm,
+                                         const std::string &experiment_id) {
+  return call<size_t>([&](CutInfoStore &store) {
+    return store.num_completed_runs(hypergraph_id, algorithm, experiment_id);
+  });
 }
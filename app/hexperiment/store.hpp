@@ -5,8 +5,16 @@
 #ifndef HYPERGRAPHPARTITIONING_EXPERIMENT_STORE_HPP
 #define HYPERGRAPHPARTITIONING_EXPERIMENT_STORE_HPP
 
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 
 #include <generators/generators.hpp>
 
@@ -60,14 +68,37 @@ public:
                               size_t num_runs_for_discovery,
                               size_t num_contractions) = 0;
 
+  /**
+   * The number of runs of an algorithm on a hypergraph that an experiment has reported, so that an interrupted
+   * experiment can resume where it left off. 0 if the store cannot tell.
+   */
+  virtual size_t num_completed_runs(const std::string & /* hypergraph_id */,
+                                    const std::string & /* algorithm */,
+                                    const std::string & /* experiment_id */) { return 0; }
+
+  /**
+   * Group the reports made until commit_batch() so that they are persisted together, if the store supports it.
+   */
+  virtual bool begin_batch() { return true; }
+  virtual bool commit_batch() { return true; }
+
+  /**
+   * Block until every report made so far is persisted.
+   */
+  virtual void flush() {}
+
   virtual ~CutInfoStore() = default;
 };
 
-// Forward declaration for SqliteStore
-class sqlite3;
+// Forward declarations for SqliteStore
+struct sqlite3;
+struct sqlite3_stmt;
 
 /**
- * Persists experimental data to a sqlite database.
+ * Persists experimental data to a sqlite database. The database is opened in WAL mode and every statement is prepared
+ * once and reused. A batch is a transaction.
+ *
+ * Not thread safe, wrap it in a BatchingStore to report from several threads.
  */
 class SqliteStore : public CutInfoStore {
 public:
@@ -89,12 +120,97 @@ public:
                       size_t num_runs_for_discovery,
                       size_t num_contractions) override;
 
+  size_t num_completed_runs(const std::string &hypergraph_id,
+                            const std::string &algorithm,
+                            const std::string &experiment_id) override;
+
+  bool begin_batch() override;
+  bool commit_batch() override;
+
   ~SqliteStore() override;
 private:
 
   std::optional<std::tuple<bool, uint64_t>> has_cut(const std::string &hypergraph_id, const CutInfo &info);
 
-  sqlite3 *db_;
+  // The prepared statement for some SQL, reset and with its parameters cleared. Null on failure.
+  sqlite3_stmt *statement(const std::string &sql);
+
+  // Insert a run, with a NULL cut ID if there is none
+  ReportStatus insert_run(const std::string &hypergraph_id,
+                          const std::optional<uint64_t> &cut_id,
+                          const CutRunInfo &info,
+                          size_t num_runs_for_discovery,
+                          size_t num_contractions);
+
+  sqlite3 *db_ = nullptr;
+  // Prepared statements by their SQL
+  std::unordered_map<std::string, sqlite3_stmt *> statements_;
+};
+
+/**
+ * Makes another store safe to report to from several threads by handing all reports to a single writer thread.
+ *
+ * Reports of runs are queued and return right away, their errors are only logged. Reports of hypergraphs and cuts
+ * block until the writer has made them, since the caller needs their result. The writer makes the reports that pile
+ * up while it is busy in one batch of at most `max_batch_size` reports.
+ */
+class BatchingStore : public CutInfoStore {
+public:
+  explicit BatchingStore(std::shared_ptr<CutInfoStore> store, size_t max_batch_size = 1024);
+
+  BatchingStore(const BatchingStore &) = delete;
+  BatchingStore &operator=(const BatchingStore &) = delete;
+
+  ReportStatus report(const HypergraphWrapper &hypergraph) override;
+  ReportStatus report(const HypergraphGenerator &hypergraph) override;
+
+  std::tuple<ReportStatus, uint64_t> report(const std::string &hypergraph_id,
+                                            const CutInfo &info,
+                                            bool planted) override;
+  ReportStatus report(const std::string &hypergraph_id,
+                      uint64_t cut_id,
+                      const CutRunInfo &info,
+                      size_t num_runs_for_discovery,
+                      size_t num_contractions) override;
+  ReportStatus report(const std::string &hypergraph_id,
+                      const CutRunInfo &info,
+                      size_t num_runs_for_discovery,
+                      size_t num_contractions) override;
+
+  // Counts the runs queued before the call too
+  size_t num_completed_runs(const std::string &hypergraph_id,
+                            const std::string &algorithm,
+                            const std::string &experiment_id) override;
+
+  void flush() override;
+
+  // Flushes and stops the writer
+  ~BatchingStore() override;
+
+private:
+  using Write = std::function<void(CutInfoStore &)>;
+
+  void enqueue(Write write);
+
+  // Enqueue a write and wait for its result
+  template<typename T>
+  T call(std::function<T(CutInfoStore &)> write);
+
+  void work();
+
+  std::shared_ptr<CutInfoStore> store_;
+  size_t max_batch_size_;
+
+  std::mutex mutex_;
+  // Signalled when a write is queued or the writer stops
+  std::condition_variable queued_;
+  // Signalled when the writer has finished a batch
+  std::condition_variable written_;
+  std::deque<Write> writes_;
+  // Writes queued or in the batch being written
+  size_t unfinished_ = 0;
+  bool stopping_ = false;
+  std::thread writer_;
 };
 
 #endif //HYPERGRAPHPARTITIONING_EXPERIMENT_STORE_HPP
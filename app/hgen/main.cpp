@@ -2,6 +2,7 @@
 
 #include <tclap/CmdLine.h>
 #include <generators/generators.hpp>
+#include <hypergraph/io.hpp>
 
 TCLAP::CmdLine cmd("Hypergraph instance generator", ' ', "0.1");
 
@@ -89,9 +90,31 @@ int main(int argc, char *argv[]) {
   TCLAP::UnlabeledValueArg<std::string>
       instanceArg("instance", "Type of instance to generate", true, "", &allowedInstances, cmd);
 
+  TCLAP::SwitchArg binaryArg("b", "binary", "Write the hypergraph and its planted cut in the binary format", cmd);
+
+  TCLAP::ValueArg<size_t> threadsArg("t",
+                                     "threads",
+                                     "Sample the edges of planted instances on this many threads and write them as they "
+                                     "are sampled, without building the hypergraph. The instance does not depend on the "
+                                     "number of threads, but differs from the one generated without this flag",
+                                     false,
+                                     0,
+                                     "threads",
+                                     cmd);
+
   cmd.parse(argc, argv);
 
+  const auto write = [binary = binaryArg.getValue()](const auto &generated) {
+    const auto &[hypergraph, cut] = generated;
+    if (binary) {
+      std::cout << hypergraphlib::as_binary(hypergraph, cut ? &*cut : nullptr);
+    } else {
+      std::cout << hypergraph;
+    }
+  };
+
   const std::string instance = instanceArg.getValue();
+  const size_t num_threads = threadsArg.getValue();
 
   if (instance == "planted") {
     PlantedHypergraph generator(
@@ -103,8 +126,11 @@ int main(int argc, char *argv[]) {
         params.at("k"),
         static_cast<size_t>(params.at("seed"))
     );
-    auto[hypergraph, _] = generator.generate();
-    std::cout << hypergraph;
+    if (num_threads > 0) {
+      generator.write(std::cout, binaryArg.getValue(), num_threads);
+    } else {
+      write(generator.generate());
+    }
   } else if (instance == "planted_constant_rank") {
     UniformPlantedHypergraph generator(
         params.at("num_vertices"),
@@ -114,8 +140,11 @@ int main(int argc, char *argv[]) {
         params.at("m2"),
         static_cast<size_t>(params.at("seed"))
     );
-    auto[hypergraph, _] = generator.generate();
-    std::cout << hypergraph;
+    if (num_threads > 0) {
+      generator.write(std::cout, binaryArg.getValue(), num_threads);
+    } else {
+      write(generator.generate());
+    }
   } else if (instance == "ring") {
     RandomRingConstantEdgeHypergraph generator(
         params.at("num_vertices"),
@@ -123,8 +152,7 @@ int main(int argc, char *argv[]) {
         params.at("mean"),
         static_cast<size_t>(params.at("seed"))
     );
-    auto[hypergraph, _] = generator.generate();
-    std::cout << hypergraph;
+    write(generator.generate());
   } else {
     std::cerr << "No such instance '" << instance << "'" << std::endl;
     return 1;
@@ -14,6 +14,7 @@
 #include <filesystem>
 
 #include <hypergraph/hypergraph.hpp>
+#include <hypergraph/io.hpp>
 #include <hypergraph/order.hpp>
 
 using std::begin, std::end;
@@ -27,15 +28,24 @@ int run(const HypergraphType &h, const std::string &filename, const std::filesys
 
   auto rank = h.rank();
 
+  // The core numbers of all vertices are found in one pass, after which each k-core is extracted in linear time
+  std::cout << "Computing core decomposition..." << std::endl;
+  const CoreDecomposition decomposition(h);
+
   for (size_t k = 2; k < rank; ++k) {
-    std::cout << "Computing k-core decomposition with k = " << k << "..." << std::endl;
-    auto kcore = kCoreDecomposition(h, k);
+    if (k > decomposition.max_core()) {
+      std::cout << "The " << k << "-core is empty, stopping" << std::endl;
+      break;
+    }
 
-    if (kcore.num_vertices() == h.num_vertices()) {
-      std::cout << "Decomposition did not reduce graph, continuing..." << std::endl;
+    if (decomposition.num_vertices(k) == h.num_vertices()) {
+      std::cout << "Decomposition with k = " << k << " did not reduce graph, continuing..." << std::endl;
       continue;
     }
 
+    std::cout << "Extracting k-core decomposition with k = " << k << "..." << std::endl;
+    auto kcore = decomposition.core(k);
+
     std::cout << "Computed k-core decomposition\n"
               << "Vertices: " << h.num_vertices() << " -> " << kcore.num_vertices() << "\n"
               << "Edges: " << h.num_edges() << " -> " << kcore.num_edges() << std::endl;
@@ -72,24 +82,32 @@ int run(const HypergraphType &h, const std::string &filename, const std::filesys
 }
 
 bool hmetis_file_is_unweighted(const std::string &filename) {
-  std::ifstream input;
-  input.open(filename);
-  return is_unweighted_hmetis_file(input);
+  try {
+    return is_unweighted_hypergraph_file(filename);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
 }
 
 // Attempts to read a hypergraph from a file
 template<typename HypergraphType>
 bool parse_hypergraph(const std::string &filename, HypergraphType &hypergraph) {
-  std::ifstream input;
-  input.open(filename);
-  input >> hypergraph;
-  return true;
+  try {
+    hypergraph = read_hypergraph_file<HypergraphType>(filename);
+    return true;
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
 }
 
 int main(int argc, char **argv) {
   if (hmetis_file_is_unweighted(argv[1])) {
     Hypergraph h;
-    assert(parse_hypergraph(argv[1], h));
+    if (!parse_hypergraph(argv[1], h)) {
+      return 1;
+    }
     run<Hypergraph>(h, argv[1], argv[2]);
   } else {
     assert(false);
@@ -1,49 +1,50 @@
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <string>
 
 #include "hypergraph/hypergraph.hpp"
 #include "hypergraph/certificate.hpp"
+#include "hypergraph/io.hpp"
 
 using namespace hypergraphlib;
 
 bool hmetis_file_is_unweighted(const std::string &filename) {
-  std::ifstream input;
-  input.open(filename);
-  return is_unweighted_hmetis_file(input);
-}
-
-bool parse_hypergraph(const std::string &filename, Hypergraph &hypergraph) {
-  std::ifstream input;
-  input.open(filename);
-  input >> hypergraph;
-  return input.eof();
+  try {
+    return is_unweighted_hypergraph_file(filename);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
 }
 
-int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cerr << "Usage: " << argv[0] << " <input file> <c>" << std::endl;
-    return 1;
-  }
-
-  int k = std::atoi(argv[2]);
-
-  if (!hmetis_file_is_unweighted(argv[1])) {
-    std::cerr << argv[1] << " is not an unweighted hmetis file." << std::endl;
-    return 1;
+template<typename HypergraphType>
+bool parse_hypergraph(const std::string &filename, HypergraphType &hypergraph) {
+  try {
+    hypergraph = read_hypergraph_file<HypergraphType>(filename);
+    return true;
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
   }
+}
 
-  Hypergraph hypergraph;
-  if (!parse_hypergraph(argv[1], hypergraph)) {
-    std::cout << "Failed to parse hypergraph in " << argv[1] << std::endl;
+// Write the c-trimmed certificate of the hypergraph in the file to sparse_<file>
+template<typename HypergraphType>
+int sparsify(const std::string &filename, const typename HypergraphType::EdgeWeight c) {
+  HypergraphType hypergraph;
+  if (!parse_hypergraph(filename, hypergraph)) {
+    std::cout << "Failed to parse hypergraph in " << filename << std::endl;
     return 1;
   }
 
   // Sparsify
-  KTrimmedCertificate certificate(hypergraph);
+  const certificate_t<HypergraphType> certificate(hypergraph);
 
-  Hypergraph sparse = certificate.certificate(k);
+  const HypergraphType sparse = certificate.certificate(c);
 
-  std::string new_filename = std::string("sparse_") + argv[1];
+  std::string new_filename = std::string("sparse_") + filename;
 
   std::ofstream stream;
   stream.open(new_filename);
@@ -56,3 +57,87 @@ int main(int argc, char **argv) {
 
   return 0;
 }
+
+/* Write a certificate of the hypergraph in the hMETIS file that keeps cut values up to c to sparse_<file>, reading the
+ * file a chunk at a time so that the hypergraph never has to fit in memory. Edges are written to a temporary file as
+ * they are kept, since the header holds their number. Weights have to be integers.
+ */
+int sparsify_stream(const std::string &filename, const size_t c) {
+  const std::string new_filename = std::string("sparse_") + filename;
+  const std::string body_filename = new_filename + ".edges";
+  size_t num_vertices = 0;
+  size_t num_kept = 0;
+  bool weighted = false;
+  try {
+    if (BinaryHypergraphFile::is_binary_file(filename)) {
+      std::cerr << "Streaming only reads hMETIS files" << std::endl;
+      return 1;
+    }
+    weighted = !is_unweighted_hmetis_file(filename);
+
+    std::ifstream input(filename);
+    io::HmetisReader<size_t> reader(input, weighted);
+    num_vertices = reader.num_vertices();
+    StreamingCertificate certificate(num_vertices, c);
+
+    std::ofstream body(body_filename);
+    io::HmetisData<size_t> chunk;
+    while (reader.next(chunk)) {
+      for (size_t e = 0; e + 1 < chunk.edge_offsets.size(); ++e) {
+        const auto begin = std::begin(chunk.pins) + static_cast<std::ptrdiff_t>(chunk.edge_offsets[e]);
+        const auto end = std::begin(chunk.pins) + static_cast<std::ptrdiff_t>(chunk.edge_offsets[e + 1]);
+        const size_t weight = certificate.add(begin, end, weighted ? chunk.edge_weights[e] : 1);
+        if (weight == 0) {
+          continue;
+        }
+        ++num_kept;
+        if (weighted) {
+          body << weight;
+        }
+        for (auto it = begin; it != end; ++it) {
+          body << (weighted || it != begin ? " " : "") << *it;
+        }
+        body << "\n";
+      }
+    }
+    if (!body.flush()) {
+      throw std::runtime_error("could not write " + body_filename);
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    std::cout << "Failed to sparsify hypergraph in " << filename << std::endl;
+    std::remove(body_filename.c_str());
+    return 1;
+  }
+
+  std::ofstream stream(new_filename);
+  stream << num_kept << " " << num_vertices << (weighted ? " 1" : "") << "\n";
+  {
+    std::ifstream body(body_filename);
+    if (num_kept > 0) {
+      stream << body.rdbuf();
+    }
+  }
+  stream.close();
+  std::remove(body_filename.c_str());
+
+  std::cout << new_filename << std::endl;
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const bool stream = argc == 4 && std::string(argv[1]) == "--stream";
+  if (argc != 3 && !stream) {
+    std::cerr << "Usage: " << argv[0] << " [--stream] <input file> <c>" << std::endl;
+    return 1;
+  }
+
+  if (stream) {
+    return sparsify_stream(argv[2], std::strtoul(argv[3], nullptr, 10));
+  }
+  if (hmetis_file_is_unweighted(argv[1])) {
+    return sparsify<Hypergraph>(argv[1], std::atoi(argv[2]));
+  }
+  return sparsify<WeightedHypergraph<double>>(argv[1], std::atof(argv[2]));
+}
@@ -6,6 +6,7 @@
 #define HYPERGRAPHPARTITIONING_EXPERIMENT_GENERATORS_HPP
 
 #include <cstddef>
+#include <ostream>
 #include <tuple>
 #include <random>
 #include <optional>
@@ -103,6 +104,14 @@ struct MXNHypergraph {
   std::string name();
 };
 
+/**
+ * The planted generators can also write their hypergraph straight to a stream with write(), sampling the edges on
+ * several threads without building the hypergraph. The edges are sampled in chunks of this many edges, and each chunk
+ * has its own random generator seeded with the seed of the generator and the index of the chunk. So the output only
+ * depends on the parameters and not on the number of threads, but it is not the hypergraph that generate() returns.
+ */
+constexpr size_t kEdgesPerChunk = 4096;
+
 /**
  * Divide the hypergraph into k equally-sized clusters.
  *
@@ -128,6 +137,12 @@ struct PlantedHypergraph : public HypergraphGenerator {
   [[nodiscard]]
   std::tuple<hypergraphlib::Hypergraph, std::optional<hypergraphlib::HypergraphCut<size_t>>> generate() const override;
 
+  /**
+   * Writes the hypergraph in hMETIS format, or in the binary format together with the planted cut, with its edges
+   * sampled on `num_threads` threads (see kEdgesPerChunk).
+   */
+  void write(std::ostream &os, bool binary, size_t num_threads) const;
+
   [[nodiscard]]
   std::string name() const override;
 
@@ -153,6 +168,12 @@ struct UniformPlantedHypergraph : public HypergraphGenerator {
   [[nodiscard]]
   std::tuple<hypergraphlib::Hypergraph, std::optional<hypergraphlib::HypergraphCut<size_t>>> generate() const override;
 
+  /**
+   * Writes the hypergraph in hMETIS format, or in the binary format together with the planted cut, with its edges
+   * sampled on `num_threads` threads (see kEdgesPerChunk).
+   */
+  void write(std::ostream &os, bool binary, size_t num_threads) const;
+
   [[nodiscard]]
   std::string name() const override;
 
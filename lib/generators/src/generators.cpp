@@ -4,6 +4,10 @@
 
 #include <generators/generators.hpp>
 
+#include <charconv>
+#include <thread>
+
+#include <hypergraph/io.hpp>
 #include <sqlite3.h>
 
 using std::begin, std::end;
@@ -104,6 +108,173 @@ int null_callback(void *,
   return 0;
 }
 
+// The first vertex of cluster i and the vertex after its last one, with the clusters laid out as in Cluster
+std::pair<size_t, size_t> cluster_range(const size_t n, const size_t k, const size_t i) {
+  const size_t size = n / k;
+  return {size * i, i == k - 1 ? n : size * (i + 1)};
+}
+
+size_t cluster_of(const size_t v, const size_t n, const size_t k) {
+  const size_t size = n / k;
+  return size == 0 ? k - 1 : std::min(v / size, k - 1);
+}
+
+// Appends every vertex in [begin, end) with probability p. Skipping ahead by geometrically distributed gaps makes this
+// take time proportional to the number of sampled vertices rather than to end - begin.
+void sample_each(const size_t begin,
+                 const size_t end,
+                 const double p,
+                 std::mt19937_64 &gen,
+                 std::vector<int32_t> &pins) {
+  if (p <= 0) {
+    return;
+  }
+  if (p >= 1) {
+    for (size_t v = begin; v < end; ++v) {
+      pins.push_back(static_cast<int32_t>(v));
+    }
+    return;
+  }
+  std::geometric_distribution<size_t> gap(p);
+  for (size_t v = begin + gap(gen); v < end; v += gap(gen) + 1) {
+    pins.push_back(static_cast<int32_t>(v));
+  }
+}
+
+// Appends r distinct vertices from [begin, end), or all of them if there are fewer, in increasing order. Uses Floyd's
+// algorithm, which takes time proportional to r.
+void sample_distinct(const size_t begin,
+                     const size_t end,
+                     const size_t r,
+                     std::mt19937_64 &gen,
+                     std::vector<int32_t> &pins) {
+  const size_t first = pins.size();
+  if (r >= end - begin) {
+    for (size_t v = begin; v < end; ++v) {
+      pins.push_back(static_cast<int32_t>(v));
+    }
+    return;
+  }
+  auto &marker = detail::VertexMarker::local();
+  marker.start(end);
+  for (size_t j = end - begin - r; j < end - begin; ++j) {
+    const size_t t = begin + std::uniform_int_distribution<size_t>(0, j)(gen);
+    const size_t v = marker.mark(static_cast<int>(t)) ? begin + j : t;
+    marker.mark(static_cast<int>(v));
+    pins.push_back(static_cast<int32_t>(v));
+  }
+  std::sort(std::begin(pins) + first, std::end(pins));
+}
+
+// The edges sampled for one chunk
+struct EdgeChunk {
+  std::vector<uint64_t> edge_ends;
+  std::vector<int32_t> pins;
+  // The number of edges that cross the planted cut
+  size_t cut_value = 0;
+  // The edges as hMETIS lines, if the output is text
+  std::string text;
+};
+
+/* Samples `num_edges` edges in chunks of kEdgesPerChunk on `num_threads` threads, and writes them to `os` as they are
+ * sampled in hMETIS format, or at the end in binary format with the planted cut. `sample(i, gen, pins)` appends the
+ * vertices of edge i to `pins`.
+ *
+ * Only a bounded number of chunks are kept for the hMETIS format. The binary format needs the incidence lists before
+ * anything can be written, so its pins are kept in flat arrays, which take much less memory than a Hypergraph.
+ */
+template<typename SampleEdge>
+void write_in_chunks(std::ostream &os,
+                     const size_t n,
+                     const size_t k,
+                     const size_t num_edges,
+                     const uint64_t seed,
+                     const bool binary,
+                     size_t num_threads,
+                     const SampleEdge &sample) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  const size_t num_chunks = (num_edges + kEdgesPerChunk - 1) / kEdgesPerChunk;
+
+  const auto sample_chunk = [&](const size_t c, EdgeChunk &chunk) {
+    std::seed_seq seq{seed, static_cast<uint64_t>(c)};
+    std::mt19937_64 gen(seq);
+    chunk.edge_ends.clear();
+    chunk.pins.clear();
+    chunk.text.clear();
+    chunk.cut_value = 0;
+    for (size_t i = c * kEdgesPerChunk; i < std::min(num_edges, (c + 1) * kEdgesPerChunk); ++i) {
+      const size_t begin = chunk.pins.size();
+      sample(i, gen, chunk.pins);
+      const size_t cluster = begin < chunk.pins.size() ? cluster_of(chunk.pins[begin], n, k) : 0;
+      if (std::any_of(std::begin(chunk.pins) + begin, std::end(chunk.pins), [cluster, n, k](const int32_t v) {
+        return cluster_of(v, n, k) != cluster;
+      })) {
+        ++chunk.cut_value;
+      }
+      chunk.edge_ends.push_back(chunk.pins.size());
+    }
+    if (!binary) {
+      // Formatting takes longer than sampling, so it is done on the worker threads too
+      char buffer[16];
+      size_t begin = 0;
+      for (const uint64_t end : chunk.edge_ends) {
+        for (size_t i = begin; i < end; ++i) {
+          const auto result = std::to_chars(buffer, buffer + sizeof(buffer), chunk.pins[i]);
+          chunk.text.append(buffer, result.ptr);
+          chunk.text.push_back(' ');
+        }
+        chunk.text.push_back('\n');
+        begin = end;
+      }
+    }
+  };
+
+  std::vector<uint64_t> edge_offsets = {0};
+  std::vector<int32_t> pins;
+  size_t cut_value = 0;
+  if (binary) {
+    edge_offsets.reserve(num_edges + 1);
+  } else {
+    os << num_edges << " " << n << "\n";
+  }
+
+  // Chunks are sampled in rounds, and written in order after each round
+  std::vector<EdgeChunk> round(4 * num_threads);
+  for (size_t first = 0; first < num_chunks; first += round.size()) {
+    const size_t round_size = std::min(round.size(), num_chunks - first);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < std::min(num_threads, round_size); ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t i = t; i < round_size; i += num_threads) {
+          sample_chunk(first + i, round[i]);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i < round_size; ++i) {
+      auto &chunk = round[i];
+      cut_value += chunk.cut_value;
+      if (binary) {
+        const uint64_t offset = pins.size();
+        for (const uint64_t end : chunk.edge_ends) {
+          edge_offsets.push_back(offset + end);
+        }
+        pins.insert(std::end(pins), std::begin(chunk.pins), std::end(chunk.pins));
+      } else {
+        os.write(chunk.text.data(), static_cast<std::streamsize>(chunk.text.size()));
+      }
+    }
+  }
+
+  if (binary) {
+    const HypergraphCut<size_t> cut = Cluster::create_cut_from_cluster(cut_value, k, n);
+    io::write_binary<size_t>(os, n, edge_offsets, pins, {}, false, &cut);
+  }
+}
+
 }
 
 template<>
@@ -258,6 +429,19 @@ std::tuple<Hypergraph, std::optional<HypergraphCut<size_t>>> PlantedHypergraph::
   return {Hypergraph{vertices, edges}, cut};
 }
 
+void PlantedHypergraph::write(std::ostream &os, const bool binary, const size_t num_threads) const {
+  write_in_chunks(os, n, k, k * m1 + m2, seed, binary, num_threads,
+                  [this](const size_t i, std::mt19937_64 &gen, std::vector<int32_t> &pins) {
+                    if (i < k * m1) {
+                      // m1 edges from each cluster, then m2 from the entire hypergraph
+                      const auto [begin, end] = cluster_range(n, k, i / m1);
+                      sample_each(begin, end, p1, gen, pins);
+                    } else {
+                      sample_each(0, n, p2, gen, pins);
+                    }
+                  });
+}
+
 std::string PlantedHypergraph::name() const {
   std::stringstream ss;
   ss << "planted"
@@ -359,6 +543,18 @@ std::tuple<Hypergraph, std::optional<HypergraphCut<size_t>>> UniformPlantedHyper
   HypergraphCut<size_t> cut = Cluster::create_cut_from_cluster(cut_value, k, n);
   return {Hypergraph{vertices, edges}, cut};
 }
+void UniformPlantedHypergraph::write(std::ostream &os, const bool binary, const size_t num_threads) const {
+  write_in_chunks(os, n, k, k * m1 + m2, seed, binary, num_threads,
+                  [this](const size_t i, std::mt19937_64 &gen, std::vector<int32_t> &pins) {
+                    if (i < k * m1) {
+                      const auto [begin, end] = cluster_range(n, k, i / m1);
+                      sample_distinct(begin, end, r, gen, pins);
+                    } else {
+                      sample_distinct(0, n, r, gen, pins);
+                    }
+                  });
+}
+
 std::string UniformPlantedHypergraph::name() const {
   std::stringstream s;
   s << "uniformplanted_" << n << "_" << k << "_" << r << "_" << m1 << "_" << m2;
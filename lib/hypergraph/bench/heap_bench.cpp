@@ -0,0 +1,104 @@
+// Compares the heaps used for vertex orderings on a workload shaped like one: every value starts at key zero, keys are
+// incremented many times, and values are popped until the heap is empty.
+//
+// Usage: hypergraph_heap_bench [num_values] [increments_per_value] [repetitions]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hypergraph/heap.hpp"
+
+using namespace hypergraphlib;
+
+namespace {
+
+struct Workload {
+  std::vector<int> values;
+  size_t capacity;
+  // A pop is encoded as -1
+  std::vector<int> operations;
+  std::vector<double> amounts;
+};
+
+Workload make_workload(const size_t num_values, const size_t increments_per_value, const uint64_t seed) {
+  Workload workload;
+  workload.values.resize(num_values);
+  for (size_t i = 0; i < num_values; ++i) {
+    workload.values[i] = static_cast<int>(i);
+  }
+
+  // Each value is popped after increments_per_value random increments on average
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int> value(0, static_cast<int>(num_values) - 1);
+  std::uniform_real_distribution<double> amount(0.5, 2.0);
+  std::vector<size_t> keys(num_values, 0);
+  size_t max_key = 0;
+  for (size_t popped = 0; popped < num_values; ++popped) {
+    for (size_t i = 0; i < increments_per_value; ++i) {
+      const int v = value(rng);
+      workload.operations.push_back(v);
+      workload.amounts.push_back(amount(rng));
+      max_key = std::max(max_key, ++keys[v]);
+    }
+    workload.operations.push_back(-1);
+    workload.amounts.push_back(0);
+  }
+  workload.capacity = max_key + 1;
+  return workload;
+}
+
+// Run the workload and return a checksum of the popped keys, so that the work cannot be optimized away. Increments of
+// values that have been popped already are skipped. Which values those are depends on how the heap breaks ties, but
+// all heaps do the same number of pops and roughly the same number of increments.
+template<typename Heap, bool Weighted>
+double run(const Workload &workload) {
+  Heap heap(workload.values, workload.capacity);
+  std::vector<bool> popped(workload.values.size(), false);
+  double checksum = 0;
+  for (size_t i = 0; i < workload.operations.size(); ++i) {
+    const int v = workload.operations[i];
+    if (v < 0) {
+      const auto [key, value] = heap.pop_key_val();
+      popped[value] = true;
+      checksum += key;
+    } else if (popped[v]) {
+      continue;
+    } else if constexpr (Weighted) {
+      heap.increment(v, workload.amounts[i]);
+    } else {
+      heap.increment(v);
+    }
+  }
+  return checksum;
+}
+
+template<typename Heap, bool Weighted>
+void report(const std::string &name, const Workload &workload, const size_t repetitions) {
+  double checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < repetitions; ++i) {
+    checksum += run<Heap, Weighted>(workload);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const double ms = std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+  std::cout << name << ": " << ms << " ms per run (checksum " << checksum << ")" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  const size_t num_values = argc > 1 ? std::stoul(argv[1]) : 100000;
+  const size_t increments_per_value = argc > 2 ? std::stoul(argv[2]) : 8;
+  const size_t repetitions = argc > 3 ? std::stoul(argv[3]) : 5;
+
+  const Workload workload = make_workload(num_values, increments_per_value, 0);
+  std::cout << num_values << " values, " << workload.operations.size() << " operations" << std::endl;
+
+  report<BucketHeap, false>("BucketHeap", workload, repetitions);
+  report<IndexedBucketHeap, false>("IndexedBucketHeap", workload, repetitions);
+  report<FibonacciHeap<double>, true>("FibonacciHeap", workload, repetitions);
+  report<QuaternaryHeap<double>, true>("QuaternaryHeap", workload, repetitions);
+}
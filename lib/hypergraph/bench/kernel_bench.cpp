@@ -0,0 +1,234 @@
+// Microbenchmarks for the kernels behind the cut algorithms, on hypergraphs from the generators at several sizes.
+//
+// Benchmarks that take a hypergraph are parameterized by generator (0: planted, 1: uniform planted, 2: ring) and
+// number of vertices. To compare two commits, save the results of each as JSON with
+//
+//   hypergraph_bench --benchmark_out=<file>.json --benchmark_out_format=json
+//
+// and compare them with tools/compare.py from Google Benchmark.
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <generators/generators.hpp>
+
+#include "hypergraph/certificate.hpp"
+#include "hypergraph/compact.hpp"
+#include "hypergraph/cut.hpp"
+#include "hypergraph/cxy.hpp"
+#include "hypergraph/heap.hpp"
+#include "hypergraph/hypergraph.hpp"
+#include "hypergraph/io.hpp"
+#include "hypergraph/order.hpp"
+
+using namespace hypergraphlib;
+
+namespace {
+
+constexpr std::array<const char *, 3> kGeneratorNames = {"planted", "uniform_planted", "ring"};
+
+// Every generated hypergraph has about 8 pins per edge and between 1.25n and 4n edges, so the sizes of the
+// hypergraphs from different generators are comparable
+std::unique_ptr<HypergraphGenerator> make_generator(const int64_t generator, const size_t n) {
+  switch (generator) {
+    case 0: return std::make_unique<PlantedHypergraph>(n, n / 2, 16.0 / n, n / 4, 8.0 / n, 2, 777);
+    case 1: return std::make_unique<UniformPlantedHypergraph>(n, 2, 8, n / 2, n / 4, 777);
+    default: return std::make_unique<RandomRingConstantEdgeHypergraph>(n, 4 * n, 8.0 * 360 / n, 777);
+  }
+}
+
+// Generating is slower than most kernels, so every hypergraph is only generated once
+const Hypergraph &instance(const benchmark::State &state) {
+  static std::map<std::pair<int64_t, int64_t>, Hypergraph> instances;
+  const auto key = std::make_pair(state.range(0), state.range(1));
+  auto it = instances.find(key);
+  if (it == instances.end()) {
+    auto hypergraph = std::get<0>(make_generator(key.first, key.second)->generate());
+    hypergraph.remove_singleton_and_empty_hyperedges();
+    it = instances.emplace(key, std::move(hypergraph)).first;
+  }
+  return it->second;
+}
+
+void label(benchmark::State &state, const Hypergraph &hypergraph) {
+  state.SetLabel(kGeneratorNames[state.range(0)]);
+  state.counters["pins"] = static_cast<double>(hypergraph.size());
+}
+
+// Every generator at every size
+void generator_sizes(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"generator", "n"});
+  for (int64_t generator = 0; generator < static_cast<int64_t>(kGeneratorNames.size()); ++generator) {
+    for (const int64_t n : {250, 1000, 4000}) {
+      benchmark->Args({generator, n});
+    }
+  }
+}
+
+// Contract random pairs of vertices of a compact copy in place until two vertices are left
+void BM_ContractInPlace(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  const CompactHypergraph original(hypergraph);
+  std::mt19937_64 random_generator(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    CompactHypergraph compact(original);
+    std::vector<int> vertices(std::begin(compact.vertices()), std::end(compact.vertices()));
+    state.ResumeTiming();
+
+    while (vertices.size() > 2) {
+      std::uniform_int_distribution<size_t> dis(0, vertices.size() - 1);
+      const size_t i = dis(random_generator);
+      size_t j = dis(random_generator);
+      if (i == j) {
+        continue;
+      }
+      const int pair[] = {vertices[i], vertices[j]};
+      vertices[i] = compact.contract_in_place<false>(std::begin(pair), std::end(pair));
+      vertices[j] = vertices.back();
+      vertices.pop_back();
+    }
+    benchmark::DoNotOptimize(compact.num_edges());
+  }
+  label(state, hypergraph);
+}
+BENCHMARK(BM_ContractInPlace)->Apply(generator_sizes);
+
+template<tightening_t<Hypergraph> Tighten>
+void BM_Ordering(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  const int a = *std::begin(hypergraph.vertices());
+  OrderingContext<Hypergraph::Heap> ctx;
+  for (auto _ : state) {
+    ordering<Hypergraph, Tighten>(hypergraph, a, ctx);
+    benchmark::DoNotOptimize(ctx.ordering.data());
+  }
+  label(state, hypergraph);
+}
+BENCHMARK_TEMPLATE(BM_Ordering, tight_ordering_tighten<Hypergraph>)->Name("BM_TightOrdering")->Apply(generator_sizes);
+BENCHMARK_TEMPLATE(BM_Ordering, queyranne_ordering_tighten<Hypergraph>)->Name("BM_QueyranneOrdering")
+    ->Apply(generator_sizes);
+
+// Pop every vertex from a bucket heap whose keys are the degrees of the vertices
+void BM_BucketHeapPopKeyVal(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  const std::vector<int> vertices(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
+  size_t max_degree = 0;
+  for (const int v : vertices) {
+    max_degree = std::max(max_degree, hypergraph.edges_incident_on(v).size());
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    BucketHeap heap(vertices, max_degree + 1);
+    for (const int v : vertices) {
+      for (size_t i = 0; i < hypergraph.edges_incident_on(v).size(); ++i) {
+        heap.increment(v);
+      }
+    }
+    state.ResumeTiming();
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      benchmark::DoNotOptimize(heap.pop_key_val());
+    }
+  }
+  label(state, hypergraph);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * vertices.size()));
+}
+BENCHMARK(BM_BucketHeapPopKeyVal)->Apply(generator_sizes);
+
+void BM_Certificate(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  const KTrimmedCertificate certificate(hypergraph);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(certificate.certificate(4).size());
+  }
+  label(state, hypergraph);
+}
+BENCHMARK(BM_Certificate)->Apply(generator_sizes);
+
+// Score 16 random 2-way partitions, one at a time (batch 0) or all in one pass over the edges (batch 1)
+void BM_CutEvaluator(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  const CutEvaluator evaluator(hypergraph);
+  constexpr size_t kNumCuts = 16;
+  const size_t n = evaluator.num_vertices();
+  std::mt19937_64 random_generator(0);
+  std::uniform_int_distribution<int> side(0, 1);
+  std::vector<std::vector<int>> labellings(kNumCuts, std::vector<int>(n));
+  std::vector<int> interleaved(n * kNumCuts);
+  for (size_t j = 0; j < kNumCuts; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      labellings[j][i] = interleaved[i * kNumCuts + j] = side(random_generator);
+    }
+  }
+
+  for (auto _ : state) {
+    if (state.range(2) == 0) {
+      for (const auto &labels : labellings) {
+        benchmark::DoNotOptimize(evaluator.value(labels));
+      }
+    } else {
+      benchmark::DoNotOptimize(evaluator.values(interleaved, kNumCuts).data());
+    }
+  }
+  label(state, hypergraph);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kNumCuts));
+}
+BENCHMARK(BM_CutEvaluator)->ArgNames({"generator", "n", "batch"})->ArgsProduct({{0, 1, 2}, {250, 1000, 4000}, {0, 1}});
+
+// Parse the hMETIS text of the hypergraph on one thread
+void BM_ParseHmetis(benchmark::State &state) {
+  const Hypergraph &hypergraph = instance(state);
+  std::stringstream stream;
+  stream << hypergraph;
+  const std::string contents = stream.str();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(io::parse_hmetis<size_t>(contents, false, 1).pins.size());
+  }
+  label(state, hypergraph);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * contents.size()));
+}
+BENCHMARK(BM_ParseHmetis)->Apply(generator_sizes);
+
+// Arguments are the number of vertices and the size of the edge, with k = 2
+void BM_CxyDelta(benchmark::State &state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const auto size = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cxy::cxy_delta(n, size, 2));
+  }
+}
+BENCHMARK(BM_CxyDelta)->ArgNames({"n", "size"})->ArgsProduct({{1000, 1000000}, {2, 64, 512}});
+
+void BM_CxyDeltaTable(benchmark::State &state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const auto size = static_cast<size_t>(state.range(1));
+  const cxy::DeltaTable delta(n, 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(delta(n, size));
+  }
+}
+BENCHMARK(BM_CxyDeltaTable)->ArgNames({"n", "size"})->ArgsProduct({{1000, 1000000}, {2, 64, 512}});
+
+void BM_CxyFixedKDelta(benchmark::State &state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const auto size = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cxy::fixed_k_delta<2>(n, size));
+  }
+}
+BENCHMARK(BM_CxyFixedKDelta)->ArgNames({"n", "size"})->ArgsProduct({{1000, 1000000}, {2, 64, 512}});
+
+}
+
+BENCHMARK_MAIN();
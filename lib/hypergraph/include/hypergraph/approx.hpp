@@ -1,83 +1,167 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "hypergraph.hpp"
+#include "compact.hpp"
 #include "certificate.hpp"
 #include "order.hpp"
 
 namespace hypergraphlib {
 
-/* Approximate (2+epsilon) hypergraph minimum cut from [CX'18].
+namespace detail {
+
+// Vertices per thread below which scanning the degrees is not worth starting another thread
+constexpr size_t kMinVerticesPerThread = 1 << 14;
+
+/* A vertex of minimum degree (the weight of the edges incident on it) and its degree. The vertices are split between
+ * up to `num_threads` threads, and ties go to the vertex that comes first.
  *
- * Time complexity: O(p/epsilon), p is the size of the hypergraph
+ * Time complexity: O(p), where p is the size of the hypergraph
  */
 template<typename HypergraphType>
-HypergraphCut<typename HypergraphType::EdgeWeight> approximate_minimizer(HypergraphType &hypergraph,
-                                                                         const double epsilon) {
-  using Cut = HypergraphCut<typename HypergraphType::EdgeWeight>;
+std::pair<int, typename HypergraphType::EdgeWeight> min_degree_vertex(const HypergraphType &hypergraph,
+                                                                      const std::vector<int> &vertices,
+                                                                      size_t num_threads) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+  num_threads = std::max<size_t>(1, std::min(num_threads, vertices.size() / kMinVerticesPerThread));
 
-  if (hypergraph.num_vertices() == 1) {
-    return Cut::max();
-  }
+  std::vector<std::pair<int, EdgeWeight>> minimum(num_threads, {-1, std::numeric_limits<EdgeWeight>::max()});
+  const auto scan = [&](const size_t t) {
+    const size_t begin = t * vertices.size() / num_threads;
+    const size_t end = (t + 1) * vertices.size() / num_threads;
+    for (size_t i = begin; i < end; ++i) {
+      const auto degree = one_vertex_cut<false>(hypergraph, vertices[i]);
+      if (minimum[t].first == -1 || degree < minimum[t].second) {
+        minimum[t] = {vertices[i], degree};
+      }
+    }
+  };
 
-  auto delta = Cut::max();
-  for (const auto v : hypergraph.vertices()) {
-    // TODO one vertex cut
-    delta = std::min(delta, one_vertex_cut<true>(hypergraph, v));
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; ++t) {
+    threads.emplace_back(scan, t);
   }
-  if (delta.value == 0) {
-    return delta;
+  scan(0);
+  for (auto &thread : threads) {
+    thread.join();
   }
-  double alpha = delta.value / (2.0 + epsilon);
 
-  const auto &[ordering, tightness] = queyranne_ordering_with_tightness(
-      hypergraph, *std::begin(hypergraph.vertices()));
+  return *std::min_element(std::begin(minimum), std::end(minimum), [](const auto &a, const auto &b) {
+    return a.second < b.second;
+  });
+}
 
-  // TODO maybe tightness should return pairs to enforce that len(order) =
-  // len(tightness)...
-  auto curr_order = std::begin(ordering);
-  auto curr_tight = std::begin(tightness);
-  auto begin = curr_order;
-  using it_pair = std::pair<decltype(curr_order), decltype(curr_order)>;
+}
+
+/* Approximate (2+epsilon) hypergraph minimum cut from [CX'18], with the degree scan of each round split between up to
+ * `num_threads` threads.
+ *
+ * Each round finds the minimum degree, then contracts the alpha-tight sets of a Queyranne ordering. The rounds run on
+ * one compact copy of the hypergraph that is contracted in place, with all of the sets of a round contracted in one
+ * pass. The partitions of a one vertex cut are only built when it is the smallest so far.
+ *
+ * Time complexity: O(p/epsilon), p is the size of the hypergraph
+ */
+template<typename HypergraphType>
+HypergraphCut<typename HypergraphType::EdgeWeight> approximate_minimizer_with_threads(const HypergraphType &hypergraph,
+                                                                                      const double epsilon,
+                                                                                      const size_t num_threads) {
+  using Cut = HypergraphCut<typename HypergraphType::EdgeWeight>;
+  using PhaseHypergraph = phase_hypergraph_t<HypergraphType>;
+
+  auto min_cut = Cut::max();
+  PhaseHypergraph contracted(hypergraph);
+  OrderingContext<typename PhaseHypergraph::Heap> ctx;
+  std::vector<int> vertices;
+  using it_pair = std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>;
   std::vector<it_pair> alpha_tight_sets;
-  for (; curr_order != std::end(ordering) - 1; ++curr_order, ++curr_tight) {
-    if (*(curr_tight + 1) < alpha) {
-      // Check to see if we should contract the current set (if it has more than
-      // one element)
-      if (std::distance(begin, curr_order) > 1) {
-        alpha_tight_sets.emplace_back(begin, curr_order);
+
+  while (contracted.num_vertices() > 1) {
+    vertices.assign(std::begin(contracted.vertices()), std::end(contracted.vertices()));
+    const auto[v, delta] = detail::min_degree_vertex(contracted, vertices, num_threads);
+    if (delta < min_cut.value) {
+      min_cut = one_vertex_cut<true>(contracted, v);
+    }
+    if (delta == 0) {
+      return contracted.original_cut(std::move(min_cut));
+    }
+    const double alpha = delta / (2.0 + epsilon);
+
+    ordering<PhaseHypergraph, queyranne_ordering_tighten>(contracted, vertices.front(), ctx);
+    const auto &ordering = ctx.ordering;
+    const auto &tightness = ctx.tightness;
+
+    auto curr_order = std::cbegin(ordering);
+    auto curr_tight = std::cbegin(tightness);
+    auto begin = curr_order;
+    alpha_tight_sets.clear();
+    for (; curr_order != std::cend(ordering) - 1; ++curr_order, ++curr_tight) {
+      if (*(curr_tight + 1) < alpha) {
+        // Check to see if we should contract the current set (if it has more than
+        // one element)
+        if (std::distance(begin, curr_order) > 1) {
+          alpha_tight_sets.emplace_back(begin, curr_order);
+        }
+        // Start a new alpha-tight set
+        begin = curr_order + 1;
       }
-      // Start a new alpha-tight set
-      begin = curr_order + 1;
     }
-  }
 
-  if (std::distance(begin, std::end(ordering)) > 1) {
-    alpha_tight_sets.emplace_back(begin, std::end(ordering));
-  }
+    if (std::distance(begin, std::cend(ordering)) > 1) {
+      alpha_tight_sets.emplace_back(begin, std::cend(ordering));
+    }
 
-  // alpha contraction
-  HypergraphType temp(hypergraph);
-  for (const auto[begin, end] : alpha_tight_sets) {
-    // TODO support not getting contraction
-    temp = temp.template contract<false, true>(begin, end);
+    if (alpha_tight_sets.empty()) {
+      // Nothing left to contract, which [CX'18] shows does not happen
+      break;
+    }
+    contracted.template contract_sets_in_place<true>(std::begin(alpha_tight_sets), std::end(alpha_tight_sets));
   }
 
-  return std::min(delta, approximate_minimizer(temp, epsilon));
+  return contracted.original_cut(std::move(min_cut));
+}
+
+/* Approximate (2+epsilon) hypergraph minimum cut from [CX'18], using every hardware thread for large hypergraphs.
+ *
+ * Time complexity: O(p/epsilon), p is the size of the hypergraph
+ */
+template<typename HypergraphType>
+HypergraphCut<typename HypergraphType::EdgeWeight> approximate_minimizer(HypergraphType &hypergraph,
+                                                                         const double epsilon) {
+  return approximate_minimizer_with_threads(hypergraph, epsilon, std::max(std::thread::hardware_concurrency(), 1u));
 }
 
 /**
  * Combines the certificate and approximate algorithm.
  *
  * Uses the approximate algorithm to get a bound on the min cut for the certificate, and then runs the
- * algorithm on the certificate.
+ * algorithm on the certificate. The certificates of the hypergraph are given, so they can be built once and shared.
  */
-template<auto MinCutFunc>
-HypergraphCut <size_t> apxCertCX(Hypergraph &hypergraph, const double epsilon) {
-  Hypergraph copy(hypergraph);
+template<auto MinCutFunc, typename HypergraphType>
+HypergraphCut<typename HypergraphType::EdgeWeight> apxCertCX_with_certificates(
+    const HypergraphType &hypergraph,
+    const certificate_t<HypergraphType> &certifier,
+    const double epsilon) {
+  HypergraphType copy(hypergraph);
   const auto approx_cut = approximate_minimizer(copy, epsilon);
-  KTrimmedCertificate certifier(hypergraph);
   auto certificate = certifier.certificate(approx_cut.value);
   return MinCutFunc(certificate);
 }
 
+/**
+ * Combines the certificate and approximate algorithm.
+ *
+ * Uses the approximate algorithm to get a bound on the min cut for the certificate, and then runs the
+ * algorithm on the certificate.
+ */
+template<auto MinCutFunc, typename HypergraphType>
+HypergraphCut<typename HypergraphType::EdgeWeight> apxCertCX(HypergraphType &hypergraph, const double epsilon) {
+  return apxCertCX_with_certificates<MinCutFunc>(hypergraph, certificate_t<HypergraphType>(hypergraph), epsilon);
+}
+
 }
@@ -0,0 +1,96 @@
+// Memory for the temporaries of a single run of a contraction algorithm
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace hypergraphlib {
+
+/* A monotonic memory resource whose memory is released all at once by reset(). Unlike
+ * std::pmr::monotonic_buffer_resource, reset() keeps the blocks it got from the heap and hands them out again, so once
+ * a run has needed as much memory as the largest run before it, runs no longer allocate from the heap.
+ *
+ * Deallocating does nothing, so containers that grow a lot within a run should reserve up front. An arena must only be
+ * used by one thread at a time.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+  explicit Arena(const size_t initial_block_size = 4096) : next_block_size_(std::max<size_t>(initial_block_size, 64)) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /* Make all memory handed out so far available again. Everything allocated from the arena must be gone by then.
+   *
+   * Time complexity: O(1)
+   */
+  void reset() {
+    current_ = 0;
+    offset_ = 0;
+  }
+
+  // The number of blocks taken from the heap so far
+  [[nodiscard]]
+  size_t num_blocks() const { return blocks_.size(); }
+
+  // The total size of the blocks taken from the heap so far
+  [[nodiscard]]
+  size_t capacity() const {
+    size_t capacity = 0;
+    for (const auto &block : blocks_) {
+      capacity += block.size;
+    }
+    return capacity;
+  }
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  void *do_allocate(const size_t bytes, const size_t alignment) override {
+    // Look for space in the current block, then in the blocks after it that were kept by reset()
+    for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+      if (void *p = carve(blocks_[current_], bytes, alignment)) {
+        return p;
+      }
+    }
+
+    // Blocks double in size, so a run takes O(log s) blocks to need s bytes
+    const size_t size = std::max(next_block_size_, bytes + alignment);
+    next_block_size_ = 2 * size;
+    blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+    offset_ = 0;
+    return carve(blocks_[current_], bytes, alignment);
+  }
+
+  void do_deallocate(void *, size_t, size_t) override {}
+
+  [[nodiscard]]
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  // Space at the offset of a block, or null if the block is too small
+  void *carve(const Block &block, const size_t bytes, const size_t alignment) {
+    void *p = block.data.get() + offset_;
+    size_t space = block.size - offset_;
+    if (std::align(alignment, bytes, p, space) == nullptr) {
+      return nullptr;
+    }
+    offset_ = block.size - space + bytes;
+    return p;
+  }
+
+  std::vector<Block> blocks_;
+  // The block that memory is handed out from, and how much of it is handed out
+  size_t current_ = 0;
+  size_t offset_ = 0;
+  size_t next_block_size_;
+};
+
+}
@@ -1,11 +1,156 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <vector>
+#include <list>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+
+#include "instrument.hpp"
+#include "memory.hpp"
 
 namespace hypergraphlib {
 
+namespace detail {
+
+/* Finds repeated vertices in time linear in the number of vertices looked at. Vertices with IDs in [0, bound) are
+ * marked in an array, and each pass stamps them with a new epoch, so the marks never need to be cleared between passes.
+ * Other vertices are marked in a hash set, so callers pass a bound only if the IDs are dense enough for an array of
+ * that size, and 0 otherwise.
+ */
+class VertexMarker {
+public:
+  // Bounds above this are ignored, so that the array of a thread stays at most 64 MB
+  static constexpr size_t kMaxBound = size_t{1} << 24;
+
+  // The marker of the calling thread
+  static VertexMarker &local() {
+    thread_local VertexMarker marker;
+    return marker;
+  }
+
+  // Start a pass, marking the vertices with IDs in [0, bound) in the array
+  void start(size_t bound) {
+    bound = bound <= kMaxBound ? bound : 0;
+    overflow_.clear();
+    if (marks_.size() < bound) {
+      marks_.resize(bound, 0);
+    } else if (marks_.size() > 4 * bound + 4096) {
+      // Give back the array of a much larger hypergraph
+      marks_.assign(bound, 0);
+      marks_.shrink_to_fit();
+      epoch_ = 0;
+    }
+    bound_ = bound;
+    if (++epoch_ == 0) {
+      std::fill(std::begin(marks_), std::end(marks_), 0);
+      epoch_ = 1;
+    }
+  }
+
+  // Mark a vertex, and return whether it was already marked in this pass
+  bool mark(const int v) {
+    if (v < 0 || static_cast<size_t>(v) >= bound_) {
+      return !overflow_.insert(v).second;
+    }
+    if (marks_[v] == epoch_) {
+      return true;
+    }
+    marks_[v] = epoch_;
+    return false;
+  }
+
+private:
+  std::vector<uint32_t> marks_;
+  uint32_t epoch_ = 0;
+  size_t bound_ = 0;
+  std::unordered_set<int> overflow_;
+};
+
+}
+
+/* A translation between a set of IDs and dense IDs in [0, n), given in increasing order of the IDs. Both directions are
+ * array lookups as long as the IDs span not much more than n values, so state can be kept in plain arrays indexed by
+ * dense ID and translated back to the IDs afterwards. IDs that are spread further apart are looked up by binary search
+ * instead, so the map always takes O(n) space.
+ */
+class IdMap {
+public:
+  static constexpr int kNone = -1;
+
+  IdMap() = default;
+
+  /* Time complexity: O(n log n)
+   */
+  template<typename Range>
+  explicit IdMap(const Range &ids) : ids_(std::begin(ids), std::end(ids)) {
+    std::sort(std::begin(ids_), std::end(ids_));
+    assert(std::adjacent_find(std::begin(ids_), std::end(ids_)) == std::end(ids_));
+    if (ids_.empty()) {
+      return;
+    }
+    min_id_ = ids_.front();
+    const auto span = static_cast<uint64_t>(static_cast<int64_t>(ids_.back()) - min_id_) + 1;
+    if (span <= 2 * ids_.size() + 1024) {
+      dense_.assign(span, kNone);
+      for (size_t i = 0; i < ids_.size(); ++i) {
+        dense_[offset(ids_[i])] = static_cast<int>(i);
+      }
+    }
+  }
+
+  [[nodiscard]]
+  size_t size() const { return ids_.size(); }
+
+  /* The dense ID of an ID, or kNone if it is not in the map
+   *
+   * Time complexity: O(1), or O(log n) if the IDs are spread too far apart for an array
+   */
+  [[nodiscard]]
+  int dense(const int id) const {
+    if (dense_.empty()) {
+      const auto it = std::lower_bound(std::begin(ids_), std::end(ids_), id);
+      return it == std::end(ids_) || *it != id ? kNone : static_cast<int>(it - std::begin(ids_));
+    }
+    if (id < min_id_ || offset(id) >= dense_.size()) {
+      return kNone;
+    }
+    return dense_[offset(id)];
+  }
+
+  // The ID of a dense ID
+  [[nodiscard]]
+  int id(const int dense) const {
+    assert(dense >= 0 && static_cast<size_t>(dense) < ids_.size());
+    return ids_[dense];
+  }
+
+  // The IDs, indexed by their dense IDs
+  [[nodiscard]]
+  const std::vector<int> &ids() const { return ids_; }
+
+  // The bytes the map takes, including the map itself
+  [[nodiscard]]
+  size_t memory_usage() const { return sizeof(IdMap) + heap_bytes(ids_) + heap_bytes(dense_); }
+
+private:
+  // The distance of an ID from the smallest ID, which can be more than the largest int
+  [[nodiscard]]
+  size_t offset(const int id) const { return static_cast<size_t>(static_cast<int64_t>(id) - min_id_); }
+
+  std::vector<int> ids_;
+  // dense_[offset(id)] is the dense ID of id, or kNone. Empty if the IDs are too far apart.
+  int min_id_ = 0;
+  std::vector<int> dense_;
+};
+
 template<typename T>
 class HypergraphBase {
   friend T;
@@ -16,7 +161,12 @@ public:
 
   HypergraphBase() = default;
 
-  HypergraphBase(const HypergraphBase &other) = default;
+  HypergraphBase(const HypergraphBase &other)
+      : vertices_(other.vertices_), edges_(other.edges_), vertices_within_(other.vertices_within_),
+        edges_with_repeated_pins_(other.edges_with_repeated_pins_), next_vertex_id_(other.next_vertex_id_),
+        next_edge_id_(other.next_edge_id_) {
+    instrument::count(instrument::Counter::HypergraphCopies);
+  }
 
   HypergraphBase(const std::vector<int> &vertices,
                  const std::vector<std::vector<int>> &edges) :
@@ -33,10 +183,22 @@ public:
       for (const int u : incident_vertices) {
         vertices_[u].push_back(e_i);
       }
+      if (has_repeated_pins(incident_vertices)) {
+        edges_with_repeated_pins_.insert(e_i);
+      }
     }
   }
 
-  HypergraphBase &operator=(const HypergraphBase &other) = default;
+  HypergraphBase &operator=(const HypergraphBase &other) {
+    vertices_ = other.vertices_;
+    edges_ = other.edges_;
+    vertices_within_ = other.vertices_within_;
+    edges_with_repeated_pins_ = other.edges_with_repeated_pins_;
+    next_vertex_id_ = other.next_vertex_id_;
+    next_edge_id_ = other.next_edge_id_;
+    instrument::count(instrument::Counter::HypergraphCopies);
+    return *this;
+  }
 
   /**
    * Determines whether two hypergraphs have the same vertices and hyperedges with the same labels. Does NOT determine
@@ -129,17 +291,34 @@ public:
     return true;
   }
 
+  /* Whether an edge may contain a vertex more than once. The hypergraph keeps track of the edges that were given to it
+   * with repeated vertices, so this is false for every edge of most hypergraphs.
+   *
+   * Time complexity: O(1)
+   */
+  [[nodiscard]]
+  bool may_have_repeated_pins(const int edge_id) const {
+    return !edges_with_repeated_pins_.empty() && edges_with_repeated_pins_.count(edge_id) > 0;
+  }
+
   /* Returns a new hypergraph with the edge contracted. Assumes that there is
    * an edge in the hypergraph with the given edge ID.
    *
+   * With EdgeMayContainLoops, repeated vertices in the edge are removed first, but only if the hypergraph does not
+   * already know that the edge has none. Without it, the caller promises that the edge has none.
+   *
    * Time complexity: O(p), where p is the size of the hypergraph.
    */
   template<bool EdgeMayContainLoops = true, bool TrackContractedVertices = true>
   [[nodiscard]]
   T contract(const int edge_id) const {
-    // TODO EdgeMayContainLoops default true is a bit aggressive and may lead to performance regressions,
-    //      we should try to avoid setting it to true if possible
-    std::vector<int> old_edge = edges_.at(edge_id);
+    std::vector<int> distinct_pins;
+    if constexpr (EdgeMayContainLoops) {
+      if (may_have_repeated_pins(edge_id)) {
+        distinct_pins = without_repeated_pins(edges_.at(edge_id));
+      }
+    }
+    const std::vector<int> &old_edge = distinct_pins.empty() ? edges_.at(edge_id) : distinct_pins;
 
     if (old_edge.empty()) {
       // Pretty much nothing will change, just remove the old edge
@@ -149,11 +328,6 @@ public:
       return T(std::move(new_vertices), std::move(new_edges), static_cast<const T &>(*this));
     }
 
-    if constexpr (EdgeMayContainLoops) {
-      std::set<int> sorted(std::begin(old_edge), std::end(old_edge));
-      old_edge = {std::begin(sorted), std::end(sorted)};
-    }
-
     // TODO verify that inserts actually insert (not overwrite)
     // Set V' := V \ e (do not copy incidence lists)
     std::unordered_map<int, std::vector<int>> new_vertices;
@@ -235,14 +409,16 @@ public:
 
     std::vector<int> edge = edges_.at(edge_id);
     if constexpr (EdgeMayContainLoops) {
-      std::set<int> sorted(std::begin(edge), std::end(edge));
-      edge = {std::begin(sorted), std::end(sorted)};
+      if (may_have_repeated_pins(edge_id)) {
+        edge = without_repeated_pins(edge);
+      }
     }
 
     for (auto v : edge) {
       vertices_.erase(v);
     }
     edges_.erase(edge_id);
+    edges_with_repeated_pins_.erase(edge_id);
 
     // Remove edge_id from incidence of all v in e
     for (auto &[v, edges] : vertices_) {
@@ -288,6 +464,9 @@ public:
     std::vector new_edge(begin, end);
     auto new_edge_id = next_edge_id_;
 
+    if (has_repeated_pins(new_edge)) {
+      edges_with_repeated_pins_.insert(new_edge_id);
+    }
     edges_.insert({new_edge_id, new_edge});
 
     for (const auto v : new_edge) {
@@ -313,6 +492,7 @@ public:
       vertex_incidence_list.pop_back();
     }
     edges_.erase(edge_id);
+    edges_with_repeated_pins_.erase(edge_id);
   }
 
   void remove_vertex(int vertex_id) {
@@ -347,6 +527,16 @@ public:
     return ret;
   }
 
+  /* Returns an estimate of the bytes the hypergraph takes, including the hypergraph itself.
+   *
+   * Time complexity: O(n + m)
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return sizeof(T) + heap_bytes(vertices_) + heap_bytes(edges_) + heap_bytes(vertices_within_)
+        + heap_bytes(edges_with_repeated_pins_);
+  }
+
   /* Contracts the vertices in the range into one vertex.
    *
    * Time complexity: O(p), where p is the size of the hypergraph.
@@ -354,12 +544,199 @@ public:
   template<bool EdgesMayContainLoops, bool TrackContractedVertices, typename InputIt>
   [[nodiscard]]
   T contract(InputIt begin, InputIt end) const {
-    // TODO if we have a non-const contract then this copy is unnecessary. Right
-    // now we copy twice (once to avoid modifying the input hypergraph and the
-    // second time to contract)
-    HypergraphBase copy(*this);
-    auto new_e = copy.add_hyperedge(begin, end);
-    return copy.contract<EdgesMayContainLoops, TrackContractedVertices>(new_e);
+    const std::pair<InputIt, InputIt> sets[] = {{begin, end}};
+    return contract_sets<TrackContractedVertices>(std::begin(sets), std::end(sets));
+  }
+
+  /* Returns a new hypergraph in which each of several disjoint sets of vertices is contracted into a new vertex. Each
+   * element of the range is a pair of iterators over the vertices of one set. Every hyperedge is rewritten once however
+   * many of the sets it meets: repeated vertices are dropped from it, and it is removed if it lies inside one new vertex.
+   * In a weighted hypergraph, hyperedges that end up with the same vertices are merged into the one with the smallest
+   * ID, which takes their total weight. An unweighted hypergraph has no weights to merge them into, so it keeps them.
+   *
+   * Time complexity: O(p) for an unweighted hypergraph and O(p log r) for a weighted one, where p is the size of the
+   * hypergraph and r is its rank.
+   */
+  template<bool TrackContractedVertices = true, typename InputIt>
+  [[nodiscard]]
+  T contract_sets(InputIt begin, InputIt end) const {
+    // The new vertex of each set, by the vertices in the set
+    std::unordered_map<int, int> merged_into;
+    int next_vertex_id = next_vertex_id_;
+    std::vector<int> new_vertex_ids;
+    for (auto it = begin; it != end; ++it) {
+      const auto &[first, last] = *it;
+      if (first == last) {
+        continue;
+      }
+      for (auto v = first; v != last; ++v) {
+        assert(vertices_.count(*v) > 0);
+        const auto [existing, inserted] = merged_into.insert({*v, next_vertex_id});
+        assert(inserted || existing->second == next_vertex_id);
+      }
+      new_vertex_ids.push_back(next_vertex_id++);
+    }
+
+    // Rewrite the edges that meet a set, dropping those that end up inside a single vertex
+    std::unordered_map<int, std::vector<int>> new_edges;
+    new_edges.reserve(edges_.size());
+    auto &marker = detail::VertexMarker::local();
+    for (const auto &[e, edge] : edges_) {
+      const bool meets_a_set = std::any_of(std::begin(edge), std::end(edge), [&merged_into](const int v) {
+        return merged_into.count(v) > 0;
+      });
+      if (!meets_a_set) {
+        new_edges.insert({e, edge});
+        continue;
+      }
+      marker.start(marker_bound(next_vertex_id));
+      std::vector<int> new_edge;
+      new_edge.reserve(edge.size());
+      for (const int v : edge) {
+        const auto it = merged_into.find(v);
+        const int u = it == std::end(merged_into) ? v : it->second;
+        if (!marker.mark(u)) {
+          new_edge.push_back(u);
+        }
+      }
+      if (new_edge.size() > 1) {
+        new_edges.insert({e, std::move(new_edge)});
+      }
+    }
+
+    // Edges merged into a parallel edge, and the edges they were merged into
+    std::vector<std::pair<int, int>> parallel;
+    if constexpr (T::weighted) {
+      // Edges are keyed by their sorted vertices, and each key goes to the smallest ID among its edges
+      std::unordered_map<std::vector<int>, int, boost::hash<std::vector<int>>> edge_with_vertices;
+      edge_with_vertices.reserve(new_edges.size());
+      const auto sorted = [](const std::vector<int> &edge) {
+        std::vector<int> key(std::begin(edge), std::end(edge));
+        std::sort(std::begin(key), std::end(key));
+        return key;
+      };
+      for (const auto &[e, edge] : new_edges) {
+        const auto [it, inserted] = edge_with_vertices.insert({sorted(edge), e});
+        it->second = std::min(it->second, e);
+      }
+      if (edge_with_vertices.size() < new_edges.size()) {
+        for (const auto &[e, edge] : new_edges) {
+          const int into = edge_with_vertices.at(sorted(edge));
+          if (into != e) {
+            parallel.emplace_back(e, into);
+          }
+        }
+        for (const auto &[removed, into] : parallel) {
+          new_edges.erase(removed);
+        }
+      }
+    }
+
+    std::unordered_map<int, std::vector<int>> new_vertices;
+    new_vertices.reserve(vertices_.size() - merged_into.size() + new_vertex_ids.size());
+    for (const auto &[v, incidence] : vertices_) {
+      if (merged_into.count(v) == 0) {
+        new_vertices[v] = {};
+      }
+    }
+    for (const int v : new_vertex_ids) {
+      new_vertices[v] = {};
+    }
+    for (const auto &[e, edge] : new_edges) {
+      for (const int v : edge) {
+        new_vertices.at(v).push_back(e);
+      }
+    }
+
+    T contracted(std::move(new_vertices), std::move(new_edges), static_cast<const T &>(*this));
+    contracted.next_vertex_id_ = next_vertex_id;
+    if constexpr (T::weighted) {
+      for (const auto &[removed, into] : parallel) {
+        contracted.edge_weights_[into] += contracted.edge_weights_[removed];
+      }
+    }
+
+    if constexpr (TrackContractedVertices) {
+      for (auto it = begin; it != end; ++it) {
+        const auto &[first, last] = *it;
+        if (first == last) {
+          continue;
+        }
+        std::list<int> within;
+        const int merged = merged_into.at(*first);
+        for (auto v = first; v != last; ++v) {
+          const auto old = contracted.vertices_within_.find(*v);
+          if (old != std::end(contracted.vertices_within_)) {
+            within.splice(std::end(within), std::move(old->second));
+            contracted.vertices_within_.erase(old);
+          }
+        }
+        contracted.vertices_within_.insert({merged, std::move(within)});
+      }
+    }
+
+    return contracted;
+  }
+
+  /* Renumbers the vertices to [0, n) and the edges to [0, m), in increasing order of their IDs, so that they can index
+   * plain arrays. The IDs given up by contractions and removed edges are then handed out again. The vertices within
+   * each vertex keep their IDs, so cuts are still given in the IDs of the hypergraph this one was contracted from.
+   *
+   * Returns the old IDs of the vertices and of the edges, indexed by their new IDs.
+   *
+   * Time complexity: O(p + n log n + m log m), where p is the size of the hypergraph, or O(p log p) if the old IDs are
+   * spread much further apart than [0, n) and [0, m) (see IdMap)
+   */
+  std::pair<IdMap, IdMap> compact_ids() {
+    IdMap vertex_ids(vertices());
+    IdMap edge_ids(boost::adaptors::keys(edges_));
+
+    std::unordered_map<int, std::vector<int>> vertices;
+    vertices.reserve(vertices_.size());
+    std::unordered_map<int, std::list<int>> vertices_within;
+    vertices_within.reserve(vertices_.size());
+    for (auto &[v, incidence] : vertices_) {
+      for (int &e : incidence) {
+        e = edge_ids.dense(e);
+      }
+      const int dense = vertex_ids.dense(v);
+      vertices.insert({dense, std::move(incidence)});
+      // Vertices contracted without tracking have nothing within them
+      if (const auto it = vertices_within_.find(v); it != std::end(vertices_within_)) {
+        vertices_within.insert({dense, std::move(it->second)});
+      }
+    }
+
+    std::unordered_map<int, std::vector<int>> edges;
+    edges.reserve(edges_.size());
+    std::unordered_set<int> edges_with_repeated_pins;
+    for (auto &[e, edge] : edges_) {
+      for (int &v : edge) {
+        v = vertex_ids.dense(v);
+      }
+      const int dense = edge_ids.dense(e);
+      if (edges_with_repeated_pins_.count(e) > 0) {
+        edges_with_repeated_pins.insert(dense);
+      }
+      edges.insert({dense, std::move(edge)});
+    }
+
+    if constexpr (T::weighted) {
+      auto &weights = static_cast<T &>(*this).edge_weights_;
+      std::vector<typename T::EdgeWeight> dense_weights(edge_ids.size());
+      for (size_t e = 0; e < edge_ids.size(); ++e) {
+        dense_weights[e] = weights[edge_ids.id(static_cast<int>(e))];
+      }
+      weights = std::move(dense_weights);
+    }
+
+    vertices_ = std::move(vertices);
+    edges_ = std::move(edges);
+    vertices_within_ = std::move(vertices_within);
+    edges_with_repeated_pins_ = std::move(edges_with_repeated_pins);
+    next_vertex_id_ = static_cast<int>(vertex_ids.size());
+    next_edge_id_ = static_cast<int>(edge_ids.size());
+    return {std::move(vertex_ids), std::move(edge_ids)};
   }
 
   /* When an edge is contracted into a single vertex the original vertices in the edge can be stored and referred to
@@ -375,8 +752,40 @@ private:
   HypergraphBase(std::unordered_map<int, std::vector<int>> &&vertices,
                  std::unordered_map<int, std::vector<int>> &&edges,
                  const HypergraphBase &old)
-      : vertices_(vertices), edges_(edges), next_vertex_id_(old.next_vertex_id_), next_edge_id_(old.next_edge_id_),
-        vertices_within_(old.vertices_within_) {}
+      : vertices_(std::move(vertices)), edges_(std::move(edges)), next_vertex_id_(old.next_vertex_id_),
+        next_edge_id_(old.next_edge_id_), vertices_within_(old.vertices_within_),
+        edges_with_repeated_pins_(old.edges_with_repeated_pins_) {}
+
+  // The bound for a VertexMarker over vertex IDs below `next_vertex_id`: that ID if an array of its size takes O(n)
+  // space, and 0 otherwise
+  [[nodiscard]]
+  size_t marker_bound(const int next_vertex_id) const {
+    if (next_vertex_id <= 0 || static_cast<size_t>(next_vertex_id) > 2 * vertices_.size() + 1024) {
+      return 0;
+    }
+    return static_cast<size_t>(next_vertex_id);
+  }
+
+  // Time complexity: O(|edge|) expected
+  [[nodiscard]]
+  bool has_repeated_pins(const std::vector<int> &edge) const {
+    auto &marker = detail::VertexMarker::local();
+    marker.start(marker_bound(next_vertex_id_));
+    return std::any_of(std::begin(edge), std::end(edge), [&marker](const int v) { return marker.mark(v); });
+  }
+
+  // The vertices of the edge in order of their first appearance. Time complexity: O(|edge|) expected
+  [[nodiscard]]
+  std::vector<int> without_repeated_pins(const std::vector<int> &edge) const {
+    auto &marker = detail::VertexMarker::local();
+    marker.start(marker_bound(next_vertex_id_));
+    std::vector<int> distinct;
+    distinct.reserve(edge.size());
+    std::copy_if(std::begin(edge), std::end(edge), std::back_inserter(distinct), [&marker](const int v) {
+      return !marker.mark(v);
+    });
+    return distinct;
+  }
 
   // Map of vertex IDs -> incidence lists
   std::unordered_map<int, std::vector<int>> vertices_;
@@ -388,6 +797,10 @@ private:
   // Note that in the interest of performance, old entries may not be deleted (but each entry is immutable)
   std::unordered_map<int, std::list<int>> vertices_within_;
 
+  // IDs of the edges that may contain a vertex more than once. Edge IDs are only reused after compact_ids, which drops
+  // the IDs of removed edges, so until then it may also hold the IDs of edges that have since been removed.
+  std::unordered_set<int> edges_with_repeated_pins_;
+
   int next_vertex_id_;
   int next_edge_id_;
 };
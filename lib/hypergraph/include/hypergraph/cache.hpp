@@ -0,0 +1,182 @@
+// A cache of exact cuts on disk, keyed by the contents of the hypergraph
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "hypergraph.hpp"
+#include "cut.hpp"
+
+namespace hypergraphlib {
+
+namespace detail {
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+
+// FNV-1a over the bytes of a value
+template<typename T>
+uint64_t fnv1a(uint64_t hash, const T &value) {
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  for (const unsigned char byte : bytes) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// The splitmix64 finalizer, so that summing the hashes of edges does not let them cancel out
+inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+}
+
+/* A 64-bit hash of the contents of a hypergraph: its vertex IDs and the pins and weights of its edges. It does not
+ * depend on edge IDs or on the order of vertices, edges or pins, so a hypergraph read back from a file hashes the same
+ * as the one that was written.
+ *
+ * Time complexity: O(n log n + p log p), where n is the number of vertices and p is the size of the hypergraph
+ */
+template<typename HypergraphType>
+uint64_t content_hash(const HypergraphType &hypergraph) {
+  std::vector<int> vertices(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
+  std::sort(std::begin(vertices), std::end(vertices));
+  uint64_t hash = detail::fnv1a(detail::kFnvOffset, vertices.size());
+  for (const int v : vertices) {
+    hash = detail::fnv1a(hash, v);
+  }
+
+  // Edges are combined with a sum, which does not depend on their order
+  uint64_t edges = 0;
+  std::vector<int> pins;
+  for (const auto &[id, edge] : hypergraph.edges()) {
+    pins.assign(std::begin(edge), std::end(edge));
+    std::sort(std::begin(pins), std::end(pins));
+    uint64_t edge_hash = detail::fnv1a(detail::kFnvOffset, edge_weight(hypergraph, id));
+    for (const int v : pins) {
+      edge_hash = detail::fnv1a(edge_hash, v);
+    }
+    edges += detail::mix(edge_hash);
+  }
+  return detail::fnv1a(detail::fnv1a(hash, hypergraph.num_edges()), edges);
+}
+
+/* The directory for caches of this project: $XDG_CACHE_HOME/hypergraph-k-cut, or ~/.cache/hypergraph-k-cut if
+ * XDG_CACHE_HOME is not set. Empty if neither variable is set.
+ */
+inline std::filesystem::path default_cache_directory() {
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0') {
+    return std::filesystem::path(xdg) / "hypergraph-k-cut";
+  }
+  if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    return std::filesystem::path(home) / ".cache" / "hypergraph-k-cut";
+  }
+  return {};
+}
+
+/* Cuts found by exact algorithms, stored in a directory with one file per hypergraph content, algorithm and k. Only
+ * cache the cuts of deterministic algorithms, since a hit returns the cut that was stored.
+ *
+ * Entries are written to a temporary file and renamed into place, so several processes can share a directory and an
+ * interrupted write leaves no entry behind. A corrupt or unreadable entry is treated as a miss.
+ */
+class CutCache {
+public:
+  explicit CutCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+  [[nodiscard]]
+  const std::filesystem::path &directory() const { return directory_; }
+
+  // The cached cut of the hypergraph, if there is one
+  template<typename HypergraphType>
+  std::optional<HypergraphCut<typename HypergraphType::EdgeWeight>> find(const HypergraphType &hypergraph,
+                                                                         const std::string &algorithm,
+                                                                         const size_t k) const {
+    std::ifstream file(path(hypergraph, algorithm, k));
+    if (!file) {
+      return {};
+    }
+
+    HypergraphCut<typename HypergraphType::EdgeWeight> cut(0);
+    size_t num_partitions = 0;
+    if (!(file >> cut.value >> num_partitions) || num_partitions != k) {
+      return {};
+    }
+    cut.partitions.resize(num_partitions);
+    for (auto &partition : cut.partitions) {
+      size_t size = 0;
+      if (!(file >> size)) {
+        return {};
+      }
+      partition.resize(size);
+      for (auto &v : partition) {
+        if (!(file >> v)) {
+          return {};
+        }
+      }
+    }
+    return cut;
+  }
+
+  /* Store the cut of a hypergraph, replacing any cut stored for it before. Returns false if the cut could not be
+   * written.
+   */
+  template<typename HypergraphType>
+  bool store(const HypergraphType &hypergraph,
+             const std::string &algorithm,
+             const size_t k,
+             const HypergraphCut<typename HypergraphType::EdgeWeight> &cut) const {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+      return false;
+    }
+
+    const auto destination = path(hypergraph, algorithm, k);
+    const auto temporary = destination.string() + ".tmp." + std::to_string(std::random_device{}());
+    {
+      std::ofstream file(temporary);
+      file.precision(std::numeric_limits<typename HypergraphType::EdgeWeight>::max_digits10);
+      file << cut.value << "\n" << cut.partitions.size() << "\n";
+      for (const auto &partition : cut.partitions) {
+        file << partition.size();
+        for (const int v : partition) {
+          file << " " << v;
+        }
+        file << "\n";
+      }
+      if (!file.flush()) {
+        std::filesystem::remove(temporary, error);
+        return false;
+      }
+    }
+    std::filesystem::rename(temporary, destination, error);
+    return !error;
+  }
+
+private:
+  template<typename HypergraphType>
+  std::filesystem::path path(const HypergraphType &hypergraph, const std::string &algorithm, const size_t k) const {
+    std::ostringstream name;
+    name << std::hex << content_hash(hypergraph) << std::dec << "-" << algorithm << "-" << k
+         << (is_weighted<HypergraphType> ? "-w" : "") << ".cut";
+    return directory_ / name.str();
+  }
+
+  std::filesystem::path directory_;
+};
+
+}
@@ -1,10 +1,18 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "hypergraph.hpp"
 #include "cut.hpp"
+#include "order.hpp"
 
 namespace hypergraphlib {
 
@@ -27,7 +35,24 @@ public:
   [[nodiscard]]
   Hypergraph certificate(size_t k) const;
 
+  /* Returns an estimate of the bytes the certificate takes, including the hypergraph it is built from.
+   *
+   * Time complexity: O(n + m)
+   */
+  [[nodiscard]]
+  size_t memory_usage() const;
+
 private:
+  friend class IncrementalCertificate;
+
+  // The hypergraph with the vertices of the hypergraph and no edges, which is the 0-trimmed certificate
+  [[nodiscard]]
+  Hypergraph empty_certificate() const;
+
+  // Turn the `from`-trimmed certificate into the `to`-trimmed certificate, by adding the backward edges of each vertex
+  // between positions `from` and `to`. Takes O(n + q) time, where q is the number of pins added.
+  void extend(Hypergraph &certificate, size_t from, size_t to) const;
+
   // Return the head of an edge (the vertex in it that occurs first in the
   // vertex ordering). Takes constant time.
   [[nodiscard]]
@@ -46,22 +71,269 @@ private:
   // (see paper for more details)
   std::unordered_map<int, std::vector<int>> backward_edges_;
 };
-/* Given a hypergraph and a function that orders the vertices, find the minimum
-* cut through an exponential search on the minimum cuts of k-trimmed
-* certificates. See [CX'09] for more details.
+/* Builds the k-trimmed certificates of a hypergraph for a growing sequence of k. The k-trimmed certificate
+ * contains the j-trimmed certificate for every j < k, so growing from j to k only adds the pins between the two. Over
+ * any sequence of calls to `grow` the pins take O(p) time in total, where p is the size of the hypergraph.
+ */
+class IncrementalCertificate {
+public:
+  /* Time complexity: O(p)
+   */
+  explicit IncrementalCertificate(const Hypergraph &hypergraph);
+
+  /* Grows certificates out of already built certificates, which can be shared with other threads.
+   *
+   * Time complexity: O(n)
+   */
+  explicit IncrementalCertificate(std::shared_ptr<const KTrimmedCertificate> certificates);
+
+  /* Grows the certificate into the k-trimmed certificate and returns it. `k` must be at least the k of the previous
+   * call.
+   *
+   * Time complexity: O(n + q), where q is the number of pins added
+   */
+  const Hypergraph &grow(size_t k);
+
+  [[nodiscard]]
+  size_t k() const { return k_; }
+
+  [[nodiscard]]
+  const Hypergraph &certificate() const { return certificate_; }
+
+private:
+  const std::shared_ptr<const KTrimmedCertificate> certificates_;
+  Hypergraph certificate_;
+  size_t k_ = 0;
+};
+
+/* The k-trimmed certificates of a weighted hypergraph. An edge of weight w acts like w parallel copies of the edge, as
+ * in the unweighted certificate, without making the copies: the copies of an edge are next to each other in the head
+ * ordering, so a vertex keeps a prefix of them, and the copies that keep the same vertices become one edge whose weight
+ * is their number. An edge is split into at most as many edges as it has vertices.
+ *
+ * Weights do not have to be integers. The certificate keeps every cut with a value less than k and keeps the value of
+ * every other cut at least k.
+ */
+template<typename EdgeWeightType>
+class WeightedKTrimmedCertificate {
+public:
+  /* Time complexity: O(p log n) where p is the size of the hypergraph
+   */
+  explicit WeightedKTrimmedCertificate(const WeightedHypergraph<EdgeWeightType> &hypergraph) : hypergraph_(hypergraph) {
+    const auto vertex_ordering = maximum_adjacency_ordering(hypergraph_, *std::begin(hypergraph_.vertices()));
+
+    std::unordered_map<int, size_t> vertex_to_order;
+    for (size_t i = 0; i < vertex_ordering.size(); ++i) {
+      vertex_to_order[vertex_ordering[i]] = i;
+    }
+
+    // Bucket the edges by their heads to get the induced head ordering, like the unweighted certificate
+    std::vector<std::vector<int>> buckets(vertex_ordering.size());
+    for (const auto &[e, vertices] : hypergraph_.edges()) {
+      auto head = std::numeric_limits<size_t>::max();
+      for (const int v : vertices) {
+        head = std::min(head, vertex_to_order.at(v));
+      }
+      if (head != std::numeric_limits<size_t>::max()) {
+        edge_to_head_[e] = vertex_ordering[head];
+        buckets.at(head).push_back(e);
+      }
+    }
+
+    for (const auto v : hypergraph_.vertices()) {
+      backward_edges_[v] = {};
+    }
+    for (const auto &bucket : buckets) {
+      for (const int e : bucket) {
+        head_ordering_.push_back(e);
+        const int h = edge_to_head_.at(e);
+        for (const int v : hypergraph_.edges().at(e)) {
+          if (v != h) {
+            backward_edges_.at(v).push_back(e);
+          }
+        }
+      }
+    }
+  }
+
+  /* Returns the k-trimmed certificate.
+   *
+   * Time complexity: O(n + q log r), where q is the number of pins in the certificate and r is the rank of the
+   * hypergraph
+   */
+  [[nodiscard]]
+  WeightedHypergraph<EdgeWeightType> certificate(const EdgeWeightType k) const {
+    // The weight of the copies of each edge that each of its vertices other than its head keeps. A vertex keeps the
+    // copies of its backward edges up to a total weight of k.
+    std::unordered_map<int, std::vector<std::pair<EdgeWeightType, int>>> kept;
+    for (const auto &[v, backward_edges] : backward_edges_) {
+      EdgeWeightType before = 0;
+      for (size_t i = 0; i < backward_edges.size() && before < k; ++i) {
+        const int e = backward_edges[i];
+        const EdgeWeightType weight = hypergraph_.edge_weight(e);
+        if (weight > 0) {
+          kept[e].emplace_back(std::min(weight, k - before), v);
+          before += weight;
+        }
+      }
+    }
+
+    std::unordered_map<int, std::vector<int>> new_vertices;
+    for (const auto v : hypergraph_.vertices()) {
+      new_vertices.insert({v, {}});
+    }
+    WeightedHypergraph<EdgeWeightType> certificate(std::move(new_vertices), {}, hypergraph_);
+
+    // The vertices that keep the most copies come first, so the copies of an edge that keep the first i vertices are
+    // an edge on the head and those vertices, weighted by how many more copies vertex i keeps than vertex i + 1
+    std::vector<int> pins;
+    for (const int e : head_ordering_) {
+      auto it = kept.find(e);
+      if (it == std::end(kept)) {
+        continue;
+      }
+      auto &vertices = it->second;
+      std::sort(std::begin(vertices), std::end(vertices), std::greater<>());
+      pins.assign(1, edge_to_head_.at(e));
+      for (size_t i = 0; i < vertices.size(); ++i) {
+        pins.push_back(vertices[i].second);
+        const EdgeWeightType next = i + 1 < vertices.size() ? vertices[i + 1].first : 0;
+        if (vertices[i].first > next) {
+          certificate.add_hyperedge(std::begin(pins), std::end(pins), vertices[i].first - next);
+        }
+      }
+    }
+    return certificate;
+  }
+
+  /* Returns an estimate of the bytes the certificate takes, including the hypergraph it is built from.
+   *
+   * Time complexity: O(n + m)
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return sizeof(WeightedKTrimmedCertificate) - sizeof(hypergraph_) + hypergraph_.memory_usage()
+        + heap_bytes(head_ordering_) + heap_bytes(edge_to_head_) + heap_bytes(backward_edges_);
+  }
+
+private:
+  // The hypergraph we are creating certificates of
+  const WeightedHypergraph<EdgeWeightType> hypergraph_;
+
+  // The edges in the head ordering
+  std::vector<int> head_ordering_;
+
+  // The head of each edge, the vertex in it that occurs first in the vertex ordering
+  std::unordered_map<int, int> edge_to_head_;
+
+  // A list for each vertex that holds v's backward edges in the head ordering
+  std::unordered_map<int, std::vector<int>> backward_edges_;
+};
+
+// The certificates of a hypergraph type
+template<typename HypergraphType>
+using certificate_t = std::conditional_t<is_weighted<HypergraphType>,
+                                         WeightedKTrimmedCertificate<typename HypergraphType::EdgeWeight>,
+                                         KTrimmedCertificate>;
+
+/* A sparse certificate that is built in one pass over the edges, for hypergraphs that do not fit in memory. The
+ * k-trimmed certificate needs a maximum adjacency ordering of the whole hypergraph, so instead the edges are packed
+ * greedily into k forests in the order they arrive [NI'92]: every copy of an edge goes into the first forest in which
+ * its vertices are not all in one component, and an edge whose vertices are in one component of every forest is
+ * dropped. The components of a forest are refined by those of the next forest, so the forests an edge can go into
+ * are found by binary search.
+ *
+ * Like the k-trimmed certificate, it keeps every cut with a value less than k and keeps the value of every other cut
+ * at least k. It holds at most k(n - 1) copies of edges, and only the components of the forests are kept in memory, so
+ * the edges that are kept have to be written out by the caller as they are added.
+ */
+class StreamingCertificate {
+public:
+  /* Certificate of a hypergraph on the vertices 0, ..., n - 1.
+   *
+   * Time complexity: O(kn)
+   */
+  StreamingCertificate(size_t num_vertices, size_t k);
+
+  /* Add an edge with an integral weight, and return the weight it keeps in the certificate, which is 0 if it is
+   * dropped.
+   *
+   * Time complexity: O(p log k α(n)) where p is the number of vertices of the edge
+   */
+  template<typename InputIt>
+  size_t add(InputIt begin, InputIt end, const size_t weight = 1) {
+    pins_.assign(begin, end);
+    return add_pins(weight);
+  }
+
+  [[nodiscard]]
+  size_t num_vertices() const { return num_vertices_; }
+
+  [[nodiscard]]
+  size_t k() const { return k_; }
+
+  /* The bytes the certificate takes, which is O(kn) and does not grow with the number of edges added.
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return sizeof(StreamingCertificate) + heap_bytes(parent_) + heap_bytes(rank_) + heap_bytes(pins_);
+  }
+
+private:
+  size_t add_pins(size_t weight);
+
+  // Whether the pins are not all in one component of forest i
+  bool separates(size_t i);
+
+  // The root of the component of v in forest i
+  int find(size_t i, int v);
+
+  size_t num_vertices_;
+  size_t k_;
+
+  // Union-find over the vertices of every forest, with forest i at [i * n, (i + 1) * n)
+  std::vector<int> parent_;
+  std::vector<uint8_t> rank_;
+
+  // The pins of the edge being added
+  std::vector<int> pins_;
+};
+
+/* Find the minimum cut through an exponential search on the minimum cuts of
+* the k-trimmed certificates grown by `gen`. See [CX'09] for more details.
 *
-* Time complexity: O(p + cn^2), where p is the size of the hypergraph, c is the
-* value of the minimum cut, and n is the number of vertices
+* Time complexity: O(cn^2), where c is the value of the minimum cut, and n is
+* the number of vertices
 */
 template<typename HypergraphType, bool ReturnsPartitions = true>
-Cut<HypergraphType, ReturnsPartitions> certificate_minimum_cut(const HypergraphType &hypergraph,
+Cut<HypergraphType, ReturnsPartitions> certificate_minimum_cut(IncrementalCertificate gen,
                                                                MinimumCutFunction<HypergraphType,
                                                                ReturnsPartitions> min_cut) {
-  KTrimmedCertificate gen(hypergraph);
   size_t k = 1;
   while (true) {
-    // Copy hypergraph
-    Hypergraph certificate = gen.certificate(k);
+    // Copy the certificate, since the minimum cut function may modify it
+    Hypergraph certificate = gen.grow(k);
+    auto cut = min_cut(certificate);
+    if (cut_value<HypergraphType>(cut) < k) {
+      return cut;
+    }
+    k *= 2;
+  }
+}
+
+/* Find the minimum cut of a weighted hypergraph through an exponential search on the minimum cuts of its k-trimmed
+ * certificates. Every certificate is built from scratch, since the edges a weighted edge is split into depend on k.
+ *
+ * Time complexity: O(log c (n + q log r)) plus the time of the minimum cuts, where c is the value of the minimum cut
+ * and q is the number of pins in the largest certificate
+ */
+template<typename HypergraphType, bool ReturnsPartitions = true>
+Cut<HypergraphType, ReturnsPartitions> certificate_minimum_cut(
+    const WeightedKTrimmedCertificate<typename HypergraphType::EdgeWeight> &certificates,
+    MinimumCutFunction<HypergraphType, ReturnsPartitions> min_cut) {
+  typename HypergraphType::EdgeWeight k = 1;
+  while (true) {
+    auto certificate = certificates.certificate(k);
     auto cut = min_cut(certificate);
     if (cut_value<HypergraphType>(cut) < k) {
       return cut;
@@ -70,4 +342,24 @@ Cut<HypergraphType, ReturnsPartitions> certificate_minimum_cut(const HypergraphT
   }
 }
 
+/* Given a hypergraph and a function that orders the vertices, find the minimum
+* cut through an exponential search on the minimum cuts of k-trimmed
+* certificates. See [CX'09] for more details.
+*
+* Time complexity: O(p + cn^2), where p is the size of the hypergraph, c is the
+* value of the minimum cut, and n is the number of vertices
+*/
+template<typename HypergraphType, bool ReturnsPartitions = true>
+Cut<HypergraphType, ReturnsPartitions> certificate_minimum_cut(const HypergraphType &hypergraph,
+                                                               MinimumCutFunction<HypergraphType,
+                                                               ReturnsPartitions> min_cut) {
+  if constexpr (is_weighted<HypergraphType>) {
+    return certificate_minimum_cut<HypergraphType, ReturnsPartitions>(
+        WeightedKTrimmedCertificate<typename HypergraphType::EdgeWeight>(hypergraph), std::move(min_cut));
+  } else {
+    return certificate_minimum_cut<HypergraphType, ReturnsPartitions>(IncrementalCertificate(hypergraph),
+                                                                      std::move(min_cut));
+  }
+}
+
 }
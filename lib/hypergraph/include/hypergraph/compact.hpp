@@ -0,0 +1,1260 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/iterator/counting_iterator.hpp>
+
+#include "heap.hpp"
+#include "hypergraph.hpp"
+
+namespace hypergraphlib {
+
+/* A view of a contiguous run of IDs. Used for the vertices of a hyperedge and the edges incident on a vertex in a
+ * compact hypergraph. Any modification of the hypergraph invalidates the view.
+ */
+class IdSpan {
+public:
+  using value_type = int;
+  using iterator = const int *;
+  using const_iterator = const int *;
+
+  IdSpan() = default;
+
+  IdSpan(const int *begin, const int *end) : begin_(begin), end_(end) {}
+
+  [[nodiscard]]
+  const int *begin() const { return begin_; }
+
+  [[nodiscard]]
+  const int *end() const { return end_; }
+
+  [[nodiscard]]
+  size_t size() const { return static_cast<size_t>(end_ - begin_); }
+
+  [[nodiscard]]
+  bool empty() const { return begin_ == end_; }
+
+  int operator[](size_t i) const { return begin_[i]; }
+
+  [[nodiscard]]
+  int back() const { return end_[-1]; }
+
+private:
+  const int *begin_ = nullptr;
+  const int *end_ = nullptr;
+};
+
+/* Borrowed compressed sparse row arrays of a hypergraph on the vertices 0, ..., num_vertices - 1 and the edges
+ * 0, ..., num_edges - 1. The vertices of edge e are pins[edge_offsets[e]], ..., pins[edge_offsets[e + 1] - 1], and the
+ * edges incident on vertex v are incidence[incidence_offsets[v]], ..., incidence[incidence_offsets[v + 1] - 1].
+ */
+struct CsrArrays {
+  size_t num_vertices = 0;
+  size_t num_edges = 0;
+  const uint64_t *edge_offsets = nullptr;
+  const int32_t *pins = nullptr;
+  const uint64_t *incidence_offsets = nullptr;
+  const int32_t *incidence = nullptr;
+};
+
+/* A hypergraph stored in compressed sparse row form. Instead of a hash map of vectors per vertex and per edge, all of
+ * the vertices of all of the hyperedges live in one contiguous array, and so do all of the incidence lists. Vertex
+ * and edge IDs are used directly as indices into these arrays, so they should be dense (as they are for hypergraphs
+ * read from hMETIS files).
+ *
+ * The interface mirrors HypergraphBase, so the vertex ordering and contraction algorithms run on the compact types
+ * unchanged. The one observable difference is that contracting a set of vertices does not create a new vertex ID.
+ * The merged vertex reuses the ID of one of the vertices that was merged, so IDs stay inside their original range.
+ *
+ * Contracting a hyperedge takes time linear in the total size of the hyperedges incident on the merged vertices,
+ * rather than in the size of the whole hypergraph.
+ */
+template<typename T>
+class CompactHypergraphBase {
+  friend T;
+public:
+  using EdgeWeight = size_t;
+  using vertex_range = const std::vector<int> &;
+
+  /* A view of the hyperedges of the hypergraph. Iterating yields (edge ID, vertices) pairs, like iterating over the
+   * edges of a HypergraphBase.
+   */
+  class EdgeRange {
+  public:
+    class const_iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::pair<int, IdSpan>;
+      using difference_type = std::ptrdiff_t;
+      using reference = value_type;
+
+      // Pairs are built on the fly, so `->` needs something to point into
+      struct pointer {
+        value_type value;
+        const value_type *operator->() const { return &value; }
+      };
+
+      const_iterator() = default;
+
+      const_iterator(const CompactHypergraphBase *hypergraph, std::vector<int>::const_iterator it) :
+          hypergraph_(hypergraph), it_(it) {}
+
+      value_type operator*() const { return {*it_, hypergraph_->pins(*it_)}; }
+
+      pointer operator->() const { return {**this}; }
+
+      const_iterator &operator++() {
+        ++it_;
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        const_iterator old = *this;
+        ++it_;
+        return old;
+      }
+
+      bool operator==(const const_iterator &other) const { return it_ == other.it_; }
+
+      bool operator!=(const const_iterator &other) const { return it_ != other.it_; }
+
+    private:
+      const CompactHypergraphBase *hypergraph_ = nullptr;
+      std::vector<int>::const_iterator it_;
+    };
+
+    using iterator = const_iterator;
+    using value_type = typename const_iterator::value_type;
+
+    explicit EdgeRange(const CompactHypergraphBase *hypergraph) : hypergraph_(hypergraph) {}
+
+    [[nodiscard]]
+    const_iterator begin() const { return {hypergraph_, hypergraph_->edge_list_.cbegin()}; }
+
+    [[nodiscard]]
+    const_iterator end() const { return {hypergraph_, hypergraph_->edge_list_.cend()}; }
+
+    [[nodiscard]]
+    size_t size() const { return hypergraph_->edge_list_.size(); }
+
+    [[nodiscard]]
+    bool empty() const { return hypergraph_->edge_list_.empty(); }
+
+    [[nodiscard]]
+    size_t count(const int edge_id) const { return hypergraph_->has_edge(edge_id) ? 1 : 0; }
+
+    /* Returns the vertices of the edge. Throws std::out_of_range if there is no such edge.
+     */
+    [[nodiscard]]
+    IdSpan at(const int edge_id) const {
+      if (!hypergraph_->has_edge(edge_id)) {
+        throw std::out_of_range("no hyperedge with ID " + std::to_string(edge_id));
+      }
+      return hypergraph_->pins(edge_id);
+    }
+
+  private:
+    const CompactHypergraphBase *hypergraph_;
+  };
+
+  /* A view of the vertices that were contracted into a vertex. The vertices are stored as a linked list threaded
+   * through a flat array, so merging two of these lists takes constant time.
+   */
+  class ContractedVertexRange {
+  public:
+    class const_iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = int;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const int *;
+      using reference = int;
+
+      const_iterator() = default;
+
+      const_iterator(const std::vector<int> *next, int v) : next_(next), v_(v) {}
+
+      int operator*() const { return v_; }
+
+      const_iterator &operator++() {
+        v_ = (*next_)[v_];
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        const_iterator old = *this;
+        ++*this;
+        return old;
+      }
+
+      bool operator==(const const_iterator &other) const { return v_ == other.v_; }
+
+      bool operator!=(const const_iterator &other) const { return v_ != other.v_; }
+
+    private:
+      const std::vector<int> *next_ = nullptr;
+      int v_ = kNone;
+    };
+
+    using iterator = const_iterator;
+    using value_type = int;
+
+    ContractedVertexRange(const std::vector<int> *next, int v) : next_(next), v_(v) {}
+
+    [[nodiscard]]
+    const_iterator begin() const { return {next_, v_}; }
+
+    [[nodiscard]]
+    const_iterator end() const { return {next_, kNone}; }
+
+  private:
+    const std::vector<int> *next_;
+    int v_;
+  };
+
+  CompactHypergraphBase() = default;
+
+  CompactHypergraphBase(const CompactHypergraphBase &other) = default;
+
+  CompactHypergraphBase(CompactHypergraphBase &&other) noexcept = default;
+
+  CompactHypergraphBase &operator=(const CompactHypergraphBase &other) = default;
+
+  CompactHypergraphBase &operator=(CompactHypergraphBase &&other) noexcept = default;
+
+  CompactHypergraphBase(const std::vector<int> &vertices,
+                        const std::vector<std::vector<int>> &edges) {
+    assert(vertices.size() > 0);
+    init_vertices(std::begin(vertices), std::end(vertices));
+    for (size_t i = 0; i < edges.size(); ++i) {
+      init_edge(static_cast<int>(i), std::begin(edges[i]), std::end(edges[i]));
+    }
+    build_incidence();
+  }
+
+  /* Builds a hypergraph on the vertices 0, ..., num_vertices - 1 whose hyperedges are already in compressed sparse row
+   * form: the vertices of edge i are pins[edge_offsets[i]], ..., pins[edge_offsets[i + 1] - 1]. The pin array is taken
+   * over as is, so no per-edge vectors are built.
+   *
+   * Time complexity: O(n + p), where p is the size of the hypergraph
+   */
+  CompactHypergraphBase(const size_t num_vertices, std::vector<size_t> edge_offsets, std::vector<int> pins) {
+    assert(num_vertices > 0);
+    assert(!edge_offsets.empty() && edge_offsets.back() == pins.size());
+    init_vertices(boost::counting_iterator<int>(0), boost::counting_iterator<int>(static_cast<int>(num_vertices)));
+    const size_t num_edges = edge_offsets.size() - 1;
+    edge_list_.resize(num_edges);
+    std::iota(std::begin(edge_list_), std::end(edge_list_), 0);
+    edge_position_ = edge_list_;
+    edge_size_.resize(num_edges);
+    for (size_t e = 0; e < num_edges; ++e) {
+      edge_size_[e] = edge_offsets[e + 1] - edge_offsets[e];
+    }
+    edge_mark_.resize(num_edges, 0);
+    edge_offsets.pop_back();
+    pin_offset_ = std::move(edge_offsets);
+    pins_ = std::move(pins);
+    build_incidence();
+  }
+
+  /* Copies a hypergraph whose incidence lists have already been laid out, for example by a binary hypergraph file.
+   * Only the sizes of edges and degrees of vertices are computed, so nothing is parsed, hashed or sorted.
+   *
+   * Time complexity: O(n + m + p), where p is the size of the hypergraph
+   */
+  explicit CompactHypergraphBase(const CsrArrays &arrays) {
+    assert(arrays.num_vertices > 0);
+    const size_t n = arrays.num_vertices;
+    const size_t m = arrays.num_edges;
+    init_vertices(boost::counting_iterator<int>(0), boost::counting_iterator<int>(static_cast<int>(n)));
+    incidence_offset_.assign(arrays.incidence_offsets, arrays.incidence_offsets + n);
+    for (size_t v = 0; v < n; ++v) {
+      degree_[v] = arrays.incidence_offsets[v + 1] - arrays.incidence_offsets[v];
+    }
+    incidence_.assign(arrays.incidence, arrays.incidence + arrays.incidence_offsets[n]);
+    live_incidence_ = incidence_.size();
+
+    edge_list_.resize(m);
+    std::iota(std::begin(edge_list_), std::end(edge_list_), 0);
+    edge_position_ = edge_list_;
+    pin_offset_.assign(arrays.edge_offsets, arrays.edge_offsets + m);
+    edge_size_.resize(m);
+    for (size_t e = 0; e < m; ++e) {
+      edge_size_[e] = arrays.edge_offsets[e + 1] - arrays.edge_offsets[e];
+    }
+    edge_mark_.resize(m, 0);
+    pins_.assign(arrays.pins, arrays.pins + arrays.edge_offsets[m]);
+  }
+
+  /**
+   * Determines whether two hypergraphs have the same vertices and hyperedges with the same labels. Does NOT determine
+   * whether they are isomorphic.
+   */
+  bool operator==(const CompactHypergraphBase &other) const {
+    if (num_vertices() != other.num_vertices() || num_edges() != other.num_edges()) {
+      return false;
+    }
+    for (const int v : vertices()) {
+      if (!other.has_vertex(v) || degree(v) != other.degree(v)) {
+        return false;
+      }
+    }
+    for (const int e : edge_list_) {
+      if (!other.has_edge(e)) {
+        return false;
+      }
+      const auto a = pins(e);
+      const auto b = other.pins(e);
+      if (!std::equal(std::begin(a), std::end(a), std::begin(b), std::end(b))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]]
+  size_t num_vertices() const { return vertex_list_.size(); };
+
+  [[nodiscard]]
+  size_t num_edges() const { return edge_list_.size(); }
+
+  [[nodiscard]]
+  vertex_range vertices() const { return vertex_list_; };
+
+  [[nodiscard]]
+  IdSpan edges_incident_on(int vertex_id) const {
+    assert(has_vertex(vertex_id));
+    const int *begin = incidence_.data() + incidence_offset_[vertex_id];
+    return {begin, begin + degree_[vertex_id]};
+  }
+
+  [[nodiscard]]
+  EdgeRange edges() const { return EdgeRange(this); }
+
+  [[nodiscard]]
+  bool has_vertex(const int vertex_id) const {
+    return vertex_id >= 0 && static_cast<size_t>(vertex_id) < vertex_position_.size()
+        && vertex_position_[vertex_id] != kNone;
+  }
+
+  [[nodiscard]]
+  bool has_edge(const int edge_id) const {
+    return edge_id >= 0 && static_cast<size_t>(edge_id) < edge_position_.size() && edge_position_[edge_id] != kNone;
+  }
+
+  [[nodiscard]]
+  size_t rank() const {
+    size_t r = 0;
+    for (const int e : edge_list_) {
+      r = std::max(r, edge_size_[e]);
+    }
+    return r;
+  }
+
+  void remove_singleton_and_empty_hyperedges() {
+    std::vector<int> to_remove;
+    for (const int e : edge_list_) {
+      if (edge_size_[e] < 2) {
+        to_remove.push_back(e);
+      }
+    }
+    for (const int e : to_remove) {
+      remove_hyperedge(e);
+    }
+  }
+
+  [[nodiscard]]
+  size_t degree(const int vertex_id) const {
+    assert(has_vertex(vertex_id));
+    return degree_[vertex_id];
+  }
+
+  /* Checks that the internal state of the hypergraph is consistent. Mainly for
+   * debugging.
+   */
+  [[nodiscard]]
+  bool is_valid() const {
+    for (const int v : vertex_list_) {
+      for (const int e : edges_incident_on(v)) {
+        if (!has_edge(e)) {
+          std::cerr << "ERROR: vertex " << v << " is incident on removed edge " << e << std::endl;
+          return false;
+        }
+        const auto vertices_incident_on = pins(e);
+        if (std::find(vertices_incident_on.begin(), vertices_incident_on.end(), v) == vertices_incident_on.end()) {
+          std::cerr << "ERROR: edge " << e << " should contain vertex " << v << std::endl;
+          return false;
+        }
+      }
+    }
+
+    for (const int e : edge_list_) {
+      for (const int v : pins(e)) {
+        if (!has_vertex(v)) {
+          std::cerr << "ERROR: edge " << e << " contains removed vertex " << v << std::endl;
+          return false;
+        }
+        const auto incident_on = edges_incident_on(v);
+        if (std::find(incident_on.begin(), incident_on.end(), e) == incident_on.end()) {
+          std::cerr << "ERROR: vertex " << v << " should contain edge " << e << std::endl;
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /* Returns a new hypergraph with the edge contracted. Assumes that there is
+   * an edge in the hypergraph with the given edge ID.
+   *
+   * Time complexity: O(p), since the hypergraph needs to be copied. Use
+   * contract_in_place to avoid the copy.
+   */
+  template<bool EdgeMayContainLoops = true, bool TrackContractedVertices = true>
+  [[nodiscard]]
+  T contract(const int edge_id) const {
+    T copy(static_cast<const T &>(*this));
+    copy.template contract_in_place<EdgeMayContainLoops, TrackContractedVertices>(edge_id);
+    return copy;
+  }
+
+  /* Contracts the edge in place. Repeated vertices in the edge are always handled, so EdgeMayContainLoops is only
+   * accepted for compatibility with HypergraphBase.
+   *
+   * Time complexity: linear in the total size of the hyperedges incident on the vertices of the edge.
+   */
+  template<bool EdgeMayContainLoops = true, bool TrackContractedVertices = true>
+  void contract_in_place(const int edge_id) {
+    const auto edge = edges().at(edge_id);
+    if (edge.empty()) {
+      remove_edge_id(edge_id);
+      return;
+    }
+    group_.assign(std::begin(edge), std::end(edge));
+    // The contracted edge lies entirely inside the merged vertex, so it is dropped along with any other such edge
+    merge_group<TrackContractedVertices>();
+  }
+
+  /* Contracts the vertices in the range into one vertex in place and returns the ID of that vertex, which is one of
+   * the IDs in the range.
+   *
+   * Time complexity: linear in the total size of the hyperedges incident on the vertices in the range.
+   */
+  template<bool TrackContractedVertices = true, typename InputIt>
+  int contract_in_place(InputIt begin, InputIt end) {
+    group_.assign(begin, end);
+    return merge_group<TrackContractedVertices>();
+  }
+
+  /* Contracts each of several disjoint sets of vertices into one vertex in place. Each element of the range is a pair
+   * of iterators over the vertices of one set. A hyperedge is rewritten once however many of the sets it meets, so
+   * this is cheaper than contracting the sets one at a time.
+   *
+   * Time complexity: linear in the total size of the hyperedges incident on the vertices in the sets.
+   */
+  template<bool TrackContractedVertices = true, typename InputIt>
+  void contract_sets_in_place(InputIt begin, InputIt end) {
+    group_.clear();
+    group_offsets_.assign(1, 0);
+    for (auto it = begin; it != end; ++it) {
+      const auto &[first, last] = *it;
+      group_.insert(std::end(group_), first, last);
+      group_offsets_.push_back(group_.size());
+    }
+    merge_groups<TrackContractedVertices>();
+  }
+
+  /* Add hyperedge and return its ID.
+   *
+   * Time complexity: O(d), where d is the total degree of the vertices in the hyperedge, since their incidence lists
+   * may need to be moved to the end of the incidence array.
+   */
+  template<typename InputIt>
+  int add_hyperedge(InputIt begin, InputIt end) {
+    const int new_edge_id = static_cast<int>(edge_position_.size());
+    init_edge(new_edge_id, begin, end);
+    for (const int v : pins(new_edge_id)) {
+      assert(has_vertex(v));
+      append_incidence(v, new_edge_id);
+    }
+    maybe_compact_incidence();
+    return new_edge_id;
+  }
+
+  /* Remove a hyperedge.
+   *
+   * Time complexity: linear with the size of all vertices contained by the hyperedge
+   */
+  void remove_hyperedge(const int edge_id) {
+    assert(has_edge(edge_id));
+    for (const int v : pins(edge_id)) {
+      int *begin = incidence_.data() + incidence_offset_[v];
+      int *end = begin + degree_[v];
+      int *it = std::find(begin, end, edge_id);
+      assert(it != end);
+      // Swap it with the last element and pop it off to remove in O(1) time
+      std::iter_swap(it, end - 1);
+      --degree_[v];
+      --live_incidence_;
+    }
+    remove_edge_id(edge_id);
+  }
+
+  void remove_vertex(const int vertex_id) {
+    assert(has_vertex(vertex_id));
+    std::vector<int> invalid_edges;
+    const auto incident_on = edges_incident_on(vertex_id);
+    for (const int e : std::vector<int>(std::begin(incident_on), std::end(incident_on))) {
+      int *begin = pins_.data() + pin_offset_[e];
+      int *end = std::remove(begin, begin + edge_size_[e], vertex_id);
+      edge_size_[e] = static_cast<size_t>(end - begin);
+      if (edge_size_[e] < 2) {
+        invalid_edges.push_back(e);
+      }
+    }
+    live_incidence_ -= degree_[vertex_id];
+    degree_[vertex_id] = 0;
+    for (const int e : invalid_edges) {
+      remove_hyperedge(e);
+    }
+    remove_vertex_id(vertex_id);
+  }
+
+  /**
+   * Return the combined size of all hyperedges
+   */
+  [[nodiscard]]
+  size_t size() const {
+    size_t ret = 0;
+    for (const int e : edge_list_) {
+      ret += edge_size_[e];
+    }
+    return ret;
+  }
+
+  /* Returns an estimate of the bytes the hypergraph takes, including the hypergraph itself.
+   *
+   * Time complexity: O(1)
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    size_t bytes = sizeof(T);
+    for (const auto *ints : {&vertex_list_, &vertex_position_, &edge_list_, &edge_position_, &pins_, &incidence_,
+                             &first_within_, &next_within_, &last_within_, &group_, &merged_, &representative_,
+                             &last_written_}) {
+      bytes += heap_bytes(*ints);
+    }
+    for (const auto *sizes : {&incidence_offset_, &degree_, &pin_offset_, &edge_size_, &group_offsets_}) {
+      bytes += heap_bytes(*sizes);
+    }
+    return bytes + heap_bytes(vertex_mark_) + heap_bytes(edge_mark_) + heap_bytes(original_ids_);
+  }
+
+  /* Contracts the vertices in the range into one vertex.
+   *
+   * Time complexity: O(p), where p is the size of the hypergraph.
+   */
+  template<bool EdgesMayContainLoops, bool TrackContractedVertices, typename InputIt>
+  [[nodiscard]]
+  T contract(InputIt begin, InputIt end) const {
+    T copy(static_cast<const T &>(*this));
+    copy.template contract_in_place<TrackContractedVertices>(begin, end);
+    return copy;
+  }
+
+  /* When an edge is contracted into a single vertex the original vertices in the edge can be stored and referred to
+   * later using this method. This is useful for calculating the actual partitions that make up the cuts.
+   */
+  [[nodiscard]]
+  ContractedVertexRange vertices_within(const int v) const {
+    assert(has_vertex(v));
+    return {&next_within_, first_within_[v]};
+  }
+
+protected:
+  /* Copies a HypergraphBase into compact form. Vertex and edge IDs (and the vertices contracted into each vertex) are
+   * preserved, so cuts computed on the copy are cuts of the original, unless some vertex ID is negative or much larger
+   * than the number of vertices. The vertices are then renumbered to [0, n') in increasing order of their IDs, where
+   * n' also counts the vertices contracted into them, and cuts of the copy are translated back by original_cut.
+   *
+   * Time complexity: O(p), where p is the size of the hypergraph, plus the largest edge ID and either the largest
+   * vertex ID or O(n' log n') to renumber the vertices.
+   */
+  template<typename HypergraphType>
+  explicit CompactHypergraphBase(const HypergraphBase<HypergraphType> &hypergraph) {
+    std::vector<int> ids;
+    for (const int v : hypergraph.vertices()) {
+      ids.push_back(v);
+      ids.insert(std::end(ids), std::begin(hypergraph.vertices_within(v)), std::end(hypergraph.vertices_within(v)));
+    }
+    const auto [min_id, max_id] = std::minmax_element(std::begin(ids), std::end(ids));
+    if (!ids.empty() && (*min_id < 0 || static_cast<size_t>(*max_id) > 2 * ids.size() + 1024)) {
+      std::sort(std::begin(ids), std::end(ids));
+      ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
+      original_ids_ = std::move(ids);
+      renumbered_ = true;
+    }
+
+    std::vector<int> copied;
+    const auto copy = [this, &copied](const auto &vertices) {
+      copied.clear();
+      std::transform(std::begin(vertices), std::end(vertices), std::back_inserter(copied), [this](const int v) {
+        return copied_vertex(v);
+      });
+    };
+
+    copy(hypergraph.vertices());
+    init_vertices(std::begin(copied), std::end(copied));
+    for (const int v : hypergraph.vertices()) {
+      // Contracted vertices can refer to IDs that no longer exist, so make sure that they have a slot
+      const int copied = copied_vertex(v);
+      int previous = kNone;
+      first_within_[copied] = kNone;
+      for (const int u : hypergraph.vertices_within(v)) {
+        const int copied_u = copied_vertex(u);
+        grow_vertex_ids(static_cast<size_t>(copied_u) + 1);
+        if (previous == kNone) {
+          first_within_[copied] = copied_u;
+        } else {
+          next_within_[previous] = copied_u;
+        }
+        previous = copied_u;
+      }
+      if (previous != kNone) {
+        next_within_[previous] = kNone;
+      }
+      last_within_[copied] = previous;
+    }
+    for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+      copy(vertices);
+      init_edge(edge_id, std::begin(copied), std::end(copied));
+    }
+    build_incidence();
+  }
+
+public:
+  // Whether the vertices were renumbered when the hypergraph was copied from a HypergraphBase
+  [[nodiscard]]
+  bool renumbered() const { return renumbered_; }
+
+  // The ID in this hypergraph of a vertex of the HypergraphBase it was copied from
+  [[nodiscard]]
+  int copied_vertex(const int v) const {
+    if (!renumbered_) {
+      return v;
+    }
+    return static_cast<int>(std::lower_bound(std::begin(original_ids_), std::end(original_ids_), v)
+                                - std::begin(original_ids_));
+  }
+
+  /* A cut of this hypergraph with its partitions given in the vertex IDs of the HypergraphBase it was copied from.
+   *
+   * Time complexity: O(n) if the vertices were renumbered, otherwise O(1)
+   */
+  template<typename Cut>
+  Cut original_cut(Cut cut) const {
+    if (renumbered_) {
+      for (auto &partition : cut.partitions) {
+        for (int &v : partition) {
+          v = original_ids_[v];
+        }
+      }
+    }
+    return cut;
+  }
+
+private:
+  static constexpr int kNone = -1;
+
+  [[nodiscard]]
+  IdSpan pins(const int edge_id) const {
+    const int *begin = pins_.data() + pin_offset_[edge_id];
+    return {begin, begin + edge_size_[edge_id]};
+  }
+
+  void grow_vertex_ids(const size_t capacity) {
+    if (vertex_position_.size() >= capacity) {
+      return;
+    }
+    vertex_position_.resize(capacity, kNone);
+    incidence_offset_.resize(capacity, 0);
+    degree_.resize(capacity, 0);
+    first_within_.resize(capacity, kNone);
+    next_within_.resize(capacity, kNone);
+    last_within_.resize(capacity, kNone);
+    vertex_mark_.resize(capacity, 0);
+    representative_.resize(capacity, kNone);
+    last_written_.resize(capacity, kNone);
+  }
+
+  template<typename InputIt>
+  void init_vertices(InputIt begin, InputIt end) {
+    for (auto it = begin; it != end; ++it) {
+      const int v = *it;
+      assert(v >= 0);
+      grow_vertex_ids(static_cast<size_t>(v) + 1);
+      assert(vertex_position_[v] == kNone);
+      vertex_position_[v] = static_cast<int>(vertex_list_.size());
+      vertex_list_.push_back(v);
+      first_within_[v] = v;
+      last_within_[v] = v;
+    }
+  }
+
+  // Appends the vertices of a new edge to the pin array. Does not touch the incidence lists.
+  template<typename InputIt>
+  void init_edge(const int edge_id, InputIt begin, InputIt end) {
+    assert(edge_id >= 0);
+    if (edge_position_.size() <= static_cast<size_t>(edge_id)) {
+      edge_position_.resize(edge_id + 1, kNone);
+      pin_offset_.resize(edge_id + 1, 0);
+      edge_size_.resize(edge_id + 1, 0);
+      edge_mark_.resize(edge_id + 1, 0);
+    }
+    assert(edge_position_[edge_id] == kNone);
+    pin_offset_[edge_id] = pins_.size();
+    pins_.insert(std::end(pins_), begin, end);
+    edge_size_[edge_id] = pins_.size() - pin_offset_[edge_id];
+    edge_position_[edge_id] = static_cast<int>(edge_list_.size());
+    edge_list_.push_back(edge_id);
+  }
+
+  // Lays out the incidence lists of all vertices contiguously with a counting sort over the pins
+  void build_incidence() {
+    std::fill(std::begin(degree_), std::end(degree_), 0);
+    for (const int e : edge_list_) {
+      for (const int v : pins(e)) {
+        assert(has_vertex(v));
+        ++degree_[v];
+      }
+    }
+    size_t offset = 0;
+    for (const int v : vertex_list_) {
+      incidence_offset_[v] = offset;
+      offset += degree_[v];
+      degree_[v] = 0;
+    }
+    incidence_.resize(offset);
+    for (const int e : edge_list_) {
+      for (const int v : pins(e)) {
+        incidence_[incidence_offset_[v] + degree_[v]++] = e;
+      }
+    }
+    live_incidence_ = offset;
+  }
+
+  void append_incidence(const int v, const int edge_id) {
+    if (incidence_offset_[v] + degree_[v] != incidence_.size()) {
+      // Move the incidence list to the end of the array so that it can grow
+      const size_t new_offset = incidence_.size();
+      for (size_t i = 0; i < degree_[v]; ++i) {
+        incidence_.push_back(incidence_[incidence_offset_[v] + i]);
+      }
+      incidence_offset_[v] = new_offset;
+    }
+    incidence_.push_back(edge_id);
+    ++degree_[v];
+    ++live_incidence_;
+  }
+
+  // Incidence lists are moved instead of resized, so reclaim the holes they leave behind once they take up more space
+  // than the lists themselves. This keeps the cost amortized constant per moved entry.
+  void maybe_compact_incidence() {
+    if (incidence_.size() <= 2 * live_incidence_ + 64) {
+      return;
+    }
+    std::vector<int> compacted;
+    compacted.reserve(live_incidence_);
+    for (const int v : vertex_list_) {
+      const size_t offset = compacted.size();
+      compacted.insert(std::end(compacted),
+                       std::begin(incidence_) + incidence_offset_[v],
+                       std::begin(incidence_) + incidence_offset_[v] + degree_[v]);
+      incidence_offset_[v] = offset;
+    }
+    incidence_ = std::move(compacted);
+  }
+
+  void remove_edge_id(const int edge_id) {
+    const int position = edge_position_[edge_id];
+    assert(position != kNone);
+    const int last = edge_list_.back();
+    edge_list_[position] = last;
+    edge_position_[last] = position;
+    edge_list_.pop_back();
+    edge_position_[edge_id] = kNone;
+  }
+
+  void remove_vertex_id(const int vertex_id) {
+    const int position = vertex_position_[vertex_id];
+    assert(position != kNone);
+    const int last = vertex_list_.back();
+    vertex_list_[position] = last;
+    vertex_position_[last] = position;
+    vertex_list_.pop_back();
+    vertex_position_[vertex_id] = kNone;
+  }
+
+  // Starts a new generation of vertex and edge marks, so that marking is constant time without clearing
+  void next_mark() {
+    if (++mark_ == 0) {
+      std::fill(std::begin(vertex_mark_), std::end(vertex_mark_), 0);
+      std::fill(std::begin(edge_mark_), std::end(edge_mark_), 0);
+      mark_ = 1;
+    }
+  }
+
+  // Merges the vertices in group_ into the one with the largest degree and returns it. Hyperedges whose vertices all
+  // get merged are removed.
+  template<bool TrackContractedVertices>
+  int merge_group() {
+    next_mark();
+
+    // Deduplicate the group and find the vertex to merge into
+    int merged = kNone;
+    size_t num_distinct = 0;
+    for (const int v : group_) {
+      assert(has_vertex(v));
+      if (vertex_mark_[v] == mark_) {
+        continue;
+      }
+      vertex_mark_[v] = mark_;
+      group_[num_distinct++] = v;
+      if (merged == kNone || degree_[v] > degree_[merged]) {
+        merged = v;
+      }
+    }
+    group_.resize(num_distinct);
+    if (merged == kNone) {
+      return kNone;
+    }
+
+    // Rewrite every edge incident on the group, writing the new incidence list of the merged vertex to the end of the
+    // incidence array. Edges can only shrink, so their vertices are rewritten where they are.
+    const size_t new_offset = incidence_.size();
+    size_t old_incidence = 0;
+    for (const int v : group_) {
+      const size_t offset = incidence_offset_[v];
+      const size_t degree = degree_[v];
+      old_incidence += degree;
+      for (size_t i = 0; i < degree; ++i) {
+        const int e = incidence_[offset + i];
+        if (edge_mark_[e] == mark_) {
+          continue;
+        }
+        edge_mark_[e] = mark_;
+
+        int *begin = pins_.data() + pin_offset_[e];
+        int *out = begin;
+        bool contains_merged = false;
+        for (const int *it = begin; it != begin + edge_size_[e]; ++it) {
+          if (vertex_mark_[*it] != mark_) {
+            *out++ = *it;
+          } else if (!contains_merged) {
+            *out++ = merged;
+            contains_merged = true;
+          }
+        }
+        edge_size_[e] = static_cast<size_t>(out - begin);
+
+        if (edge_size_[e] == 1) {
+          // Every vertex of the edge was merged, and the group holds its only incidences
+          remove_edge_id(e);
+        } else {
+          incidence_.push_back(e);
+        }
+      }
+    }
+
+    for (const int v : group_) {
+      degree_[v] = 0;
+      if (v == merged) {
+        continue;
+      }
+      remove_vertex_id(v);
+      if constexpr (TrackContractedVertices) {
+        if (first_within_[v] == kNone) {
+          continue;
+        }
+        if (first_within_[merged] == kNone) {
+          first_within_[merged] = first_within_[v];
+        } else {
+          next_within_[last_within_[merged]] = first_within_[v];
+        }
+        last_within_[merged] = last_within_[v];
+      }
+    }
+    incidence_offset_[merged] = new_offset;
+    degree_[merged] = incidence_.size() - new_offset;
+    live_incidence_ = live_incidence_ - old_incidence + degree_[merged];
+
+    maybe_compact_incidence();
+    return merged;
+  }
+
+  // Merges each of the groups of vertices in group_, which are delimited by group_offsets_ and disjoint, into the
+  // vertex of the group with the largest degree. Hyperedges whose vertices all get merged into one vertex are removed.
+  template<bool TrackContractedVertices>
+  void merge_groups() {
+    const size_t num_groups = group_offsets_.size() - 1;
+    next_mark();
+
+    // Deduplicate the groups and find the vertex to merge each of them into
+    merged_.assign(num_groups, kNone);
+    size_t num_distinct = 0;
+    for (size_t g = 0; g < num_groups; ++g) {
+      const size_t first = num_distinct;
+      for (size_t i = group_offsets_[g]; i < group_offsets_[g + 1]; ++i) {
+        const int v = group_[i];
+        assert(has_vertex(v));
+        if (vertex_mark_[v] == mark_) {
+          continue;
+        }
+        vertex_mark_[v] = mark_;
+        group_[num_distinct++] = v;
+        if (merged_[g] == kNone || degree_[v] > degree_[merged_[g]]) {
+          merged_[g] = v;
+        }
+      }
+      group_offsets_[g] = first;
+    }
+    group_offsets_[num_groups] = num_distinct;
+    group_.resize(num_distinct);
+    for (size_t g = 0; g < num_groups; ++g) {
+      for (size_t i = group_offsets_[g]; i < group_offsets_[g + 1]; ++i) {
+        representative_[group_[i]] = merged_[g];
+      }
+      if (merged_[g] != kNone) {
+        last_written_[merged_[g]] = kNone;
+      }
+    }
+
+    // Rewrite every edge incident on a group once, replacing the vertices of each group by the vertex it is merged into.
+    // Edges can only shrink, so their vertices are rewritten where they are.
+    for (const int v : group_) {
+      const size_t offset = incidence_offset_[v];
+      for (size_t i = 0; i < degree_[v]; ++i) {
+        const int e = incidence_[offset + i];
+        if (edge_mark_[e] == mark_) {
+          continue;
+        }
+        edge_mark_[e] = mark_;
+
+        int *begin = pins_.data() + pin_offset_[e];
+        int *out = begin;
+        for (const int *it = begin; it != begin + edge_size_[e]; ++it) {
+          if (vertex_mark_[*it] != mark_) {
+            *out++ = *it;
+          } else if (const int merged = representative_[*it]; last_written_[merged] != e) {
+            last_written_[merged] = e;
+            *out++ = merged;
+          }
+        }
+        edge_size_[e] = static_cast<size_t>(out - begin);
+
+        if (edge_size_[e] == 1) {
+          // Every vertex of the edge was merged into the same vertex, and its group holds its only incidences
+          remove_edge_id(e);
+        }
+      }
+    }
+
+    // Write the new incidence list of each merged vertex to the end of the incidence array
+    size_t old_incidence = 0;
+    size_t new_incidence = 0;
+    for (size_t g = 0; g < num_groups; ++g) {
+      const int merged = merged_[g];
+      if (merged == kNone) {
+        continue;
+      }
+      // Only edge marks are needed from here on, to list each edge once per group
+      next_mark();
+      const size_t new_offset = incidence_.size();
+      for (size_t i = group_offsets_[g]; i < group_offsets_[g + 1]; ++i) {
+        const int v = group_[i];
+        const size_t offset = incidence_offset_[v];
+        old_incidence += degree_[v];
+        for (size_t j = 0; j < degree_[v]; ++j) {
+          const int e = incidence_[offset + j];
+          if (has_edge(e) && edge_mark_[e] != mark_) {
+            edge_mark_[e] = mark_;
+            incidence_.push_back(e);
+          }
+        }
+      }
+
+      for (size_t i = group_offsets_[g]; i < group_offsets_[g + 1]; ++i) {
+        const int v = group_[i];
+        degree_[v] = 0;
+        if (v == merged) {
+          continue;
+        }
+        remove_vertex_id(v);
+        if constexpr (TrackContractedVertices) {
+          if (first_within_[v] == kNone) {
+            continue;
+          }
+          if (first_within_[merged] == kNone) {
+            first_within_[merged] = first_within_[v];
+          } else {
+            next_within_[last_within_[merged]] = first_within_[v];
+          }
+          last_within_[merged] = last_within_[v];
+        }
+      }
+      incidence_offset_[merged] = new_offset;
+      degree_[merged] = incidence_.size() - new_offset;
+      new_incidence += degree_[merged];
+    }
+    live_incidence_ = live_incidence_ - old_incidence + new_incidence;
+
+    maybe_compact_incidence();
+  }
+
+  // Vertex state, indexed by vertex ID
+  std::vector<int> vertex_list_;
+  std::vector<int> vertex_position_;
+  std::vector<size_t> incidence_offset_;
+  std::vector<size_t> degree_;
+
+  // Edge state, indexed by edge ID
+  std::vector<int> edge_list_;
+  std::vector<int> edge_position_;
+  std::vector<size_t> pin_offset_;
+  std::vector<size_t> edge_size_;
+
+  // The vertices of all hyperedges, back to back
+  std::vector<int> pins_;
+
+  // The incidence lists of all vertices. May have holes left behind by lists that were moved.
+  std::vector<int> incidence_;
+  size_t live_incidence_ = 0;
+
+  // The vertices contracted into each vertex, as linked lists threaded through next_within_
+  std::vector<int> first_within_;
+  std::vector<int> next_within_;
+  std::vector<int> last_within_;
+
+  // Scratch space for contractions
+  std::vector<uint32_t> vertex_mark_;
+  std::vector<uint32_t> edge_mark_;
+  uint32_t mark_ = 0;
+  std::vector<int> group_;
+  std::vector<size_t> group_offsets_;
+  std::vector<int> merged_;
+  // The vertex each vertex of the groups is merged into, and the last edge that vertex was written to, by vertex ID
+  std::vector<int> representative_;
+  std::vector<int> last_written_;
+
+  // The IDs of the vertices of the HypergraphBase this was copied from, by vertex ID, if they were renumbered. Sorted.
+  bool renumbered_ = false;
+  std::vector<int> original_ids_;
+};
+
+/* The compact counterpart of Hypergraph.
+ */
+class CompactHypergraph : public CompactHypergraphBase<CompactHypergraph> {
+  using Base = CompactHypergraphBase<CompactHypergraph>;
+
+  friend Base;
+
+public:
+  static constexpr bool weighted = false;
+
+  using Heap = IndexedBucketHeap;
+
+  using Base::Base;
+
+  explicit CompactHypergraph(const Hypergraph &hypergraph) : Base(hypergraph) {}
+};
+
+/* The compact counterpart of WeightedHypergraph. Edge weights are kept in an array indexed by edge ID.
+ */
+template<typename EdgeWeightType>
+class CompactWeightedHypergraph : public CompactHypergraphBase<CompactWeightedHypergraph<EdgeWeightType>> {
+  using Base = CompactHypergraphBase<CompactWeightedHypergraph<EdgeWeightType>>;
+  friend Base;
+
+public:
+  static constexpr bool weighted = true;
+
+  using Heap = QuaternaryHeap<EdgeWeightType>;
+  using EdgeWeight = EdgeWeightType;
+
+  CompactWeightedHypergraph() = default;
+
+  CompactWeightedHypergraph(const std::vector<int> &vertices,
+                            const std::vector<std::pair<std::vector<int>, EdgeWeightType>> &edges) {
+    this->init_vertices(std::begin(vertices), std::end(vertices));
+    edge_weights_.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+      this->init_edge(static_cast<int>(i), std::begin(edges[i].first), std::end(edges[i].first));
+      edge_weights_.push_back(edges[i].second);
+    }
+    this->build_incidence();
+  }
+
+  // See the compressed sparse row constructor of CompactHypergraphBase. Edge i gets weight edge_weights[i].
+  CompactWeightedHypergraph(const size_t num_vertices,
+                            std::vector<size_t> edge_offsets,
+                            std::vector<int> pins,
+                            std::vector<EdgeWeightType> edge_weights) :
+      Base(num_vertices, std::move(edge_offsets), std::move(pins)), edge_weights_(std::move(edge_weights)) {
+    assert(edge_weights_.size() == this->edge_position_.size());
+  }
+
+  CompactWeightedHypergraph(const CsrArrays &arrays, std::vector<EdgeWeightType> edge_weights) :
+      Base(arrays), edge_weights_(std::move(edge_weights)) {
+    assert(edge_weights_.size() == this->edge_position_.size());
+  }
+
+  explicit CompactWeightedHypergraph(const WeightedHypergraph<EdgeWeightType> &hypergraph) :
+      Base(hypergraph), edge_weights_(this->edge_position_.size()) {
+    for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+      edge_weights_[edge_id] = hypergraph.edge_weight(edge_id);
+    }
+  }
+
+  // Every edge of the unweighted hypergraph gets weight 1
+  explicit CompactWeightedHypergraph(const Hypergraph &hypergraph) :
+      Base(hypergraph), edge_weights_(this->edge_position_.size(), 1) {}
+
+  bool operator==(const CompactWeightedHypergraph &other) const {
+    if (!Base::operator==(other)) {
+      return false;
+    }
+    return std::all_of(std::begin(this->edges()), std::end(this->edges()), [this, &other](const auto &edge) {
+      return edge_weight(edge.first) == other.edge_weight(edge.first);
+    });
+  }
+
+  EdgeWeightType edge_weight(int edge_id) const {
+    assert(this->has_edge(edge_id));
+    return edge_weights_[edge_id];
+  }
+
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return Base::memory_usage() + heap_bytes(edge_weights_);
+  }
+
+  void resample_edge_weights(std::function<EdgeWeightType()> f) {
+    for (const int e : this->edge_list_) {
+      edge_weights_[e] = f();
+    }
+  }
+
+  template<typename InputIt>
+  int add_hyperedge(InputIt begin, InputIt end, EdgeWeightType weight) {
+    const int id = Base::add_hyperedge(begin, end);
+    edge_weights_.resize(this->edge_position_.size());
+    edge_weights_[id] = weight;
+    return id;
+  }
+
+private:
+  std::vector<EdgeWeightType> edge_weights_;
+};
+
+/**
+ * Reads a hypergraph in hMETIS format directly into compact form. Assumes that nodes are numbered from [0, n - 1].
+ */
+inline std::istream &operator>>(std::istream &is, CompactHypergraph &hypergraph) {
+  size_t num_edges, num_vertices;
+  is >> num_edges >> num_vertices;
+
+  std::vector<std::vector<int>> edges;
+
+  std::string line;
+  std::getline(is, line); // Throw away first line
+
+  size_t i = 0;
+  while (i++ < num_edges && std::getline(is, line)) {
+    std::vector<int> edge;
+    std::stringstream sstr(line);
+    int node;
+    while (sstr >> node) {
+      edge.push_back(node);
+    }
+    edges.push_back(std::move(edge));
+  }
+
+  std::vector<int> vertices(num_vertices);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+
+  if (is) {
+    hypergraph = CompactHypergraph(vertices, edges);
+  }
+  return is;
+}
+
+template<typename EdgeWeightType>
+std::istream &operator>>(std::istream &is, CompactWeightedHypergraph<EdgeWeightType> &hypergraph) {
+  size_t num_edges, num_vertices;
+  is >> num_edges >> num_vertices;
+
+  std::vector<std::pair<std::vector<int>, EdgeWeightType>> edges;
+  std::string line;
+  std::getline(is, line); // Throw away first line
+
+  size_t i = 0;
+  while (i++ < num_edges && std::getline(is, line)) {
+    EdgeWeightType edge_weight;
+    std::vector<int> edge;
+    std::stringstream sstr(line);
+
+    sstr >> edge_weight;
+
+    int v;
+    while (sstr >> v) {
+      edge.push_back(v);
+    }
+    edges.emplace_back(edge, edge_weight);
+  }
+
+  std::vector<int> vertices(num_vertices);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+
+  if (is) {
+    hypergraph = CompactWeightedHypergraph<EdgeWeightType>(vertices, edges);
+  }
+  return is;
+}
+
+inline std::ostream &operator<<(std::ostream &os, const CompactHypergraph &hypergraph) {
+  os << hypergraph.num_edges() << " " << hypergraph.num_vertices() << std::endl;
+
+  for (const auto &[id, vertices] : hypergraph.edges()) {
+    for (const int v : vertices) {
+      os << v << " ";
+    }
+    os << std::endl;
+  }
+  return os;
+}
+
+template<typename EdgeWeightType>
+std::ostream &operator<<(std::ostream &os, const CompactWeightedHypergraph<EdgeWeightType> &hypergraph) {
+  os << hypergraph.num_edges() << " " << hypergraph.num_vertices() << " 1" << std::endl;
+  for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+    os << hypergraph.edge_weight(edge_id);
+    for (const auto v : vertices) {
+      os << " " << v;
+    }
+    os << std::endl;
+  }
+  return os;
+}
+
+}
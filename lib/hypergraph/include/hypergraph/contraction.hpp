@@ -0,0 +1,891 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "compact.hpp"
+#include "fenwick.hpp"
+#include "hypergraph.hpp"
+#include "instrument.hpp"
+#include "memory.hpp"
+
+namespace hypergraphlib {
+
+/* Contracts the hyperedges of a fixed hypergraph in place, for the randomized contraction algorithms.
+ *
+ * Instead of rebuilding incidence lists, the engine keeps a disjoint-set forest over the vertices of the original
+ * hypergraph. Contracting a hyperedge is a union of its vertices, and the vertices of the contracted hypergraph are
+ * the roots of the forest. Hyperedges are never rewritten, but the number of vertices of the contracted hypergraph in
+ * each hyperedge (its size) is kept up to date. A hyperedge whose vertices all end up in one vertex is a loop, and it
+ * is removed as soon as that happens.
+ *
+ * The edges are kept in one array ordered by size, with the removed edges in front, and their weights in a Fenwick tree
+ * in the same order. When an edge shrinks it is swapped to the boundary of its size class, so the array never needs
+ * to be rebuilt. Edges can be sampled by weight or, for CXY, by weight times a factor that only depends on their size.
+ *
+ * The read-only part (pins, incidences and weights of the hypergraph) is built once and shared between copies, so
+ * copying an engine or resetting it to the original hypergraph takes O(n + m) time.
+ *
+ * Vertices and edges are referred to by dense indices in [0, n) and [0, m), given in increasing order of their IDs in
+ * the hypergraph. partitions() translates back to the vertices of the original hypergraph.
+ *
+ * While recording, every write to the mutable state is kept in an undo log, so the engine can be rolled back to a
+ * checkpoint in time proportional to the changes made since. Branching algorithms can then keep one engine and a
+ * checkpoint per branch instead of a copy of the engine per branch.
+ */
+template<typename HypergraphType>
+class ContractionEngine {
+public:
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+
+  static constexpr int kNone = -1;
+
+  // A state that the engine can be rolled back to while recording
+  struct Checkpoint {
+    size_t num_changes;
+    size_t num_sampler_changes;
+    size_t num_components;
+  };
+
+  /* Time complexity: O(p + n log n + m log m) expected, where p is the size of the hypergraph.
+   */
+  explicit ContractionEngine(const HypergraphType &hypergraph) :
+      index_(std::make_shared<Index>(hypergraph)), scratch_(index_->num_vertices(), index_->weights.size()) {
+    const size_t n = index_->num_vertices();
+    parent_.resize(n);
+    component_size_.resize(n);
+    next_member_.resize(n);
+    last_member_.resize(n);
+    reset();
+    instrument::count(instrument::Counter::EngineAllocations);
+  }
+
+  /* Undo all contractions and edge removals.
+   *
+   * Time complexity: O(n + m)
+   */
+  void reset() {
+    std::iota(std::begin(parent_), std::end(parent_), 0);
+    std::fill(std::begin(component_size_), std::end(component_size_), 1);
+    std::fill(std::begin(next_member_), std::end(next_member_), kNone);
+    std::iota(std::begin(last_member_), std::end(last_member_), 0);
+    num_components_ = parent_.size();
+
+    edge_order_ = index_->edge_order;
+    edge_position_ = index_->edge_position;
+    bucket_begin_ = index_->bucket_begin;
+    edge_size_ = index_->edge_size;
+    sampler_ = index_->sampler;
+    changes_.clear();
+    sampler_changes_.clear();
+  }
+
+  /* Start or stop recording changes. Stopping discards the changes recorded so far.
+   */
+  void record_changes(const bool recording) {
+    recording_ = recording;
+    if (!recording) {
+      changes_.clear();
+      sampler_changes_.clear();
+    }
+  }
+
+  /* The current state, to roll back to later. The engine must be recording.
+   */
+  [[nodiscard]]
+  Checkpoint checkpoint() const {
+    assert(recording_);
+    return {changes_.size(), sampler_changes_.size(), num_components_};
+  }
+
+  /* Undo every change made since the checkpoint was taken. Checkpoints taken after it can no longer be rolled back to.
+   *
+   * Time complexity: O(c + s log m), where c is the number of writes and s the number of sampler updates since the
+   * checkpoint, or O(c + m) if the sampler was rebuilt since
+   */
+  void rollback(const Checkpoint &checkpoint) {
+    assert(checkpoint.num_changes <= changes_.size() && checkpoint.num_sampler_changes <= sampler_changes_.size());
+    while (changes_.size() > checkpoint.num_changes) {
+      undo(changes_.back());
+      changes_.pop_back();
+    }
+    num_components_ = checkpoint.num_components;
+
+    const auto first = std::begin(sampler_changes_) + checkpoint.num_sampler_changes;
+    const bool rebuilt = std::any_of(first, std::end(sampler_changes_), [](const SamplerChange &change) {
+      return change.rebuilt;
+    });
+    if (rebuilt) {
+      sampler_changes_.erase(first, std::end(sampler_changes_));
+      rebuild_sums();
+    } else {
+      while (sampler_changes_.size() > checkpoint.num_sampler_changes) {
+        const auto &change = sampler_changes_.back();
+        if (change.added) {
+          sampler_.subtract(change.position, change.amount);
+        } else {
+          sampler_.add(change.position, change.amount);
+        }
+        sampler_changes_.pop_back();
+      }
+    }
+  }
+
+  /* An estimate of the bytes this engine takes on its own, including the undo log. Copies share the bytes of
+   * shared_memory_usage().
+   *
+   * Time complexity: O(1)
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return sizeof(ContractionEngine) + heap_bytes(parent_) + heap_bytes(component_size_) + heap_bytes(next_member_)
+        + heap_bytes(last_member_) + heap_bytes(edge_order_) + heap_bytes(edge_position_) + heap_bytes(bucket_begin_)
+        + heap_bytes(edge_size_) + sampler_.memory_usage() - sizeof(sampler_) + heap_bytes(changes_)
+        + heap_bytes(sampler_changes_) + heap_bytes(scratch_.roots) + heap_bytes(scratch_.touched)
+        + heap_bytes(scratch_.components) + heap_bytes(scratch_.hits) + heap_bytes(scratch_.size_weights)
+        + heap_bytes(scratch_.sampler_weights) + heap_bytes(scratch_.vertex_mark) + heap_bytes(scratch_.component_mark);
+  }
+
+  /* An estimate of the bytes of the read-only part that this engine shares with its copies.
+   *
+   * Time complexity: O(1)
+   */
+  [[nodiscard]]
+  size_t shared_memory_usage() const {
+    const Index &index = *index_;
+    return sizeof(Index) + heap_bytes(index.pin_offsets) + heap_bytes(index.pins) + heap_bytes(index.weights)
+        + heap_bytes(index.incidence_offsets) + heap_bytes(index.incidence) + heap_bytes(index.within_offsets)
+        + heap_bytes(index.within) + heap_bytes(index.edges) + heap_bytes(index.edge_order)
+        + heap_bytes(index.edge_position) + heap_bytes(index.bucket_begin) + heap_bytes(index.edge_size)
+        + index.sampler.memory_usage() - sizeof(index.sampler);
+  }
+
+  /* The number of vertices of the contracted hypergraph.
+   */
+  [[nodiscard]]
+  size_t num_vertices() const { return num_components_; }
+
+  /* The number of edges that have not been removed, none of which are loops.
+   */
+  [[nodiscard]]
+  size_t num_edges() const { return edge_order_.size() - bucket_begin_[2]; }
+
+  /* The edges that have not been removed, by increasing size. Removing or contracting an edge reorders this list.
+   */
+  [[nodiscard]]
+  IdSpan edges() const {
+    return {edge_order_.data() + bucket_begin_[2], edge_order_.data() + edge_order_.size()};
+  }
+
+  /* The vertices of an edge in the original hypergraph, as dense indices. Each vertex appears once.
+   */
+  [[nodiscard]]
+  IdSpan pins(const int e) const {
+    const int *begin = index_->pins.data();
+    return {begin + index_->pin_offsets[e], begin + index_->pin_offsets[e + 1]};
+  }
+
+  [[nodiscard]]
+  EdgeWeight edge_weight(const int e) const { return index_->weights[e]; }
+
+  /* The largest size of an edge in the original hypergraph.
+   */
+  [[nodiscard]]
+  size_t rank() const { return bucket_begin_.size() - 2; }
+
+  /* The vertex of the contracted hypergraph that contains v.
+   */
+  int find(int v) {
+    int root = v;
+    while (parent_[root] != root) {
+      root = parent_[root];
+    }
+    while (parent_[v] != root) {
+      const int next = parent_[v];
+      write(Field::Parent, parent_, v, root);
+      v = next;
+    }
+    return root;
+  }
+
+  /* The number of vertices of the contracted hypergraph in the edge. Time complexity: O(1)
+   */
+  [[nodiscard]]
+  size_t edge_size(const int e) const { return edge_size_[e]; }
+
+  /* Whether the edge lies entirely inside one vertex of the contracted hypergraph.
+   */
+  [[nodiscard]]
+  bool is_loop(const int e) const { return edge_size_[e] < 2; }
+
+  /* Whether the edge has not been removed.
+   */
+  [[nodiscard]]
+  bool is_live(const int e) const { return edge_position_[e] >= bucket_begin_[2]; }
+
+  /* Remove an edge. Time complexity: O(|e| log m)
+   */
+  void remove_edge(const int e) {
+    assert(is_live(e));
+    move_down(e, edge_size_[e], 1);
+    sampler_subtract(edge_position_[e], edge_weight(e));
+    move_down(e, 1, 0);
+  }
+
+  /* Remove every edge with at least `size` vertices and return their total weight, for the k-spanning edges of FPZ.
+   * The edges are the last c of edges(), and the buckets of smaller edges are shifted past all of them at once, rather
+   * than once per edge as by remove_edge.
+   *
+   * Time complexity: O((c + s) log m + r), where c is the number of edges removed, s is the sum over the smaller sizes
+   * of the lesser of c and the number of edges of that size, and r is the rank of the hypergraph
+   */
+  EdgeWeight remove_edges_of_size_at_least(size_t size) {
+    size = std::max<size_t>(size, 2);
+    if (size >= bucket_begin_.size() - 1) {
+      return 0;
+    }
+    const size_t m = edge_order_.size();
+    const size_t c = m - bucket_begin_[size];
+    if (c == 0) {
+      return 0;
+    }
+
+    // The removed edges are kept right after each bucket as it is shifted, starting at `hole`. A bucket of length l
+    // moves past them by swapping its first min(c, l) edges with the last min(c, l) of the run of removed edges
+    // behind it.
+    size_t hole = bucket_begin_[size];
+    for (size_t bucket = size - 1; bucket >= 2; --bucket) {
+      const size_t begin = bucket_begin_[bucket];
+      const size_t length = hole - begin;
+      for (size_t i = 0; i < std::min(c, length); ++i) {
+        swap_positions(begin + i, begin + std::max(c, length) + i);
+      }
+      write(Field::BucketBegin, bucket_begin_, bucket, begin + c);
+      hole = begin;
+    }
+    write(Field::BucketBegin, bucket_begin_, 1, bucket_begin_[1] + c);
+    for (size_t bucket = size; bucket < bucket_begin_.size() - 1 && bucket_begin_[bucket] != m; ++bucket) {
+      write(Field::BucketBegin, bucket_begin_, bucket, m);
+    }
+
+    EdgeWeight weight = 0;
+    for (size_t position = hole; position < hole + c; ++position) {
+      const EdgeWeight w = edge_weight(edge_order_[position]);
+      sampler_subtract(position, w);
+      weight += w;
+    }
+    return weight;
+  }
+
+  /* Merge two vertices of the contracted hypergraph and return the merged vertex.
+   *
+   * Time complexity: O(sum of the sizes of the edges incident on the smaller vertex) amortized
+   */
+  int merge(int u, int v) {
+    u = find(u);
+    v = find(v);
+    if (u == v) {
+      return u;
+    }
+    scratch_.roots.clear();
+    scratch_.roots.push_back(u);
+    scratch_.roots.push_back(v);
+    return merge_roots();
+  }
+
+  /* Contract an edge and return the vertex it was contracted into. The edge is removed.
+   *
+   * Time complexity: O(sum of the sizes of the edges incident on all but the largest vertex in e) amortized
+   */
+  int contract(const int e) {
+    next_mark(scratch_.vertex_mark, scratch_.current_vertex_mark);
+    scratch_.roots.clear();
+    instrument::count(instrument::Counter::PinsTouched, pins(e).size());
+    for (const int v : pins(e)) {
+      const int root = find(v);
+      if (scratch_.vertex_mark[root] != scratch_.current_vertex_mark) {
+        scratch_.vertex_mark[root] = scratch_.current_vertex_mark;
+        scratch_.roots.push_back(root);
+      }
+    }
+    if (is_live(e)) {
+      remove_edge(e);
+    }
+    write(Field::EdgeSize, edge_size_, e, 1u);
+    return scratch_.roots.size() == 1 ? scratch_.roots[0] : merge_roots();
+  }
+
+  /* Sample an edge with probability proportional to its weight, or return kNone if all edges have weight zero.
+   *
+   * Time complexity: O(log m)
+   */
+  template<typename RandomGenerator>
+  int sample_edge(RandomGenerator &random_generator) {
+    bool rebuilt = false;
+    while (num_edges() > 0 && sampler_.total() > 0) {
+      const size_t position = sampler_.find(draw(random_generator, sampler_.total()));
+      if (is_positive(position)) {
+        return edge_order_[position];
+      }
+      if (!rebuilt) {
+        // The sums have drifted from the weights
+        rebuild_sampler();
+        rebuilt = true;
+      }
+    }
+    return kNone;
+  }
+
+  /* Sample an edge with probability proportional to its weight times `factor(size)`, where size is the size of the
+   * edge, or return kNone if that is zero for all edges. `factor` must be non-negative.
+   *
+   * Time complexity: O(r log m), where r is the rank of the hypergraph
+   */
+  template<typename RandomGenerator, typename SizeFactor>
+  int sample_edge(RandomGenerator &random_generator, SizeFactor &&factor) {
+    auto &size_weights = scratch_.size_weights;
+    const auto weigh_sizes = [&]() {
+      size_weights.assign(rank() + 1, 0);
+      for (size_t size = 2; size <= rank(); ++size) {
+        if (bucket_begin_[size] < bucket_begin_[size + 1]) {
+          const auto weight = bucket_weight(size);
+          if (weight > 0) {
+            size_weights[size] = factor(size) * static_cast<double>(weight);
+          }
+        }
+      }
+    };
+
+    weigh_sizes();
+    bool rebuilt = false;
+    while (true) {
+      const double sum = std::accumulate(std::begin(size_weights), std::end(size_weights), 0.0);
+      if (!(sum > 0)) {
+        return kNone;
+      }
+
+      double target = std::uniform_real_distribution<double>(0, sum)(random_generator);
+      size_t size = 2;
+      for (; size < rank() && (target >= size_weights[size] || size_weights[size] == 0); ++size) {
+        target -= size_weights[size];
+      }
+      if (size_weights[size] > 0) {
+        const size_t begin = bucket_begin_[size];
+        const size_t end = bucket_begin_[size + 1];
+        const size_t position = sampler_.find(sampler_.prefix(begin) + draw(random_generator, bucket_weight(size)));
+        if (begin <= position && position < end && is_positive(position)) {
+          return edge_order_[position];
+        }
+      }
+
+      if (rebuilt) {
+        // Only rounding errors are left in the weight of this size
+        size_weights[size] = 0;
+      } else {
+        // The sums have drifted from the weights
+        rebuild_sampler();
+        rebuilt = true;
+        weigh_sizes();
+      }
+    }
+  }
+
+  /* The total weight of the remaining edges. Once the contracted hypergraph has k vertices this is the value of the
+   * corresponding k-cut.
+   *
+   * Time complexity: O(m)
+   */
+  [[nodiscard]]
+  EdgeWeight cut_value() const {
+    EdgeWeight value = 0;
+    for (const int e : edges()) {
+      value += edge_weight(e);
+    }
+    return value;
+  }
+
+  /* The vertices of the contracted hypergraph.
+   *
+   * Time complexity: O(n)
+   */
+  [[nodiscard]]
+  std::vector<int> vertices() const {
+    std::vector<int> roots;
+    fill_vertices(roots);
+    return roots;
+  }
+
+  // The same, in memory from `resource`
+  [[nodiscard]]
+  std::pmr::vector<int> vertices(std::pmr::memory_resource *resource) const {
+    std::pmr::vector<int> roots(resource);
+    fill_vertices(roots);
+    return roots;
+  }
+
+  /* Merge vertices arbitrarily until there are at most k of them.
+   */
+  void merge_down_to(const size_t k) {
+    if (num_components_ <= k) {
+      return;
+    }
+    auto &roots = scratch_.components;
+    roots.clear();
+    fill_vertices(roots);
+    for (size_t i = 1; num_components_ > k; ++i) {
+      merge(roots[0], roots[i]);
+    }
+  }
+
+  /* The vertices of the original hypergraph (with their IDs in it) grouped by the vertex of the contracted hypergraph
+   * they belong to.
+   *
+   * Time complexity: O(n)
+   */
+  [[nodiscard]]
+  std::vector<std::vector<int>> partitions() const {
+    std::vector<std::vector<int>> partitions;
+    fill_partitions(partitions);
+    return partitions;
+  }
+
+  // The same, in memory from `resource`
+  [[nodiscard]]
+  std::pmr::vector<std::pmr::vector<int>> partitions(std::pmr::memory_resource *resource) const {
+    std::pmr::vector<std::pmr::vector<int>> partitions(resource);
+    fill_partitions(partitions);
+    return partitions;
+  }
+
+private:
+  template<typename Vertices>
+  void fill_vertices(Vertices &roots) const {
+    roots.reserve(num_components_);
+    for (size_t v = 0; v < parent_.size(); ++v) {
+      if (parent_[v] == static_cast<int>(v)) {
+        roots.push_back(static_cast<int>(v));
+      }
+    }
+  }
+
+  template<typename Partitions>
+  void fill_partitions(Partitions &partitions) const {
+    partitions.reserve(num_components_);
+    for (size_t root = 0; root < parent_.size(); ++root) {
+      if (parent_[root] != static_cast<int>(root)) {
+        continue;
+      }
+      auto &partition = partitions.emplace_back();
+      for (int v = static_cast<int>(root); v != kNone; v = next_member_[v]) {
+        const auto within_begin = std::begin(index_->within) + index_->within_offsets[v];
+        const auto within_end = std::begin(index_->within) + index_->within_offsets[v + 1];
+        partition.insert(std::end(partition), within_begin, within_end);
+      }
+    }
+  }
+
+  // The original hypergraph in flat arrays, and the state of the engine before anything is contracted
+  struct Index {
+    explicit Index(const HypergraphType &hypergraph) {
+      // Number vertices and edges in the order of their IDs, so that runs do not depend on the iteration order of the
+      // hypergraph
+      std::vector<int> vertex_ids(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
+      std::sort(std::begin(vertex_ids), std::end(vertex_ids));
+      std::vector<int> edge_ids;
+      edge_ids.reserve(hypergraph.num_edges());
+      for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+        edge_ids.push_back(edge_id);
+      }
+      std::sort(std::begin(edge_ids), std::end(edge_ids));
+
+      std::unordered_map<int, int> dense_vertex;
+      within_offsets.push_back(0);
+      for (const int v : vertex_ids) {
+        dense_vertex.insert({v, static_cast<int>(dense_vertex.size())});
+        within.insert(std::end(within),
+                      std::begin(hypergraph.vertices_within(v)),
+                      std::end(hypergraph.vertices_within(v)));
+        within_offsets.push_back(within.size());
+      }
+
+      pin_offsets.push_back(0);
+      size_t max_size = 1;
+      for (const int edge_id : edge_ids) {
+        const size_t begin = pins.size();
+        for (const int v : hypergraph.edges().at(edge_id)) {
+          pins.push_back(dense_vertex.at(v));
+        }
+        std::sort(std::begin(pins) + begin, std::end(pins));
+        pins.erase(std::unique(std::begin(pins) + begin, std::end(pins)), std::end(pins));
+        pin_offsets.push_back(pins.size());
+        weights.push_back(hypergraphlib::edge_weight(hypergraph, edge_id));
+        edge_size.push_back(static_cast<uint32_t>(pins.size() - begin));
+        max_size = std::max<size_t>(max_size, edge_size.back());
+      }
+
+      // Count sort the edges by size. Edges with less than two vertices can never be cut, so they are removed from the
+      // start.
+      const size_t m = weights.size();
+      bucket_begin.assign(max_size + 2, 0);
+      for (size_t e = 0; e < m; ++e) {
+        ++bucket_begin[bucket_of(e) + 1];
+      }
+      std::partial_sum(std::begin(bucket_begin), std::end(bucket_begin), std::begin(bucket_begin));
+      edge_order.resize(m);
+      edge_position.resize(m);
+      std::vector<EdgeWeight> ordered_weights(m, 0);
+      std::vector<size_t> next_position(std::begin(bucket_begin), std::end(bucket_begin) - 1);
+      for (size_t e = 0; e < m; ++e) {
+        const size_t position = next_position[bucket_of(e)]++;
+        edge_order[position] = static_cast<int>(e);
+        edge_position[e] = static_cast<uint32_t>(position);
+        if (edge_size[e] >= 2) {
+          ordered_weights[position] = weights[e];
+          edges.push_back(static_cast<int>(e));
+        }
+      }
+      sampler = FenwickTree<EdgeWeight>(std::move(ordered_weights));
+
+      // Count sort the live edges into incidence lists
+      incidence_offsets.assign(vertex_ids.size() + 1, 0);
+      for (const int e : edges) {
+        for (size_t i = pin_offsets[e]; i < pin_offsets[e + 1]; ++i) {
+          ++incidence_offsets[pins[i] + 1];
+        }
+      }
+      std::partial_sum(std::begin(incidence_offsets), std::end(incidence_offsets), std::begin(incidence_offsets));
+      incidence.resize(incidence_offsets.back());
+      std::vector<size_t> next(std::begin(incidence_offsets), std::end(incidence_offsets) - 1);
+      for (const int e : edges) {
+        for (size_t i = pin_offsets[e]; i < pin_offsets[e + 1]; ++i) {
+          incidence[next[pins[i]]++] = e;
+        }
+      }
+    }
+
+    [[nodiscard]]
+    size_t num_vertices() const { return within_offsets.size() - 1; }
+
+    // Removed edges are kept with the empty edges
+    [[nodiscard]]
+    size_t bucket_of(const size_t e) const { return edge_size[e] >= 2 ? edge_size[e] : 0; }
+
+    std::vector<size_t> pin_offsets;
+    std::vector<int> pins;
+    std::vector<EdgeWeight> weights;
+
+    // The live edges that each vertex is incident on
+    std::vector<size_t> incidence_offsets;
+    std::vector<int> incidence;
+
+    // The original vertices that each vertex contains
+    std::vector<size_t> within_offsets;
+    std::vector<int> within;
+
+    // The edges that are not removed from the start
+    std::vector<int> edges;
+
+    // The initial state
+    std::vector<int> edge_order;
+    std::vector<uint32_t> edge_position;
+    std::vector<size_t> bucket_begin;
+    std::vector<uint32_t> edge_size;
+    FenwickTree<EdgeWeight> sampler;
+  };
+
+  /* Space used within a single operation. A copy gets space of its own, so that copies of an engine can be used on
+   * different threads, but the contents are not copied, and assigning keeps the space that is already there.
+   */
+  struct Scratch {
+    Scratch(const size_t n, const size_t m) : hits(m, 0), vertex_mark(n, 0), component_mark(m, 0) {}
+
+    Scratch(const Scratch &other) : Scratch(other.vertex_mark.size(), other.hits.size()) {}
+
+    Scratch(Scratch &&) noexcept = default;
+
+    Scratch &operator=(const Scratch &other) {
+      if (vertex_mark.size() != other.vertex_mark.size() || hits.size() != other.hits.size()) {
+        *this = Scratch(other);
+      }
+      return *this;
+    }
+
+    Scratch &operator=(Scratch &&) noexcept = default;
+
+    std::vector<int> roots;
+    std::vector<int> touched;
+    // The vertices to merge in merge_down_to
+    std::vector<int> components;
+    // Zero outside of merge_roots
+    std::vector<uint32_t> hits;
+    std::vector<double> size_weights;
+    std::vector<EdgeWeight> sampler_weights;
+    std::vector<uint32_t> vertex_mark;
+    uint32_t current_vertex_mark = 0;
+    std::vector<uint32_t> component_mark;
+    uint32_t current_component_mark = 0;
+  };
+
+  template<typename RandomGenerator>
+  static EdgeWeight draw(RandomGenerator &random_generator, const EdgeWeight total) {
+    if constexpr (std::is_integral_v<EdgeWeight>) {
+      return std::uniform_int_distribution<EdgeWeight>(0, total - 1)(random_generator);
+    } else {
+      return std::uniform_real_distribution<EdgeWeight>(0, total)(random_generator);
+    }
+  }
+
+  // Whether the edge at a position is live and has positive weight
+  [[nodiscard]]
+  bool is_positive(const size_t position) const {
+    return position >= bucket_begin_[2] && edge_weight(edge_order_[position]) > 0;
+  }
+
+  // Recompute the sums of the sampler from the weights of the live edges
+  void rebuild_sampler() {
+    rebuild_sums();
+    if (recording_) {
+      sampler_changes_.push_back({0, 0, false, true});
+    }
+  }
+
+  void rebuild_sums() {
+    auto &weights = scratch_.sampler_weights;
+    weights.assign(edge_order_.size(), 0);
+    for (size_t position = bucket_begin_[2]; position < edge_order_.size(); ++position) {
+      weights[position] = edge_weight(edge_order_[position]);
+    }
+    sampler_.assign(weights);
+  }
+
+  // The arrays of the mutable state, for the undo log
+  enum class Field : uint8_t {
+    Parent,
+    ComponentSize,
+    NextMember,
+    LastMember,
+    EdgeOrder,
+    EdgePosition,
+    BucketBegin,
+    EdgeSize,
+  };
+
+  // A write to one of the arrays, with the value it overwrote
+  struct Change {
+    Field field;
+    uint32_t index;
+    uint64_t old_value;
+  };
+
+  // An update of the sampler, or a rebuild of it
+  struct SamplerChange {
+    size_t position;
+    EdgeWeight amount;
+    bool added;
+    bool rebuilt;
+  };
+
+  template<typename T>
+  void write(const Field field, std::vector<T> &array, const size_t index, const T value) {
+    if (recording_) {
+      changes_.push_back({field, static_cast<uint32_t>(index), static_cast<uint64_t>(array[index])});
+    }
+    array[index] = value;
+  }
+
+  void undo(const Change &change) {
+    switch (change.field) {
+      case Field::Parent: parent_[change.index] = static_cast<int>(change.old_value);
+        break;
+      case Field::ComponentSize: component_size_[change.index] = static_cast<int>(change.old_value);
+        break;
+      case Field::NextMember: next_member_[change.index] = static_cast<int>(change.old_value);
+        break;
+      case Field::LastMember: last_member_[change.index] = static_cast<int>(change.old_value);
+        break;
+      case Field::EdgeOrder: edge_order_[change.index] = static_cast<int>(change.old_value);
+        break;
+      case Field::EdgePosition: edge_position_[change.index] = static_cast<uint32_t>(change.old_value);
+        break;
+      case Field::BucketBegin: bucket_begin_[change.index] = static_cast<size_t>(change.old_value);
+        break;
+      case Field::EdgeSize: edge_size_[change.index] = static_cast<uint32_t>(change.old_value);
+        break;
+    }
+  }
+
+  void sampler_add(const size_t position, const EdgeWeight amount) {
+    sampler_.add(position, amount);
+    if (recording_) {
+      sampler_changes_.push_back({position, amount, true, false});
+    }
+  }
+
+  void sampler_subtract(const size_t position, const EdgeWeight amount) {
+    sampler_.subtract(position, amount);
+    if (recording_) {
+      sampler_changes_.push_back({position, amount, false, false});
+    }
+  }
+
+  // The total weight of the edges of a size
+  [[nodiscard]]
+  EdgeWeight bucket_weight(const size_t size) const {
+    return sampler_.prefix(bucket_begin_[size + 1]) - sampler_.prefix(bucket_begin_[size]);
+  }
+
+  void swap_positions(const size_t a, const size_t b) {
+    if (a == b) {
+      return;
+    }
+    const int e = edge_order_[a];
+    const int f = edge_order_[b];
+    write(Field::EdgeOrder, edge_order_, a, f);
+    write(Field::EdgeOrder, edge_order_, b, e);
+    write(Field::EdgePosition, edge_position_, e, static_cast<uint32_t>(b));
+    write(Field::EdgePosition, edge_position_, f, static_cast<uint32_t>(a));
+    // Both edges are live, so their weights are in the sampler
+    const EdgeWeight weight_e = edge_weight(e);
+    const EdgeWeight weight_f = edge_weight(f);
+    if (weight_e < weight_f) {
+      sampler_add(a, weight_f - weight_e);
+      sampler_subtract(b, weight_f - weight_e);
+    } else if (weight_f < weight_e) {
+      sampler_subtract(a, weight_e - weight_f);
+      sampler_add(b, weight_e - weight_f);
+    }
+  }
+
+  /* Move an edge from bucket `from` down to bucket `to`, where bucket 0 holds the removed edges. On the way the edge
+   * is swapped to the front of each bucket and the boundary of the bucket moves past it. The sampler is only kept up
+   * to date for swaps between live edges, so an edge in bucket 1 must have its weight taken out before moving on.
+   *
+   * Time complexity: O((from - to) log m)
+   */
+  void move_down(const int e, const size_t from, const size_t to) {
+    for (size_t bucket = from; bucket > to; --bucket) {
+      swap_positions(edge_position_[e], bucket_begin_[bucket]);
+      write(Field::BucketBegin, bucket_begin_, bucket, bucket_begin_[bucket] + 1);
+    }
+  }
+
+  // Whether the edge has a vertex in the given vertex of the contracted hypergraph
+  bool touches(const int e, const int root) {
+    const auto vertices = pins(e);
+    size_t num_touched = 0;
+    const bool touched = std::any_of(vertices.begin(), vertices.end(), [this, root, &num_touched](const int v) {
+      ++num_touched;
+      return find(v) == root;
+    });
+    instrument::count(instrument::Counter::PinsTouched, num_touched);
+    return touched;
+  }
+
+  /* Merge the distinct roots in scratch_.roots into the one with the most vertices, and update the sizes of the edges.
+   *
+   * An edge that has vertices in c of the roots loses c - 1 vertices. The edges with vertices in the smaller roots are
+   * found through their incidence lists, and only those are checked against the largest root, so each original vertex
+   * is looked at O(log n) times over a run.
+   */
+  int merge_roots() {
+    assert(scratch_.roots.size() >= 2);
+    const auto &roots = scratch_.roots;
+    const int largest = *std::max_element(std::begin(roots), std::end(roots), [this](const int a, const int b) {
+      return component_size_[a] < component_size_[b];
+    });
+
+    scratch_.touched.clear();
+    size_t num_incidences = 0;
+    for (const int root : roots) {
+      if (root == largest) {
+        continue;
+      }
+      next_mark(scratch_.component_mark, scratch_.current_component_mark);
+      for (int v = root; v != kNone; v = next_member_[v]) {
+        num_incidences += index_->incidence_offsets[v + 1] - index_->incidence_offsets[v];
+        for (size_t i = index_->incidence_offsets[v]; i < index_->incidence_offsets[v + 1]; ++i) {
+          const int e = index_->incidence[i];
+          if (!is_live(e) || scratch_.component_mark[e] == scratch_.current_component_mark) {
+            continue;
+          }
+          scratch_.component_mark[e] = scratch_.current_component_mark;
+          if (scratch_.hits[e]++ == 0) {
+            scratch_.touched.push_back(e);
+          }
+        }
+      }
+    }
+    instrument::count(instrument::Counter::PinsTouched, num_incidences);
+
+    for (const int e : scratch_.touched) {
+      const size_t merged = scratch_.hits[e] + (touches(e, largest) ? 1 : 0);
+      scratch_.hits[e] = 0;
+      if (merged < 2) {
+        continue;
+      }
+      const size_t size = edge_size_[e] - (merged - 1);
+      if (size < 2) {
+        remove_edge(e);
+        write(Field::EdgeSize, edge_size_, e, 1u);
+      } else {
+        move_down(e, edge_size_[e], size);
+        write(Field::EdgeSize, edge_size_, e, static_cast<uint32_t>(size));
+      }
+    }
+
+    for (const int root : roots) {
+      if (root == largest) {
+        continue;
+      }
+      write(Field::Parent, parent_, root, largest);
+      write(Field::ComponentSize, component_size_, largest, component_size_[largest] + component_size_[root]);
+      write(Field::NextMember, next_member_, last_member_[largest], root);
+      write(Field::LastMember, last_member_, largest, last_member_[root]);
+      --num_components_;
+    }
+    return largest;
+  }
+
+  static void next_mark(std::vector<uint32_t> &marks, uint32_t &current) {
+    if (++current == 0) {
+      std::fill(std::begin(marks), std::end(marks), 0);
+      current = 1;
+    }
+  }
+
+  std::shared_ptr<const Index> index_;
+
+  // The disjoint-set forest, with union by size and path compression. The vertices of each root are also kept in a
+  // linked list that starts at the root.
+  std::vector<int> parent_;
+  std::vector<int> component_size_;
+  std::vector<int> next_member_;
+  std::vector<int> last_member_;
+  size_t num_components_ = 0;
+
+  // The edges ordered by size, with the removed edges in bucket 0. Bucket 1 is always empty.
+  std::vector<int> edge_order_;
+  std::vector<uint32_t> edge_position_;
+  std::vector<size_t> bucket_begin_;
+  std::vector<uint32_t> edge_size_;
+
+  // The weights of the edges in edge_order_, with 0 for removed edges
+  FenwickTree<EdgeWeight> sampler_;
+
+  // The undo log, while recording
+  bool recording_ = false;
+  std::vector<Change> changes_;
+  std::vector<SamplerChange> sampler_changes_;
+
+  Scratch scratch_;
+};
+
+}
@@ -31,6 +31,166 @@ struct HypergraphCut {
   }
 };
 
+/* Evaluates cuts of a hypergraph given as the part of every vertex, so that checking whether an edge is cut is a single
+ * scan over the labels of its pins for their minimum and maximum rather than a search of the partitions.
+ *
+ * The hypergraph is copied once into arrays indexed by dense vertex IDs, given by an IdMap, and a labelling is an array
+ * with the part of vertex v at position index(v). Labels are arbitrary ints; vertices with the same label are on the
+ * same side.
+ */
+template<typename HypergraphType>
+class CutEvaluator {
+public:
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+
+  /* Time complexity: O(n log n + p + u), where p is the size of the hypergraph and u is the difference between the
+   * largest and smallest vertex ID
+   */
+  explicit CutEvaluator(const HypergraphType &hypergraph) : ids_(hypergraph.vertices()) {
+
+    // Edges that cannot be cut are left out
+    edge_offsets_.push_back(0);
+    for (const auto &[id, edge] : hypergraph.edges()) {
+      if (std::distance(std::begin(edge), std::end(edge)) < 2) {
+        continue;
+      }
+      for (const int v : edge) {
+        pins_.push_back(ids_.dense(v));
+      }
+      edge_offsets_.push_back(pins_.size());
+      weights_.push_back(edge_weight(hypergraph, id));
+    }
+  }
+
+  // The number of labels in a labelling
+  [[nodiscard]]
+  size_t num_vertices() const { return ids_.size(); }
+
+  // The position of the label of vertex v in a labelling, or -1 if v is not a vertex of the hypergraph
+  [[nodiscard]]
+  int index(const int v) const { return ids_.dense(v); }
+
+  /* Label the vertices of partition i with i. The partitions are a range of ranges of vertices. Returns false if a
+   * vertex is not in the hypergraph or is in more than one partition. Vertices in no partition are labelled -1.
+   *
+   * Time complexity: O(n)
+   */
+  template<typename It>
+  bool label(const It begin, const It end, std::vector<int> &labels) const {
+    labels.assign(num_vertices(), -1);
+    return label(begin, end, labels.data(), 1);
+  }
+
+  /* The value of the cut given by a labelling.
+   *
+   * Time complexity: O(p)
+   */
+  [[nodiscard]]
+  EdgeWeight value(const std::vector<int> &labels) const {
+    assert(labels.size() == num_vertices());
+    EdgeWeight value = 0;
+    for (size_t e = 0; e < weights_.size(); ++e) {
+      int lo = labels[pins_[edge_offsets_[e]]];
+      int hi = lo;
+      for (size_t i = edge_offsets_[e] + 1; i < edge_offsets_[e + 1]; ++i) {
+        const int l = labels[pins_[i]];
+        lo = std::min(lo, l);
+        hi = std::max(hi, l);
+      }
+      if (lo != hi) {
+        value += weights_[e];
+      }
+    }
+    return value;
+  }
+
+  /* The values of the cuts given by several labellings at once, in one pass over the edges. The labellings are
+   * interleaved: the label of vertex index(v) in labelling j is at labels[index(v) * batch + j], so the labels of a pin
+   * in all labellings are contiguous and are reduced together.
+   *
+   * Time complexity: O(p * batch)
+   */
+  [[nodiscard]]
+  std::vector<EdgeWeight> values(const std::vector<int> &labels, const size_t batch) const {
+    assert(labels.size() == num_vertices() * batch);
+    std::vector<EdgeWeight> values(batch, 0);
+    std::vector<int> lo(batch), hi(batch);
+    for (size_t e = 0; e < weights_.size(); ++e) {
+      const int *first = labels.data() + static_cast<size_t>(pins_[edge_offsets_[e]]) * batch;
+      std::copy(first, first + batch, std::begin(lo));
+      std::copy(first, first + batch, std::begin(hi));
+      for (size_t i = edge_offsets_[e] + 1; i < edge_offsets_[e + 1]; ++i) {
+        const int *row = labels.data() + static_cast<size_t>(pins_[i]) * batch;
+        for (size_t j = 0; j < batch; ++j) {
+          lo[j] = std::min(lo[j], row[j]);
+          hi[j] = std::max(hi[j], row[j]);
+        }
+      }
+      const EdgeWeight w = weights_[e];
+      for (size_t j = 0; j < batch; ++j) {
+        values[j] += lo[j] != hi[j] ? w : 0;
+      }
+    }
+    return values;
+  }
+
+  /* The values of several cuts, each given as a range of partitions. Returns an empty vector if the partitions of one of
+   * the cuts are not disjoint sets of vertices of the hypergraph.
+   *
+   * Time complexity: O((n + p) * c), where c is the number of cuts
+   */
+  template<typename It>
+  std::vector<EdgeWeight> values(const It begin, const It end) const {
+    const auto batch = static_cast<size_t>(std::distance(begin, end));
+    std::vector<int> labels(num_vertices() * batch, -1);
+    size_t j = 0;
+    for (auto it = begin; it != end; ++it, ++j) {
+      if (!label(std::begin(*it), std::end(*it), labels.data() + j, batch)) {
+        return {};
+      }
+    }
+    return values(labels, batch);
+  }
+
+private:
+  template<typename It>
+  bool label(const It begin, const It end, int *labels, const size_t stride) const {
+    int i = 0;
+    for (auto it = begin; it != end; ++it, ++i) {
+      for (const int v : *it) {
+        const int position = index(v);
+        if (position == -1 || labels[position * stride] != -1) {
+          return false;
+        }
+        labels[position * stride] = i;
+      }
+    }
+    return true;
+  }
+
+  IdMap ids_;
+
+  // The pins of edge e, as dense IDs, are pins_[edge_offsets_[e]] to pins_[edge_offsets_[e + 1]]
+  std::vector<size_t> edge_offsets_;
+  std::vector<int> pins_;
+  std::vector<EdgeWeight> weights_;
+};
+
+/* The cut with every vertex v of its partitions replaced by ids.id(v), for a cut of a hypergraph whose vertices are the
+ * dense IDs of `ids`, such as one renumbered by normalize or compact_ids.
+ *
+ * Time complexity: O(n)
+ */
+template<typename EdgeWeightType>
+HypergraphCut<EdgeWeightType> translate(HypergraphCut<EdgeWeightType> cut, const IdMap &ids) {
+  for (auto &partition : cut.partitions) {
+    for (int &v : partition) {
+      v = ids.id(v);
+    }
+  }
+  return cut;
+}
+
 template<typename HypergraphType>
 bool cut_is_valid(const HypergraphCut<typename HypergraphType::EdgeWeight> &cut,
                   const HypergraphType &hypergraph,
@@ -54,15 +214,11 @@ bool cut_is_valid(const HypergraphCut<typename HypergraphType::EdgeWeight> &cut,
     return false;
   }
 
-  // Check vertices in partitions are the vertices in the hypergraph
-  std::set<int> in_partitions;
-  for (const auto &partition : cut.partitions) {
-    for (const auto v : partition) {
-      in_partitions.emplace(v);
-    }
-  }
-  std::set<int> in_hypergraph(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
-  if (in_partitions != in_hypergraph) {
+  // Check vertices in partitions are the vertices in the hypergraph. There are as many of them as vertices in the
+  // hypergraph, so this fails if a vertex is in two partitions
+  const CutEvaluator<HypergraphType> evaluator(hypergraph);
+  std::vector<int> labels;
+  if (!evaluator.label(std::begin(cut.partitions), std::end(cut.partitions), labels)) {
     error = "Vertices in partitions do not match vertices in hypergraph";
     return false;
   }
@@ -74,33 +230,7 @@ bool cut_is_valid(const HypergraphCut<typename HypergraphType::EdgeWeight> &cut,
   }
 
   // Check cut value is as expected
-  constexpr auto edge_entirely_inside_partition =
-      [](const auto edge_begin, const auto edge_end, const auto partition_begin, const auto partition_end) {
-        return std::all_of(edge_begin, edge_end, [partition_begin, partition_end](const auto v) {
-          return std::find(partition_begin, partition_end, v) != partition_end;
-        });
-      };
-
-  typename HypergraphType::EdgeWeight expected_cut_value = 0;
-  for (const auto &edge : hypergraph.edges()) {
-    // Destructured bindings cannot be captured in lambdas
-    const auto &edge_id = edge.first;
-    const auto &vertices = edge.second;
-    const bool none_of_edges_entirely_inside_partition =
-        std::none_of(std::begin(cut.partitions),
-                     std::end(cut.partitions),
-                     [edge_entirely_inside_partition, vertices](const auto &partition) {
-                       return edge_entirely_inside_partition(
-                           std::begin(vertices),
-                           std::end(vertices),
-                           std::begin(partition),
-                           std::end(partition)
-                       );
-                     });
-    if (none_of_edges_entirely_inside_partition) {
-      expected_cut_value += edge_weight(hypergraph, edge_id);
-    }
-  }
+  const typename HypergraphType::EdgeWeight expected_cut_value = evaluator.value(labels);
   if constexpr (std::is_floating_point_v<typename HypergraphType::EdgeWeight>) {
     if (std::abs(expected_cut_value - cut.value) > 0.1) {
       error = "Stored value of cut (" + std::to_string(cut.value) + ") does not match actual value of cut ("
@@ -192,6 +322,83 @@ auto one_vertex_cut(const HypergraphType &hypergraph, const int v) -> typename H
   }
 }
 
+/* The merges made while contracting a hypergraph, from which a one vertex cut seen at any point of the contraction can
+ * be worked out afterwards. Recording a cut is then O(1), the number of merges so far and the vertex, and only the cut
+ * that is returned gets its partitions built.
+ *
+ * Merged vertices must not be tracked in the hypergraph, since the vertices within each vertex are copied when the log
+ * is created and are not expected to change.
+ */
+class ContractionLog {
+public:
+  // Time complexity: O(n + u), where u is the number of vertices contracted into the vertices of the hypergraph
+  template<typename HypergraphType>
+  explicit ContractionLog(const HypergraphType &hypergraph) {
+    within_offsets_.push_back(0);
+    for (const int v : hypergraph.vertices()) {
+      vertices_.push_back(v);
+      within_.insert(std::end(within_), std::begin(hypergraph.vertices_within(v)),
+                     std::end(hypergraph.vertices_within(v)));
+      within_offsets_.push_back(within_.size());
+    }
+  }
+
+  // Record that vertex v was merged into vertex into
+  void merge(const int v, const int into) {
+    merges_.emplace_back(v, into);
+  }
+
+  // The number of merges recorded so far
+  [[nodiscard]]
+  size_t size() const { return merges_.size(); }
+
+  /* The cut of the given value between vertex v and the rest of the vertices, as it was after the first num_merges
+   * merges.
+   *
+   * Time complexity: O((n + m) log n + u), where m is the number of merges
+   */
+  template<typename EdgeWeightType>
+  HypergraphCut<EdgeWeightType> one_vertex_cut(const size_t num_merges, const int v, const EdgeWeightType value) const {
+    assert(num_merges <= merges_.size());
+    int max_id = v;
+    for (const int u : vertices_) {
+      max_id = std::max(max_id, u);
+    }
+    for (size_t i = 0; i < num_merges; ++i) {
+      max_id = std::max({max_id, merges_[i].first, merges_[i].second});
+    }
+
+    // Every merge joins two vertices that exist at the time, so they are both roots
+    std::vector<int> parent(static_cast<size_t>(max_id) + 1);
+    std::iota(std::begin(parent), std::end(parent), 0);
+    for (size_t i = 0; i < num_merges; ++i) {
+      parent[merges_[i].first] = merges_[i].second;
+    }
+    const auto find = [&parent](int u) {
+      while (parent[u] != u) {
+        parent[u] = parent[parent[u]];
+        u = parent[u];
+      }
+      return u;
+    };
+
+    std::vector<int> partitions[2];
+    for (size_t i = 0; i < vertices_.size(); ++i) {
+      auto &partition = partitions[find(vertices_[i]) == v ? 0 : 1];
+      partition.insert(std::end(partition), std::begin(within_) + within_offsets_[i],
+                       std::begin(within_) + within_offsets_[i + 1]);
+    }
+    return {std::begin(partitions), std::end(partitions), value};
+  }
+
+private:
+  // The vertices within vertices_[i] are within_[within_offsets_[i]] to within_[within_offsets_[i + 1]]
+  std::vector<int> vertices_;
+  std::vector<size_t> within_offsets_;
+  std::vector<int> within_;
+  std::vector<std::pair<int, int>> merges_;
+};
+
 template<typename HypergraphType, bool ReturnsPartitions>
 using Cut = typename std::conditional<ReturnsPartitions,
                                       HypergraphCut<typename HypergraphType::EdgeWeight>,
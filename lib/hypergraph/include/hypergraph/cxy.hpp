@@ -5,11 +5,14 @@
 #include <chrono>
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <random>
 #include <vector>
 #include <cassert>
 
 #include "hypergraph.hpp"
+#include "instrument.hpp"
 #include "util.hpp"
 
 namespace hypergraphlib {
@@ -29,7 +32,8 @@ struct cxy : public ContractionAlgo<cxy> {
  * then they can multiply the returned value by the weight of the
  * edge themselves.
  *
- * The calculation is computed in logs for numerical stability.
+ * The calculation is computed in logs for numerical stability. It takes
+ * O(r(e) + k) time; the contraction algorithms use a DeltaTable instead.
  *
  *
  *   n: number of vertices
@@ -37,12 +41,6 @@ struct cxy : public ContractionAlgo<cxy> {
  *   k: number of partitions
  */
   static inline double cxy_delta(size_t num_vertices, size_t hyperedge_size, size_t k) {
-    static std::map<std::tuple<size_t, size_t, size_t>, double> memo;
-
-    if (auto it = memo.find(std::make_tuple(num_vertices, hyperedge_size, k)); it != std::end(memo)) {
-      return it->second;
-    }
-
     double s = 0;
     if (num_vertices < hyperedge_size + k - 2) {
       return 0;
@@ -60,6 +58,81 @@ struct cxy : public ContractionAlgo<cxy> {
     return std::exp(s);
   }
 
+/**
+ * Answers cxy_delta in constant time for a fixed k and hypergraphs with at most `max_vertices` vertices.
+ *
+ * With a table of log-factorials L[x] = log(x!), the two sums in cxy_delta are
+ *   delta_e = exp(L[n - r(e)] - L[n - r(e) - k + 1] - L[n] + L[n - k + 1]).
+ * The table is not changed after construction, so one table can be shared by the contexts of several threads.
+ */
+  class DeltaTable {
+  public:
+    /* Time complexity: O(max_vertices)
+     */
+    DeltaTable(const size_t max_vertices, const size_t k) : k_(k), log_factorial_(max_vertices + 1) {
+      // Summing in extended precision keeps the differences of large entries accurate
+      long double sum = 0;
+      log_factorial_[0] = 0;
+      for (size_t i = 1; i <= max_vertices; ++i) {
+        sum += std::log(static_cast<long double>(i));
+        log_factorial_[i] = static_cast<double>(sum);
+      }
+    }
+
+    /* Time complexity: O(1)
+     */
+    [[nodiscard]]
+    double operator()(const size_t num_vertices, const size_t hyperedge_size) const {
+      assert(num_vertices < log_factorial_.size());
+      if (num_vertices + 1 < hyperedge_size + k_) {
+        return 0;
+      }
+      const double s = log_factorial_[num_vertices - hyperedge_size]
+          - log_factorial_[num_vertices - hyperedge_size - k_ + 1]
+          - log_factorial_[num_vertices]
+          + log_factorial_[num_vertices - k_ + 1];
+      return std::exp(s);
+    }
+
+    // The bytes the table takes, including the table itself
+    [[nodiscard]]
+    size_t memory_usage() const { return sizeof(DeltaTable) + heap_bytes(log_factorial_); }
+
+  private:
+    size_t k_;
+    std::vector<double> log_factorial_;
+  };
+
+/**
+ * cxy_delta for a k that is known at compile time. Cancelling the factorials leaves
+ *   delta_e = prod_{i=0}^{k-2} (n - r(e) - i) / (n - i),
+ * which is (n - r(e)) / n for k = 2. For small k this is cheaper than a DeltaTable lookup, which takes an exponential.
+ */
+  template<size_t K>
+  static constexpr double fixed_k_delta(const size_t num_vertices, const size_t hyperedge_size) {
+    static_assert(K >= 2);
+    if (num_vertices + 1 < hyperedge_size + K) {
+      return 0;
+    }
+    double delta = 1;
+    for (size_t i = 0; i + 2 <= K; ++i) {
+      delta *= static_cast<double>(num_vertices - hyperedge_size - i) / static_cast<double>(num_vertices - i);
+    }
+    return delta;
+  }
+
+/**
+ * The delta of a hyperedge in a kernel specialized for K, see util::with_fixed_k. Looks it up in the table if K is 0.
+ */
+  template<size_t K>
+  static double delta_of(const DeltaTable &table, const size_t num_vertices, const size_t hyperedge_size) {
+    if constexpr (K == 0) {
+      return table(num_vertices, hyperedge_size);
+    } else {
+      return fixed_k_delta<K>(num_vertices, hyperedge_size);
+    }
+  }
+
 /**
  * Return n choose k
  */
@@ -84,78 +157,84 @@ struct cxy : public ContractionAlgo<cxy> {
 
   static constexpr bool pass_discovery_value = false;
 
+  // Threads are spread over runs
+  static constexpr bool parallel_branches = false;
+
   static constexpr char name[] = "CXY";
 
   template<typename HypergraphType>
-  using Context = util::BaseContext<HypergraphType>;
+  struct Context : public util::BaseContext<HypergraphType> {
+
+    // Shared with the contexts of worker threads
+    std::shared_ptr<const DeltaTable> delta;
+
+    Context(const HypergraphType &hypergraph,
+            size_t k,
+            const std::mt19937_64 &random_generator,
+            typename HypergraphType::EdgeWeight discovery_value,
+            std::optional<size_t> max_num_runs,
+            size_t num_threads = 1)
+        : util::BaseContext<HypergraphType>(hypergraph, k, random_generator, discovery_value, max_num_runs, num_threads),
+          delta(std::make_shared<const DeltaTable>(hypergraph.num_vertices(), k)) {
+      this->shared_footprint.grow(delta->memory_usage());
+    }
+
+    Context(const Context &parent, const std::mt19937_64 &random_generator)
+        : util::BaseContext<HypergraphType>(parent, random_generator), delta(parent.delta) {}
+  };
 
 /**
  * The contraction algorithm from [CXY'18]. This returns the minimum cut with some probability.
  *
- * Takes time O(np) where p is the size of the hypergraph.
+ * Takes time O(n(r + log m)) for sampling, where r is the rank of the hypergraph, plus the time for contractions.
  */
   template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity>
   static HypergraphCut<typename HypergraphType::EdgeWeight> contract(Context<HypergraphType> &ctx) {
-    HypergraphType hypergraph(ctx.hypergraph);
-
-    std::vector<int> candidates = {};
-    std::vector<int> edge_ids;
-    std::vector<double> deltas;
+    return util::with_fixed_k(ctx.k, [&ctx](const auto K) {
+      return contract_fixed_k<HypergraphType, ReturnPartitions, Verbosity, decltype(K)::value>(ctx);
+    });
+  }
 
-    typename HypergraphType::EdgeWeight min_so_far = total_edge_weight(hypergraph);
+  // A run of the contraction algorithm, specialized for k = K or for any k if K is 0
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity, size_t K>
+  static HypergraphCut<typename HypergraphType::EdgeWeight> contract_fixed_k(Context<HypergraphType> &ctx) {
+    const size_t k = K != 0 ? K : ctx.k;
+    auto &engine = ctx.engine;
+    engine.reset();
 
     while (true) {
-      edge_ids.resize(hypergraph.edges().size());
-      deltas.resize(hypergraph.edges().size());
-
-      size_t i = 0;
-      for (const auto &[edge_id, incidence] : hypergraph.edges()) {
-        edge_ids[i] = edge_id;
-        deltas[i] = cxy_delta(hypergraph.num_vertices(), incidence.size(), ctx.k) * edge_weight(hypergraph, edge_id);
-        ++i;
+      // Sample an edge with probability proportional to its delta. This only depends on the size of the edge, so
+      // the engine can sample it without looking at every edge.
+      const size_t n = engine.num_vertices();
+      int sampled;
+      {
+        const instrument::ScopedTimer timer(instrument::Phase::Sampling);
+        sampled = engine.sample_edge(ctx.random_generator, [n, &delta = *ctx.delta](const size_t size) {
+          return delta_of<K>(delta, n, size);
+        });
       }
-
-      if (std::accumulate(std::begin(deltas), std::end(deltas), 0.0) == 0) {
-        auto cut = total_edge_weight(hypergraph);
-        min_so_far = std::min(min_so_far, cut);
+      if (sampled == ContractionEngine<HypergraphType>::kNone) {
         break;
       }
-
-      std::discrete_distribution<size_t> distribution(std::begin(deltas),
-                                                      std::end(deltas));
-
-      size_t sampled = distribution(ctx.random_generator);
-      int sampled_id = edge_ids.at(sampled);
-
-      hypergraph.template contract_in_place<true, ReturnPartitions>(sampled_id);
+      {
+        const instrument::ScopedTimer timer(instrument::Phase::Contraction);
+        engine.contract(sampled);
+      }
       ++ctx.stats.num_contractions;
     }
 
+    const auto min_so_far = engine.cut_value();
+
     // May terminate early if it finds a zero cost cut with >k partitions, so need
     // to merge partitions. At this point the sum of deltas is zero, so every
     // remaining hyperedge crosses all components, so we can merge components
     // without changing the cut value.
-    while (hypergraph.num_vertices() > ctx.k) {
-      auto begin = std::begin(hypergraph.vertices());
-      auto end = std::begin(hypergraph.vertices());
-      std::advance(end, 2);
-      // Contract two vertices
-      hypergraph = hypergraph.template contract<true, ReturnPartitions>(begin, end);
-      ++ctx.stats.num_contractions;
+    if (engine.num_vertices() > k) {
+      ctx.stats.num_contractions += engine.num_vertices() - k;
+      engine.merge_down_to(k);
     }
 
-    if constexpr (ReturnPartitions) {
-      std::vector<std::vector<int>> partitions;
-      for (const auto v : hypergraph.vertices()) {
-        const auto &partition = hypergraph.vertices_within(v);
-        partitions.emplace_back(std::begin(partition), std::end(partition));
-      }
-      return HypergraphCut<typename HypergraphType::EdgeWeight>(std::begin(partitions),
-                                                                std::end(partitions),
-                                                                min_so_far);
-    } else {
-      return HypergraphCut<typename HypergraphType::EdgeWeight>(min_so_far);
-    }
+    return ctx.template cut_of<ReturnPartitions>(engine, min_so_far);
   }
 
 /**
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace hypergraphlib {
+
+/* A Fenwick tree (binary indexed tree) over non-negative values, for sampling an index with probability proportional
+ * to its value while the values change.
+ *
+ * Only the partial sums are stored, so callers that already know the values pass changes as differences. When T is a
+ * floating point type the sums may drift from the values after many updates; `assign` recomputes them exactly.
+ */
+template<typename T>
+class FenwickTree {
+public:
+  FenwickTree() = default;
+
+  /* Time complexity: O(n)
+   */
+  explicit FenwickTree(const std::vector<T> &values) {
+    assign(values);
+  }
+
+  [[nodiscard]]
+  size_t size() const { return tree_.size(); }
+
+  [[nodiscard]]
+  bool empty() const { return tree_.empty(); }
+
+  [[nodiscard]]
+  T total() const { return total_; }
+
+  // The bytes the tree takes, including the tree itself
+  [[nodiscard]]
+  size_t memory_usage() const { return sizeof(FenwickTree) + tree_.capacity() * sizeof(T); }
+
+  /* Time complexity: O(log n)
+   */
+  void add(const size_t i, const T delta) {
+    total_ += delta;
+    for (size_t j = i + 1; j <= tree_.size(); j += lowbit(j)) {
+      tree_[j - 1] += delta;
+    }
+  }
+
+  /* Time complexity: O(log n)
+   */
+  void subtract(const size_t i, const T delta) {
+    total_ -= delta;
+    for (size_t j = i + 1; j <= tree_.size(); j += lowbit(j)) {
+      tree_[j - 1] -= delta;
+    }
+  }
+
+  /* The sum of the first i values. Time complexity: O(log n)
+   */
+  [[nodiscard]]
+  T prefix(size_t i) const {
+    T sum = 0;
+    for (; i > 0; i -= lowbit(i)) {
+      sum += tree_[i - 1];
+    }
+    return sum;
+  }
+
+  /* Time complexity: O(log n)
+   */
+  [[nodiscard]]
+  T value(const size_t i) const { return prefix(i + 1) - prefix(i); }
+
+  /* The index i such that prefix(i) <= target < prefix(i + 1). For target in [0, total()) this is an index with
+   * non-zero value, chosen with probability proportional to it if target is uniform.
+   *
+   * Time complexity: O(log n)
+   */
+  [[nodiscard]]
+  size_t find(T target) const {
+    assert(!tree_.empty());
+    size_t step = 1;
+    while (2 * step <= tree_.size()) {
+      step *= 2;
+    }
+    size_t position = 0;
+    for (; step > 0; step /= 2) {
+      if (position + step <= tree_.size() && tree_[position + step - 1] <= target) {
+        position += step;
+        target -= tree_[position - 1];
+      }
+    }
+    // Only reachable with rounding errors
+    return position < tree_.size() ? position : tree_.size() - 1;
+  }
+
+  /* Replace all values. Time complexity: O(n)
+   */
+  void assign(const std::vector<T> &values) {
+    tree_ = values;
+    total_ = 0;
+    for (size_t j = 1; j <= tree_.size(); ++j) {
+      total_ += values[j - 1];
+      const size_t parent = j + lowbit(j);
+      if (parent <= tree_.size()) {
+        tree_[parent - 1] += tree_[j - 1];
+      }
+    }
+  }
+
+private:
+  static size_t lowbit(const size_t i) { return i & (~i + 1); }
+
+  std::vector<T> tree_;
+  T total_ = 0;
+};
+
+}
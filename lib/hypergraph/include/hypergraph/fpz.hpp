@@ -1,13 +1,22 @@
 // Branching contraction algorithm from [FPZ'19]
 #pragma once
 
+#include <atomic>
 #include <cmath>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <thread>
 #include <cassert>
 
 #include "hypergraph.hpp"
+#include "contraction.hpp"
 #include "cxy.hpp"
+#include "instrument.hpp"
 
 namespace hypergraphlib {
 
@@ -28,6 +37,9 @@ struct fpz : public ContractionAlgo<fpz> {
 
   static constexpr bool pass_discovery_value = true;
 
+  // Threads are spread over the branches of each run rather than over runs
+  static constexpr bool parallel_branches = true;
+
   static constexpr char name[] = "FPZ";
 
 /**
@@ -35,7 +47,7 @@ struct fpz : public ContractionAlgo<fpz> {
  */
   template<typename HypergraphType>
   struct LocalContext {
-    HypergraphType hypergraph;
+    ContractionEngine<HypergraphType> engine;
     typename HypergraphType::EdgeWeight accumulated;
   };
 
@@ -43,13 +55,35 @@ struct fpz : public ContractionAlgo<fpz> {
   struct Context : public util::BaseContext<HypergraphType> {
     std::deque<LocalContext<HypergraphType>> branches;
 
-    using util::BaseContext<HypergraphType>::BaseContext;
+    // Engines of finished branches, kept so that new branches can be copied into them without allocating
+    std::vector<ContractionEngine<HypergraphType>> spare_engines;
+
+    // Shared with the contexts of worker threads
+    std::shared_ptr<const cxy::DeltaTable> delta;
+
+    Context(const HypergraphType &hypergraph,
+            size_t k,
+            const std::mt19937_64 &random_generator,
+            typename HypergraphType::EdgeWeight discovery_value,
+            std::optional<size_t> max_num_runs,
+            size_t num_threads = 1)
+        : util::BaseContext<HypergraphType>(hypergraph, k, random_generator, discovery_value, max_num_runs, num_threads),
+          delta(std::make_shared<const cxy::DeltaTable>(hypergraph.num_vertices(), k)) {
+      this->shared_footprint.grow(delta->memory_usage());
+    }
+
+    Context(const Context &parent, const std::mt19937_64 &random_generator)
+        : util::BaseContext<HypergraphType>(parent, random_generator), delta(parent.delta) {}
   };
 
 /**
  * The randomized branching contraction algorithm from [FPZ'19] that returns the minimum-k-cut of a hypergraph with some
  * probability.
  *
+ * The branches are explored depth first on the engine of the context. A branch that is set aside for later is a
+ * checkpoint of the engine, and is resumed by rolling the engine back to it, so waiting branches only cost memory for
+ * the changes made since they were set aside.
+ *
  * @tparam HypergraphType
  * @tparam Verbosity
  * @param hypergraph
@@ -60,19 +94,169 @@ struct fpz : public ContractionAlgo<fpz> {
  */
   template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity>
   static HypergraphCut<typename HypergraphType::EdgeWeight> contract(Context<HypergraphType> &ctx) {
+    return util::with_fixed_k(ctx.k, [&ctx](const auto K) {
+      return contract_fixed_k<HypergraphType, ReturnPartitions, Verbosity, decltype(K)::value>(ctx);
+    });
+  }
+
+  // A run of the branching contraction algorithm, specialized for k = K or for any k if K is 0
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity, size_t K>
+  static HypergraphCut<typename HypergraphType::EdgeWeight> contract_fixed_k(Context<HypergraphType> &ctx) {
+    if (ctx.num_threads > 1) {
+      return contract_in_parallel<HypergraphType, ReturnPartitions, Verbosity, K>(ctx);
+    }
+
+    ctx.engine.reset();
+    instrument::count(instrument::Counter::Branches);
+    explore_depth_first<HypergraphType, ReturnPartitions, Verbosity, K>(ctx, ctx.engine, 0);
+    return ctx.min_so_far;
+  }
+
+  /* Explores the branch on `engine` and all branches below it depth first. A branch that is set aside for later is a
+   * checkpoint of the engine, kept in the arena of the context.
+   */
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity, size_t K>
+  static void explore_depth_first(Context<HypergraphType> &ctx,
+                                  ContractionEngine<HypergraphType> &engine,
+                                  typename HypergraphType::EdgeWeight accumulated) {
+    using Engine = ContractionEngine<HypergraphType>;
+    using EdgeWeight = typename HypergraphType::EdgeWeight;
+
+    // The branches that were set aside, and the value they had accumulated
+    std::pmr::vector<std::pair<typename Engine::Checkpoint, EdgeWeight>> pending(&ctx.arena);
+
+    engine.record_changes(true);
+    while (!ctx.stop_requested()) {
+      const auto step = next_step<K>(ctx, engine, accumulated);
+      // A branch can only add to its value, so one that another search has beaten is dropped
+      const bool beaten = ctx.beaten_by_bound(accumulated);
+      if (step.finished || beaten) {
+        if (!beaten) {
+          finish_branch<HypergraphType, ReturnPartitions, Verbosity>(ctx, engine, accumulated);
+        }
+        if (pending.empty() || ctx.min_so_far.value <= ctx.discovery_value) {
+          break;
+        }
+        engine.rollback(pending.back().first);
+        accumulated = pending.back().second;
+        pending.pop_back();
+        continue;
+      }
+      if (step.edge == Engine::kNone) {
+        continue;
+      }
+      if (step.branch) {
+        pending.emplace_back(engine.checkpoint(), accumulated);
+        instrument::count(instrument::Counter::Branches);
+        instrument::count_max(instrument::Counter::MaxBranchDepth, pending.size());
+      }
+      {
+        const instrument::ScopedTimer timer(instrument::Phase::Contraction);
+        engine.contract(step.edge);
+      }
+      ++ctx.stats.num_contractions;
+    }
+    engine.record_changes(false);
+  }
+
+/**
+ * A single run of the branching contraction algorithm, with the branches spread over `ctx.num_threads` threads.
+ *
+ * Every worker keeps its own deque of branches and continues with its newest branch, like the single-threaded version
+ * does. Since a stolen branch has to be explored on another thread, every branch of the parallel search has an engine
+ * of its own rather than a checkpoint. A worker that runs out of branches steals the oldest branch of another worker,
+ * which tends to be the root of the largest unexplored subtree. A branch whose accumulated value has already reached
+ * the best cut found so far, or the bound from other searches, is pruned, since contracting it further can only add to
+ * its value. All workers stop once the discovery value is reached or the search is stopped.
+ *
+ * With a memory limit, a worker that would have to allocate an engine that takes the search over the limit explores
+ * its branch depth first instead, with checkpoints on the engine it already has, like the single-threaded version.
+ */
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity, size_t K>
+  static HypergraphCut<typename HypergraphType::EdgeWeight> contract_in_parallel(Context<HypergraphType> &ctx) {
+    struct Worker {
+      std::mutex mutex;
+      std::deque<LocalContext<HypergraphType>> branches;
+    };
+    std::vector<Worker> workers(ctx.num_threads);
+
+    // The number of branches that have been created but not finished. It is raised for the children of a branch
+    // before the branch itself is finished, so it only reaches zero once every branch has been explored.
+    std::atomic<size_t> num_pending = 1;
+    std::atomic<bool> discovered = false;
+    std::mutex result_mutex;
 
-    ctx.branches.push_back({.hypergraph = ctx.hypergraph, .accumulated = 0});
+    ctx.engine.reset();
+    workers[0].branches.push_back({.engine = ctx.engine, .accumulated = 0});
+    const MemoryTracker::Allocation root_engine(ctx.memory, ctx.engine.memory_usage());
+    count_root_branch();
 
-    while (!ctx.branches.empty()) {
-      auto local_ctx = std::move(ctx.branches.back());
-      ctx.branches.pop_back();
+    std::vector<std::mt19937_64> random_generators;
+    for (size_t t = 0; t < workers.size(); ++t) {
+      std::seed_seq seed{ctx.random_generator(), ctx.random_generator()};
+      random_generators.emplace_back(seed);
+    }
+
+    const auto work = [&](const size_t id) {
+      Context<HypergraphType> worker_ctx(ctx, random_generators[id]);
+      auto &own = workers[id];
+
+      while (!discovered.load() && num_pending.load() > 0 && !ctx.stop_requested()) {
+        std::optional<LocalContext<HypergraphType>> branch;
+        {
+          std::lock_guard lock(own.mutex);
+          if (!own.branches.empty()) {
+            branch = std::move(own.branches.back());
+            own.branches.pop_back();
+          }
+        }
+        for (size_t i = 1; !branch && i < workers.size(); ++i) {
+          auto &victim = workers[(id + i) % workers.size()];
+          std::lock_guard lock(victim.mutex);
+          if (!victim.branches.empty()) {
+            branch = std::move(victim.branches.front());
+            victim.branches.pop_front();
+          }
+        }
+        if (!branch) {
+          std::this_thread::yield();
+          continue;
+        }
 
-      // Call internal function with global context. This will update it.
-      contract_<HypergraphType, ReturnPartitions, Verbosity>(ctx, local_ctx);
+        if (branch->accumulated < ctx.min_val_so_far.load() && !ctx.beaten_by_bound(branch->accumulated)) {
+          // The children of the branch are pushed onto the worker's own context, and then handed over to the deque
+          contract_<HypergraphType, ReturnPartitions, Verbosity, K>(worker_ctx, *branch);
+          num_pending += worker_ctx.branches.size();
+          {
+            std::lock_guard lock(own.mutex);
+            for (auto &child : worker_ctx.branches) {
+              own.branches.push_back(std::move(child));
+            }
+            instrument::count_max(instrument::Counter::MaxBranchDepth, own.branches.size());
+          }
+          worker_ctx.branches.clear();
 
-      if (ctx.min_so_far.value <= ctx.discovery_value) {
-        break;
+          util::update_minimum(ctx.min_val_so_far, worker_ctx.min_so_far.value);
+          if (worker_ctx.min_so_far.value <= ctx.discovery_value) {
+            discovered.store(true);
+          }
+        }
+        --num_pending;
       }
+
+      std::lock_guard lock(result_mutex);
+      ctx.min_so_far = std::min(ctx.min_so_far, worker_ctx.min_so_far);
+      ctx.stats.num_contractions += worker_ctx.stats.num_contractions;
+      // The worker thread only counted this run
+      ctx.stats.counters += instrument::local();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < workers.size(); ++t) {
+      threads.emplace_back(work, t);
+    }
+    for (auto &thread : threads) {
+      thread.join();
     }
 
     return ctx.min_so_far;
@@ -93,89 +277,159 @@ struct fpz : public ContractionAlgo<fpz> {
     return log_n * log_n;
   }
 
-  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity>
-  static void contract_(Context<HypergraphType> &ctx,
-                        LocalContext<HypergraphType> &local_ctx) {
-    auto &[hypergraph, accumulated] = local_ctx;
-
-    // Remove k-spanning hyperedges from hypergraph
-    std::vector<int> k_spanning_hyperedges;
-    for (const auto &[edge_id, vertices] : hypergraph.edges()) {
-      // TODO overflow here?
-      if (vertices.size() >= hypergraph.num_vertices() - ctx.k + 2) {
-        k_spanning_hyperedges.push_back(edge_id);
-        accumulated += edge_weight(hypergraph, edge_id);
-      }
+  // What a branch does next
+  struct Step {
+    // No edges are left, so the branch has a cut
+    bool finished;
+    // The edge to contract, or kNone if there is nothing to contract this step
+    int edge;
+    // Whether the branch before contracting the edge should be explored as well
+    bool branch;
+  };
+
+  /* Removes the k-spanning edges of the branch, and picks the edge to contract next. Specialized for k = K, or for any
+   * k if K is 0.
+   */
+  template<size_t K, typename HypergraphType>
+  static Step next_step(Context<HypergraphType> &ctx,
+                        ContractionEngine<HypergraphType> &engine,
+                        typename HypergraphType::EdgeWeight &accumulated) {
+    const size_t k = K != 0 ? K : ctx.k;
+
+    // Remove k-spanning hyperedges from hypergraph. The engine orders edges by size, so they are at the back and are
+    // removed together.
+    {
+      const instrument::ScopedTimer timer(instrument::Phase::SpanningEdgeRemoval);
+      const size_t n = engine.num_vertices();
+      accumulated += engine.remove_edges_of_size_at_least(n + 2 > k ? n + 2 - k : 0);
     }
-    for (const auto edge_id : k_spanning_hyperedges) {
-      hypergraph.remove_hyperedge(edge_id);
-    }
-
-    // If no edges remain, return the answer
-    if (hypergraph.num_edges() == 0) {
-      // May terminate early if it finds a zero cost cut with >k partitions, so need
-      // to merge partitions.
-      while (hypergraph.num_vertices() > ctx.k) {
-        auto begin = std::begin(hypergraph.vertices());
-        auto end = std::begin(hypergraph.vertices());
-        std::advance(end, 2);
-        // Contract two vertices
-        hypergraph = hypergraph.template contract<true, ReturnPartitions>(begin, end);
-        ++ctx.stats.num_contractions;
-      }
 
-      if constexpr (ReturnPartitions) {
-        std::vector<std::vector<int>> partitions;
-        for (const auto v : hypergraph.vertices()) {
-          const auto &partition = hypergraph.vertices_within(v);
-          partitions.emplace_back(std::begin(partition), std::end(partition));
-        }
-        const auto cut =
-            HypergraphCut<typename HypergraphType::EdgeWeight>(std::begin(partitions),
-                                                               std::end(partitions),
-                                                               accumulated);
-        if constexpr (Verbosity > 1) {
-          std::cout << "Got cut of value " << cut.value << std::endl;
-        }
-        ctx.min_so_far = std::min(ctx.min_so_far, cut);
-        ctx.min_val_so_far.store(std::min(ctx.min_val_so_far.load(), cut.value));
-        return;
-      } else {
-        if constexpr (Verbosity > 1) {
-          std::cout << "Got cut of value " << accumulated << std::endl;
-        }
-        ctx.min_so_far = std::min(ctx.min_so_far, HypergraphCut<typename HypergraphType::EdgeWeight>{accumulated});
-        ctx.min_val_so_far.store(ctx.min_so_far.value);
-        return;
-      }
+    if (engine.num_edges() == 0) {
+      return {true, ContractionEngine<HypergraphType>::kNone, false};
     }
 
-    static std::uniform_real_distribution<> dis(0.0, 1.0);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
 
     // Select a hyperedge with probability proportional to its weight
-    std::vector<int> edge_ids;
-    std::vector<Hypergraph::EdgeWeight> edge_weights;
-    for (const auto &[edge_id, vertices] : hypergraph.edges()) {
-      edge_ids.push_back(edge_id);
-      edge_weights.push_back(edge_weight(hypergraph, edge_id));
+    int sampled;
+    {
+      const instrument::ScopedTimer timer(instrument::Phase::Sampling);
+      sampled = engine.sample_edge(ctx.random_generator);
+    }
+    if (sampled == ContractionEngine<HypergraphType>::kNone) {
+      // Only edges of weight zero are left, so they can be cut for free
+      engine.remove_edges_of_size_at_least(0);
+      return {false, ContractionEngine<HypergraphType>::kNone, false};
     }
-    std::discrete_distribution<size_t> distribution(std::begin(edge_weights), std::end(edge_weights));
-    const auto sampled_edge_id = edge_ids.at(distribution(ctx.random_generator));
-    const auto sampled_edge = hypergraph.edges().at(sampled_edge_id);
 
-    double redo =
-        redo_probability(hypergraph.num_vertices(), sampled_edge.size(), ctx.k);
+    // The redo probability, 1 - cxy_delta
+    const double redo = 1 - cxy::delta_of<K>(*ctx.delta, engine.num_vertices(), engine.edge_size(sampled));
+    return {false, sampled, dis(ctx.random_generator) < redo};
+  }
+
+  /* One step of a branch of the parallel search. The branch and its children are pushed onto `ctx.branches`, with the
+   * children on top.
+   */
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity, size_t K>
+  static void contract_(Context<HypergraphType> &ctx,
+                        LocalContext<HypergraphType> &local_ctx) {
+    auto &[engine, accumulated] = local_ctx;
+    if (ctx.memory_limit.has_value() && ctx.spare_engines.empty()
+        && ctx.memory->current() + engine.memory_usage() > ctx.memory_limit.value()) {
+      // Branching would copy the engine, so the whole subtree is explored on this engine instead. Nothing else in the
+      // arena outlives a step.
+      ctx.arena.reset();
+      explore_depth_first<HypergraphType, ReturnPartitions, Verbosity, K>(ctx, engine, accumulated);
+      ctx.spare_engines.push_back(std::move(engine));
+      return;
+    }
+    const auto [finished, sampled, branch] = next_step<K>(ctx, engine, accumulated);
 
-    if (dis(ctx.random_generator) < redo) {
-      HypergraphType contracted = hypergraph.template contract<true, ReturnPartitions>(sampled_edge_id);
+    if (ctx.beaten_by_bound(accumulated)) {
+      ctx.spare_engines.push_back(std::move(engine));
+      return;
+    }
+    if (finished) {
+      finish_branch<HypergraphType, ReturnPartitions, Verbosity>(ctx, engine, accumulated);
+      ctx.spare_engines.push_back(std::move(engine));
+      return;
+    }
+    if (sampled == ContractionEngine<HypergraphType>::kNone) {
+      ctx.branches.push_back(std::move(local_ctx));
+      return;
+    }
+
+    if (branch) {
+      LocalContext<HypergraphType> contracted{.engine = copy_engine(ctx, engine), .accumulated = accumulated};
+      instrument::count(instrument::Counter::Branches);
+      {
+        const instrument::ScopedTimer timer(instrument::Phase::Contraction);
+        contracted.engine.contract(sampled);
+      }
       ++ctx.stats.num_contractions;
-      ctx.branches.push_back(local_ctx);
-      ctx.branches.push_back({.hypergraph = contracted, .accumulated = accumulated});
+      ctx.branches.push_back(std::move(local_ctx));
+      ctx.branches.push_back(std::move(contracted));
     } else {
-      local_ctx.hypergraph.template contract_in_place<true, ReturnPartitions>(sampled_edge_id);
+      {
+        const instrument::ScopedTimer timer(instrument::Phase::Contraction);
+        engine.contract(sampled);
+      }
       ++ctx.stats.num_contractions;
-      ctx.branches.push_back(local_ctx);
+      ctx.branches.push_back(std::move(local_ctx));
+    }
+  }
+
+  // Record the cut of a branch that has no edges left
+  template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity>
+  static void finish_branch(Context<HypergraphType> &ctx,
+                            ContractionEngine<HypergraphType> &engine,
+                            const typename HypergraphType::EdgeWeight accumulated) {
+    // May terminate early if it finds a zero cost cut with >k partitions, so need
+    // to merge partitions.
+    if (engine.num_vertices() > ctx.k) {
+      ctx.stats.num_contractions += engine.num_vertices() - ctx.k;
+      engine.merge_down_to(ctx.k);
+    }
+
+    if constexpr (ReturnPartitions) {
+      const auto cut = ctx.template cut_of<true>(engine, accumulated);
+      if constexpr (Verbosity > 1) {
+        std::cout << "Got cut of value " << cut.value << std::endl;
+      }
+      ctx.min_so_far = std::min(ctx.min_so_far, cut);
+      ctx.min_val_so_far.store(std::min(ctx.min_val_so_far.load(), cut.value));
+    } else {
+      if constexpr (Verbosity > 1) {
+        std::cout << "Got cut of value " << accumulated << std::endl;
+      }
+      ctx.min_so_far = std::min(ctx.min_so_far, HypergraphCut<typename HypergraphType::EdgeWeight>{accumulated});
+      ctx.min_val_so_far.store(ctx.min_so_far.value);
+    }
+  }
+
+  // The root branch of a parallel run starts from a copy of the engine of the context
+  static void count_root_branch() {
+    instrument::count(instrument::Counter::Branches);
+    instrument::count(instrument::Counter::EngineCopies);
+    instrument::count(instrument::Counter::EngineAllocations);
+  }
+
+  // A copy of the engine, reusing the storage of a spare engine if there is one. New engines are counted in the
+  // footprint of the context until the run is over.
+  template<typename HypergraphType>
+  static ContractionEngine<HypergraphType> copy_engine(Context<HypergraphType> &ctx,
+                                                       const ContractionEngine<HypergraphType> &engine) {
+    const instrument::ScopedTimer timer(instrument::Phase::Copying);
+    instrument::count(instrument::Counter::EngineCopies);
+    if (ctx.spare_engines.empty()) {
+      instrument::count(instrument::Counter::EngineAllocations);
+      ctx.footprint.grow(engine.memory_usage());
+      return engine;
     }
+    auto copy = std::move(ctx.spare_engines.back());
+    ctx.spare_engines.pop_back();
+    copy = engine;
+    return copy;
   }
 
 };
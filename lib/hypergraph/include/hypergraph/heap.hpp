@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <list>
 #include <unordered_map>
@@ -27,6 +28,12 @@ public:
    */
   BucketHeap(std::vector<int> values, size_t capacity);
 
+  /* Replace the contents with the given values and capacity, all with key zero.
+   *
+   * Time complexity: O(n + b), where b is the number of buckets.
+   */
+  void reset(const std::vector<int> &values, size_t capacity);
+
   /* Increment the key of the value.
    *
    * Time complexity: O(1).
@@ -48,7 +55,7 @@ public:
   std::pair<size_t, int> pop_key_val();
 
 private:
-  const size_t capacity_;
+  size_t capacity_;
 
   // buckets_[i] is a collection of all values with key = i
   std::vector<std::list<int>> buckets_;
@@ -63,12 +70,205 @@ private:
   size_t max_key_;
 };
 
+/* The same as BucketHeap, but without any allocations per value. Values are used as indices into flat arrays, so they
+ * should be small non-negative integers (like vertex IDs). Each bucket is a doubly linked list threaded through
+ * arrays indexed by value.
+ *
+ * reset() reuses the arrays, so a heap that is reset for each vertex ordering only allocates when there are more
+ * values or buckets than before.
+ */
+class IndexedBucketHeap {
+public:
+  /* Time complexity: O(n + b), where n is the number of values and b the number of buckets.
+   */
+  IndexedBucketHeap(const std::vector<int> &values, const size_t capacity) {
+    reset(values, capacity);
+  }
+
+  /* Time complexity: O(n + b)
+   */
+  void reset(const std::vector<int> &values, size_t capacity);
+
+  /* Time complexity: O(1)
+   */
+  void increment(const int value) {
+    unlink(value);
+    const size_t key = ++key_[value];
+    assert(key < capacity_);
+    link(value, key);
+    max_key_ = std::max(max_key_, key);
+  }
+
+  /* Time complexity: Amortized O(1) over a vertex ordering, worst-case is O(b).
+   */
+  int pop() { return pop_key_val().second; }
+
+  /* Time complexity: Amortized O(1) over a vertex ordering, worst-case is O(b).
+   */
+  std::pair<size_t, int> pop_key_val() {
+    while (head_[max_key_] == kNone) {
+      --max_key_;
+    }
+    const int value = head_[max_key_];
+    unlink(value);
+    return {max_key_, value};
+  }
+
+private:
+  static constexpr int kNone = -1;
+
+  // Add the value to the front of the bucket, like BucketHeap does
+  void link(const int value, const size_t key) {
+    prev_[value] = kNone;
+    next_[value] = head_[key];
+    if (head_[key] != kNone) {
+      prev_[head_[key]] = value;
+    }
+    head_[key] = value;
+  }
+
+  void unlink(const int value) {
+    if (prev_[value] != kNone) {
+      next_[prev_[value]] = next_[value];
+    } else {
+      head_[key_[value]] = next_[value];
+    }
+    if (next_[value] != kNone) {
+      prev_[next_[value]] = prev_[value];
+    }
+  }
+
+  size_t capacity_ = 0;
+
+  // The first value of each bucket
+  std::vector<int> head_;
+
+  // The key and neighbours in its bucket of each value
+  std::vector<size_t> key_;
+  std::vector<int> next_;
+  std::vector<int> prev_;
+
+  size_t max_key_ = 0;
+};
+
+/* An addressable max-heap with four children per node, for vertex orderings of weighted hypergraphs. Values are used
+ * as indices into flat arrays like in IndexedBucketHeap. Keys only ever increase, so an increment is a sift-up, which
+ * is cheap since the tree is shallow.
+ */
+template<typename EdgeWeightType>
+class QuaternaryHeap {
+public:
+  /* Time complexity: O(n)
+   */
+  QuaternaryHeap(const std::vector<int> &values, const size_t capacity) {
+    reset(values, capacity);
+  }
+
+  /* Time complexity: O(n)
+   */
+  void reset(const std::vector<int> &values, [[maybe_unused]] const size_t capacity) {
+    heap_.assign(std::begin(values), std::end(values));
+    const int max_value = values.empty() ? -1 : *std::max_element(std::begin(values), std::end(values));
+    if (key_.size() < static_cast<size_t>(max_value + 1)) {
+      key_.resize(max_value + 1);
+      position_.resize(max_value + 1);
+    }
+    for (size_t i = 0; i < heap_.size(); ++i) {
+      key_[heap_[i]] = 0;
+      position_[heap_[i]] = i;
+    }
+  }
+
+  /* Increase the key of the value by a non-negative amount.
+   *
+   * Time complexity: O(log n)
+   */
+  void increment(const int value, const EdgeWeightType amount) {
+    key_[value] += amount;
+    sift_up(position_[value]);
+  }
+
+  /* Pop an arbitrary value with a maximum key.
+   *
+   * Time complexity: O(log n)
+   */
+  int pop() { return pop_key_val().second; }
+
+  std::pair<EdgeWeightType, int> pop_key_val() {
+    assert(!heap_.empty());
+    const int top = heap_.front();
+    const int last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+      place(last, 0);
+      sift_down(0);
+    }
+    return {key_[top], top};
+  }
+
+private:
+  void place(const int value, const size_t i) {
+    heap_[i] = value;
+    position_[value] = i;
+  }
+
+  void sift_up(size_t i) {
+    const int value = heap_[i];
+    const EdgeWeightType key = key_[value];
+    while (i > 0) {
+      const size_t parent = (i - 1) / 4;
+      if (!(key_[heap_[parent]] < key)) {
+        break;
+      }
+      place(heap_[parent], i);
+      i = parent;
+    }
+    place(value, i);
+  }
+
+  void sift_down(size_t i) {
+    const int value = heap_[i];
+    const EdgeWeightType key = key_[value];
+    while (true) {
+      const size_t first = 4 * i + 1;
+      if (first >= heap_.size()) {
+        break;
+      }
+      const size_t end = std::min(first + 4, heap_.size());
+      size_t best = first;
+      for (size_t child = first + 1; child < end; ++child) {
+        if (key_[heap_[best]] < key_[heap_[child]]) {
+          best = child;
+        }
+      }
+      if (!(key < key_[heap_[best]])) {
+        break;
+      }
+      place(heap_[best], i);
+      i = best;
+    }
+    place(value, i);
+  }
+
+  std::vector<int> heap_;
+
+  // The key and position in heap_ of each value
+  std::vector<EdgeWeightType> key_;
+  std::vector<size_t> position_;
+};
+
 /* Wrapper of boost::fibonacci_heap that conforms to the BucketHeap interface
  */
 template<typename EdgeWeightType>
 class FibonacciHeap {
 public:
   FibonacciHeap(const std::vector<int> &values, [[maybe_unused]] size_t capacity) {
+    reset(values, capacity);
+  }
+
+  void reset(const std::vector<int> &values, [[maybe_unused]] size_t capacity) {
+    heap_.clear();
+    handles_.clear();
     for (const int v : values) {
       auto handle = heap_.push({0, v});
       const auto[it, inserted] = handles_.insert({v, handle});
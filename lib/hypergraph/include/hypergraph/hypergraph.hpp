@@ -1,11 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <unordered_map>
 #include <vector>
 #include <functional>
 #include <numeric>
 
+#include <boost/functional/hash.hpp>
 #include <boost/range/adaptors.hpp>
 
 #include "heap.hpp"
@@ -27,13 +29,16 @@ class Hypergraph : public HypergraphBase<Hypergraph> {
 public:
   static constexpr bool weighted = false;
 
-  using Heap = BucketHeap;
+  using Heap = IndexedBucketHeap;
 
   using Base::Base;
 };
 
 /* A hypergraph with weighted edges. The time complexities of all operations are the same as with the unweighted
  * hypergraph.
+ *
+ * The weights are kept in an array indexed by edge ID, next to the edges, so looking one up does not hash. Edge IDs are
+ * handed out in order and only reused after compact_ids, so the array has one slot per edge ID handed out so far.
  */
 template<typename EdgeWeightType>
 class WeightedHypergraph : public HypergraphBase<WeightedHypergraph<EdgeWeightType>> {
@@ -43,15 +48,16 @@ class WeightedHypergraph : public HypergraphBase<WeightedHypergraph<EdgeWeightTy
 public:
   static constexpr bool weighted = true;
 
-  using Heap = FibonacciHeap<EdgeWeightType>;
+  using Heap = QuaternaryHeap<EdgeWeightType>;
   using EdgeWeight = EdgeWeightType;
 
   WeightedHypergraph() = default;
 
   template<typename OtherEdgeWeight>
   explicit WeightedHypergraph(const WeightedHypergraph<OtherEdgeWeight> &other): Base(other.hypergraph_) {
+    edge_weights_.resize(static_cast<size_t>(this->next_edge_id_));
     for (const auto &[edge_id, incident_on] : other.edges()) {
-      edges_to_weights_.insert({edge_id, other.edge_weight(edge_id)});
+      edge_weights_[edge_id] = other.edge_weight(edge_id);
     }
   }
 
@@ -63,10 +69,16 @@ public:
                      std::unordered_map<int, std::vector<int>> &&edges,
                      const WeightedHypergraph &old) :
       Base(std::move(vertices), std::move(edges), static_cast<const Base &>(old)),
-      edges_to_weights_(old.edges_to_weights_) {}
+      edge_weights_(old.edge_weights_) {}
 
+  // The weights of removed edges are ignored
   bool operator==(const WeightedHypergraph &other) const {
-    return Base::operator==(other) && edges_to_weights_ == other.edges_to_weights_;
+    if (!Base::operator==(other)) {
+      return false;
+    }
+    return std::all_of(std::begin(this->edges()), std::end(this->edges()), [this, &other](const auto &edge) {
+      return edge_weight(edge.first) == other.edge_weight(edge.first);
+    });
   }
 
   using Edge = std::vector<int>;
@@ -93,11 +105,9 @@ public:
   WeightedHypergraph(const std::vector<int> &vertices,
                      const std::vector<std::pair<std::vector<int>, EdgeWeightType>> edges) :
       Base(vertices, edges_weights_removed(edges)) {
-    for (size_t i = 0; i < edges.size(); ++i) {
-      const auto[it, inserted] = edges_to_weights_.insert({i, edges.at(i).second});
-#ifndef NDEBUG
-      assert(inserted);
-#endif
+    edge_weights_.reserve(edges.size());
+    for (const auto &edge : edges) {
+      edge_weights_.push_back(edge.second);
     }
   }
 
@@ -107,48 +117,50 @@ public:
   [[nodiscard]]
   WeightedHypergraph contract(int edge_id) const {
     HypergraphBase contracted = Base::template contract<EdgeMayContainLoops, TrackContractedVertices>(edge_id);
-    // TODO edges to weights should still be valid
-    return WeightedHypergraph(contracted, edges_to_weights_);
+    return WeightedHypergraph(contracted, edge_weights_);
   }
 
   EdgeWeightType edge_weight(int edge_id) const {
-    return edges_to_weights_.at(edge_id);
+    assert(this->edges_.count(edge_id) > 0);
+    return edge_weights_[edge_id];
+  }
+
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return Base::memory_usage() + heap_bytes(edge_weights_);
   }
 
   void resample_edge_weights(std::function<EdgeWeightType()> f) {
-    for (auto &[k, v] : edges_to_weights_) {
-      v = f();
+    for (const auto &[edge_id, incident_on] : this->edges()) {
+      edge_weights_[edge_id] = f();
     }
   }
 
   template<typename InputIt>
   int add_hyperedge(InputIt begin, InputIt end, EdgeWeightType weight) {
     auto id = Base::add_hyperedge(begin, end);
-    const auto[it, inserted] = edges_to_weights_.insert({id, weight});
-#ifndef NDEBUG
-    assert(inserted);
-#endif
+    edge_weights_.resize(static_cast<size_t>(this->next_edge_id_));
+    edge_weights_[id] = weight;
     return id;
   }
 
   void remove_hyperedge(int edge_id) {
-    // Edge weights from edges that were subsets of the removed edge are not removed
+    // The weight stays in its slot, since edge IDs are not reused
     Base::remove_hyperedge(edge_id);
-    edges_to_weights_.erase(edge_id);
   }
 
   template<bool EdgeMayContainLoops, bool TrackContractedVertices, typename InputIt>
   WeightedHypergraph contract(InputIt begin, InputIt end) const {
-    WeightedHypergraph copy(*this);
-    auto new_e = copy.add_hyperedge(begin, end, {}); // Doesn't matter what weight you add
-    return copy.template contract<true, TrackContractedVertices>(new_e);
+    const std::pair<InputIt, InputIt> sets[] = {{begin, end}};
+    return Base::template contract_sets<TrackContractedVertices>(std::begin(sets), std::end(sets));
   }
 
 private:
-  WeightedHypergraph(const Base &hypergraph, const std::unordered_map<int, EdgeWeightType> edge_weights) :
-      Base(hypergraph), edges_to_weights_(edge_weights) {}
+  WeightedHypergraph(const Base &hypergraph, const std::vector<EdgeWeightType> &edge_weights) :
+      Base(hypergraph), edge_weights_(edge_weights) {}
 
-  std::unordered_map<int, EdgeWeightType> edges_to_weights_;
+  // Indexed by edge ID
+  std::vector<EdgeWeightType> edge_weights_;
 };
 
 template<typename HypergraphType>
@@ -172,7 +184,7 @@ template<typename HypergraphType>
 inline typename HypergraphType::EdgeWeight total_edge_weight(const HypergraphType &hypergraph) {
   // TODO could probably optimize for weighted hypergraphs by caching the weight, but then we would have to be a lot
   //      more careful about keeping edge_to_weights_ completely accurate
-  if constexpr (std::is_same_v<HypergraphType, Hypergraph>) {
+  if constexpr (is_unweighted<HypergraphType>) {
     return hypergraph.edges().size();
   } else {
     return std::accumulate(hypergraph.edges().begin(),
@@ -196,6 +208,47 @@ HypergraphType merge_vertices(const HypergraphType &hypergraph, const int s, con
   return hypergraph.template contract<EdgesContainLoops, TrackContractedVertices>(std::begin(vs), std::end(vs));
 }
 
+/* A weighted hypergraph on the same vertices in which the hyperedges with the same vertices are merged into one
+ * hyperedge, whose weight is their total weight (their number, for an unweighted hypergraph). Repeated vertices in a
+ * hyperedge are dropped. Every cut has the same value in both hypergraphs, but the algorithms store, scan and sample
+ * each set of vertices once. Hyperedges are numbered in order of the smallest ID among the hyperedges merged into them,
+ * and vertices contracted into a vertex are not carried over.
+ *
+ * Time complexity: O(p log r) expected, where p is the size of the hypergraph and r is its rank
+ */
+template<typename HypergraphType>
+WeightedHypergraph<typename HypergraphType::EdgeWeight> coalesce_parallel_edges(const HypergraphType &hypergraph) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+
+  std::vector<int> edge_ids;
+  edge_ids.reserve(hypergraph.num_edges());
+  for (const auto &[e, edge] : hypergraph.edges()) {
+    edge_ids.push_back(e);
+  }
+  std::sort(std::begin(edge_ids), std::end(edge_ids));
+
+  // The index of the merged edge of each set of vertices
+  std::unordered_map<std::vector<int>, size_t, boost::hash<std::vector<int>>> index;
+  index.reserve(edge_ids.size());
+  std::vector<std::pair<std::vector<int>, EdgeWeight>> edges;
+  for (const int e : edge_ids) {
+    const auto &edge = hypergraph.edges().at(e);
+    std::vector<int> key(std::begin(edge), std::end(edge));
+    std::sort(std::begin(key), std::end(key));
+    key.erase(std::unique(std::begin(key), std::end(key)), std::end(key));
+    const auto [it, inserted] = index.insert({key, edges.size()});
+    if (inserted) {
+      edges.emplace_back(std::move(key), edge_weight(hypergraph, e));
+    } else {
+      edges[it->second].second += edge_weight(hypergraph, e);
+    }
+  }
+
+  std::vector<int> vertices(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
+  std::sort(std::begin(vertices), std::end(vertices));
+  return WeightedHypergraph<EdgeWeight>(vertices, edges);
+}
+
 std::istream &operator>>(std::istream &is, Hypergraph &hypergraph);
 
 std::ostream &operator<<(std::ostream &os, const Hypergraph &hypergraph);
@@ -232,67 +285,233 @@ std::istream &operator>>(std::istream &is, WeightedHypergraph<EdgeWeightType> &h
 }
 
 /**
- * Renames the vertices in the graph so that they are contiguous
+ * Renames the vertices in the graph so that they are contiguous, in increasing order of their IDs. The cuts of the
+ * result are translated back to the vertices of `h` by `translate(cut, IdMap(h.vertices()))`.
  *
  * @param is
  * @return
  */
 inline Hypergraph normalize(const Hypergraph &h) {
-  std::vector<int> vertices(std::begin(h.vertices()), std::end(h.vertices()));
-  std::sort(std::begin(vertices), std::end(vertices));
+  const IdMap ids(h.vertices());
 
-  std::vector<int> new_vertices(vertices.size());
+  std::vector<int> new_vertices(ids.size());
   std::iota(std::begin(new_vertices), std::end(new_vertices), 0);
 
-  auto normalize_vertex = [&vertices](auto v) -> decltype(v) {
-    auto it = std::lower_bound(std::cbegin(vertices), std::cend(vertices), v);
-    assert(it != std::cend(vertices));
-    return std::distance(std::cbegin(vertices), it);
-  };
-
-  auto normalize_edge = [normalize_vertex](const auto &edge) -> std::vector<int> {
-    std::vector<int> new_edge{};
-    std::transform(std::begin(edge), std::end(edge), std::back_inserter(new_edge), normalize_vertex);
-    return new_edge;
-  };
-
-  // This takes a pair {edge_id, edge} since that is what is returned by edges() right now
-  auto normalize_edge2 = [normalize_edge](const auto &edge) {
-    const auto &vertices = edge.second;
-    return normalize_edge(vertices);
-  };
-
   std::vector<std::vector<int>> new_edges;
-  std::transform(std::begin(h.edges()), std::end(h.edges()), std::back_inserter(new_edges), normalize_edge2);
+  new_edges.reserve(h.num_edges());
+  for (const auto &[id, edge] : h.edges()) {
+    auto &new_edge = new_edges.emplace_back();
+    new_edge.reserve(edge.size());
+    std::transform(std::begin(edge), std::end(edge), std::back_inserter(new_edge), [&ids](const int v) {
+      return ids.dense(v);
+    });
+  }
 
   return Hypergraph{new_vertices, new_edges};
 }
 
-template<typename HypergraphType>
-HypergraphType kCoreDecomposition(const HypergraphType &h, size_t k) {
-  HypergraphType copy{h};
+/* The core numbers of all vertices of a hypergraph, found by peeling vertices in order of degree with a bucket queue.
+ *
+ * The k-core of a hypergraph is what is left after repeatedly removing a vertex with degree less than k, where removing
+ * a vertex removes it from its edges and removes the edges that are left with fewer than two vertices. The core number
+ * of a vertex is the largest k such that the vertex is in the k-core. Every k-core is extracted from the same
+ * decomposition, so finding the k-cores for all k takes one pass over the hypergraph.
+ *
+ * The hypergraph is copied once into arrays indexed by dense vertex and edge IDs, so peeling does not touch hash maps.
+ */
+class CoreDecomposition {
+public:
+  /* Time complexity: O(n log n + p), where p is the size of the hypergraph, if the vertex IDs are contiguous and
+   * O((n + p) log n) otherwise
+   */
+  template<typename HypergraphType>
+  explicit CoreDecomposition(const HypergraphType &hypergraph) :
+      vertices_(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices())) {
+    std::sort(std::begin(vertices_), std::end(vertices_));
+    const size_t n = vertices_.size();
+
+    // Edges as a CSR array of dense vertex IDs, in the order the hypergraph stores them
+    edge_offsets_.reserve(hypergraph.num_edges() + 1);
+    edge_offsets_.push_back(0);
+    pins_.reserve(hypergraph.size());
+    for (const auto &[id, edge] : hypergraph.edges()) {
+      for (const int v : edge) {
+        pins_.push_back(dense_id(v));
+      }
+      edge_offsets_.push_back(pins_.size());
+    }
+    const size_t m = edge_offsets_.size() - 1;
+
+    // The edges incident on each vertex, also as a CSR array
+    std::vector<size_t> incidence_offsets(n + 1, 0);
+    for (const int v : pins_) {
+      ++incidence_offsets[v + 1];
+    }
+    std::partial_sum(std::begin(incidence_offsets), std::end(incidence_offsets), std::begin(incidence_offsets));
+    std::vector<int> incidence(pins_.size());
+    {
+      std::vector<size_t> next(std::begin(incidence_offsets), std::end(incidence_offsets) - 1);
+      for (size_t e = 0; e < m; ++e) {
+        for (size_t i = edge_offsets_[e]; i < edge_offsets_[e + 1]; ++i) {
+          incidence[next[pins_[i]]++] = static_cast<int>(e);
+        }
+      }
+    }
+
+    // Sort vertices by degree into buckets (Batagelj and Zaversnik). position[v] is the index of v in order, and
+    // bucket[d] is the index of the first vertex with degree d in order.
+    std::vector<size_t> degree(n);
+    size_t max_degree = 0;
+    for (size_t v = 0; v < n; ++v) {
+      degree[v] = incidence_offsets[v + 1] - incidence_offsets[v];
+      max_degree = std::max(max_degree, degree[v]);
+    }
+    std::vector<size_t> bucket(max_degree + 2, 0);
+    for (size_t v = 0; v < n; ++v) {
+      ++bucket[degree[v] + 1];
+    }
+    std::partial_sum(std::begin(bucket), std::end(bucket), std::begin(bucket));
+    std::vector<int> order(n);
+    std::vector<size_t> position(n);
+    {
+      std::vector<size_t> next(std::begin(bucket), std::end(bucket) - 1);
+      for (size_t v = 0; v < n; ++v) {
+        position[v] = next[degree[v]]++;
+        order[position[v]] = static_cast<int>(v);
+      }
+    }
 
-  auto removeVertexWithDegreeLessThanK = [k, &copy]() -> bool {
-    const auto &vertices = copy.vertices();
+    // Peel vertices in order of degree. An edge stays alive until it has fewer than two vertices left, or until its
+    // only vertex is removed if it started out with one, and the degree of a vertex is its number of alive edges.
+    std::vector<size_t> remaining(m);
+    std::vector<bool> alive(m, true);
+    for (size_t e = 0; e < m; ++e) {
+      remaining[e] = edge_offsets_[e + 1] - edge_offsets_[e];
+    }
+    std::vector<bool> removed(n, false);
+    core_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      const int v = order[i];
+      core_[v] = degree[v];
+      max_core_ = std::max(max_core_, core_[v]);
+      removed[v] = true;
+      for (size_t j = incidence_offsets[v]; j < incidence_offsets[v + 1]; ++j) {
+        const int e = incidence[j];
+        if (!alive[e]) {
+          continue;
+        }
+        if (--remaining[e] > 1) {
+          continue;
+        }
+        alive[e] = false;
+        if (remaining[e] == 0) {
+          continue;
+        }
+
+        // The vertex left in the edge loses it. Every edge dies once, so these scans take O(p) in total.
+        const auto begin = std::begin(pins_) + edge_offsets_[e];
+        const auto end = std::begin(pins_) + edge_offsets_[e + 1];
+        const int u = *std::find_if(begin, end, [&removed](const int w) { return !removed[w]; });
+        if (degree[u] > degree[v]) {
+          // Move u to the front of its bucket, then shrink the bucket past it
+          const size_t d = degree[u];
+          const int w = order[bucket[d]];
+          std::swap(order[position[u]], order[bucket[d]]);
+          std::swap(position[u], position[w]);
+          ++bucket[d];
+          --degree[u];
+        }
+      }
+    }
+  }
 
-    auto degreeLessThanK = [&copy, k](const int v) {
-      return copy.degree(v) < k;
-    };
+  // The core number of a vertex of the hypergraph
+  [[nodiscard]]
+  size_t core_number(const int v) const {
+    return core_[dense_id(v)];
+  }
 
-    auto it = std::find_if(std::begin(vertices), std::end(vertices), degreeLessThanK);
+  // The largest k with a non-empty k-core
+  [[nodiscard]]
+  size_t max_core() const { return max_core_; }
 
-    if (it == std::end(vertices)) {
-      return false;
+  /* The number of vertices in the k-core.
+   *
+   * Time complexity: O(n)
+   */
+  [[nodiscard]]
+  size_t num_vertices(const size_t k) const {
+    return static_cast<size_t>(std::count_if(std::begin(core_), std::end(core_), [k](const size_t c) {
+      return c >= k;
+    }));
+  }
+
+  /* The k-core, with vertices renamed as by `normalize`. Empty if k is larger than max_core().
+   *
+   * Time complexity: O(p)
+   */
+  [[nodiscard]]
+  Hypergraph core(const size_t k) const {
+    // The vertices of the core in order, renamed to 0, 1, ...
+    std::vector<int> new_id(vertices_.size(), -1);
+    int num_vertices = 0;
+    for (size_t v = 0; v < vertices_.size(); ++v) {
+      if (core_[v] >= k) {
+        new_id[v] = num_vertices++;
+      }
+    }
+    if (num_vertices == 0) {
+      return {};
+    }
+    std::vector<int> new_vertices(static_cast<size_t>(num_vertices));
+    std::iota(std::begin(new_vertices), std::end(new_vertices), 0);
+
+    std::vector<std::vector<int>> new_edges;
+    std::vector<int> new_edge;
+    for (size_t e = 0; e + 1 < edge_offsets_.size(); ++e) {
+      new_edge.clear();
+      for (size_t i = edge_offsets_[e]; i < edge_offsets_[e + 1]; ++i) {
+        if (new_id[pins_[i]] >= 0) {
+          new_edge.push_back(new_id[pins_[i]]);
+        }
+      }
+      const size_t size = edge_offsets_[e + 1] - edge_offsets_[e];
+      if (new_edge.size() >= std::min<size_t>(size, 2)) {
+        new_edges.push_back(new_edge);
+      }
     }
 
-    copy.remove_vertex(*it);
-    return true;
-  };
+    return Hypergraph{new_vertices, new_edges};
+  }
 
-  while (removeVertexWithDegreeLessThanK()) {
+private:
+  [[nodiscard]]
+  int dense_id(const int v) const {
+    // Vertex IDs are usually contiguous already, as after normalize or reading a file
+    if (vertices_.back() - vertices_.front() + 1 == static_cast<int>(vertices_.size())) {
+      return v - vertices_.front();
+    }
+    const auto it = std::lower_bound(std::cbegin(vertices_), std::cend(vertices_), v);
+    assert(it != std::cend(vertices_) && *it == v);
+    return static_cast<int>(std::distance(std::cbegin(vertices_), it));
   }
 
-  return normalize(copy);
+  // The vertices of the hypergraph in sorted order, vertex i of the arrays below is vertices_[i]
+  std::vector<int> vertices_;
+  std::vector<size_t> edge_offsets_;
+  std::vector<int> pins_;
+  std::vector<size_t> core_;
+  size_t max_core_ = 0;
+};
+
+/* The k-core of a hypergraph, with vertices renamed as by `normalize`. To find the k-cores for several k, build a
+ * CoreDecomposition once instead.
+ *
+ * Time complexity: O(n log n + p)
+ */
+template<typename HypergraphType>
+HypergraphType kCoreDecomposition(const HypergraphType &h, size_t k) {
+  return CoreDecomposition(h).core(k);
 }
 
 template<typename EdgeWeightType>
@@ -0,0 +1,195 @@
+// Counters and timers for the hot paths of the cut algorithms
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+namespace hypergraphlib {
+
+/* Counts and times what the cut algorithms spend their time on. Everything here compiles to nothing unless
+ * HYPERGRAPH_INSTRUMENT is defined (with the HYPERGRAPH_INSTRUMENT CMake option), so it can stay in the hot paths.
+ *
+ * Counts are kept per thread, so counting does not synchronize. The contraction algorithms collect the counts of the
+ * threads that worked on a call into ContractionStats::counters.
+ */
+namespace instrument {
+
+#ifdef HYPERGRAPH_INSTRUMENT
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class Counter : size_t {
+  // Pins and incidences looked at by the contraction engine
+  PinsTouched,
+  // Contraction engines that needed storage of their own, rather than reusing the storage of a spare engine
+  EngineAllocations,
+  EngineCopies,
+  HypergraphCopies,
+  // Branches of FPZ, counting the root of each run
+  Branches,
+  // The most branches that FPZ had waiting at once
+  MaxBranchDepth,
+  // Increments and pops of the heaps of vertex orderings
+  HeapOperations,
+  NumCounters,
+};
+
+enum class Phase : size_t {
+  // Sampling an edge to contract
+  Sampling,
+  Contraction,
+  // Removing the k-spanning edges of an FPZ branch
+  SpanningEdgeRemoval,
+  // Copying contraction engines for new branches
+  Copying,
+  NumPhases,
+};
+
+constexpr size_t kNumCounters = static_cast<size_t>(Counter::NumCounters);
+constexpr size_t kNumPhases = static_cast<size_t>(Phase::NumPhases);
+
+// Names for reports, in the order of the enums
+constexpr std::array<const char *, kNumCounters> kCounterNames = {
+    "pins_touched",
+    "engine_allocations",
+    "engine_copies",
+    "hypergraph_copies",
+    "branches",
+    "max_branch_depth",
+    "heap_operations",
+};
+
+constexpr std::array<const char *, kNumPhases> kPhaseNames = {
+    "sampling",
+    "contraction",
+    "spanning_edge_removal",
+    "copying",
+};
+
+struct Counters {
+  std::array<uint64_t, kNumCounters> counts{};
+  std::array<std::chrono::nanoseconds, kNumPhases> times{};
+
+  [[nodiscard]]
+  uint64_t operator[](const Counter counter) const { return counts[static_cast<size_t>(counter)]; }
+
+  [[nodiscard]]
+  std::chrono::nanoseconds operator[](const Phase phase) const { return times[static_cast<size_t>(phase)]; }
+
+  // Adds up the counts and times, except for MaxBranchDepth, which is the larger of the two
+  Counters &operator+=(const Counters &other) {
+    for (size_t i = 0; i < kNumCounters; ++i) {
+      if (i == static_cast<size_t>(Counter::MaxBranchDepth)) {
+        counts[i] = std::max(counts[i], other.counts[i]);
+      } else {
+        counts[i] += other.counts[i];
+      }
+    }
+    for (size_t i = 0; i < kNumPhases; ++i) {
+      times[i] += other.times[i];
+    }
+    return *this;
+  }
+};
+
+// One name=value pair per counter and phase, with times in microseconds
+inline std::ostream &operator<<(std::ostream &os, const Counters &counters) {
+  for (size_t i = 0; i < kNumCounters; ++i) {
+    os << kCounterNames[i] << "=" << counters.counts[i] << " ";
+  }
+  for (size_t i = 0; i < kNumPhases; ++i) {
+    os << kPhaseNames[i] << "_us=" << std::chrono::duration_cast<std::chrono::microseconds>(counters.times[i]).count()
+       << (i + 1 < kNumPhases ? " " : "");
+  }
+  return os;
+}
+
+/* The counts of the calling thread.
+ */
+inline Counters &local() {
+  thread_local Counters counters;
+  return counters;
+}
+
+inline void count(const Counter counter, const uint64_t n = 1) {
+  if constexpr (enabled) {
+    local().counts[static_cast<size_t>(counter)] += n;
+  }
+}
+
+// Raise a counter that holds a maximum, like MaxBranchDepth
+inline void count_max(const Counter counter, const uint64_t value) {
+  if constexpr (enabled) {
+    auto &current = local().counts[static_cast<size_t>(counter)];
+    current = std::max(current, value);
+  }
+}
+
+/* Adds the time from its construction to its destruction to a phase.
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const Phase phase) : phase_(phase) {
+    if constexpr (enabled) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  ~ScopedTimer() {
+    if constexpr (enabled) {
+      local().times[static_cast<size_t>(phase_)] += std::chrono::steady_clock::now() - start_;
+    }
+  }
+
+private:
+  Phase phase_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/* Separates the counts made on this thread while it is alive from the counts made before, so that a call can report
+ * only its own counts. The counts are added back to the thread's counts on destruction.
+ */
+class Section {
+public:
+  Section() {
+    if constexpr (enabled) {
+      outer_ = std::exchange(local(), Counters{});
+    }
+  }
+
+  Section(const Section &) = delete;
+  Section &operator=(const Section &) = delete;
+
+  ~Section() {
+    if constexpr (enabled) {
+      const Counters inner = std::exchange(local(), outer_);
+      local() += inner;
+    }
+  }
+
+  // The counts made on this thread since construction
+  [[nodiscard]]
+  Counters collect() const {
+    if constexpr (enabled) {
+      return local();
+    } else {
+      return {};
+    }
+  }
+
+private:
+  Counters outer_;
+};
+
+}
+
+}
@@ -0,0 +1,781 @@
+// Reading and writing hypergraph files
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "hypergraph.hpp"
+#include "compact.hpp"
+#include "cut.hpp"
+
+namespace hypergraphlib {
+
+namespace io {
+
+/* A read-only view of the contents of a file. The file is memory mapped if the platform supports it, and read into a
+ * buffer otherwise. Throws std::runtime_error if the file cannot be read.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename);
+
+  MappedFile(const MappedFile &other) = delete;
+
+  MappedFile &operator=(const MappedFile &other) = delete;
+
+  ~MappedFile();
+
+  [[nodiscard]]
+  std::string_view contents() const { return {data_, size_}; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::string buffer_;
+};
+
+/* The hyperedges of an hMETIS file in compressed sparse row form. The vertices of edge i are
+ * pins[edge_offsets[i]], ..., pins[edge_offsets[i + 1] - 1], and its weight is edge_weights[i] if the file is weighted.
+ */
+template<typename EdgeWeightType>
+struct HmetisData {
+  size_t num_vertices = 0;
+  std::vector<size_t> edge_offsets;
+  std::vector<int> pins;
+  // Empty for unweighted files
+  std::vector<EdgeWeightType> edge_weights;
+};
+
+// Below this many bytes per thread, starting a thread costs more than the parsing it saves
+constexpr size_t kMinBytesPerThread = 1 << 20;
+
+inline bool is_blank(const char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char *skip_blanks(const char *it, const char *end) {
+  while (it != end && is_blank(*it)) {
+    ++it;
+  }
+  return it;
+}
+
+// Parses the number that starts at `it`, which has to be followed by a blank or the end of the line. Returns the
+// position after the number, or nullptr if there is no such number.
+template<typename T>
+const char *parse_number(const char *it, const char *end, T &value) {
+  if constexpr (std::is_floating_point_v<T>) {
+    // from_chars does not accept a leading plus sign, but streams do
+    if (it != end && *it == '+') {
+      ++it;
+    }
+  }
+  const auto [ptr, ec] = std::from_chars(it, end, value);
+  if (ec != std::errc() || (ptr != end && !is_blank(*ptr))) {
+    return nullptr;
+  }
+  return ptr;
+}
+
+[[noreturn]] inline void parse_error(const size_t line, const std::string &message) {
+  throw std::runtime_error("hMETIS line " + std::to_string(line) + ": " + message);
+}
+
+/* Parses the complete lines in [begin, end) into `data`. Each line is one hyperedge, starting with its weight if the
+ * file is weighted. `first_line` is the line number of `begin`, for error messages. Offsets in data.edge_offsets are
+ * relative to the pins of this chunk, and there is no leading zero.
+ */
+template<typename EdgeWeightType>
+void parse_lines(const char *begin,
+                 const char *end,
+                 const bool weighted,
+                 const size_t first_line,
+                 HmetisData<EdgeWeightType> &data) {
+  size_t line = first_line;
+  for (const char *it = begin; it != end; ++line) {
+    const char *line_end = static_cast<const char *>(std::memchr(it, '\n', static_cast<size_t>(end - it)));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+
+    it = skip_blanks(it, line_end);
+    if (weighted) {
+      EdgeWeightType weight{};
+      it = parse_number(it, line_end, weight);
+      if (it == nullptr) {
+        parse_error(line, "expected an edge weight");
+      }
+      data.edge_weights.push_back(weight);
+      it = skip_blanks(it, line_end);
+    }
+    while (it != line_end) {
+      int v;
+      it = parse_number(it, line_end, v);
+      if (it == nullptr || v < 0 || static_cast<size_t>(v) >= data.num_vertices) {
+        parse_error(line, "expected a vertex ID below " + std::to_string(data.num_vertices));
+      }
+      data.pins.push_back(v);
+      it = skip_blanks(it, line_end);
+    }
+    data.edge_offsets.push_back(data.pins.size());
+
+    it = line_end == end ? end : line_end + 1;
+  }
+}
+
+/* Parses the contents of an hMETIS file. The first line holds the number of hyperedges and the number of vertices,
+ * and each of the following lines holds one hyperedge, starting with its weight if `weighted` is set. Lines after the
+ * last hyperedge are ignored. Vertices are numbered from 0.
+ *
+ * The hyperedge lines are split into chunks of whole lines, which are parsed on up to `num_threads` threads and then
+ * concatenated in order. Numbers are parsed with std::from_chars, so no streams or locales are involved.
+ *
+ * Throws std::runtime_error if the contents are malformed.
+ *
+ * Time complexity: O(s / t + p), where s is the size of the contents, t the number of threads and p the size of the
+ * hypergraph
+ */
+template<typename EdgeWeightType>
+HmetisData<EdgeWeightType> parse_hmetis(const std::string_view contents, const bool weighted, size_t num_threads) {
+  const char *const file_begin = contents.data();
+  const char *const file_end = file_begin + contents.size();
+
+  // Header
+  const char *header_end = static_cast<const char *>(std::memchr(file_begin, '\n', contents.size()));
+  if (header_end == nullptr) {
+    header_end = file_end;
+  }
+  size_t num_edges = 0;
+  size_t num_vertices = 0;
+  const char *it = parse_number(skip_blanks(file_begin, header_end), header_end, num_edges);
+  if (it != nullptr) {
+    it = parse_number(skip_blanks(it, header_end), header_end, num_vertices);
+  }
+  if (it == nullptr || num_vertices == 0) {
+    parse_error(1, "expected the number of hyperedges and the number of vertices");
+  }
+  const char *const body = header_end == file_end ? file_end : header_end + 1;
+  const size_t body_size = static_cast<size_t>(file_end - body);
+
+  num_threads = std::max<size_t>(1, std::min(num_threads, body_size / kMinBytesPerThread));
+
+  // Split the body into chunks that start at the beginning of a line
+  std::vector<const char *> chunk_begin(num_threads + 1, file_end);
+  chunk_begin[0] = body;
+  for (size_t t = 1; t < num_threads; ++t) {
+    const char *split = std::max(body + t * (body_size / num_threads), chunk_begin[t - 1]);
+    const char *newline = static_cast<const char *>(std::memchr(split, '\n', static_cast<size_t>(file_end - split)));
+    chunk_begin[t] = newline == nullptr ? file_end : newline + 1;
+  }
+
+  const auto run_on_chunks = [num_threads](const auto &f) {
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+      threads.emplace_back(f, t);
+    }
+    f(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+
+  // Count the lines of every chunk, so that the lines after the last hyperedge can be cut off before parsing
+  std::vector<size_t> num_lines(num_threads);
+  run_on_chunks([&](const size_t t) {
+    num_lines[t] = static_cast<size_t>(std::count(chunk_begin[t], chunk_begin[t + 1], '\n'));
+  });
+  if (body != file_end && file_end[-1] != '\n') {
+    // The last line has no newline
+    ++num_lines[num_threads - 1];
+  }
+
+  std::vector<size_t> first_line(num_threads + 1, 0);
+  first_line[0] = 0;
+  for (size_t t = 0; t < num_threads; ++t) {
+    first_line[t + 1] = first_line[t] + num_lines[t];
+  }
+  if (first_line[num_threads] < num_edges) {
+    parse_error(first_line[num_threads] + 1,
+                "expected " + std::to_string(num_edges) + " hyperedges but the file ends after "
+                    + std::to_string(first_line[num_threads]));
+  }
+  for (size_t t = 0; t < num_threads; ++t) {
+    if (first_line[t + 1] >= num_edges) {
+      // The last hyperedge is in this chunk, so find the end of its line and drop the chunks after it
+      const char *cut = chunk_begin[t];
+      for (size_t i = first_line[t]; i < num_edges; ++i) {
+        const char *newline = static_cast<const char *>(std::memchr(cut, '\n', static_cast<size_t>(file_end - cut)));
+        cut = newline == nullptr ? file_end : newline + 1;
+      }
+      std::fill(std::begin(chunk_begin) + t + 1, std::end(chunk_begin), cut);
+      break;
+    }
+  }
+
+  std::vector<HmetisData<EdgeWeightType>> chunks(num_threads);
+  run_on_chunks([&](const size_t t) {
+    auto &chunk = chunks[t];
+    chunk.num_vertices = num_vertices;
+    // Every vertex takes at least two characters
+    chunk.pins.reserve(static_cast<size_t>(chunk_begin[t + 1] - chunk_begin[t]) / 2);
+    parse_lines(chunk_begin[t], chunk_begin[t + 1], weighted, first_line[t] + 2, chunk);
+  });
+
+  if (num_threads == 1) {
+    auto &data = chunks[0];
+    data.edge_offsets.insert(std::begin(data.edge_offsets), 0);
+    return std::move(data);
+  }
+
+  HmetisData<EdgeWeightType> data;
+  data.num_vertices = num_vertices;
+  data.edge_offsets.reserve(num_edges + 1);
+  data.edge_offsets.push_back(0);
+  data.pins.reserve(std::accumulate(std::begin(chunks), std::end(chunks), size_t(0), [](size_t sum, const auto &c) {
+    return sum + c.pins.size();
+  }));
+  for (const auto &chunk : chunks) {
+    const size_t offset = data.pins.size();
+    data.pins.insert(std::end(data.pins), std::begin(chunk.pins), std::end(chunk.pins));
+    for (const size_t end : chunk.edge_offsets) {
+      data.edge_offsets.push_back(offset + end);
+    }
+    data.edge_weights.insert(std::end(data.edge_weights), std::begin(chunk.edge_weights), std::end(chunk.edge_weights));
+  }
+  return data;
+}
+
+/* Reads the hyperedges of an hMETIS stream a chunk at a time, in the format that parse_hmetis reads, so that only one
+ * chunk is in memory at a time.
+ *
+ * Throws std::runtime_error if the stream is malformed.
+ */
+template<typename EdgeWeightType>
+class HmetisReader {
+public:
+  /* Reads the header. Chunks hold the whole lines of about `chunk_size` bytes of the stream, or one line if it is
+   * longer than that.
+   */
+  HmetisReader(std::istream &is, const bool weighted, const size_t chunk_size = kMinBytesPerThread)
+      : is_(is), weighted_(weighted), chunk_size_(std::max<size_t>(chunk_size, 1)) {
+    std::string header;
+    std::getline(is_, header);
+    const char *const end = header.data() + header.size();
+    const char *it = parse_number(skip_blanks(header.data(), end), end, num_edges_);
+    if (it != nullptr) {
+      it = parse_number(skip_blanks(it, end), end, num_vertices_);
+    }
+    if (it == nullptr || num_vertices_ == 0) {
+      parse_error(1, "expected the number of hyperedges and the number of vertices");
+    }
+  }
+
+  [[nodiscard]]
+  size_t num_edges() const { return num_edges_; }
+
+  [[nodiscard]]
+  size_t num_vertices() const { return num_vertices_; }
+
+  /* Replace the contents of `data` with the next chunk of hyperedges, with a leading zero in data.edge_offsets. Returns
+   * false once all hyperedges have been read.
+   */
+  bool next(HmetisData<EdgeWeightType> &data) {
+    data.num_vertices = num_vertices_;
+    data.edge_offsets.assign(1, 0);
+    data.pins.clear();
+    data.edge_weights.clear();
+    if (num_read_ == num_edges_) {
+      return false;
+    }
+
+    // Read until the buffer holds a whole line, keeping the partial line at its end for the next chunk
+    size_t end = 0;
+    while (true) {
+      const size_t size = buffer_.size();
+      buffer_.resize(size + chunk_size_);
+      is_.read(buffer_.data() + size, static_cast<std::streamsize>(chunk_size_));
+      buffer_.resize(size + static_cast<size_t>(is_.gcount()));
+      // The partial line before this read has no newline
+      const auto newline = std::find(buffer_.rbegin(), buffer_.rend() - static_cast<std::ptrdiff_t>(size), '\n');
+      if (newline != buffer_.rend() - static_cast<std::ptrdiff_t>(size)) {
+        end = static_cast<size_t>(buffer_.rend() - newline);
+        break;
+      }
+      if (!is_) {
+        // The last line has no newline
+        end = buffer_.size();
+        break;
+      }
+    }
+    if (end == 0) {
+      parse_error(num_read_ + 2,
+                  "expected " + std::to_string(num_edges_) + " hyperedges but the file ends after "
+                      + std::to_string(num_read_));
+    }
+
+    // Lines after the last hyperedge are ignored
+    const char *const begin = buffer_.data();
+    size_t lines = 0;
+    for (const char *it = begin; it != begin + end; ++lines) {
+      if (lines == num_edges_ - num_read_) {
+        end = static_cast<size_t>(it - begin);
+        break;
+      }
+      const char *newline = static_cast<const char *>(std::memchr(it, '\n', static_cast<size_t>(begin + end - it)));
+      it = newline == nullptr ? begin + end : newline + 1;
+    }
+
+    parse_lines(begin, begin + end, weighted_, num_read_ + 2, data);
+    num_read_ += data.edge_offsets.size() - 1;
+    buffer_.erase(0, end);
+    return true;
+  }
+
+private:
+  std::istream &is_;
+  const bool weighted_;
+  const size_t chunk_size_;
+  size_t num_edges_ = 0;
+  size_t num_vertices_ = 0;
+  size_t num_read_ = 0;
+  // The part of the stream that has been read but not parsed
+  std::string buffer_;
+};
+
+
+template<typename HypergraphType>
+constexpr bool is_compact = std::is_base_of_v<CompactHypergraphBase<HypergraphType>, HypergraphType>;
+
+/* Builds a hypergraph that is not compact from the pins of its edges, laid out as in HmetisData. Edge weights are
+ * only read if HypergraphType is weighted.
+ */
+template<typename HypergraphType, typename Offset>
+HypergraphType hypergraph_from_pins(const size_t num_vertices,
+                                    const size_t num_edges,
+                                    const Offset *edge_offsets,
+                                    const int *pins,
+                                    const std::vector<typename HypergraphType::EdgeWeight> &edge_weights) {
+  std::vector<int> vertices(num_vertices);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+  const auto edge = [edge_offsets, pins](const size_t i) {
+    return std::vector<int>(pins + edge_offsets[i], pins + edge_offsets[i + 1]);
+  };
+  if constexpr (HypergraphType::weighted) {
+    std::vector<std::pair<std::vector<int>, typename HypergraphType::EdgeWeight>> edges;
+    edges.reserve(num_edges);
+    for (size_t i = 0; i < num_edges; ++i) {
+      edges.emplace_back(edge(i), edge_weights[i]);
+    }
+    return HypergraphType(vertices, edges);
+  } else {
+    std::vector<std::vector<int>> edges;
+    edges.reserve(num_edges);
+    for (size_t i = 0; i < num_edges; ++i) {
+      edges.push_back(edge(i));
+    }
+    return HypergraphType(vertices, edges);
+  }
+}
+
+constexpr char kBinaryMagic[8] = {'H', 'G', 'R', 'A', 'P', 'H', 'B', 'N'};
+constexpr uint32_t kBinaryVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+enum class WeightType : uint32_t {
+  kNone = 0,
+  kUnsigned = 1,
+  kDouble = 2
+};
+
+// Weights are stored in one of two types, depending on whether the weight type of the hypergraph is floating point
+template<typename EdgeWeightType>
+using StoredWeight = std::conditional_t<std::is_floating_point_v<EdgeWeightType>, double, uint64_t>;
+
+template<typename EdgeWeightType>
+constexpr WeightType stored_weight_type = std::is_floating_point_v<EdgeWeightType> ? WeightType::kDouble
+                                                                                   : WeightType::kUnsigned;
+
+/* The header of a binary hypergraph file. It is followed by these sections, each starting at a multiple of 8 bytes:
+ *
+ *   uint64_t edge_offsets[num_edges + 1]
+ *   int32_t pins[num_pins]
+ *   uint64_t incidence_offsets[num_vertices + 1]
+ *   int32_t incidence[num_pins]
+ *   edge_weights[num_edges], if weight_type is not kNone
+ *   and, if num_partitions is not zero, the planted cut:
+ *     its value
+ *     uint64_t partition_offsets[num_partitions + 1]
+ *     int32_t partition_vertices[num_vertices]
+ *
+ * The arrays are laid out as in CsrArrays, and partition_vertices is laid out like the pins. Weights and the cut value
+ * are uint64_t or double, as given by weight_type; the cut value of an unweighted hypergraph is a uint64_t. Numbers are
+ * stored in the byte order of the machine that wrote the file, so files are only portable between machines with the
+ * same byte order, which byte_order_mark checks.
+ */
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint32_t weight_type;
+  uint32_t reserved;
+  uint64_t num_vertices;
+  uint64_t num_edges;
+  uint64_t num_pins;
+  uint64_t num_partitions;
+};
+
+static_assert(sizeof(BinaryHeader) == 56);
+
+constexpr size_t align_to_word(const size_t bytes) {
+  return (bytes + 7) & ~size_t(7);
+}
+
+// The byte offsets of the sections of a binary hypergraph file
+struct BinaryLayout {
+  explicit BinaryLayout(const BinaryHeader &header) {
+    edge_offsets = align_to_word(sizeof(BinaryHeader));
+    pins = edge_offsets + (header.num_edges + 1) * sizeof(uint64_t);
+    incidence_offsets = pins + align_to_word(header.num_pins * sizeof(int32_t));
+    incidence = incidence_offsets + (header.num_vertices + 1) * sizeof(uint64_t);
+    edge_weights = incidence + align_to_word(header.num_pins * sizeof(int32_t));
+    cut_value = edge_weights + (header.weight_type == static_cast<uint32_t>(WeightType::kNone) ? 0 : header.num_edges * 8);
+    partition_offsets = cut_value + (header.num_partitions > 0 ? 8 : 0);
+    partition_vertices = partition_offsets + (header.num_partitions > 0 ? (header.num_partitions + 1) * 8 : 0);
+    size = partition_vertices + (header.num_partitions > 0 ? align_to_word(header.num_vertices * sizeof(int32_t)) : 0);
+  }
+
+  size_t edge_offsets;
+  size_t pins;
+  size_t incidence_offsets;
+  size_t incidence;
+  size_t edge_weights;
+  size_t cut_value;
+  size_t partition_offsets;
+  size_t partition_vertices;
+  size_t size;
+};
+
+template<typename T>
+void write_section(std::ostream &os, const std::vector<T> &values) {
+  const size_t bytes = values.size() * sizeof(T);
+  os.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(bytes));
+  const char padding[8] = {};
+  os.write(padding, static_cast<std::streamsize>(align_to_word(bytes) - bytes));
+}
+
+/* Writes a hypergraph given by its edges in the binary format, with edge i made up of the vertices
+ * pins[edge_offsets[i]], ..., pins[edge_offsets[i + 1] - 1]. The edge weights are only written if `weighted` is set.
+ * The vertices have to be 0, ..., n - 1.
+ *
+ * Throws std::invalid_argument if the planted cut does not partition the vertices.
+ *
+ * Time complexity: O(n + m + p), where p is the number of pins
+ */
+template<typename EdgeWeight>
+std::ostream &write_binary(std::ostream &os,
+                           const size_t n,
+                           const std::vector<uint64_t> &edge_offsets,
+                           const std::vector<int32_t> &pins,
+                           const std::vector<StoredWeight<EdgeWeight>> &edge_weights,
+                           const bool weighted,
+                           const HypergraphCut<EdgeWeight> *planted_cut) {
+  // Lay out the incidence lists with a counting sort over the pins, in the same order as compact hypergraphs do
+  std::vector<uint64_t> incidence_offsets(n + 1, 0);
+  for (const int v : pins) {
+    ++incidence_offsets[v + 1];
+  }
+  std::partial_sum(std::begin(incidence_offsets), std::end(incidence_offsets), std::begin(incidence_offsets));
+  std::vector<uint64_t> next(std::begin(incidence_offsets), std::end(incidence_offsets) - 1);
+  std::vector<int32_t> incidence(pins.size());
+  for (size_t e = 0; e + 1 < edge_offsets.size(); ++e) {
+    for (size_t i = edge_offsets[e]; i < edge_offsets[e + 1]; ++i) {
+      incidence[next[pins[i]]++] = static_cast<int32_t>(e);
+    }
+  }
+
+  BinaryHeader header{};
+  std::copy(std::begin(kBinaryMagic), std::end(kBinaryMagic), header.magic);
+  header.version = kBinaryVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.weight_type = static_cast<uint32_t>(weighted ? stored_weight_type<EdgeWeight> : WeightType::kNone);
+  header.num_vertices = n;
+  header.num_edges = edge_offsets.size() - 1;
+  header.num_pins = pins.size();
+
+  std::vector<StoredWeight<EdgeWeight>> cut_value;
+  std::vector<uint64_t> partition_offsets = {0};
+  std::vector<int32_t> partition_vertices;
+  if (planted_cut != nullptr) {
+    const auto &cut = *planted_cut;
+    cut_value.push_back(static_cast<StoredWeight<EdgeWeight>>(cut.value));
+    for (const auto &partition : cut.partitions) {
+      partition_vertices.insert(std::end(partition_vertices), std::begin(partition), std::end(partition));
+      partition_offsets.push_back(partition_vertices.size());
+    }
+    if (cut.partitions.empty() || partition_vertices.size() != n) {
+      throw std::invalid_argument("the planted cut does not partition the vertices");
+    }
+    header.num_partitions = cut.partitions.size();
+  }
+
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  write_section(os, edge_offsets);
+  write_section(os, pins);
+  write_section(os, incidence_offsets);
+  write_section(os, incidence);
+  write_section(os, edge_weights);
+  if (planted_cut != nullptr) {
+    write_section(os, cut_value);
+    write_section(os, partition_offsets);
+    write_section(os, partition_vertices);
+  }
+  return os;
+}
+
+}
+
+/* Reads a hypergraph from an hMETIS file, in the format that operator>> reads, by memory mapping it and parsing it on
+ * up to `num_threads` threads. Whether lines start with an edge weight is decided by whether HypergraphType is
+ * weighted. Compact hypergraphs are built directly from the parsed pin array.
+ *
+ * Throws std::runtime_error if the file cannot be read or is malformed.
+ */
+template<typename HypergraphType>
+HypergraphType read_hmetis_file(const std::string &filename,
+                                const size_t num_threads = std::max(1u, std::thread::hardware_concurrency())) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+  constexpr bool weighted = HypergraphType::weighted;
+
+  auto data = [&] {
+    const io::MappedFile file(filename);
+    return io::parse_hmetis<EdgeWeight>(file.contents(), weighted, num_threads);
+  }();
+
+  if constexpr (io::is_compact<HypergraphType>) {
+    if constexpr (weighted) {
+      return HypergraphType(data.num_vertices,
+                            std::move(data.edge_offsets),
+                            std::move(data.pins),
+                            std::move(data.edge_weights));
+    } else {
+      return HypergraphType(data.num_vertices, std::move(data.edge_offsets), std::move(data.pins));
+    }
+  } else {
+    return io::hypergraph_from_pins<HypergraphType>(data.num_vertices,
+                                                    data.edge_offsets.size() - 1,
+                                                    data.edge_offsets.data(),
+                                                    data.pins.data(),
+                                                    data.edge_weights);
+  }
+}
+
+/* Whether the hMETIS file at `filename` is unweighted, as decided by is_unweighted_hmetis_file. Throws
+ * std::runtime_error if the file cannot be read.
+ */
+bool is_unweighted_hmetis_file(const std::string &filename);
+
+/* A hypergraph file in the binary format described by io::BinaryHeader. Opening the file only maps it and checks its
+ * header, and the arrays in the file are already the arrays of a compact hypergraph, so loading a compact hypergraph
+ * copies them without parsing, hashing or sorting anything. The contents of the arrays are trusted.
+ *
+ * Throws std::runtime_error if the file cannot be read or is not a binary hypergraph file of a supported version.
+ */
+class BinaryHypergraphFile {
+public:
+  explicit BinaryHypergraphFile(const std::string &filename);
+
+  // Whether the file at `filename` starts like a binary hypergraph file
+  static bool is_binary_file(const std::string &filename);
+
+  [[nodiscard]]
+  bool weighted() const { return header_.weight_type != static_cast<uint32_t>(io::WeightType::kNone); }
+
+  [[nodiscard]]
+  bool has_planted_cut() const { return header_.num_partitions > 0; }
+
+  [[nodiscard]]
+  size_t num_vertices() const { return header_.num_vertices; }
+
+  [[nodiscard]]
+  size_t num_edges() const { return header_.num_edges; }
+
+  // Views into the mapped file, valid for the lifetime of this object
+  [[nodiscard]]
+  CsrArrays arrays() const {
+    return {.num_vertices = header_.num_vertices,
+        .num_edges = header_.num_edges,
+        .edge_offsets = section<uint64_t>(layout_.edge_offsets),
+        .pins = section<int32_t>(layout_.pins),
+        .incidence_offsets = section<uint64_t>(layout_.incidence_offsets),
+        .incidence = section<int32_t>(layout_.incidence)};
+  }
+
+  /* The edge weights, converted to EdgeWeightType. All weights are 1 if the file is unweighted.
+   *
+   * Time complexity: O(m)
+   */
+  template<typename EdgeWeightType>
+  [[nodiscard]]
+  std::vector<EdgeWeightType> edge_weights() const {
+    std::vector<EdgeWeightType> weights(num_edges(), 1);
+    if (header_.weight_type == static_cast<uint32_t>(io::WeightType::kDouble)) {
+      const double *stored = section<double>(layout_.edge_weights);
+      std::transform(stored, stored + num_edges(), std::begin(weights), [](const double w) {
+        return static_cast<EdgeWeightType>(w);
+      });
+    } else if (header_.weight_type == static_cast<uint32_t>(io::WeightType::kUnsigned)) {
+      const uint64_t *stored = section<uint64_t>(layout_.edge_weights);
+      std::transform(stored, stored + num_edges(), std::begin(weights), [](const uint64_t w) {
+        return static_cast<EdgeWeightType>(w);
+      });
+    }
+    return weights;
+  }
+
+  /* The hypergraph in the file. A weighted hypergraph can be read into an unweighted type only by dropping its
+   * weights, so that throws std::runtime_error instead.
+   *
+   * Time complexity: O(n + m + p) for compact types, where p is the size of the hypergraph. Other types are built from
+   * the pins of each edge, like operator>> builds them.
+   */
+  template<typename HypergraphType>
+  [[nodiscard]]
+  HypergraphType hypergraph() const {
+    if (weighted() && !HypergraphType::weighted) {
+      throw std::runtime_error("cannot read a weighted hypergraph into an unweighted type");
+    }
+    if constexpr (io::is_compact<HypergraphType>) {
+      if constexpr (HypergraphType::weighted) {
+        return HypergraphType(arrays(), edge_weights<typename HypergraphType::EdgeWeight>());
+      } else {
+        return HypergraphType(arrays());
+      }
+    } else {
+      const auto csr = arrays();
+      std::vector<typename HypergraphType::EdgeWeight> weights;
+      if constexpr (HypergraphType::weighted) {
+        weights = edge_weights<typename HypergraphType::EdgeWeight>();
+      }
+      return io::hypergraph_from_pins<HypergraphType>(csr.num_vertices, csr.num_edges, csr.edge_offsets, csr.pins,
+                                                      weights);
+    }
+  }
+
+  // The planted cut stored with the hypergraph, if there is one
+  template<typename EdgeWeightType>
+  [[nodiscard]]
+  std::optional<HypergraphCut<EdgeWeightType>> planted_cut() const {
+    if (!has_planted_cut()) {
+      return std::nullopt;
+    }
+    EdgeWeightType value;
+    if (header_.weight_type == static_cast<uint32_t>(io::WeightType::kDouble)) {
+      value = static_cast<EdgeWeightType>(*section<double>(layout_.cut_value));
+    } else {
+      value = static_cast<EdgeWeightType>(*section<uint64_t>(layout_.cut_value));
+    }
+    HypergraphCut<EdgeWeightType> cut(value);
+    const uint64_t *offsets = section<uint64_t>(layout_.partition_offsets);
+    const int32_t *vertices = section<int32_t>(layout_.partition_vertices);
+    for (size_t i = 0; i < header_.num_partitions; ++i) {
+      cut.partitions.emplace_back(vertices + offsets[i], vertices + offsets[i + 1]);
+    }
+    return cut;
+  }
+
+private:
+  static io::BinaryHeader read_header(const io::MappedFile &file, const std::string &filename);
+
+  template<typename T>
+  const T *section(const size_t offset) const {
+    return reinterpret_cast<const T *>(file_.contents().data() + offset);
+  }
+
+  io::MappedFile file_;
+  io::BinaryHeader header_{};
+  io::BinaryLayout layout_;
+};
+
+template<typename HypergraphType>
+struct BinaryWriter {
+  const HypergraphType &hypergraph;
+  const HypergraphCut<typename HypergraphType::EdgeWeight> *planted_cut;
+};
+
+/* Writes a hypergraph, and optionally a planted cut, in the binary format with `os << as_binary(hypergraph)`. The
+ * vertex IDs have to be 0, ..., n - 1, as in hypergraphs read from hMETIS files. Edges are renumbered in the order
+ * the hypergraph iterates over them, as with the hMETIS writers.
+ */
+template<typename HypergraphType>
+BinaryWriter<HypergraphType> as_binary(const HypergraphType &hypergraph,
+                                       const HypergraphCut<typename HypergraphType::EdgeWeight> *planted_cut = nullptr) {
+  return {hypergraph, planted_cut};
+}
+
+/* Throws std::invalid_argument if the vertex IDs are not dense or if the planted cut does not partition the vertices.
+ *
+ * Time complexity: O(n + m + p), where p is the size of the hypergraph
+ */
+template<typename HypergraphType>
+std::ostream &operator<<(std::ostream &os, const BinaryWriter<HypergraphType> &writer) {
+  using EdgeWeight = typename HypergraphType::EdgeWeight;
+  const auto &hypergraph = writer.hypergraph;
+  const size_t n = hypergraph.num_vertices();
+
+  std::vector<uint64_t> edge_offsets = {0};
+  std::vector<int32_t> pins;
+  std::vector<io::StoredWeight<EdgeWeight>> edge_weights;
+  edge_offsets.reserve(hypergraph.num_edges() + 1);
+  for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+    for (const int v : vertices) {
+      if (v < 0 || static_cast<size_t>(v) >= n) {
+        throw std::invalid_argument("vertex ID " + std::to_string(v) + " is not below the number of vertices");
+      }
+      pins.push_back(v);
+    }
+    edge_offsets.push_back(pins.size());
+    if constexpr (HypergraphType::weighted) {
+      edge_weights.push_back(static_cast<io::StoredWeight<EdgeWeight>>(hypergraph.edge_weight(edge_id)));
+    }
+  }
+
+  return io::write_binary<EdgeWeight>(os,
+                                      n,
+                                      edge_offsets,
+                                      pins,
+                                      edge_weights,
+                                      HypergraphType::weighted,
+                                      writer.planted_cut);
+}
+
+/* Reads a hypergraph from a binary hypergraph file or from an hMETIS file, whichever `filename` is.
+ *
+ * Throws std::runtime_error if the file cannot be read or is malformed.
+ */
+template<typename HypergraphType>
+HypergraphType read_hypergraph_file(const std::string &filename) {
+  if (BinaryHypergraphFile::is_binary_file(filename)) {
+    return BinaryHypergraphFile(filename).hypergraph<HypergraphType>();
+  }
+  return read_hmetis_file<HypergraphType>(filename);
+}
+
+/* Whether the binary hypergraph file or hMETIS file at `filename` is unweighted. Throws std::runtime_error if the file
+ * cannot be read.
+ */
+bool is_unweighted_hypergraph_file(const std::string &filename);
+
+}
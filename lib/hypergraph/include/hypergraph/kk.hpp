@@ -11,6 +11,9 @@ struct kk : public ContractionAlgo<kk> {
 
   static constexpr bool pass_discovery_value = false;
 
+  // Threads are spread over runs
+  static constexpr bool parallel_branches = false;
+
   static constexpr char name[] = "KK";
 
   template<typename HypergraphType>
@@ -22,9 +25,13 @@ struct kk : public ContractionAlgo<kk> {
             size_t k,
             const std::mt19937_64 &random_generator,
             typename HypergraphType::EdgeWeight discovery_value,
-            std::optional<size_t> max_num_runs)
-        : util::BaseContext<HypergraphType>(hypergraph, k, random_generator, discovery_value, max_num_runs),
+            std::optional<size_t> max_num_runs,
+            size_t num_threads = 1)
+        : util::BaseContext<HypergraphType>(hypergraph, k, random_generator, discovery_value, max_num_runs, num_threads),
           rank(hypergraph.rank()) {}
+
+    Context(const Context &parent, const std::mt19937_64 &random_generator)
+        : util::BaseContext<HypergraphType>(parent, random_generator), rank(parent.rank) {}
   };
 
 /**
@@ -40,46 +47,30 @@ struct kk : public ContractionAlgo<kk> {
  */
   template<typename HypergraphType, bool ReturnPartitions, uint8_t Verbosity>
   static HypergraphCut<typename HypergraphType::EdgeWeight> contract(Context<HypergraphType> &ctx) {
-    HypergraphType h(ctx.hypergraph);
+    auto &engine = ctx.engine;
+    engine.reset();
 
     // This can be tweaked to make this algorithm approximate. We are interested in exact solutions however.
     double alpha = 1;
 
-    // TODO abstract sampling an edge with some weight function and use with fpz and cxy
-    while (h.num_vertices() > ctx.rank * alpha * (ctx.k - 1)) { // TODO what should this be when k > 2?
-      if (h.num_edges() == 0) {
-        break;
-      }
+    while (engine.num_vertices() > ctx.rank * alpha * (ctx.k - 1)) { // TODO what should this be when k > 2?
       // Select a hyperedge with probability proportional to its weight
-      std::vector<int> edge_ids;
-      std::vector<Hypergraph::EdgeWeight> edge_weights;
-      for (const auto &[edge_id, vertices] : h.edges()) {
-        edge_ids.push_back(edge_id);
-        edge_weights.push_back(edge_weight(h, edge_id));
+      const int sampled = engine.sample_edge(ctx.random_generator);
+      if (sampled == ContractionEngine<HypergraphType>::kNone) {
+        break;
       }
-      std::discrete_distribution<size_t> distribution(std::begin(edge_weights), std::end(edge_weights));
-      const auto sampled_edge_id = edge_ids.at(distribution(ctx.random_generator));
-
-      h.template contract_in_place<true, ReturnPartitions>(sampled_edge_id);
+      engine.contract(sampled);
       ++ctx.stats.num_contractions;
     }
 
-    const auto contracted_partitions = random_k_partition(h, ctx.k, ctx.random_generator);
-
-    const auto cut_value = cut_value_of_partition(h, contracted_partitions.cbegin(), contracted_partitions.cend());
-
-    if constexpr (ReturnPartitions) {
-      // Collect vertices within
-      std::vector<std::list<int>> partitions(ctx.k);
-      for (size_t i = 0; i < ctx.k; ++i) {
-        for (const auto v : contracted_partitions[i]) {
-          partitions[i].insert(partitions[i].end(), std::begin(h.vertices_within(v)), std::end(h.vertices_within(v)));
-        }
+    const auto contracted_partitions = random_k_partition(engine.vertices(), ctx.k, ctx.random_generator);
+    for (const auto &partition : contracted_partitions) {
+      for (const auto v : partition) {
+        engine.merge(partition.front(), v);
       }
-      return {std::begin(partitions), std::end(partitions), cut_value};
-    } else {
-      return HypergraphCut<typename HypergraphType::EdgeWeight>(cut_value);
     }
+
+    return ctx.template cut_of<ReturnPartitions>(engine, engine.cut_value());
   }
 
   template<typename HypergraphType>
@@ -89,13 +80,11 @@ struct kk : public ContractionAlgo<kk> {
     return std::pow(2, r) * std::pow(n, k) * std::log(n);
   }
 
-  /// Returns a random k-way partition of the contracted vertices of the hypergraph
-  template<typename HypergraphType>
-  static std::vector<std::list<int>> random_k_partition(const HypergraphType &hypergraph,
-                                                        size_t k,
-                                                        std::mt19937_64 &random_generator) {
+  /// Returns a random k-way partition of the given vertices
+  static std::vector<std::vector<int>> random_k_partition(std::vector<int> vertices,
+                                                          size_t k,
+                                                          std::mt19937_64 &random_generator) {
     // Shuffle the vertices and choose k-1 indices to split them on
-    std::vector<int> vertices(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
     std::shuffle(std::begin(vertices), std::end(vertices), random_generator);
 
     std::vector<int> indices(vertices.size() - 1);
@@ -107,52 +96,13 @@ struct kk : public ContractionAlgo<kk> {
 
     std::sample(indices.begin(), indices.end(), sampled.begin() + 1, k - 1, random_generator);
 
-    std::vector<std::list<int>> contracted_partitions;
+    std::vector<std::vector<int>> contracted_partitions;
     for (auto it = sampled.begin() + 1; it != sampled.end(); ++it) {
       contracted_partitions.emplace_back(vertices.begin() + *(it - 1), vertices.begin() + *it);
     }
 
     return contracted_partitions;
   }
-
-  template<typename HypergraphType, typename InputIt>
-  static typename HypergraphType::EdgeWeight cut_value_of_partition(const HypergraphType &hypergraph,
-                                                                    InputIt begin,
-                                                                    InputIt end) {
-    // TODO Compute cut value of partition
-    // TODO this was copied from cut_is_valid. Could be extracted somehow
-    // Given a range of vertices in the edge and a range of vertices in the partition, returns whether
-    // any of the vertices in the edge are not in the partition
-    constexpr auto edge_entirely_inside_partition =
-        [](const auto edge_begin, const auto edge_end, const auto partition_begin, const auto partition_end) {
-          return std::all_of(edge_begin, edge_end, [partition_begin, partition_end](const auto v) {
-            return std::find(partition_begin, partition_end, v) != partition_end;
-          });
-        };
-
-    typename HypergraphType::EdgeWeight cut_value = 0;
-    for (const auto &edge : hypergraph.edges()) {
-      // Destructured bindings cannot be captured in lambdas
-      const auto &edge_id = edge.first;
-      const auto &vertices = edge.second;
-      const bool none_of_edges_entirely_inside_partition =
-          std::none_of(begin,
-                       end,
-                       [edge_entirely_inside_partition, vertices](const auto &partition) {
-                         return edge_entirely_inside_partition(
-                             std::begin(vertices),
-                             std::end(vertices),
-                             std::begin(partition),
-                             std::end(partition)
-                         );
-                       });
-      if (none_of_edges_entirely_inside_partition) {
-        cut_value += edge_weight(hypergraph, edge_id);
-      }
-    }
-
-    return cut_value;
-  }
 };
 
 } // hypergraphlib
@@ -0,0 +1,154 @@
+// Estimates of the memory that data structures take, and tracking of the memory a computation takes at its peak
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace hypergraphlib {
+
+/* The bytes that a value owns on the heap, not counting the value itself. Vectors count their capacity, and the nodes
+ * of lists and hash tables count their contents and two pointers, which is what the common standard libraries use, so
+ * the result is an estimate.
+ *
+ * Time complexity: O(1) for vectors of numbers, and linear in the number of elements otherwise
+ */
+template<typename T>
+size_t heap_bytes(const T &) {
+  static_assert(std::is_trivially_copyable_v<T>, "heap_bytes does not know what this type owns");
+  return 0;
+}
+
+template<typename A, typename B>
+size_t heap_bytes(const std::pair<A, B> &pair);
+
+template<typename T, typename Allocator>
+size_t heap_bytes(const std::vector<T, Allocator> &vector);
+
+template<typename T, typename Allocator>
+size_t heap_bytes(const std::list<T, Allocator> &list);
+
+template<typename K, typename V, typename Hash, typename Equal, typename Allocator>
+size_t heap_bytes(const std::unordered_map<K, V, Hash, Equal, Allocator> &map);
+
+template<typename K, typename Hash, typename Equal, typename Allocator>
+size_t heap_bytes(const std::unordered_set<K, Hash, Equal, Allocator> &set);
+
+namespace detail {
+
+// The bytes owned by the elements of a container, which are nothing for numbers
+template<typename Container>
+size_t element_heap_bytes(const Container &container) {
+  size_t bytes = 0;
+  if constexpr (!std::is_trivially_copyable_v<typename Container::value_type>) {
+    for (const auto &element : container) {
+      bytes += heap_bytes(element);
+    }
+  }
+  return bytes;
+}
+
+// The bytes of the nodes and buckets of a hash table
+template<typename Table>
+size_t hash_table_bytes(const Table &table) {
+  return table.bucket_count() * sizeof(void *)
+      + table.size() * (sizeof(typename Table::value_type) + 2 * sizeof(void *));
+}
+
+}
+
+template<typename A, typename B>
+size_t heap_bytes(const std::pair<A, B> &pair) {
+  return heap_bytes(pair.first) + heap_bytes(pair.second);
+}
+
+template<typename T, typename Allocator>
+size_t heap_bytes(const std::vector<T, Allocator> &vector) {
+  return vector.capacity() * sizeof(T) + detail::element_heap_bytes(vector);
+}
+
+template<typename T, typename Allocator>
+size_t heap_bytes(const std::list<T, Allocator> &list) {
+  return list.size() * (sizeof(T) + 2 * sizeof(void *)) + detail::element_heap_bytes(list);
+}
+
+template<typename K, typename V, typename Hash, typename Equal, typename Allocator>
+size_t heap_bytes(const std::unordered_map<K, V, Hash, Equal, Allocator> &map) {
+  return detail::hash_table_bytes(map) + detail::element_heap_bytes(map);
+}
+
+template<typename K, typename Hash, typename Equal, typename Allocator>
+size_t heap_bytes(const std::unordered_set<K, Hash, Equal, Allocator> &set) {
+  return detail::hash_table_bytes(set) + detail::element_heap_bytes(set);
+}
+
+/* The bytes in use by a computation, as reported to it, and the most that were in use at once. Can be shared between
+ * threads.
+ */
+class MemoryTracker {
+public:
+  void allocate(const size_t bytes) {
+    const size_t current = current_.fetch_add(bytes) + bytes;
+    size_t peak = peak_.load();
+    while (current > peak && !peak_.compare_exchange_weak(peak, current)) {}
+  }
+
+  void release(const size_t bytes) {
+    current_.fetch_sub(bytes);
+  }
+
+  [[nodiscard]]
+  size_t current() const { return current_.load(); }
+
+  [[nodiscard]]
+  size_t peak() const { return peak_.load(); }
+
+  /* Bytes reported to a tracker by one owner, which can grow and shrink as the owner is measured again. Releases its
+   * bytes when destroyed.
+   */
+  class Allocation {
+  public:
+    explicit Allocation(std::shared_ptr<MemoryTracker> tracker, const size_t bytes = 0) : tracker_(std::move(tracker)) {
+      resize(bytes);
+    }
+
+    Allocation(const Allocation &) = delete;
+    Allocation &operator=(const Allocation &) = delete;
+
+    ~Allocation() {
+      resize(0);
+    }
+
+    void resize(const size_t bytes) {
+      if (bytes > bytes_) {
+        tracker_->allocate(bytes - bytes_);
+      } else {
+        tracker_->release(bytes_ - bytes);
+      }
+      bytes_ = bytes;
+    }
+
+    void grow(const size_t bytes) {
+      resize(bytes_ + bytes);
+    }
+
+    [[nodiscard]]
+    size_t bytes() const { return bytes_; }
+
+  private:
+    std::shared_ptr<MemoryTracker> tracker_;
+    size_t bytes_ = 0;
+  };
+
+private:
+  std::atomic<size_t> current_ = 0;
+  std::atomic<size_t> peak_ = 0;
+};
+
+}
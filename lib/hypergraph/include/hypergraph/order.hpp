@@ -1,41 +1,139 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <optional>
 #include <type_traits>
-#include <unordered_set>
 #include <vector>
 
-#include <boost/heap/fibonacci_heap.hpp>
-
+#include "compact.hpp"
 #include "heap.hpp"
 #include "hypergraph.hpp"
+#include "instrument.hpp"
 #include "cut.hpp"
 
 namespace hypergraphlib {
 
-// A context for vertex ordering calculations
+/* A context for vertex ordering calculations.
+ *
+ * Vertices and edges are looked up by index in flat arrays, and the heap orders vertex indices. Edge IDs are used as
+ * indices, which is cheap as they grow by one per contraction. Vertex IDs are used as indices too when they are
+ * non-negative and not much larger than the number of vertices. Otherwise a vertex is indexed by its position among
+ * the sorted vertex IDs, found by binary search, so hypergraphs with negative or sparse vertex IDs are ordered in O(n)
+ * space. Whether a vertex or edge has been used is recorded by stamping it with the number of the current ordering, so
+ * starting a new ordering does not need to clear anything. A context can be reused for any number of orderings, and
+ * only allocates when the hypergraph has grown.
+ */
 template<typename Heap>
 struct OrderingContext {
-  // Constructor
-  OrderingContext(const std::vector<int> &vertices, size_t capacity) : heap(vertices, capacity) {}
+  /* Prepare for an ordering of the hypergraph starting with vertex a.
+   *
+   * Time complexity: O(n + m), where n is the number of vertices and m the number of edges, or O(n log n + m) if the
+   * vertices are indexed by their position among the sorted IDs
+   */
+  template<typename HypergraphType>
+  void reset(const HypergraphType &hypergraph, const int a) {
+    if (++current_stamp == 0) {
+      std::fill(std::begin(vertex_stamp), std::end(vertex_stamp), 0);
+      std::fill(std::begin(edge_stamp), std::end(edge_stamp), 0);
+      current_stamp = 1;
+    }
+
+    int min_vertex = a;
+    int max_vertex = a;
+    for (const auto v : hypergraph.vertices()) {
+      min_vertex = std::min(min_vertex, v);
+      max_vertex = std::max(max_vertex, v);
+    }
+    const size_t num_vertices = hypergraph.num_vertices();
+    remapped = min_vertex < 0 || static_cast<size_t>(max_vertex) > 2 * num_vertices + 1024;
+    if (remapped) {
+      // Refilled in place, so the array is only reallocated when there are more vertices than before
+      sorted_vertices.assign(std::begin(hypergraph.vertices()), std::end(hypergraph.vertices()));
+      std::sort(std::begin(sorted_vertices), std::end(sorted_vertices));
+    }
+    const size_t num_indices = remapped ? num_vertices : static_cast<size_t>(max_vertex) + 1;
+    if (vertex_stamp.size() < num_indices) {
+      vertex_stamp.resize(num_indices, 0);
+    }
+
+    vertices_without_a.clear();
+    for (const auto v : hypergraph.vertices()) {
+      if (v != a) {
+        vertices_without_a.push_back(index(v));
+      }
+    }
+
+    for (const auto &[e, vertices] : hypergraph.edges()) {
+      if (edge_stamp.size() <= static_cast<size_t>(e)) {
+        edge_stamp.resize(e + 1, 0);
+        edge_to_num_vertices_outside_ordering.resize(e + 1);
+      }
+      edge_to_num_vertices_outside_ordering[e] = vertices.size();
+    }
+
+    // Multiply edges by 2 for Queyranne ordering
+    const size_t capacity = 2 * hypergraph.num_edges() + 1;
+    if (heap) {
+      heap->reset(vertices_without_a, capacity);
+    } else {
+      heap.emplace(vertices_without_a, capacity);
+    }
+
+    ordering.clear();
+    tightness.clear();
+  }
+
+  // The index of a vertex in the flat arrays and the heap
+  [[nodiscard]]
+  int index(const int v) const {
+    if (!remapped) {
+      return v;
+    }
+    return static_cast<int>(std::lower_bound(std::begin(sorted_vertices), std::end(sorted_vertices), v)
+                                - std::begin(sorted_vertices));
+  }
+
+  // The vertex at an index
+  [[nodiscard]]
+  int vertex(const int i) const { return remapped ? sorted_vertices[i] : i; }
+
+  [[nodiscard]]
+  bool is_used_vertex(const int v) const { return vertex_stamp[index(v)] == current_stamp; }
+
+  void use_vertex(const int v) { vertex_stamp[index(v)] = current_stamp; }
+
+  [[nodiscard]]
+  bool is_used_edge(const int e) const { return edge_stamp[e] == current_stamp; }
+
+  void use_edge(const int e) { edge_stamp[e] = current_stamp; }
 
   // Heap for tracking which vertices are most tightly connected to the
-  // ordering
-  Heap heap;
+  // ordering, by index
+  std::optional<Heap> heap;
+
+  // The number of vertices inside each edge that have not been ordered, by
+  // edge ID
+  std::vector<size_t> edge_to_num_vertices_outside_ordering;
 
-  std::unordered_map<
-      int, boost::heap::fibonacci_heap<std::pair<size_t, int>>::handle_type>
-      handles;
+  // Vertices and edges that have been marked as used by the ordering have the
+  // current stamp, by index
+  std::vector<uint32_t> vertex_stamp;
+  std::vector<uint32_t> edge_stamp;
+  uint32_t current_stamp = 0;
 
-  // A mapping of edges to the number of vertices inside the edges that have not
-  // been ordered
-  std::unordered_map<int, int> edge_to_num_vertices_outside_ordering;
+  // Whether vertices are indexed by their position in sorted_vertices instead
+  // of their IDs
+  bool remapped = false;
+  std::vector<int> sorted_vertices;
 
-  // Vertices that have been marked as used by the ordering
-  std::unordered_set<int> used_vertices;
+  // The ordering so far, and how tight each vertex was when it was added
+  std::vector<int> ordering;
+  std::vector<double> tightness;
 
-  // Edges that have been marked as used by the ordering
-  std::unordered_set<int> used_edges;
+  // Indices of the vertices other than the first one
+  std::vector<int> vertices_without_a;
 };
 
 /* The method for calculating a vertex ordering for maximum adjacency and tight,
@@ -59,7 +157,7 @@ void maximum_adjacency_ordering_tighten(
   // Check each edge e incident on v
   for (const int e : hypergraph.edges_incident_on(v)) {
     // If e has already been used, then skip it
-    if (ctx.used_edges.find(e) != std::end(ctx.used_edges)) {
+    if (ctx.is_used_edge(e)) {
       continue;
     }
     // For every vertex u in e that is not v and not already in the ordering,
@@ -67,15 +165,16 @@ void maximum_adjacency_ordering_tighten(
     // TODO I think vertices need to be removed from the edge's incidence list
     //      to maintain the runtime.
     for (const int u : hypergraph.edges().at(e)) {
-      if (ctx.used_vertices.find(u) == std::end(ctx.used_vertices)) {
-        if constexpr (std::is_same_v<HypergraphType, Hypergraph>) {
-          ctx.heap.increment(u);
+      if (!ctx.is_used_vertex(u)) {
+        if constexpr (is_unweighted<HypergraphType>) {
+          ctx.heap->increment(ctx.index(u));
         } else {
-          ctx.heap.increment(u, edge_weight(hypergraph, e));
+          ctx.heap->increment(ctx.index(u), edge_weight(hypergraph, e));
         }
+        instrument::count(instrument::Counter::HeapOperations);
       }
     }
-    ctx.used_edges.insert(e);
+    ctx.use_edge(e);
   }
 }
 
@@ -88,17 +187,17 @@ void tight_ordering_tighten(
   // For every edge e incident on v
   for (const int e : hypergraph.edges_incident_on(v)) {
     // Tighten this edge
-    ctx.edge_to_num_vertices_outside_ordering.at(e) -= 1ul;
     // If the edge only has one vertex u left that is outside the ordering,
     // increase the key of u
-    if (ctx.edge_to_num_vertices_outside_ordering.at(e) == 1) {
+    if (--ctx.edge_to_num_vertices_outside_ordering[e] == 1) {
       for (const int u : hypergraph.edges().at(e)) {
-        if (ctx.used_vertices.find(u) == std::end(ctx.used_vertices)) {
-          if constexpr (std::is_same_v<HypergraphType, Hypergraph>) {
-            ctx.heap.increment(u);
+        if (!ctx.is_used_vertex(u)) {
+          if constexpr (is_unweighted<HypergraphType>) {
+            ctx.heap->increment(ctx.index(u));
           } else {
-            ctx.heap.increment(u, edge_weight(hypergraph, e));
+            ctx.heap->increment(ctx.index(u), edge_weight(hypergraph, e));
           }
+          instrument::count(instrument::Counter::HeapOperations);
         }
       }
     }
@@ -120,51 +219,50 @@ using tightening_t =
 std::add_pointer_t<void(const HypergraphType &, OrderingContext<typename HypergraphType::Heap> &, const int)>;
 
 /* Given a method to update the "tightness" of different vertices, computes a
- * vertex ordering and returns the ordering as well as a list of how tight each
- * vertex was when it was added to the ordering.
+ * vertex ordering into ctx.ordering, along with how tight each vertex was when
+ * it was added to the ordering in ctx.tightness.
  *
  * Time complexity: O(p), where p is the size of the hypergraph, assuming that
  * TIGHTEN runs in time linear to the number of edges incident on the selected
  * vertex.
  */
 template<typename HypergraphType, tightening_t<HypergraphType> TIGHTEN>
-inline std::pair<std::vector<int>, std::vector<double>>
-ordering(const HypergraphType &hypergraph, const int a) {
-  std::vector<int> ordering = {a};
-  std::vector<double> tightness = {0};
-  std::vector<int> vertices_without_a;
-
-  for (const auto v : hypergraph.vertices()) {
-    if (v == a) {
-      continue;
-    }
-    vertices_without_a.emplace_back(v);
-  }
-
-  // Multiply edges by 2 for Queyranne ordering
-  OrderingContext<typename HypergraphType::Heap> ctx(vertices_without_a, 2 * hypergraph.num_edges() + 1);
-  for (const auto &[e, vertices] : hypergraph.edges()) {
-    ctx.edge_to_num_vertices_outside_ordering.insert({e, vertices.size()});
-  }
+inline void ordering(const HypergraphType &hypergraph,
+                     const int a,
+                     OrderingContext<typename HypergraphType::Heap> &ctx) {
+  ctx.reset(hypergraph, a);
 
   const auto tighten = [&hypergraph, &ctx](const int v) {
-    ctx.used_vertices.insert(v);
+    ctx.use_vertex(v);
     // It is the responsibility of TIGHTEN to update the context
     TIGHTEN(hypergraph, ctx, v);
   };
 
+  ctx.ordering.push_back(a);
+  ctx.tightness.push_back(0);
   tighten(a);
 
-  while (ordering.size() < hypergraph.num_vertices()) {
-    const auto[k, v] = ctx.heap.pop_key_val();
-    ordering.emplace_back(v);
+  while (ctx.ordering.size() < hypergraph.num_vertices()) {
+    const auto[k, i] = ctx.heap->pop_key_val();
+    instrument::count(instrument::Counter::HeapOperations);
+    const int v = ctx.vertex(i);
+    ctx.ordering.emplace_back(v);
     // We need k / 2 instead of just k because this is just used for Queyranne
     // for now
-    tightness.push_back(k / 2.0);
+    ctx.tightness.push_back(k / 2.0);
     tighten(v);
   }
+}
 
-  return {ordering, tightness};
+/* Computes a vertex ordering and returns the ordering as well as a list of how
+ * tight each vertex was when it was added to the ordering.
+ */
+template<typename HypergraphType, tightening_t<HypergraphType> TIGHTEN>
+inline std::pair<std::vector<int>, std::vector<double>>
+ordering(const HypergraphType &hypergraph, const int a) {
+  OrderingContext<typename HypergraphType::Heap> ctx;
+  ordering<HypergraphType, TIGHTEN>(hypergraph, a, ctx);
+  return {std::move(ctx.ordering), std::move(ctx.tightness)};
 }
 
 /* Returns a maximum adjacency ordering of vertices, starting with vertex a.
@@ -217,6 +315,93 @@ inline std::pair<std::vector<int>,
 template<typename HypergraphType>
 using ordering_t = std::add_pointer_t<std::vector<int>(const HypergraphType &, const int)>;
 
+/* The tightening method behind one of the orderings above, or nullptr for any
+ * other ordering. The method can be asked for on another hypergraph type
+ * TightenedType, which is how the phases of a min cut find the ordering to use
+ * on the compact copy of the hypergraph.
+ */
+template<typename HypergraphType, ordering_t<HypergraphType> Ordering, typename TightenedType = HypergraphType>
+constexpr tightening_t<TightenedType> tightening_of() {
+  if constexpr (Ordering == maximum_adjacency_ordering<HypergraphType>) {
+    return maximum_adjacency_ordering_tighten<TightenedType>;
+  } else if constexpr (Ordering == tight_ordering<HypergraphType>) {
+    return tight_ordering_tighten<TightenedType>;
+  } else if constexpr (Ordering == queyranne_ordering<HypergraphType>) {
+    return queyranne_ordering_tighten<TightenedType>;
+  } else {
+    return nullptr;
+  }
+}
+
+/* The hypergraph type that the phases of a vertex ordering min cut contract in
+ * place. The hash map hypergraphs are copied into their compact counterparts,
+ * which merge two vertices without copying the hypergraph or creating new IDs.
+ */
+template<typename HypergraphType>
+struct phase_hypergraph {
+  using type = HypergraphType;
+};
+
+template<>
+struct phase_hypergraph<Hypergraph> {
+  using type = CompactHypergraph;
+};
+
+template<typename EdgeWeightType>
+struct phase_hypergraph<WeightedHypergraph<EdgeWeightType>> {
+  using type = CompactWeightedHypergraph<EdgeWeightType>;
+};
+
+template<typename HypergraphType>
+using phase_hypergraph_t = typename phase_hypergraph<HypergraphType>::type;
+
+/* Runs the phases of a vertex ordering min cut on a compact hypergraph, merging
+ * the last two vertices of each ordering in place. The ordering buffers and the
+ * contraction scratch space are reused across phases. When ReturnPartitions is
+ * set, the merges are recorded in a ContractionLog and a phase only records its
+ * cut as the number of merges before it and its last vertex, so the partitions
+ * are built once, for the minimum cut.
+ *
+ * Time complexity: O(np), where n is the number of vertices and p is the size
+ * of the hypergraph
+ */
+template<typename HypergraphType, tightening_t<HypergraphType> TIGHTEN, bool ReturnPartitions>
+auto contract_phases_in_place(HypergraphType &hypergraph,
+                              const int a) -> typename HypergraphCutRet<HypergraphType, ReturnPartitions>::T {
+  OrderingContext<typename HypergraphType::Heap> ctx;
+  if constexpr (ReturnPartitions) {
+    ContractionLog log(hypergraph);
+    auto min_cut_of_phase = HypergraphCutRet<HypergraphType, false>::max();
+    size_t min_cut_merges = 0;
+    int min_cut_vertex = -1;
+    while (hypergraph.num_vertices() > 1) {
+      ordering<HypergraphType, TIGHTEN>(hypergraph, a, ctx);
+      const auto &order = ctx.ordering;
+      const int last = order.back();
+      if (const auto cut_of_phase = one_vertex_cut<false>(hypergraph, last); cut_of_phase < min_cut_of_phase) {
+        min_cut_of_phase = cut_of_phase;
+        min_cut_merges = log.size();
+        min_cut_vertex = last;
+      }
+      const int merged = hypergraph.template contract_in_place<false>(std::end(order) - 2, std::end(order));
+      log.merge(merged == last ? *(std::end(order) - 2) : last, merged);
+    }
+    if (min_cut_vertex == -1) {
+      return HypergraphCutRet<HypergraphType, true>::max();
+    }
+    return log.one_vertex_cut(min_cut_merges, min_cut_vertex, min_cut_of_phase);
+  } else {
+    auto min_cut_of_phase = HypergraphCutRet<HypergraphType, false>::max();
+    while (hypergraph.num_vertices() > 1) {
+      ordering<HypergraphType, TIGHTEN>(hypergraph, a, ctx);
+      const auto &order = ctx.ordering;
+      min_cut_of_phase = std::min(min_cut_of_phase, one_vertex_cut<false>(hypergraph, order.back()));
+      hypergraph.template contract_in_place<false>(std::end(order) - 2, std::end(order));
+    }
+    return min_cut_of_phase;
+  }
+}
+
 /* Given a hypergraph and a function that orders the vertices, find the min cut
  * by repeatedly finding and contracting pendant pairs.
  *
@@ -224,22 +409,47 @@ using ordering_t = std::add_pointer_t<std::vector<int>(const HypergraphType &, c
  * of the hypergraph
  *
  * Ordering should be one of `tight_ordering`, `queyranne_ordering`, or
- * `maximum_adjacency_ordering`.
+ * `maximum_adjacency_ordering`. For these, the phases run on a compact copy of
+ * the hypergraph (or on the hypergraph itself if it is already compact) that is
+ * contracted in place, so a phase does not copy the hypergraph or allocate.
+ * Other orderings copy the hypergraph once per phase.
  */
 template<typename HypergraphType, ordering_t<HypergraphType> Ordering, bool ReturnPartitions>
 auto vertex_ordering_minimum_cut_start_vertex(HypergraphType &hypergraph,
                                               const int a) -> typename HypergraphCutRet<HypergraphType,
                                                                                         ReturnPartitions>::T {
+  using PhaseHypergraph = phase_hypergraph_t<HypergraphType>;
   hypergraph.remove_singleton_and_empty_hyperedges();
-  auto min_cut_of_phase = HypergraphCutRet<HypergraphType, ReturnPartitions>::max();
-  while (hypergraph.num_vertices() > 1) {
-    auto ordering = Ordering(hypergraph, a);
-    const auto cut_of_phase = one_vertex_cut<ReturnPartitions>(hypergraph, ordering.back());
-    hypergraph = merge_vertices(hypergraph, *(std::end(ordering) - 2),
-                                *(std::end(ordering) - 1));
-    min_cut_of_phase = std::min(min_cut_of_phase, cut_of_phase);
+  constexpr auto tighten = tightening_of<HypergraphType, Ordering, PhaseHypergraph>();
+  if constexpr (tighten != nullptr) {
+    if constexpr (std::is_same_v<PhaseHypergraph, HypergraphType>) {
+      return contract_phases_in_place<PhaseHypergraph, tighten, ReturnPartitions>(hypergraph, a);
+    } else {
+      PhaseHypergraph compact(hypergraph);
+      auto min_cut = contract_phases_in_place<PhaseHypergraph, tighten, ReturnPartitions>(compact,
+                                                                                          compact.copied_vertex(a));
+      if constexpr (ReturnPartitions) {
+        return compact.original_cut(std::move(min_cut));
+      } else {
+        return min_cut;
+      }
+    }
+  } else {
+    auto min_cut_of_phase = HypergraphCutRet<HypergraphType, ReturnPartitions>::max();
+    while (hypergraph.num_vertices() > 1) {
+      const auto order = Ordering(hypergraph, a);
+      if constexpr (ReturnPartitions) {
+        if (one_vertex_cut<false>(hypergraph, order.back()) < min_cut_of_phase.value) {
+          min_cut_of_phase = one_vertex_cut<true>(hypergraph, order.back());
+        }
+      } else {
+        min_cut_of_phase = std::min(min_cut_of_phase, one_vertex_cut<false>(hypergraph, order.back()));
+      }
+      hypergraph = merge_vertices(hypergraph, *(std::end(order) - 2),
+                                  *(std::end(order) - 1));
+    }
+    return min_cut_of_phase;
   }
-  return min_cut_of_phase;
 }
 
 template<typename HypergraphType, ordering_t<HypergraphType> Ordering, bool ReturnPartitions>
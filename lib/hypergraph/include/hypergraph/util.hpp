@@ -1,13 +1,26 @@
 #ifndef HYPERGRAPH_UTIL
 #define HYPERGRAPH_UTIL
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
+#include "arena.hpp"
 #include "hypergraph.hpp"
 #include "cut.hpp"
 #include "certificate.hpp"
+#include "contraction.hpp"
+#include "instrument.hpp"
+#include "memory.hpp"
 
 namespace hypergraphlib {
 
@@ -17,48 +30,335 @@ struct ContractionStats {
   uint64_t num_contractions = 0;
   uint64_t time_elapsed_ms = 0;
   size_t num_runs = 0;
+  // The most memory the search had in use at once, as estimated by the memory_usage() of its data structures
+  size_t peak_memory_bytes = 0;
+  // Empty unless built with HYPERGRAPH_INSTRUMENT
+  instrument::Counters counters;
+};
+
+/* A cut that was better than every cut found before it, reported while a contraction algorithm is still running.
+ */
+template<typename EdgeWeight>
+struct Improvement {
+  EdgeWeight value;
+  // Since the start of the search
+  std::chrono::steady_clock::duration elapsed;
+  // The run that found the cut, counting from 1
+  size_t run;
+};
+
+/* The improvements of a search in the order they were found, so that the best value the search had found by any point
+ * in time can be read off after the search is done. Recording appends to a buffer reserved up front, so it does not
+ * allocate unless a search improves more than `capacity` times.
+ */
+template<typename EdgeWeight>
+class ImprovementTrace {
+public:
+  explicit ImprovementTrace(const size_t capacity = 64) {
+    improvements_.reserve(capacity);
+  }
+
+  void record(const Improvement<EdgeWeight> &improvement) {
+    improvements_.push_back(improvement);
+  }
+
+  // A callback for `on_improvement` that records into this trace, which has to outlive the search
+  std::function<void(const Improvement<EdgeWeight> &)> recorder() {
+    return [this](const Improvement<EdgeWeight> &improvement) { record(improvement); };
+  }
+
+  /* The best value found within `elapsed` of the start of the search, or empty if none was found by then.
+   *
+   * Time complexity: O(log i), where i is the number of improvements
+   */
+  template<typename Duration>
+  std::optional<EdgeWeight> best_within(const Duration elapsed) const {
+    // Improvements are reported in the order they were found, so their times never decrease
+    const auto it = std::upper_bound(std::begin(improvements_),
+                                     std::end(improvements_),
+                                     elapsed,
+                                     [](const Duration limit, const Improvement<EdgeWeight> &improvement) {
+                                       return limit < improvement.elapsed;
+                                     });
+    if (it == std::begin(improvements_)) {
+      return {};
+    }
+    return std::prev(it)->value;
+  }
+
+  [[nodiscard]]
+  const std::vector<Improvement<EdgeWeight>> &improvements() const { return improvements_; }
+
+private:
+  std::vector<Improvement<EdgeWeight>> improvements_;
+};
+
+/* How long an anytime search for a cut may run. The search stops at the first of: the deadline passing, `max_num_runs`
+ * runs having been done, a cut with `discovery_value` being found, or `cancelled` being set by another thread. The
+ * deadline and cancellation are checked between runs (and between the branches of a run for FPZ), so a search
+ * overshoots the deadline by at most one run.
+ *
+ * With no deadline and no cancellation flag, an unset `max_num_runs` means the default number of runs of the algorithm.
+ * Otherwise it means no limit on the number of runs.
+ */
+template<typename EdgeWeight>
+struct Budget {
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  std::optional<size_t> max_num_runs;
+  EdgeWeight discovery_value = 0;
+  const std::atomic<bool> *cancelled = nullptr;
+  // The best value found by other searches, such as the other workers of a distributed search. FPZ prunes the branches
+  // that have already reached it. Only lowered by the caller.
+  const std::atomic<EdgeWeight> *bound = nullptr;
+  // Called with each improvement, from one thread at a time
+  std::function<void(const Improvement<EdgeWeight> &)> on_improvement;
+  // Bytes the search should stay within. FPZ explores branches depth first instead of copying them once it gets close.
+  std::optional<size_t> memory_limit;
 };
 
 template<typename HypergraphType>
 struct BaseContext {
-  const HypergraphType hypergraph;
+  // Shared with the contexts of worker threads
+  const std::shared_ptr<const HypergraphType> hypergraph;
+  // Contracts `hypergraph` in place. Reset at the start of each run.
+  ContractionEngine<HypergraphType> engine;
   const size_t k;
   std::mt19937_64 random_generator;
   HypergraphCut<typename HypergraphType::EdgeWeight> min_so_far;
-  // So cutoff experiments can introspect the minimum value so far at various cutoff points. Only one thread should
-  // write to this
+  // So cutoff experiments can introspect the minimum value so far at various cutoff points. Worker threads only ever
+  // lower it, with `update_minimum`.
   std::atomic<typename HypergraphType::EdgeWeight> min_val_so_far;
   util::ContractionStats stats;
   const typename HypergraphType::EdgeWeight discovery_value;
   std::optional<size_t> max_num_runs;
+  // The number of threads to spread runs over. 0 means one per hardware thread.
+  size_t num_threads;
+  // Anytime searches stop starting runs (and FPZ stops starting branches) once this passes or `cancelled` is set
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  const std::atomic<bool> *cancelled = nullptr;
+  // The best value found by other searches, or null. See Budget::bound.
+  const std::atomic<typename HypergraphType::EdgeWeight> *bound = nullptr;
+  // Called whenever a run finds a better cut than all runs before it
+  std::function<void(const Improvement<typename HypergraphType::EdgeWeight> &)> on_improvement;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  // For the temporaries of a run. Reset at the start of each run, so runs stop allocating from the heap once warmed up.
+  Arena arena;
+  // The memory in use by the search, shared with the contexts of worker threads
+  const std::shared_ptr<MemoryTracker> memory;
+  // Once the search would go over this many bytes, FPZ explores branches depth first rather than copying the engine
+  std::optional<size_t> memory_limit;
+  // The bytes of the hypergraph and of the shared part of the engine. Only counted by the context of the caller.
+  MemoryTracker::Allocation shared_footprint;
+  // The bytes of this context, measured again after every run
+  MemoryTracker::Allocation footprint;
 
   BaseContext(const HypergraphType &hypergraph,
               size_t k,
               const std::mt19937_64 &random_generator,
               typename HypergraphType::EdgeWeight discovery_value,
-              std::optional<size_t> max_num_runs)
-      : hypergraph(std::move(hypergraph)), k(k), random_generator(random_generator),
+              std::optional<size_t> max_num_runs,
+              size_t num_threads = 1)
+      : hypergraph(std::make_shared<const HypergraphType>(hypergraph)), engine(*this->hypergraph), k(k),
+        random_generator(random_generator),
         min_so_far(HypergraphCut<typename HypergraphType::EdgeWeight>::max()), min_val_so_far(min_so_far.value),
         stats(), discovery_value(discovery_value),
-        max_num_runs(max_num_runs) {}
+        max_num_runs(max_num_runs), num_threads(num_threads), memory(std::make_shared<MemoryTracker>()),
+        shared_footprint(memory, this->hypergraph->memory_usage() + engine.shared_memory_usage()),
+        footprint(memory, memory_usage()) {}
+
+  // The context of a worker thread. It shares the hypergraph with `parent` but has its own random generator and
+  // results.
+  BaseContext(const BaseContext &parent, const std::mt19937_64 &random_generator)
+      : hypergraph(parent.hypergraph), engine(parent.engine), k(parent.k), random_generator(random_generator),
+        min_so_far(HypergraphCut<typename HypergraphType::EdgeWeight>::max()),
+        min_val_so_far(parent.min_val_so_far.load()), stats(), discovery_value(parent.discovery_value),
+        max_num_runs(parent.max_num_runs), num_threads(1), deadline(parent.deadline), cancelled(parent.cancelled),
+        bound(parent.bound), start(parent.start), memory(parent.memory), memory_limit(parent.memory_limit),
+        shared_footprint(memory), footprint(memory, memory_usage()) {
+    instrument::count(instrument::Counter::EngineCopies);
+    instrument::count(instrument::Counter::EngineAllocations);
+  }
+
+  /* An estimate of the bytes of this context, not counting the hypergraph and the other parts shared with the contexts
+   * of worker threads.
+   *
+   * Time complexity: O(b), where b is the number of blocks of the arena
+   */
+  [[nodiscard]]
+  size_t memory_usage() const {
+    return sizeof(BaseContext) - sizeof(engine) + engine.memory_usage() + arena.capacity();
+  }
+
+  // Whether the deadline has passed or the search has been cancelled
+  [[nodiscard]]
+  bool stop_requested() const {
+    return (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+        || (deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value());
+  }
+
+  // Whether a value is no better than the best value found by other searches
+  [[nodiscard]]
+  bool beaten_by_bound(const typename HypergraphType::EdgeWeight value) const {
+    return bound != nullptr && value >= bound->load(std::memory_order_relaxed);
+  }
+
+  void report_improvement(const typename HypergraphType::EdgeWeight value, const size_t run) const {
+    if (on_improvement) {
+      on_improvement({value, std::chrono::steady_clock::now() - start, run});
+    }
+  }
+
+  /* The cut given by the vertices of `contracted`, which has the given value. Cuts that are no better than `min_so_far`
+   * are thrown away by the caller, so their partitions are not worked out.
+   */
+  template<bool ReturnPartitions>
+  HypergraphCut<typename HypergraphType::EdgeWeight> cut_of(const ContractionEngine<HypergraphType> &contracted,
+                                                            const typename HypergraphType::EdgeWeight value) {
+    if constexpr (ReturnPartitions) {
+      if (value < min_so_far.value) {
+        const auto partitions = contracted.partitions(&arena);
+        return {std::begin(partitions), std::end(partitions), value};
+      }
+    }
+    return HypergraphCut<typename HypergraphType::EdgeWeight>(value);
+  }
 
   // TODO Maybe max_num_runs should be an optional
 };
 
+/* Calls f with std::integral_constant<size_t, k> for the small k that the contraction kernels are specialized for,
+ * and with std::integral_constant<size_t, 0> for any other k. A kernel that takes the constant as K uses it in place of
+ * the k of its context, and the runtime k when K is 0.
+ */
+template<typename F>
+decltype(auto) with_fixed_k(const size_t k, F &&f) {
+  switch (k) {
+    case 2: return f(std::integral_constant<size_t, 2>{});
+    case 3: return f(std::integral_constant<size_t, 3>{});
+    case 4: return f(std::integral_constant<size_t, 4>{});
+    default: return f(std::integral_constant<size_t, 0>{});
+  }
+}
+
+/* Lower `minimum` to `value` if it is larger. Safe to call from several threads at once.
+ */
+template<typename T>
+void update_minimum(std::atomic<T> &minimum, const T value) {
+  T current = minimum.load();
+  while (value < current && !minimum.compare_exchange_weak(current, value)) {}
+}
+
+template<typename HypergraphType, typename ContractImpl, bool ReturnPartitions, uint8_t Verbosity>
+void repeat_contraction_in_parallel(typename ContractImpl::template Context<HypergraphType> &ctx, size_t num_threads) {
+  using Context = typename ContractImpl::template Context<HypergraphType>;
+
+  // Runs are claimed before they start so that exactly `max_num_runs` are done in total
+  std::atomic<size_t> runs_claimed = ctx.stats.num_runs;
+  std::mutex mutex;
+  size_t i = 0;
+
+  // Every worker gets its own random generator, seeded from the one in the context so runs are reproducible
+  std::vector<std::mt19937_64> random_generators;
+  for (size_t t = 0; t < num_threads; ++t) {
+    std::seed_seq seed{ctx.random_generator(), ctx.random_generator()};
+    random_generators.emplace_back(seed);
+  }
+
+  const auto work = [&ctx, &runs_claimed, &mutex, &i](const std::mt19937_64 &random_generator) {
+    Context worker(ctx, random_generator);
+    while (ctx.min_val_so_far.load() > ctx.discovery_value && !ctx.stop_requested()) {
+      const size_t run = runs_claimed.fetch_add(1);
+      if (ctx.max_num_runs.has_value() && run >= ctx.max_num_runs.value()) {
+        break;
+      }
+      ++worker.stats.num_runs;
+      worker.arena.reset();
+
+      auto start_run = std::chrono::high_resolution_clock::now();
+      auto cut = ContractImpl::template contract<HypergraphType, ReturnPartitions, Verbosity>(worker);
+      auto stop_run = std::chrono::high_resolution_clock::now();
+      worker.footprint.resize(worker.memory_usage());
+
+      worker.min_so_far = std::min(worker.min_so_far, cut);
+      if (cut.value < ctx.min_val_so_far.load()) {
+        // Improvements are lowered and reported under the lock, so they are reported in decreasing order
+        std::lock_guard lock(mutex);
+        if (cut.value < ctx.min_val_so_far.load()) {
+          ctx.min_val_so_far.store(cut.value);
+          ctx.report_improvement(cut.value, run + 1);
+        }
+      }
+
+      if constexpr (Verbosity > 0) {
+        std::lock_guard lock(mutex);
+        std::cout << "[" << ++i << "] took "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(stop_run - start_run).count()
+                  << " milliseconds, got " << cut.value << ", min is " << ctx.min_val_so_far.load()
+                  << ", discovery value is " << ctx.discovery_value << "\n";
+      }
+    }
+
+    std::lock_guard lock(mutex);
+    ctx.min_so_far = std::min(ctx.min_so_far, worker.min_so_far);
+    ctx.stats.num_runs += worker.stats.num_runs;
+    ctx.stats.num_contractions += worker.stats.num_contractions;
+    // The worker thread only counted this run
+    ctx.stats.counters += instrument::local();
+  };
+
+  std::vector<std::thread> workers;
+  for (const auto &random_generator : random_generators) {
+    workers.emplace_back(work, random_generator);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
 template<typename HypergraphType, typename ContractImpl, bool ReturnPartitions, uint8_t Verbosity>
 auto repeat_contraction(typename ContractImpl::template Context<HypergraphType> &ctx) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  const instrument::Section section;
+  const auto record_time = [&ctx, start, &section] {
+    const auto stop = std::chrono::high_resolution_clock::now();
+    ctx.stats.time_elapsed_ms += std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    ctx.stats.counters += section.collect();
+    ctx.stats.peak_memory_bytes = ctx.memory->peak();
+  };
+
+  if (ctx.num_threads == 0) {
+    ctx.num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  // Algorithms with parallel_branches use the threads within each run instead
+  if (ctx.num_threads > 1 && !ContractImpl::parallel_branches) {
+    repeat_contraction_in_parallel<HypergraphType, ContractImpl, ReturnPartitions, Verbosity>(ctx, ctx.num_threads);
+    record_time();
+    if constexpr (ReturnPartitions) {
+      return ctx.min_so_far;
+    } else {
+      return ctx.min_so_far.value;
+    }
+  }
+
   size_t i = 0;
   while (ctx.min_so_far.value > ctx.discovery_value
-      && (!ctx.max_num_runs.has_value() || ctx.stats.num_runs < ctx.max_num_runs.value())) {
+      && (!ctx.max_num_runs.has_value() || ctx.stats.num_runs < ctx.max_num_runs.value())
+      && !ctx.stop_requested()) {
     ++ctx.stats.num_runs;
-    HypergraphType copy(ctx.hypergraph);
+    ctx.arena.reset();
 
+    // FPZ lowers the minimum during a run, so compare against the minimum from before the run
+    const auto previous_min = ctx.min_so_far.value;
     auto start_run = std::chrono::high_resolution_clock::now();
     auto cut = ContractImpl::template contract<HypergraphType, ReturnPartitions, Verbosity>(ctx);
     auto stop_run = std::chrono::high_resolution_clock::now();
+    ctx.footprint.resize(ctx.memory_usage());
 
     ctx.min_so_far = std::min(ctx.min_so_far, cut);
     ctx.min_val_so_far.store(ctx.min_so_far.value);
+    if (ctx.min_so_far.value < previous_min) {
+      ctx.report_improvement(ctx.min_so_far.value, ctx.stats.num_runs);
+    }
 
     if constexpr (Verbosity > 0) {
       std::cout << "[" << ++i << "] took "
@@ -68,7 +368,7 @@ auto repeat_contraction(typename ContractImpl::template Context<HypergraphType>
     }
   }
 
-  auto stop = std::chrono::high_resolution_clock::now();
+  record_time();
 
   if constexpr (ReturnPartitions) {
     return ctx.min_so_far;
@@ -79,7 +379,10 @@ auto repeat_contraction(typename ContractImpl::template Context<HypergraphType>
 
 /**
  * Repeat randomized min-k-cut algorithm until either it has discovery a cut with value at least `discovery_value`
- * or has repeated a specified maximum number of times.
+ * or has repeated a specified maximum number of times. With a `time_limit`, no run starts after the limit has passed.
+ *
+ * Runs are spread over `num_threads` threads, or one per hardware thread if it is 0. With a `memory_limit` in bytes, FPZ
+ * explores branches depth first once copying another engine would go over the limit.
  *
  * Returns the minimum cut across all runs.
  */
@@ -90,7 +393,9 @@ auto repeat_contraction(const HypergraphType &hypergraph,
                         ContractionStats &stats_,
                         std::optional<size_t> max_num_runs_opt,
                         std::optional<size_t> discovery_value_opt, // TODO technically this should be the hypergraph edge weight type
-                        const std::optional<std::chrono::duration<double>> &time_limit = std::nullopt) -> typename HypergraphCutRet<
+                        const std::optional<std::chrono::duration<double>> &time_limit = std::nullopt,
+                        size_t num_threads = 1,
+                        std::optional<size_t> memory_limit = std::nullopt) -> typename HypergraphCutRet<
     HypergraphType,
     ReturnPartitions>::T {
   // Since we are very likely to find the discovery value within `default_num_runs` runs this should not conflict
@@ -98,21 +403,88 @@ auto repeat_contraction(const HypergraphType &hypergraph,
   size_t max_num_runs = max_num_runs_opt.value_or(ContractImpl::default_num_runs(hypergraph, k));
   size_t discovery_value = discovery_value_opt.value_or(0);
 
+  // The context copies the hypergraph, which is counted too
+  const instrument::Section setup;
   typename ContractImpl::template Context<HypergraphType> ctx(hypergraph,
                                                               k,
                                                               random_generator,
                                                               discovery_value,
-                                                              max_num_runs);
+                                                              max_num_runs,
+                                                              num_threads);
+  ctx.stats.counters = setup.collect();
+  if (time_limit.has_value()) {
+    ctx.deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time_limit.value());
+  }
+  ctx.memory_limit = memory_limit;
 
-  return repeat_contraction<HypergraphType, ContractImpl, ReturnPartitions, Verbosity>(ctx);
+  auto cut = repeat_contraction<HypergraphType, ContractImpl, ReturnPartitions, Verbosity>(ctx);
+  stats_ = ctx.stats;
+  return cut;
 }
 
 }
 
 template<typename ContractionImpl>
 struct ContractionAlgo {
+  /* Runs the algorithm until its budget runs out and returns the best cut found, reporting every improvement to
+   * `budget.on_improvement` along the way. If the budget runs out before the first run finishes, the returned cut has
+   * the largest possible value and no partitions.
+   *
+   * For example, `budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200)` asks for the
+   * best cut that can be found in about 200 milliseconds.
+   */
   template<typename HypergraphType, uint8_t Verbosity = 0>
-  static auto minimum_cut(const HypergraphType &hypergraph, size_t k, size_t num_runs = 0, uint64_t seed = 0) {
+  static auto anytime_minimum_cut(const HypergraphType &hypergraph,
+                                  size_t k,
+                                  const util::Budget<typename HypergraphType::EdgeWeight> &budget,
+                                  util::ContractionStats &stats,
+                                  uint64_t seed = 0,
+                                  size_t num_threads = 1) {
+    std::mt19937_64 rand;
+    if (seed) {
+      rand.seed(seed);
+    }
+    std::optional<size_t> max_num_runs = budget.max_num_runs;
+    if (!max_num_runs.has_value() && !budget.deadline.has_value() && budget.cancelled == nullptr) {
+      max_num_runs = ContractionImpl::default_num_runs(hypergraph, k);
+    }
+
+    const instrument::Section setup;
+    typename ContractionImpl::template Context<HypergraphType> ctx(hypergraph,
+                                                                   k,
+                                                                   rand,
+                                                                   budget.discovery_value,
+                                                                   max_num_runs,
+                                                                   num_threads);
+    ctx.stats.counters = setup.collect();
+    ctx.deadline = budget.deadline;
+    ctx.cancelled = budget.cancelled;
+    ctx.bound = budget.bound;
+    ctx.on_improvement = budget.on_improvement;
+    ctx.memory_limit = budget.memory_limit;
+
+    auto cut = util::repeat_contraction<HypergraphType, ContractionImpl, true, Verbosity>(ctx);
+    stats = ctx.stats;
+    return cut;
+  }
+
+  template<typename HypergraphType, uint8_t Verbosity = 0>
+  static auto anytime_minimum_cut(const HypergraphType &hypergraph,
+                                  size_t k,
+                                  const util::Budget<typename HypergraphType::EdgeWeight> &budget,
+                                  uint64_t seed = 0,
+                                  size_t num_threads = 1) {
+    util::ContractionStats stats{};
+    return anytime_minimum_cut<HypergraphType, Verbosity>(hypergraph, k, budget, stats, seed, num_threads);
+  }
+
+  template<typename HypergraphType, uint8_t Verbosity = 0>
+  static auto minimum_cut(const HypergraphType &hypergraph,
+                          size_t k,
+                          size_t num_runs = 0,
+                          uint64_t seed = 0,
+                          size_t num_threads = 1) {
     std::mt19937_64 rand;
     if (seed) {
       rand.seed(seed);
@@ -126,11 +498,17 @@ struct ContractionAlgo {
                                                rand,
                                                stats,
                                                num_runs == 0 ? std::nullopt : std::optional(num_runs),
-                                               std::nullopt);
+                                               std::nullopt,
+                                               std::nullopt,
+                                               num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
-  static auto minimum_cut_value(const HypergraphType &hypergraph, size_t k, size_t num_runs = 0, uint64_t seed = 0) {
+  static auto minimum_cut_value(const HypergraphType &hypergraph,
+                                size_t k,
+                                size_t num_runs = 0,
+                                uint64_t seed = 0,
+                                size_t num_threads = 1) {
     std::mt19937_64 rand;
     if (seed) {
       rand.seed(seed);
@@ -144,27 +522,31 @@ struct ContractionAlgo {
                                                rand,
                                                stats,
                                                num_runs == 0 ? std::nullopt : std::optional(num_runs),
-                                               std::nullopt);
+                                               std::nullopt,
+                                               std::nullopt,
+                                               num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
   static auto discover(const HypergraphType &hypergraph,
                        size_t k,
                        typename HypergraphType::EdgeWeight discovery_value,
-                       uint64_t seed = 0) {
+                       uint64_t seed = 0,
+                       size_t num_threads = 1) {
     util::ContractionStats stats{};
     return discover<HypergraphType,
-                    Verbosity>(hypergraph, k, discovery_value, stats, seed);
+                    Verbosity>(hypergraph, k, discovery_value, stats, seed, num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
   static auto discover_value(const HypergraphType &hypergraph,
                              size_t k,
                              typename HypergraphType::EdgeWeight discovery_value,
-                             uint64_t seed = 0) {
+                             uint64_t seed = 0,
+                             size_t num_threads = 1) {
     util::ContractionStats stats{};
     return discover_value<HypergraphType,
-                          Verbosity>(hypergraph, k, discovery_value, stats, seed);
+                          Verbosity>(hypergraph, k, discovery_value, stats, seed, num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
@@ -172,7 +554,8 @@ struct ContractionAlgo {
                        size_t k,
                        typename HypergraphType::EdgeWeight discovery_value,
                        util::ContractionStats &stats,
-                       uint64_t seed = 0) {
+                       uint64_t seed = 0,
+                       size_t num_threads = 1) {
     std::mt19937_64 rand;
     stats = {};
     if (seed) {
@@ -187,7 +570,8 @@ struct ContractionAlgo {
                                                stats,
                                                std::nullopt,
                                                discovery_value,
-                                               std::nullopt);
+                                               std::nullopt,
+                                               num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
@@ -195,7 +579,8 @@ struct ContractionAlgo {
                              size_t k,
                              typename HypergraphType::EdgeWeight discovery_value,
                              util::ContractionStats &stats,
-                             uint64_t seed = 0) {
+                             uint64_t seed = 0,
+                             size_t num_threads = 1) {
     std::mt19937_64 rand;
     stats = {};
     if (seed) {
@@ -210,7 +595,8 @@ struct ContractionAlgo {
                                                stats,
                                                std::nullopt,
                                                discovery_value,
-                                               std::nullopt);
+                                               std::nullopt,
+                                               num_threads);
   }
 
   template<typename HypergraphType, uint8_t Verbosity = 0>
@@ -1,130 +1,169 @@
 #include "hypergraph/certificate.hpp"
 
-#include "hypergraph/order.hpp"
-
-namespace {
-
-// Returns the induced head ordering of the edges in O(p) time.
-// The induced head ordering is just the edges ordered by their heads
-// (the vertex in the edge that appears first in the vertex ordering)
-std::vector<int> induced_head_ordering(const hypergraphlib::Hypergraph &hypergraph,
-                                       std::vector<int> vertex_ordering) {
-  // TODO Inverting a map is a common operation, consider using a map with two-way indexing
-  std::unordered_map<int, size_t> vertex_to_order;
-  for (size_t i = 0; i < vertex_ordering.size(); ++i) {
-    vertex_to_order[vertex_ordering[i]] = i;
-  }
-
-  // buckets.at(i) contain the edges with head vertex i
-  std::vector<std::vector<int>> buckets(vertex_ordering.size() + 1);
-
-  // TODO good place for a <algorithms>
-  // For each edge, designate as the head the vertex that appears first in the ordering
-  for (const auto &[e, vertices] : hypergraph.edges()) {
-    auto head = std::numeric_limits<size_t>::max();
-    for (const int v : vertices) {
-      if (vertex_to_order[v] < head) {
-        head = vertex_to_order[v];
-      }
-    }
-    buckets.at(head).push_back(e);
-  }
-
-  // Order the edges by their heads
-  std::vector<int> edge_ordering;
-  for (const auto &bucket : buckets) {
-    edge_ordering.insert(std::end(edge_ordering), std::begin(bucket),
-                         std::end(bucket));
-  }
-
-  return edge_ordering;
-}
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
 
-} // namespace
+#include "hypergraph/order.hpp"
 
 namespace hypergraphlib {
 
 KTrimmedCertificate::KTrimmedCertificate(const Hypergraph &hypergraph)
     : hypergraph_(hypergraph) {
-  for (const auto v : hypergraph_.vertices()) {
-    backward_edges_[v] = {};
-  }
-
   vertex_ordering_ = maximum_adjacency_ordering(
       hypergraph_, *std::begin(hypergraph.vertices()));
-  std::vector<int> edge_ordering =
-      induced_head_ordering(hypergraph_, vertex_ordering_);
 
-  // Cache all heads in O(p) time
   std::unordered_map<int, size_t> vertex_to_order;
   for (size_t i = 0; i < vertex_ordering_.size(); ++i) {
     vertex_to_order[vertex_ordering_[i]] = i;
   }
 
-  // For each edge, designate as the head the vertex that appears the first in the ordering
-  // TODO this does the same thing as edge ordering
-  for (const auto &[e, vertices] : hypergraph.edges()) {
-    edge_to_head_[e] = std::numeric_limits<size_t>::max();
+  // For each edge, designate as the head the vertex that appears first in the ordering, and bucket the edges by their
+  // heads to get the induced head ordering. Both take O(p) time.
+  std::vector<std::vector<int>> buckets(vertex_ordering_.size());
+  for (const auto &[e, vertices] : hypergraph_.edges()) {
+    auto head = std::numeric_limits<size_t>::max();
     for (const int v : vertices) {
-      if (vertex_to_order[v] < edge_to_head_[e]) {
-        edge_to_head_[e] = vertex_to_order[v];
-      }
+      head = std::min(head, vertex_to_order.at(v));
     }
+    edge_to_head_[e] = head;
+    buckets.at(head).push_back(e);
   }
 
-  // For each vertex and edge in the edge ordering
-  // if the vertex is in the edge and v is not the head of the edge
-  // e as a backward edge to v
+  // Walking over the edges in the head ordering appends each edge to the backward edges of its vertices other than
+  // the head, so every list of backward edges ends up in the head ordering. This takes O(p) time.
   for (const auto v : hypergraph_.vertices()) {
-    for (const int e : edge_ordering) {
-      const auto &e_vertices = hypergraph.edges().at(e);
-      if (std::find(std::begin(e_vertices), std::end(e_vertices), v) !=
-          std::end(e_vertices) &&
-          v != head(e)) {
-        backward_edges_.at(v).push_back(e);
+    backward_edges_[v] = {};
+  }
+  for (const auto &bucket : buckets) {
+    for (const int e : bucket) {
+      const int h = head(e);
+      for (const int v : hypergraph_.edges().at(e)) {
+        if (v != h) {
+          backward_edges_.at(v).push_back(e);
+        }
       }
     }
   }
 }
 
 Hypergraph KTrimmedCertificate::certificate(size_t k) const {
-  // TODO Allow hypergraph map constructor without next_vertex_id
-  int next_vertex_id = std::numeric_limits<int>::min();
+  Hypergraph certificate = empty_certificate();
+  extend(certificate, 0, k);
+  return certificate;
+}
 
+size_t KTrimmedCertificate::memory_usage() const {
+  return sizeof(KTrimmedCertificate) - sizeof(hypergraph_) + hypergraph_.memory_usage() + heap_bytes(vertex_ordering_)
+      + heap_bytes(edge_to_head_) + heap_bytes(backward_edges_);
+}
+
+Hypergraph KTrimmedCertificate::empty_certificate() const {
   std::unordered_map<int, std::vector<int>> new_edges;
   std::unordered_map<int, std::vector<int>> new_vertices;
-
-  // next_vertex_id is the smallest vertex id, it looks like there is also some off-by one translation to address
-  // Each vertex is in new_vertices
   for (const auto v : hypergraph_.vertices()) {
-    next_vertex_id = std::max(next_vertex_id, v + 1);
     new_vertices.insert({v, {}});
   }
+  return Hypergraph(std::move(new_vertices), std::move(new_edges), hypergraph_);
+}
 
-  // O(kn) loop
-  // For each vertex, for each backward edge of that vertex, add the vertex to that edge to the first k backward edges
-  for (const auto v : hypergraph_.vertices()) {
-    const auto backward_edges = backward_edges_.at(v);
-    for (auto it = std::begin(backward_edges);
-         it != std::end(backward_edges) &&
-             it != std::begin(backward_edges) + static_cast<long long>(k);
-         ++it) {
-      const int e = *it;
-      // TODO I think each edge is guaranteed to appear in the trimmed certificate, so we could hoist this outside of this loop
-      if (new_edges.find(e) == std::end(new_edges)) {
-        new_edges[e] = {head(e)};
+void KTrimmedCertificate::extend(Hypergraph &certificate, const size_t from, const size_t to) const {
+  auto &new_edges = certificate.edges_;
+  auto &new_vertices = certificate.vertices_;
+
+  // For each vertex, add the vertex to its backward edges from position `from` up to position `to`
+  for (const auto &[v, backward_edges] : backward_edges_) {
+    for (size_t i = from; i < std::min(to, backward_edges.size()); ++i) {
+      const int e = backward_edges[i];
+      auto it = new_edges.find(e);
+      if (it == std::end(new_edges)) {
+        it = new_edges.insert({e, {head(e)}}).first;
         new_vertices.at(head(e)).push_back(e);
       }
-      new_edges.at(e).push_back(v);
+      it->second.push_back(v);
       new_vertices.at(v).push_back(e);
     }
   }
+}
 
-  return Hypergraph(std::move(new_vertices), std::move(new_edges), hypergraph_);
+IncrementalCertificate::IncrementalCertificate(const Hypergraph &hypergraph)
+    : IncrementalCertificate(std::make_shared<const KTrimmedCertificate>(hypergraph)) {}
+
+IncrementalCertificate::IncrementalCertificate(std::shared_ptr<const KTrimmedCertificate> certificates)
+    : certificates_(std::move(certificates)), certificate_(certificates_->empty_certificate()) {}
+
+const Hypergraph &IncrementalCertificate::grow(const size_t k) {
+  assert(k >= k_);
+  certificates_->extend(certificate_, k_, k);
+  k_ = k;
+  return certificate_;
 }
 
 int KTrimmedCertificate::head(const int e) const {
   return vertex_ordering_.at(edge_to_head_.at(e));
 }
 
+StreamingCertificate::StreamingCertificate(const size_t num_vertices, const size_t k)
+    : num_vertices_(num_vertices), k_(k), parent_(k * num_vertices), rank_(k * num_vertices, 0) {
+  for (size_t i = 0; i < k_; ++i) {
+    std::iota(std::begin(parent_) + i * num_vertices_, std::begin(parent_) + (i + 1) * num_vertices_, 0);
+  }
+}
+
+size_t StreamingCertificate::add_pins(const size_t weight) {
+  if (pins_.size() < 2 || weight == 0) {
+    return 0;
+  }
+
+  // Find the first forest the edge can go into. If the pins are in one component of forest i, they are in one
+  // component of every forest before it.
+  size_t first = 0;
+  size_t last = k_;
+  while (first < last) {
+    const size_t mid = first + (last - first) / 2;
+    if (separates(mid)) {
+      last = mid;
+    } else {
+      first = mid + 1;
+    }
+  }
+
+  // Put a copy into each of the forests from there on, merging the components of the pins
+  const size_t kept = std::min(weight, k_ - first);
+  for (size_t i = first; i < first + kept; ++i) {
+    int root = find(i, pins_[0]);
+    for (size_t j = 1; j < pins_.size(); ++j) {
+      int other = find(i, pins_[j]);
+      if (other == root) {
+        continue;
+      }
+      const size_t offset = i * num_vertices_;
+      if (rank_[offset + root] < rank_[offset + other]) {
+        std::swap(root, other);
+      }
+      parent_[offset + other] = root;
+      if (rank_[offset + root] == rank_[offset + other]) {
+        ++rank_[offset + root];
+      }
+    }
+  }
+  return kept;
+}
+
+bool StreamingCertificate::separates(const size_t i) {
+  const int root = find(i, pins_[0]);
+  return std::any_of(std::begin(pins_) + 1, std::end(pins_), [&](const int v) { return find(i, v) != root; });
+}
+
+int StreamingCertificate::find(const size_t i, int v) {
+  int *const parent = parent_.data() + i * num_vertices_;
+  // Path halving
+  while (parent[v] != v) {
+    parent[v] = parent[parent[v]];
+    v = parent[v];
+  }
+  return v;
+}
+
 }
@@ -4,8 +4,16 @@
 
 namespace hypergraphlib {
 
-BucketHeap::BucketHeap(std::vector<int> values, const size_t capacity)
-    : capacity_(capacity), buckets_(capacity), max_key_(0) {
+BucketHeap::BucketHeap(std::vector<int> values, const size_t capacity) : capacity_(capacity), max_key_(0) {
+  reset(values, capacity);
+}
+
+void BucketHeap::reset(const std::vector<int> &values, const size_t capacity) {
+  capacity_ = capacity;
+  buckets_.assign(capacity, {});
+  val_to_keys_.clear();
+  val_to_its_.clear();
+  max_key_ = 0;
   for (const int value : values) {
     buckets_.front().emplace_front(value);
     val_to_keys_.insert({value, 0});
@@ -38,4 +46,20 @@ std::pair<size_t, int> BucketHeap::pop_key_val() {
   return {max_key_, value};
 }
 
+void IndexedBucketHeap::reset(const std::vector<int> &values, const size_t capacity) {
+  capacity_ = capacity;
+  head_.assign(capacity, kNone);
+  const int max_value = values.empty() ? -1 : *std::max_element(std::begin(values), std::end(values));
+  if (key_.size() < static_cast<size_t>(max_value + 1)) {
+    key_.resize(max_value + 1);
+    next_.resize(max_value + 1);
+    prev_.resize(max_value + 1);
+  }
+  for (const int value : values) {
+    key_[value] = 0;
+    link(value, 0);
+  }
+  max_key_ = 0;
+}
+
 }
@@ -0,0 +1,117 @@
+#include "hypergraph/io.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HYPERGRAPH_HAVE_MMAP
+#endif
+
+namespace hypergraphlib {
+
+namespace io {
+
+MappedFile::MappedFile(const std::string &filename) {
+#ifdef HYPERGRAPH_HAVE_MMAP
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("could not open " + filename);
+  }
+  struct stat info{};
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      // The file is read front to back
+      ::madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+      data_ = static_cast<const char *>(data);
+      size_ = static_cast<size_t>(info.st_size);
+      mapped_ = true;
+    }
+  }
+  ::close(fd);
+  if (mapped_) {
+    return;
+  }
+#endif
+  // Empty files and files that cannot be mapped, such as pipes, are read instead
+  std::ifstream input(filename, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error("could not open " + filename);
+  }
+  std::ostringstream buffer;
+  buffer << input.rdbuf();
+  buffer_ = buffer.str();
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef HYPERGRAPH_HAVE_MMAP
+  if (mapped_) {
+    ::munmap(const_cast<char *>(data_), size_);
+  }
+#endif
+}
+
+}
+
+BinaryHypergraphFile::BinaryHypergraphFile(const std::string &filename) :
+    file_(filename), header_(read_header(file_, filename)), layout_(header_) {
+  if (file_.contents().size() < layout_.size) {
+    throw std::runtime_error(filename + " is truncated");
+  }
+}
+
+io::BinaryHeader BinaryHypergraphFile::read_header(const io::MappedFile &file, const std::string &filename) {
+  io::BinaryHeader header{};
+  if (file.contents().size() < sizeof(header)) {
+    throw std::runtime_error(filename + " is not a binary hypergraph file");
+  }
+  std::memcpy(&header, file.contents().data(), sizeof(header));
+  if (!std::equal(std::begin(io::kBinaryMagic), std::end(io::kBinaryMagic), header.magic)) {
+    throw std::runtime_error(filename + " is not a binary hypergraph file");
+  }
+  if (header.byte_order_mark != io::kByteOrderMark) {
+    throw std::runtime_error(filename + " was written on a machine with a different byte order");
+  }
+  if (header.version != io::kBinaryVersion) {
+    throw std::runtime_error(filename + " has unsupported version " + std::to_string(header.version));
+  }
+  if (header.weight_type > static_cast<uint32_t>(io::WeightType::kDouble) || header.num_vertices == 0) {
+    throw std::runtime_error(filename + " has a malformed header");
+  }
+  return header;
+}
+
+bool BinaryHypergraphFile::is_binary_file(const std::string &filename) {
+  std::ifstream input(filename, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error("could not open " + filename);
+  }
+  char magic[sizeof(io::kBinaryMagic)] = {};
+  input.read(magic, sizeof(magic));
+  return input.gcount() == sizeof(magic) && std::equal(std::begin(magic), std::end(magic), io::kBinaryMagic);
+}
+
+bool is_unweighted_hypergraph_file(const std::string &filename) {
+  if (BinaryHypergraphFile::is_binary_file(filename)) {
+    return !BinaryHypergraphFile(filename).weighted();
+  }
+  return is_unweighted_hmetis_file(filename);
+}
+
+bool is_unweighted_hmetis_file(const std::string &filename) {
+  std::ifstream input(filename);
+  if (!input) {
+    throw std::runtime_error("could not open " + filename);
+  }
+  return is_unweighted_hmetis_file(input);
+}
+
+}
@@ -3,22 +3,36 @@
 //
 
 #define CREATE_HYPERGRAPH_K_CUT_TEST_SUITE2(name, ns, unweighted, weighted1, weighted2) \
-CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##Unweighted, ns, Hypergraph, unweighted) \
-CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##WeightedIntegral, ns, WeightedHypergraph<size_t>, weighted1) \
-CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##WeightedFloating, ns, WeightedHypergraph<double>, weighted2) \
-CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueUnweighted, ns, Hypergraph, unweighted) \
-CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedIntegral, ns, WeightedHypergraph<size_t>, weighted1) \
-CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedFloating, ns, WeightedHypergraph<double>, weighted2) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryUnweighted, ns, Hypergraph, unweighted) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryWeightedIntegral, ns, WeightedHypergraph<size_t>, weighted1) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryWeightedFloating, ns, WeightedHypergraph<double>, weighted2) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueUnweighted, ns, Hypergraph, unweighted) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueWeightedIntegral, ns, WeightedHypergraph<size_t>, weighted1) \
-CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueWeightedFloating, ns, WeightedHypergraph<double>, weighted2)
+CREATE_HYPERGRAPH_K_CUT_TEST_SUITE_FOR_TYPES(name, ns, Hypergraph, WeightedHypergraph<size_t>, WeightedHypergraph<double>, \
+                                             unweighted, weighted1, weighted2)
+
+#define CREATE_HYPERGRAPH_K_CUT_TEST_SUITE_FOR_TYPES(name, ns, UnweightedType, WeightedIntegralType, WeightedFloatingType, unweighted, weighted1, weighted2) \
+CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##Unweighted, ns, UnweightedType, unweighted) \
+CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##WeightedIntegral, ns, WeightedIntegralType, weighted1) \
+CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name##WeightedFloating, ns, WeightedFloatingType, weighted2) \
+CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueUnweighted, ns, UnweightedType, unweighted) \
+CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedIntegral, ns, WeightedIntegralType, weighted1) \
+CREATE_HYPERGRAPH_K_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedFloating, ns, WeightedFloatingType, weighted2) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryUnweighted, ns, UnweightedType, unweighted) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryWeightedIntegral, ns, WeightedIntegralType, weighted1) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_TEST_FIXTURE(name##DiscoveryWeightedFloating, ns, WeightedFloatingType, weighted2) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueUnweighted, ns, UnweightedType, unweighted) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueWeightedIntegral, ns, WeightedIntegralType, weighted1) \
+CREATE_HYPERGRAPH_K_CUT_DISCOVERY_VALUE_TEST_FIXTURE(name##DiscoveryValueWeightedFloating, ns, WeightedFloatingType, weighted2)
 
 #define CREATE_HYPERGRAPH_K_CUT_TEST_SUITE(name, ns) \
 CREATE_HYPERGRAPH_K_CUT_TEST_SUITE2(name, ns, small_unweighted_tests(), small_weighted_tests<size_t>(), small_weighted_tests<double>())
 
+// Same as CREATE_HYPERGRAPH_K_CUT_TEST_SUITE, but on the compact hypergraph types
+#define CREATE_COMPACT_HYPERGRAPH_K_CUT_TEST_SUITE(name, ns) \
+CREATE_HYPERGRAPH_K_CUT_TEST_SUITE_FOR_TYPES(name, ns, \
+                                             CompactHypergraph, \
+                                             CompactWeightedHypergraph<size_t>, \
+                                             CompactWeightedHypergraph<double>, \
+                                             small_tests<CompactHypergraph>(), \
+                                             small_tests<CompactWeightedHypergraph<size_t>>(), \
+                                             small_tests<CompactWeightedHypergraph<double>>())
+
 #define CREATE_HYPERGRAPH_K_CUT_TEST_FIXTURE(name, ns, HypergraphType, values) \
 class name##Test : public testing::TestWithParam<TestCaseInstance<HypergraphType>> {}; \
 TEST_P(name##Test, Works) { \
@@ -88,16 +102,30 @@ INSTANTIATE_TEST_SUITE_P( \
 );
 
 #define CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE2(name, unweighted, weighted1, weighted2) \
-CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##Unweighted, name, Hypergraph, min_cut_instances(unweighted)) \
-CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##WeightedIntegral, name, WeightedHypergraph<size_t>, min_cut_instances(weighted1)) \
-CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##WeightedFloating, name, WeightedHypergraph<double>, min_cut_instances(weighted2)) \
-CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueUnweighted, name, Hypergraph, min_cut_instances(unweighted)) \
-CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedIntegral, name, WeightedHypergraph<size_t>, min_cut_instances(weighted1)) \
-CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedFloating, name, WeightedHypergraph<double>, min_cut_instances(weighted2))
+CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE_FOR_TYPES(name, name, Hypergraph, WeightedHypergraph<size_t>, WeightedHypergraph<double>, \
+                                               unweighted, weighted1, weighted2)
+
+#define CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE_FOR_TYPES(name, funcprefix, UnweightedType, WeightedIntegralType, WeightedFloatingType, unweighted, weighted1, weighted2) \
+CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##Unweighted, funcprefix, UnweightedType, min_cut_instances(unweighted)) \
+CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##WeightedIntegral, funcprefix, WeightedIntegralType, min_cut_instances(weighted1)) \
+CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name##WeightedFloating, funcprefix, WeightedFloatingType, min_cut_instances(weighted2)) \
+CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueUnweighted, funcprefix, UnweightedType, min_cut_instances(unweighted)) \
+CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedIntegral, funcprefix, WeightedIntegralType, min_cut_instances(weighted1)) \
+CREATE_HYPERGRAPH_MIN_CUT_VALUE_TEST_FIXTURE(name##ValueWeightedFloating, funcprefix, WeightedFloatingType, min_cut_instances(weighted2))
 
 #define CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE(name) \
 CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE2(name, small_unweighted_tests(), small_weighted_tests<size_t>(), small_weighted_tests<double>())
 
+// Same as CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE, but on the compact hypergraph types
+#define CREATE_COMPACT_HYPERGRAPH_MIN_CUT_TEST_SUITE(name, funcprefix) \
+CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE_FOR_TYPES(name, funcprefix, \
+                                               CompactHypergraph, \
+                                               CompactWeightedHypergraph<size_t>, \
+                                               CompactWeightedHypergraph<double>, \
+                                               small_tests<CompactHypergraph>(), \
+                                               small_tests<CompactWeightedHypergraph<size_t>>(), \
+                                               small_tests<CompactWeightedHypergraph<double>>())
+
 #define CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(name, funcprefix, HypergraphType, values) \
 class name##Test : public testing::TestWithParam<MinCutTestCaseInstance<HypergraphType>> {}; \
 TEST_P(name##Test, Works) { \
@@ -1,14 +1,32 @@
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <random>
+#include <sstream>
 #include <tuple>
+#include <unordered_set>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include "hypergraph/approx.hpp"
+#include "hypergraph/arena.hpp"
+#include "hypergraph/cache.hpp"
+#include "hypergraph/certificate.hpp"
 #include "hypergraph/cxy.hpp"
 #include "hypergraph/fpz.hpp"
 #include <hypergraph/kk.hpp>
 #include "hypergraph/hypergraph.hpp"
+#include "hypergraph/compact.hpp"
+#include "hypergraph/contraction.hpp"
+#include "hypergraph/fenwick.hpp"
+#include "hypergraph/instrument.hpp"
+#include "hypergraph/io.hpp"
 #include "hypergraph/order.hpp"
 
+#include "testutil.hpp"
+
 using namespace hypergraphlib;
 
 namespace {
@@ -242,6 +260,37 @@ TEST(TightOrdering, Works) {
   }
 }
 
+TEST(TightOrdering, ReusesContextAcrossPhases) {
+  Hypergraph hypergraph = factory();
+  OrderingContext<Hypergraph::Heap> ctx;
+  while (hypergraph.num_vertices() > 1) {
+    ordering<Hypergraph, tight_ordering_tighten>(hypergraph, *std::begin(hypergraph.vertices()), ctx);
+
+    ASSERT_EQ(ctx.ordering.size(), hypergraph.num_vertices());
+    ASSERT_TRUE(verify_tight_ordering(hypergraph, std::begin(ctx.ordering), std::end(ctx.ordering)));
+
+    hypergraph = merge_vertices(hypergraph, *(std::end(ctx.ordering) - 2), *(std::end(ctx.ordering) - 1));
+  }
+}
+
+TEST(TightOrdering, NegativeAndSparseIds) {
+  OrderingContext<Hypergraph::Heap> ctx;
+  for (const std::vector<int> &ids : {std::vector<int>{-3, -2, -1, 0}, std::vector<int>{0, 7, 1 << 30, 5}}) {
+    const Hypergraph h(ids, {{ids[0], ids[1]}, {ids[1], ids[2]}, {ids[2], ids[3]}, {ids[3], ids[0]},
+                             {ids[0], ids[2]}});
+    for (const int a : ids) {
+      ordering<Hypergraph, tight_ordering_tighten>(h, a, ctx);
+
+      ASSERT_EQ(ctx.ordering.size(), h.num_vertices());
+      ASSERT_TRUE(verify_tight_ordering(h, std::begin(ctx.ordering), std::end(ctx.ordering)));
+      ASSERT_TRUE(std::is_permutation(std::begin(ctx.ordering), std::end(ctx.ordering), std::begin(ids)));
+    }
+
+    Hypergraph copy = h;
+    EXPECT_EQ(MW_min_cut_value(copy), 2);
+  }
+}
+
 TEST(QueyranneOrdering, OrderedByD3) {
   for (int i = 1; i <= 10; ++i) {
     Hypergraph hypergraph = factory();
@@ -481,6 +530,235 @@ TEST(Hypergraph, ContractKeepsGraphValid) {
   EXPECT_TRUE(contracted.is_valid());
 }
 
+TEST(Hypergraph, ContractHandlesRepeatedPins) {
+  const Hypergraph h = {
+      {1, 2, 3, 4},
+      {
+          {1, 2, 1},
+          {2, 3},
+          {3, 4}
+      }
+  };
+  EXPECT_TRUE(h.may_have_repeated_pins(0));
+  EXPECT_FALSE(h.may_have_repeated_pins(1));
+  EXPECT_FALSE(h.may_have_repeated_pins(2));
+
+  const int new_vertex_id = 5;
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {1, {3, new_vertex_id}},
+      {2, {3, 4}}
+  };
+  const Hypergraph contracted = h.contract(0);
+  EXPECT_THAT(contracted.vertices(), testing::UnorderedElementsAre(3, 4, new_vertex_id));
+  EXPECT_THAT(contracted.edges(), testing::UnorderedElementsAreArray(expected_edges));
+  EXPECT_THAT(contracted.vertices_within(new_vertex_id), testing::UnorderedElementsAre(1, 2));
+  EXPECT_TRUE(contracted.is_valid());
+
+  Hypergraph in_place = h;
+  in_place.contract_in_place(0);
+  EXPECT_THAT(in_place.edges(), testing::UnorderedElementsAreArray(expected_edges));
+  EXPECT_THAT(in_place.vertices_within(new_vertex_id), testing::UnorderedElementsAre(1, 2));
+  EXPECT_TRUE(in_place.is_valid());
+
+  // Edges added with repeated vertices are tracked too
+  Hypergraph added = h;
+  const std::vector<int> pins = {3, 4, 3};
+  const int e = added.add_hyperedge(std::begin(pins), std::end(pins));
+  EXPECT_TRUE(added.may_have_repeated_pins(e));
+  added.contract_in_place(e);
+  EXPECT_FALSE(added.may_have_repeated_pins(e));
+  EXPECT_TRUE(added.is_valid());
+}
+
+TEST(Hypergraph, ContractSetsRewritesEachEdgeOnce) {
+  const Hypergraph h = {
+      {1, 2, 3, 4, 5, 6},
+      {
+          {1, 2},
+          {1, 3, 2},
+          {2, 4, 5},
+          {5, 6},
+          {3, 4, 6}
+      }
+  };
+  const std::vector<int> first = {1, 2};
+  const std::vector<int> second = {5, 6};
+  using Set = std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>;
+  const std::vector<Set> sets = {{std::cbegin(first), std::cend(first)}, {std::cbegin(second), std::cend(second)}};
+  const Hypergraph contracted = h.contract_sets(std::begin(sets), std::end(sets));
+
+  // The sets become 7 and 8, and the edges inside them are dropped
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {1, {7, 3}},
+      {2, {7, 4, 8}},
+      {4, {3, 4, 8}}
+  };
+  EXPECT_THAT(contracted.vertices(), testing::UnorderedElementsAre(3, 4, 7, 8));
+  EXPECT_THAT(contracted.edges(), testing::UnorderedElementsAreArray(expected_edges));
+  EXPECT_THAT(contracted.vertices_within(7), testing::UnorderedElementsAre(1, 2));
+  EXPECT_THAT(contracted.vertices_within(8), testing::UnorderedElementsAre(5, 6));
+  EXPECT_TRUE(contracted.is_valid());
+}
+
+TEST(WeightedHypergraph, ContractSetsMergesParallelEdges) {
+  const WeightedHypergraph<size_t> h({1, 2, 3, 4}, {{{1, 3}, 1}, {{2, 3}, 2}, {{1, 2, 3}, 4}, {{3, 4}, 8}});
+  const std::vector<int> set = {1, 2};
+  const auto contracted = h.contract<true, true>(std::begin(set), std::end(set));
+
+  // All three edges on 1, 2 and 3 become {5, 3}, and keep the smallest ID
+  ASSERT_EQ(contracted.num_edges(), 2);
+  EXPECT_THAT(contracted.edges().at(0), testing::UnorderedElementsAre(5, 3));
+  EXPECT_EQ(contracted.edge_weight(0), 7);
+  EXPECT_EQ(contracted.edge_weight(3), 8);
+  EXPECT_EQ(contracted.degree(3), 2);
+  EXPECT_TRUE(contracted.is_valid());
+}
+
+TEST(WeightedHypergraph, WeightsFollowEdgeIds) {
+  WeightedHypergraph<size_t> h({1, 2, 3, 4}, {{{1, 2}, 1}, {{2, 3}, 2}, {{3, 4}, 4}});
+  const std::vector<int> pins = {1, 4};
+  const int added = h.add_hyperedge(std::begin(pins), std::end(pins), 8);
+  EXPECT_EQ(added, 3);
+  EXPECT_EQ(h.edge_weight(added), 8);
+
+  WeightedHypergraph<size_t> removed = h;
+  removed.remove_hyperedge(1);
+  EXPECT_EQ(removed.edge_weight(2), 4);
+  EXPECT_EQ(removed.edge_weight(added), 8);
+  EXPECT_FALSE(removed == h);
+
+  // Contracting an edge keeps the IDs and weights of the other edges
+  const auto contracted = h.contract(0);
+  EXPECT_EQ(contracted.edge_weight(1), 2);
+  EXPECT_EQ(contracted.edge_weight(2), 4);
+  EXPECT_EQ(contracted.edge_weight(added), 8);
+}
+
+TEST(IdMap, TranslatesBothWays) {
+  const std::vector<int> ids = {12, -3, 40, 7};
+  const IdMap map(ids);
+  ASSERT_EQ(map.size(), 4);
+  EXPECT_THAT(map.ids(), testing::ElementsAre(-3, 7, 12, 40));
+  for (const int id : ids) {
+    EXPECT_EQ(map.id(map.dense(id)), id);
+  }
+  EXPECT_EQ(map.dense(7), 1);
+  EXPECT_EQ(map.dense(8), IdMap::kNone);
+  EXPECT_EQ(map.dense(41), IdMap::kNone);
+  EXPECT_EQ(map.dense(-4), IdMap::kNone);
+}
+
+TEST(IdMap, SparseIds) {
+  const std::vector<int> ids = {0, 2000000000, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+  const IdMap map(ids);
+  EXPECT_LT(map.memory_usage(), 1024);
+  for (const int id : ids) {
+    EXPECT_EQ(map.id(map.dense(id)), id);
+  }
+  EXPECT_EQ(map.dense(2000000000), 2);
+  EXPECT_EQ(map.dense(1), IdMap::kNone);
+  EXPECT_EQ(map.dense(std::numeric_limits<int>::max() - 1), IdMap::kNone);
+
+  const Hypergraph h({0, 2000000000, -2000000000}, {{0, 2000000000}, {2000000000, -2000000000}});
+  const Hypergraph normalized = normalize(h);
+  EXPECT_THAT(normalized.vertices(), testing::UnorderedElementsAre(0, 1, 2));
+  std::vector<std::vector<int>> edges;
+  for (const auto &[e, vertices] : normalized.edges()) {
+    edges.push_back(vertices);
+  }
+  EXPECT_THAT(edges, testing::UnorderedElementsAre(std::vector<int>{1, 2}, std::vector<int>{2, 0}));
+}
+
+TEST(Hypergraph, CompactIdsReusesIds) {
+  const Hypergraph h = {
+      {1, 2, 3, 4, 5, 6},
+      {
+          {1, 2},
+          {1, 3, 2},
+          {2, 4, 5},
+          {5, 6},
+          {3, 4, 6}
+      }
+  };
+  const std::vector<int> first = {1, 2};
+  const std::vector<int> second = {5, 6};
+  using Set = std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>;
+  const std::vector<Set> sets = {{std::cbegin(first), std::cend(first)}, {std::cbegin(second), std::cend(second)}};
+  Hypergraph contracted = h.contract_sets(std::begin(sets), std::end(sets));
+
+  // Vertices 3, 4, 7 and 8 become 0 to 3, and edges 1, 2 and 4 become 0 to 2
+  const auto [vertex_ids, edge_ids] = contracted.compact_ids();
+  EXPECT_THAT(vertex_ids.ids(), testing::ElementsAre(3, 4, 7, 8));
+  EXPECT_THAT(edge_ids.ids(), testing::ElementsAre(1, 2, 4));
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {0, {2, 0}},
+      {1, {2, 1, 3}},
+      {2, {0, 1, 3}}
+  };
+  EXPECT_THAT(contracted.vertices(), testing::UnorderedElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(contracted.edges(), testing::UnorderedElementsAreArray(expected_edges));
+  EXPECT_TRUE(contracted.is_valid());
+
+  // The vertices within keep the IDs of h, so cuts are still cuts of h
+  EXPECT_THAT(contracted.vertices_within(2), testing::UnorderedElementsAre(1, 2));
+  EXPECT_THAT(contracted.vertices_within(3), testing::UnorderedElementsAre(5, 6));
+  const auto cut = MW_min_cut(contracted);
+  std::string error;
+  EXPECT_TRUE(cut_is_valid(cut, h, 2, error)) << error;
+
+  // New IDs continue from the dense ones
+  const std::vector<int> pins = {0, 1};
+  EXPECT_EQ(contracted.add_hyperedge(std::begin(pins), std::end(pins)), 3);
+  EXPECT_THAT(contracted.contract(3).vertices(), testing::Contains(4));
+}
+
+TEST(WeightedHypergraph, CompactIdsMovesWeights) {
+  WeightedHypergraph<size_t> h({1, 2, 3, 4}, {{{1, 2}, 1}, {{2, 3}, 2}, {{3, 4}, 4}, {{1, 4}, 8}});
+  h.remove_hyperedge(1);
+  const auto [vertex_ids, edge_ids] = h.compact_ids();
+  ASSERT_EQ(h.num_edges(), 3);
+  for (int e = 0; e < 3; ++e) {
+    EXPECT_EQ(h.edge_weight(e), std::vector<size_t>({1, 4, 8})[e]);
+  }
+  EXPECT_THAT(h.edges().at(1), testing::ElementsAre(vertex_ids.dense(3), vertex_ids.dense(4)));
+  EXPECT_TRUE(h.is_valid());
+}
+
+TEST(Hypergraph, NormalizedCutsTranslateBack) {
+  const Hypergraph h = factory();
+  Hypergraph normalized = normalize(h);
+  EXPECT_THAT(normalized.vertices(), testing::UnorderedElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+  const auto cut = translate(MW_min_cut(normalized), IdMap(h.vertices()));
+  std::string error;
+  EXPECT_TRUE(cut_is_valid(cut, h, 2, error)) << error;
+}
+
+TEST(Hypergraph, CoalescingMergesParallelEdges) {
+  const Hypergraph h = {
+      {1, 2, 3, 4},
+      {
+          {1, 2},
+          {2, 3, 4},
+          {2, 1},
+          {4, 3, 2, 4},
+          {3, 4}
+      }
+  };
+  const auto coalesced = coalesce_parallel_edges(h);
+  ASSERT_EQ(coalesced.num_edges(), 3);
+  EXPECT_THAT(coalesced.edges().at(0), testing::ElementsAre(1, 2));
+  EXPECT_EQ(coalesced.edge_weight(0), 2);
+  EXPECT_THAT(coalesced.edges().at(1), testing::ElementsAre(2, 3, 4));
+  EXPECT_EQ(coalesced.edge_weight(1), 2);
+  EXPECT_EQ(coalesced.edge_weight(2), 1);
+  EXPECT_TRUE(coalesced.is_valid());
+
+  // Cut values do not change
+  Hypergraph copy(h);
+  auto coalesced_copy = coalesced;
+  EXPECT_EQ(MW_min_cut_value(copy), MW_min_cut_value(coalesced_copy));
+}
+
 TEST(Hypergraph, RemoveHyperedgeSimple) {
   Hypergraph h = {
       {2, 4, 5, 6},
@@ -525,6 +803,33 @@ TEST(Hypergraph, RemoveHyperedgeKeepsGraphValid) {
   EXPECT_TRUE(h.is_valid());
 }
 
+TEST(Hypergraph, RepeatedPinsWithNegativeAndSparseIds) {
+  const Hypergraph negative({-1, 0, 1}, {{-1, 0}, {0, 1}, {1, -1, 1}});
+  EXPECT_FALSE(negative.may_have_repeated_pins(0));
+  EXPECT_FALSE(negative.may_have_repeated_pins(1));
+  EXPECT_TRUE(negative.may_have_repeated_pins(2));
+  const Hypergraph contracted = negative.contract(2);
+  EXPECT_THAT(contracted.vertices(), testing::UnorderedElementsAre(0, 2));
+  EXPECT_TRUE(contracted.is_valid());
+
+  // The vertices are marked in a hash set rather than an array as large as the largest ID
+  const Hypergraph sparse({0, 200000000, 5}, {{0, 200000000, 0}, {5, 200000000}});
+  EXPECT_TRUE(sparse.may_have_repeated_pins(0));
+  EXPECT_FALSE(sparse.may_have_repeated_pins(1));
+  const Hypergraph merged = sparse.contract(0);
+  EXPECT_THAT(merged.vertices(), testing::UnorderedElementsAre(5, 200000001));
+  EXPECT_EQ(merged.edges().size(), 1);
+  EXPECT_TRUE(merged.is_valid());
+
+  const std::vector<int> set = {0, 200000000};
+  using Set = std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>;
+  const std::vector<Set> sets = {{std::cbegin(set), std::cend(set)}};
+  const Hypergraph merged_sets = sparse.contract_sets(std::begin(sets), std::end(sets));
+  EXPECT_THAT(merged_sets.vertices(), testing::UnorderedElementsAre(5, 200000001));
+  EXPECT_EQ(merged_sets.edges().size(), 1);
+  EXPECT_TRUE(merged_sets.is_valid());
+}
+
 TEST(Hypergraph, RemoveHyperedgeKeepsGraphValidRepeated) {
   Hypergraph h = {
       {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
@@ -658,6 +963,1255 @@ TEST(Hypergraph, DegreeWorks) {
 
 namespace {
 
+// Compact hypergraphs hand out views of their edges, so copy them out for comparisons
+template<typename HypergraphType>
+std::vector<std::pair<int, std::vector<int>>> copy_edges(const HypergraphType &hypergraph) {
+  std::vector<std::pair<int, std::vector<int>>> edges;
+  for (const auto &[edge_id, vertices] : hypergraph.edges()) {
+    edges.emplace_back(edge_id, std::vector<int>(std::begin(vertices), std::end(vertices)));
+  }
+  return edges;
+}
+
+}
+
+TEST(CompactHypergraph, ContractReusesVertexId) {
+  CompactHypergraph h = {
+      {1, 2, 3, 4, 5},
+      {
+          {1, 2},
+          {1, 2, 3},
+          {2, 4, 5},
+          {2, 3}
+      }
+  };
+  CompactHypergraph contracted = h.contract(0);
+  // 2 has the largest degree so 1 is merged into it
+  EXPECT_THAT(contracted.vertices(), testing::UnorderedElementsAre(2, 3, 4, 5));
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {1, {2, 3}},
+      {2, {2, 4, 5}},
+      {3, {2, 3}}
+  };
+  EXPECT_THAT(copy_edges(contracted), testing::UnorderedElementsAreArray(expected_edges));
+  EXPECT_THAT(contracted.vertices_within(2), testing::UnorderedElementsAre(1, 2));
+  EXPECT_EQ(contracted.degree(2), 3);
+  EXPECT_TRUE(contracted.is_valid());
+
+  // The original is untouched
+  EXPECT_EQ(h.num_vertices(), 5);
+  EXPECT_EQ(h.num_edges(), 4);
+  EXPECT_TRUE(h.is_valid());
+}
+
+TEST(CompactHypergraph, InplaceContractRemovesMultipleEdges) {
+  CompactHypergraph h = {
+      {1, 2, 3, 4, 5},
+      {
+          {1, 2, 3},
+          {1, 2},
+          {1, 2, 3, 4},
+          {4, 5}
+      }
+  };
+  h.contract_in_place(0);
+  ASSERT_EQ(h.num_vertices(), 3);
+  ASSERT_EQ(h.num_edges(), 2);
+  const int merged = h.edges().at(2)[0] == 4 ? h.edges().at(2)[1] : h.edges().at(2)[0];
+  ASSERT_THAT(h.vertices(), testing::UnorderedElementsAre(4, 5, merged));
+  ASSERT_THAT(h.vertices_within(merged), testing::UnorderedElementsAre(1, 2, 3));
+  ASSERT_THAT(h.edges().at(3), testing::ElementsAre(4, 5));
+  ASSERT_TRUE(h.is_valid());
+}
+
+TEST(CompactHypergraph, InplaceContractKeepsGraphValidRepeated) {
+  CompactHypergraph h = {
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+      {
+          {9, 2, 1}, // 0
+          {9, 3, 1},
+          {8, 5, 2, 1, 0},
+          {8, 5, 3},
+          {5, 2, 0},
+          {9, 0}, // 5
+          {10, 3, 2},
+          {10, 5},
+          {4, 1},
+          {10, 8, 4},
+          {3, 2, 1}, // 10
+          {5, 4, 3, 2, 1, 0},
+          {5, 1},
+          {8, 4},
+      }
+  };
+
+  while (h.num_edges() > 0) {
+    h.contract_in_place(std::begin(h.edges())->first);
+    ASSERT_TRUE(h.is_valid());
+  }
+  // 6 and 7 are isolated, so everything else ends up in one vertex
+  ASSERT_EQ(h.num_vertices(), 3);
+  size_t num_within = 0;
+  for (const int v : h.vertices()) {
+    num_within += std::distance(std::begin(h.vertices_within(v)), std::end(h.vertices_within(v)));
+  }
+  ASSERT_EQ(num_within, 11);
+}
+
+TEST(CompactHypergraph, ContractSetsMatchesContractingOneAtATime) {
+  std::mt19937_64 rng(5);
+  std::vector<int> vertices(40);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+  std::vector<std::vector<int>> edges;
+  std::uniform_int_distribution<size_t> size(1, 6);
+  for (size_t i = 0; i < 80; ++i) {
+    std::vector<int> edge;
+    std::sample(std::begin(vertices), std::end(vertices), std::back_inserter(edge), size(rng), rng);
+    edges.push_back(edge);
+  }
+  CompactHypergraph batched(vertices, edges);
+  CompactHypergraph sequential(batched);
+
+  // Disjoint sets of 1 to 5 vertices, some of which share edges
+  std::shuffle(std::begin(vertices), std::end(vertices), rng);
+  std::vector<std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>> sets;
+  for (auto it = std::cbegin(vertices); std::distance(it, std::cend(vertices)) > 5;) {
+    const auto end = it + static_cast<long>(size(rng) % 5 + 1);
+    sets.emplace_back(it, end);
+    it = end;
+  }
+
+  batched.contract_sets_in_place(std::begin(sets), std::end(sets));
+  for (const auto &[begin, end] : sets) {
+    sequential.contract_in_place(begin, end);
+  }
+
+  ASSERT_TRUE(batched.is_valid());
+  EXPECT_THAT(batched.vertices(), testing::UnorderedElementsAreArray(sequential.vertices()));
+  EXPECT_THAT(copy_edges(batched), testing::UnorderedElementsAreArray(copy_edges(sequential)));
+  for (const int v : batched.vertices()) {
+    EXPECT_EQ(batched.degree(v), sequential.degree(v));
+    EXPECT_THAT(batched.vertices_within(v), testing::UnorderedElementsAreArray(sequential.vertices_within(v)));
+  }
+}
+
+TEST(Approx, ThreadsDoNotChangeTheCut) {
+  // Enough vertices for the degree scan to be split between threads
+  std::mt19937_64 rng(9);
+  const int n = 3 * static_cast<int>(detail::kMinVerticesPerThread);
+  std::vector<int> vertices(n);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+  std::vector<std::vector<int>> edges;
+  std::uniform_int_distribution<int> vertex(0, n - 1);
+  for (int i = 0; i < 2 * n; ++i) {
+    edges.push_back({vertex(rng), vertex(rng), vertex(rng)});
+  }
+  const Hypergraph hypergraph(vertices, edges);
+
+  const CompactHypergraph compact(hypergraph);
+  EXPECT_EQ(detail::min_degree_vertex(compact, vertices, 4), detail::min_degree_vertex(compact, vertices, 1));
+  const auto cut = approximate_minimizer_with_threads(hypergraph, 1.0, 4);
+  EXPECT_EQ(cut.value, approximate_minimizer_with_threads(hypergraph, 1.0, 1).value);
+  std::string error;
+  EXPECT_TRUE(cut_is_valid(cut, hypergraph, 2, error)) << error;
+}
+
+TEST(CompactHypergraph, RemoveHyperedgeSimple) {
+  CompactHypergraph h = {
+      {2, 4, 5, 6},
+      {
+          {2, 4, 5},
+          {2, 4},
+          {5, 6}
+      }
+  };
+  h.remove_hyperedge(0);
+  ASSERT_THAT(h.vertices(), testing::UnorderedElementsAre(2, 4, 5, 6));
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {1, {2, 4}}, {2, {5, 6}}
+  };
+  ASSERT_THAT(copy_edges(h), testing::UnorderedElementsAreArray(expected_edges));
+  ASSERT_TRUE(h.is_valid());
+}
+
+TEST(CompactHypergraph, AddHyperedgeKeepsGraphValid) {
+  CompactHypergraph h = {
+      {0, 1, 2, 3},
+      {
+          {0, 1},
+          {1, 2},
+          {2, 3}
+      }
+  };
+  for (int i = 0; i < 100; ++i) {
+    const std::vector<int> edge = {i % 4, (i + 1) % 4, (i + 3) % 4};
+    const int id = h.add_hyperedge(std::begin(edge), std::end(edge));
+    ASSERT_THAT(h.edges().at(id), testing::ElementsAreArray(edge));
+  }
+  ASSERT_EQ(h.num_edges(), 103);
+  ASSERT_EQ(h.size(), 306);
+  ASSERT_TRUE(h.is_valid());
+}
+
+TEST(CompactHypergraph, RemoveVertexInvalidatesEdge) {
+  CompactHypergraph h = {
+      {0, 1, 2, 3, 4},
+      {
+          {0, 1},
+          {0, 1, 2},
+          {3, 4}
+      }
+  };
+  h.remove_vertex(0);
+  ASSERT_THAT(h.vertices(), testing::UnorderedElementsAre(1, 2, 3, 4));
+  std::vector<std::pair<int, std::vector<int>>> expected_edges = {
+      {1, {1, 2}}, {2, {3, 4}}
+  };
+  ASSERT_THAT(copy_edges(h), testing::UnorderedElementsAreArray(expected_edges));
+  ASSERT_TRUE(h.is_valid());
+}
+
+TEST(CompactHypergraph, ConversionPreservesIds) {
+  Hypergraph h = {
+      {1, 2, 3, 4, 5},
+      {
+          {1, 2},
+          {1, 2, 3},
+          {2, 4, 5},
+          {1, 3}
+      }
+  };
+  h = h.contract(0);
+
+  CompactHypergraph compact(h);
+  EXPECT_THAT(compact.vertices(),
+              testing::UnorderedElementsAreArray(std::vector<int>(std::begin(h.vertices()), std::end(h.vertices()))));
+  EXPECT_THAT(copy_edges(compact), testing::UnorderedElementsAreArray(copy_edges(h)));
+  EXPECT_THAT(compact.vertices_within(6), testing::UnorderedElementsAre(1, 2));
+  EXPECT_TRUE(compact.is_valid());
+
+  WeightedHypergraph<size_t> weighted = {
+      {0, 1, 2},
+      {
+          {{0, 1}, 3},
+          {{1, 2}, 5},
+      }
+  };
+  CompactWeightedHypergraph<size_t> compact_weighted(weighted);
+  EXPECT_EQ(compact_weighted.edge_weight(0), 3);
+  EXPECT_EQ(compact_weighted.edge_weight(1), 5);
+  EXPECT_EQ(total_edge_weight(compact_weighted), 8);
+}
+
+namespace {
+
+// Not one of the known orderings, so the min cut falls back to copying the hypergraph in each phase
+std::vector<int> wrapped_tight_ordering(const Hypergraph &hypergraph, const int a) {
+  return tight_ordering(hypergraph, a);
+}
+
+}
+
+TEST(ContractionLog, BuildsCutsOfEarlierMerges) {
+  Hypergraph h = {
+      {1, 2, 3, 4},
+      {
+          {1, 2},
+          {2, 3},
+          {3, 4}
+      }
+  };
+  // Vertex 5 stands for vertices 1 and 2
+  const Hypergraph contracted = h.contract(0);
+  ContractionLog log(contracted);
+  log.merge(3, 5);
+  log.merge(4, 5);
+
+  const auto as_sets = [](const HypergraphCut<size_t> &cut) {
+    std::vector<std::set<int>> partitions;
+    for (const auto &partition : cut.partitions) {
+      partitions.emplace_back(std::begin(partition), std::end(partition));
+    }
+    return partitions;
+  };
+  EXPECT_EQ(as_sets(log.one_vertex_cut<size_t>(0, 4, 1)), (std::vector<std::set<int>>{{4}, {1, 2, 3}}));
+  EXPECT_EQ(as_sets(log.one_vertex_cut<size_t>(1, 5, 1)), (std::vector<std::set<int>>{{1, 2, 3}, {4}}));
+  EXPECT_EQ(as_sets(log.one_vertex_cut<size_t>(2, 5, 0)), (std::vector<std::set<int>>{{1, 2, 3, 4}, {}}));
+}
+
+TEST(VertexOrderingMinCut, InPlacePhasesMatchCopyingPhases) {
+  Hypergraph h = {
+      {1, 2, 3, 4, 5, 6},
+      {
+          {1, 2},
+          {1, 2, 3},
+          {2, 4, 5},
+          {1, 3},
+          {4, 5, 6},
+          {5, 6}
+      }
+  };
+  // Contracting first gives the hypergraph sparse IDs and a vertex that stands for several vertices
+  const Hypergraph contracted = h.contract(0);
+
+  Hypergraph copy = contracted;
+  const auto in_place = MW_min_cut(copy);
+  copy = contracted;
+  const auto copying = vertex_ordering_mincut<Hypergraph, wrapped_tight_ordering, true>(copy);
+  copy = contracted;
+  EXPECT_EQ(MW_min_cut_value(copy), in_place.value);
+
+  EXPECT_EQ(in_place.value, 1);
+  EXPECT_EQ(copying.value, 1);
+  std::string error;
+  EXPECT_TRUE(cut_is_valid(in_place, h, 2, error)) << error;
+  EXPECT_TRUE(cut_is_valid(copying, h, 2, error)) << error;
+}
+
+TEST(VertexOrderingMinCut, NegativeAndSparseIds) {
+  for (const std::vector<int> &ids : {std::vector<int>{-3, -2, -1, 0}, std::vector<int>{0, 7, 1 << 30, 5}}) {
+    const Hypergraph h(ids, {{ids[0], ids[1]}, {ids[1], ids[2]}, {ids[2], ids[3]}, {ids[3], ids[0]},
+                             {ids[0], ids[2]}});
+    CompactHypergraph compact(h);
+    EXPECT_TRUE(compact.renumbered());
+    EXPECT_TRUE(compact.is_valid());
+
+    Hypergraph copy = h;
+    const auto cut = Q_min_cut(copy);
+    EXPECT_EQ(cut.value, 2);
+    std::string error;
+    EXPECT_TRUE(cut_is_valid(cut, h, 2, error)) << error;
+    copy = h;
+    const auto approximate = approximate_minimizer(copy, 1.0);
+    EXPECT_TRUE(cut_is_valid(approximate, h, 2, error)) << error;
+  }
+}
+
+TEST(Hmetis, ReadsLikeStreams) {
+  const std::string filename = get_directory() / "instances/simple.htest";
+  const std::string weighted_filename = get_directory() / "instances/weighted_simple.htest";
+
+  const auto read_with_stream = [](const std::string &name, auto &hypergraph) {
+    std::ifstream input(name);
+    input >> hypergraph;
+  };
+  Hypergraph h;
+  read_with_stream(filename, h);
+  WeightedHypergraph<size_t> weighted;
+  read_with_stream(weighted_filename, weighted);
+
+  ASSERT_TRUE(is_unweighted_hmetis_file(filename));
+  ASSERT_FALSE(is_unweighted_hmetis_file(weighted_filename));
+  EXPECT_EQ(read_hmetis_file<Hypergraph>(filename), h);
+  EXPECT_EQ(read_hmetis_file<WeightedHypergraph<size_t>>(weighted_filename), weighted);
+  EXPECT_EQ(read_hmetis_file<CompactHypergraph>(filename), CompactHypergraph(h));
+  EXPECT_EQ(read_hmetis_file<CompactWeightedHypergraph<size_t>>(weighted_filename),
+            CompactWeightedHypergraph<size_t>(weighted));
+  EXPECT_TRUE(read_hmetis_file<CompactHypergraph>(filename).is_valid());
+  EXPECT_THROW(read_hmetis_file<Hypergraph>(get_directory() / "instances/not_even_a_file.htest"), std::runtime_error);
+}
+
+TEST(Hmetis, ParallelParseMatchesSequential) {
+  // Large enough to be split between several threads
+  std::mt19937_64 rng(1);
+  std::uniform_int_distribution<int> vertex(0, 9999);
+  std::uniform_int_distribution<int> size(0, 12);
+  std::stringstream contents;
+  const size_t num_edges = 200000;
+  contents << num_edges << " 10000 1\n";
+  for (size_t i = 0; i < num_edges; ++i) {
+    contents << (i % 97) * 0.25;
+    for (int j = size(rng); j > 0; --j) {
+      contents << ' ' << vertex(rng);
+    }
+    contents << (i % 3 == 0 ? "\r\n" : "\n");
+  }
+  contents << "2 10\n";
+  const std::string text = contents.str();
+  ASSERT_GT(text.size(), 3 * io::kMinBytesPerThread);
+
+  const auto sequential = io::parse_hmetis<double>(text, true, 1);
+  const auto parallel = io::parse_hmetis<double>(text, true, 4);
+  ASSERT_EQ(sequential.edge_offsets.size(), num_edges + 1);
+  EXPECT_EQ(sequential.edge_offsets, parallel.edge_offsets);
+  EXPECT_EQ(sequential.pins, parallel.pins);
+  EXPECT_EQ(sequential.edge_weights, parallel.edge_weights);
+  EXPECT_EQ(parallel.edge_weights[5], 1.25);
+}
+
+TEST(BinaryHypergraphFile, RoundTrips) {
+  const std::string filename = std::filesystem::temp_directory_path() / "hypergraph_test_round_trip.hgb";
+  const std::string weighted_filename = std::filesystem::temp_directory_path() / "hypergraph_test_weighted.hgb";
+  const auto write = [](const std::string &name, const auto &writer) {
+    std::ofstream output(name, std::ios::binary);
+    output << writer;
+  };
+
+  // Compact hypergraphs iterate over their edges in order of ID, so the IDs survive the round trip
+  const CompactHypergraph h = {
+      {0, 1, 2, 3, 4, 5},
+      {
+          {0, 1, 2},
+          {1, 2},
+          {2, 3, 4},
+          {3, 4, 5},
+          {0, 5}
+      }
+  };
+  const std::vector<std::vector<int>> partitions = {{0, 1, 2}, {3, 4, 5}};
+  const HypergraphCut<size_t> planted(std::begin(partitions), std::end(partitions), 2);
+  write(filename, as_binary(h, &planted));
+  ASSERT_TRUE(BinaryHypergraphFile::is_binary_file(filename));
+  ASSERT_TRUE(is_unweighted_hypergraph_file(filename));
+
+  const BinaryHypergraphFile file(filename);
+  EXPECT_EQ(file.num_vertices(), h.num_vertices());
+  EXPECT_EQ(file.num_edges(), h.num_edges());
+  EXPECT_EQ(read_hypergraph_file<CompactHypergraph>(filename), h);
+  EXPECT_TRUE(file.hypergraph<CompactHypergraph>().is_valid());
+  EXPECT_THAT(copy_edges(file.hypergraph<Hypergraph>()), testing::UnorderedElementsAreArray(copy_edges(h)));
+  const auto cut = file.planted_cut<size_t>();
+  ASSERT_TRUE(cut.has_value());
+  EXPECT_EQ(cut->value, 2);
+  EXPECT_EQ(cut->partitions, partitions);
+
+  const CompactWeightedHypergraph<double> weighted(std::vector<int>{0, 1, 2},
+                                                   {{{0, 1}, 0.5}, {{1, 2}, 2.25}, {{0, 1, 2}, 3}});
+  write(weighted_filename, as_binary(weighted));
+  ASSERT_FALSE(is_unweighted_hypergraph_file(weighted_filename));
+  EXPECT_EQ(read_hypergraph_file<CompactWeightedHypergraph<double>>(weighted_filename), weighted);
+  EXPECT_EQ(read_hypergraph_file<WeightedHypergraph<double>>(weighted_filename).edge_weight(1), 2.25);
+  EXPECT_FALSE(BinaryHypergraphFile(weighted_filename).planted_cut<double>().has_value());
+  EXPECT_THROW(read_hypergraph_file<Hypergraph>(weighted_filename), std::runtime_error);
+
+  std::filesystem::remove(filename);
+  std::filesystem::remove(weighted_filename);
+}
+
+TEST(BinaryHypergraphFile, RejectsOtherFiles) {
+  const std::string filename = get_directory() / "instances/simple.htest";
+  EXPECT_FALSE(BinaryHypergraphFile::is_binary_file(filename));
+  EXPECT_THROW(BinaryHypergraphFile{filename}, std::runtime_error);
+
+  const std::string truncated = std::filesystem::temp_directory_path() / "hypergraph_test_truncated.hgb";
+  {
+    std::stringstream contents;
+    contents << as_binary(read_hmetis_file<CompactHypergraph>(filename));
+    std::ofstream output(truncated, std::ios::binary);
+    output << contents.str().substr(0, contents.str().size() - 8);
+  }
+  EXPECT_THROW(BinaryHypergraphFile{truncated}, std::runtime_error);
+  std::filesystem::remove(truncated);
+}
+
+TEST(Hmetis, RejectsMalformedInput) {
+  EXPECT_THROW(io::parse_hmetis<size_t>("2 3\n0 1\n0 x\n", false, 1), std::runtime_error);
+  EXPECT_THROW(io::parse_hmetis<size_t>("2 3\n0 1\n0 3\n", false, 1), std::runtime_error);
+  EXPECT_THROW(io::parse_hmetis<size_t>("2 3\n0 1\n", false, 1), std::runtime_error);
+  EXPECT_THROW(io::parse_hmetis<size_t>("1 3 1\n\n", true, 1), std::runtime_error);
+  EXPECT_EQ(io::parse_hmetis<size_t>("1 3 1\n5 0 1\n", true, 1).edge_weights, std::vector<size_t>{5});
+}
+
+TEST(Hmetis, ChunkedReaderMatchesParse) {
+  std::mt19937_64 rng(2);
+  std::uniform_int_distribution<int> vertex(0, 99);
+  std::uniform_int_distribution<int> size(0, 6);
+  std::stringstream contents;
+  const size_t num_edges = 500;
+  contents << num_edges << " 100 1\n";
+  for (size_t i = 0; i < num_edges; ++i) {
+    contents << i % 7;
+    for (int j = size(rng); j > 0; --j) {
+      contents << " " << vertex(rng);
+    }
+    contents << "\n";
+  }
+  contents << "this line is not a hyperedge";
+  const auto expected = io::parse_hmetis<size_t>(contents.str(), true, 1);
+
+  // Chunks smaller than a line, and chunks of many lines
+  for (const size_t chunk_size : {1, 7, 64, 100000}) {
+    std::istringstream input(contents.str());
+    io::HmetisReader<size_t> reader(input, true, chunk_size);
+    EXPECT_EQ(reader.num_edges(), num_edges);
+    EXPECT_EQ(reader.num_vertices(), 100);
+    io::HmetisData<size_t> data, chunk;
+    data.edge_offsets.push_back(0);
+    while (reader.next(chunk)) {
+      const size_t offset = data.pins.size();
+      data.pins.insert(std::end(data.pins), std::begin(chunk.pins), std::end(chunk.pins));
+      for (size_t e = 1; e < chunk.edge_offsets.size(); ++e) {
+        data.edge_offsets.push_back(offset + chunk.edge_offsets[e]);
+      }
+      data.edge_weights.insert(std::end(data.edge_weights), std::begin(chunk.edge_weights), std::end(chunk.edge_weights));
+    }
+    EXPECT_EQ(data.edge_offsets, expected.edge_offsets) << "chunk size " << chunk_size;
+    EXPECT_EQ(data.pins, expected.pins) << "chunk size " << chunk_size;
+    EXPECT_EQ(data.edge_weights, expected.edge_weights) << "chunk size " << chunk_size;
+  }
+
+  std::istringstream truncated("3 3\n0 1\n1 2");
+  io::HmetisReader<size_t> reader(truncated, false, 4);
+  io::HmetisData<size_t> chunk;
+  EXPECT_THROW(while (reader.next(chunk)) {}, std::runtime_error);
+}
+
+TEST(IndexedBucketHeap, PopsLikeBucketHeap) {
+  const std::vector<int> values = {4, 0, 7, 2, 5};
+  BucketHeap expected(values, 8);
+  IndexedBucketHeap heap(values, 8);
+  for (const int v : {7, 2, 7, 5, 0, 7, 2}) {
+    expected.increment(v);
+    heap.increment(v);
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(heap.pop_key_val(), expected.pop_key_val());
+  }
+}
+
+TEST(IndexedBucketHeap, ResetClearsKeys) {
+  IndexedBucketHeap heap({1, 2}, 4);
+  heap.increment(1);
+  heap.increment(1);
+  heap.reset({3, 1, 2}, 4);
+  heap.increment(2);
+  EXPECT_EQ(heap.pop_key_val(), std::make_pair(size_t{1}, 2));
+  EXPECT_EQ(heap.pop_key_val().first, 0);
+  EXPECT_EQ(heap.pop_key_val().first, 0);
+}
+
+TEST(QuaternaryHeap, PopsMaximumKeys) {
+  std::vector<int> values(20);
+  std::iota(std::begin(values), std::end(values), 0);
+  QuaternaryHeap<double> heap(values, 0);
+  for (const int v : values) {
+    heap.increment(v, (v * 7) % 20 + 0.5);
+  }
+  heap.increment(3, 100);
+
+  EXPECT_EQ(heap.pop_key_val(), std::make_pair(101.5, 3));
+  double last = std::numeric_limits<double>::max();
+  for (size_t i = 1; i < values.size(); ++i) {
+    const auto [key, value] = heap.pop_key_val();
+    EXPECT_EQ(key, (value * 7) % 20 + 0.5);
+    EXPECT_LE(key, last);
+    last = key;
+  }
+}
+
+// The edges of a hypergraph with their vertices sorted, to compare hypergraphs regardless of the order of pins
+std::map<int, std::vector<int>> sorted_edges(const Hypergraph &hypergraph) {
+  std::map<int, std::vector<int>> edges;
+  for (const auto &[e, vertices] : hypergraph.edges()) {
+    auto &sorted = edges[e] = vertices;
+    std::sort(std::begin(sorted), std::end(sorted));
+  }
+  return edges;
+}
+
+TEST(KTrimmedCertificate, LargeKKeepsEveryPin) {
+  const Hypergraph h = factory();
+  const KTrimmedCertificate certificates(h);
+  EXPECT_EQ(sorted_edges(certificates.certificate(h.num_edges())), sorted_edges(h));
+  EXPECT_TRUE(certificates.certificate(2).is_valid());
+}
+
+// A random weighted hypergraph on 12 vertices with edges of three vertices, for checking certificates
+WeightedHypergraph<size_t> random_certificate_instance(std::mt19937_64 &rng, const int num_edges) {
+  const int n = 12;
+  std::vector<int> vertices(n);
+  std::iota(std::begin(vertices), std::end(vertices), 0);
+  std::uniform_int_distribution<int> vertex(0, n - 1);
+  std::uniform_int_distribution<size_t> weight(1, 4);
+  std::vector<std::pair<std::vector<int>, size_t>> edges;
+  for (int i = 0; i < num_edges; ++i) {
+    edges.push_back({{vertex(rng), vertex(rng), vertex(rng)}, weight(rng)});
+  }
+  return {vertices, edges};
+}
+
+// Checks on random cuts that the cuts of h below k keep their value in the certificate and the other cuts keep a value
+// of at least k
+void expect_keeps_cuts_below_k(const WeightedHypergraph<size_t> &h,
+                               const WeightedHypergraph<size_t> &certificate,
+                               const size_t k,
+                               std::mt19937_64 &rng) {
+  const CutEvaluator original(h);
+  const CutEvaluator trimmed(certificate);
+  std::uniform_int_distribution<int> side(0, 1);
+  for (int i = 0; i < 50; ++i) {
+    std::vector<int> labels(h.num_vertices()), trimmed_labels(h.num_vertices());
+    for (const int v : h.vertices()) {
+      labels[original.index(v)] = trimmed_labels[trimmed.index(v)] = side(rng);
+    }
+    const size_t value = original.value(labels);
+    if (value < k) {
+      EXPECT_EQ(trimmed.value(trimmed_labels), value) << "k = " << k;
+    } else {
+      EXPECT_GE(trimmed.value(trimmed_labels), k) << "k = " << k;
+    }
+  }
+}
+
+TEST(WeightedKTrimmedCertificate, MatchesUnrolledCertificate) {
+  std::mt19937_64 rng(11);
+  const WeightedHypergraph<size_t> h = random_certificate_instance(rng, 36);
+  const WeightedKTrimmedCertificate<size_t> certificates(h);
+
+  for (const size_t k : {1, 2, 3, 5, 8, 1000}) {
+    const auto certificate = certificates.certificate(k);
+    EXPECT_TRUE(certificate.is_valid());
+    expect_keeps_cuts_below_k(h, certificate, k, rng);
+  }
+
+  WeightedHypergraph<size_t> copy(h);
+  EXPECT_EQ(certificate_minimum_cut<WeightedHypergraph<size_t>>(h, MW_min_cut<WeightedHypergraph<size_t>>).value,
+            MW_min_cut_value(copy));
+}
+
+TEST(StreamingCertificate, KeepsCutsBelowK) {
+  std::mt19937_64 rng(12);
+  const WeightedHypergraph<size_t> h = random_certificate_instance(rng, 48);
+  const std::vector<int> vertices(std::begin(h.vertices()), std::end(h.vertices()));
+
+  for (const size_t k : {1, 2, 3, 5, 8, 1000}) {
+    StreamingCertificate certificates(vertices.size(), k);
+    std::vector<std::pair<std::vector<int>, size_t>> kept;
+    size_t total = 0;
+    for (const auto &[e, edge] : h.edges()) {
+      const size_t w = h.edge_weight(e);
+      if (const size_t kept_weight = certificates.add(std::begin(edge), std::end(edge), w); kept_weight > 0) {
+        EXPECT_LE(kept_weight, w);
+        kept.push_back({edge, kept_weight});
+        total += kept_weight;
+      }
+    }
+    EXPECT_LE(total, k * (vertices.size() - 1));
+    expect_keeps_cuts_below_k(h, WeightedHypergraph<size_t>(vertices, kept), k, rng);
+  }
+}
+
+TEST(IncrementalCertificate, GrowsLikeFromScratch) {
+  const Hypergraph h = factory();
+  const KTrimmedCertificate certificates(h);
+  IncrementalCertificate incremental(h);
+  for (const size_t k : {1, 2, 3, 4, 8, 16}) {
+    const Hypergraph &grown = incremental.grow(k);
+    EXPECT_EQ(incremental.k(), k);
+    EXPECT_EQ(sorted_edges(grown), sorted_edges(certificates.certificate(k)));
+    EXPECT_TRUE(grown.is_valid());
+  }
+}
+
+TEST(IncrementalCertificate, SharesCertificates) {
+  const Hypergraph h = factory();
+  const auto certificates = std::make_shared<const KTrimmedCertificate>(h);
+  IncrementalCertificate first(certificates);
+  IncrementalCertificate second(certificates);
+  EXPECT_EQ(sorted_edges(first.grow(4)), sorted_edges(certificates->certificate(4)));
+  EXPECT_EQ(sorted_edges(second.grow(2)), sorted_edges(certificates->certificate(2)));
+  EXPECT_EQ(certificate_minimum_cut<Hypergraph>(IncrementalCertificate(certificates), MW_min_cut<Hypergraph>).value,
+            certificate_minimum_cut<Hypergraph>(h, MW_min_cut<Hypergraph>).value);
+}
+
+TEST(Anytime, ReportsEachImprovementWithinTheRunBudget) {
+  const Hypergraph h = factory();
+  std::vector<util::Improvement<size_t>> improvements;
+  util::Budget<size_t> budget;
+  budget.max_num_runs = 20;
+  budget.on_improvement = [&improvements](const auto &improvement) { improvements.push_back(improvement); };
+
+  util::ContractionStats stats;
+  const auto cut = cxy::anytime_minimum_cut(h, 2, budget, stats, 1);
+  EXPECT_EQ(stats.num_runs, 20);
+  ASSERT_FALSE(improvements.empty());
+  EXPECT_EQ(improvements.back().value, cut.value);
+  for (size_t i = 1; i < improvements.size(); ++i) {
+    EXPECT_LT(improvements[i].value, improvements[i - 1].value);
+    EXPECT_GT(improvements[i].run, improvements[i - 1].run);
+    EXPECT_GE(improvements[i].elapsed, improvements[i - 1].elapsed);
+  }
+  EXPECT_LE(improvements.back().run, 20);
+}
+
+TEST(Anytime, TraceGivesTheBestValueWithinEachTimeLimit) {
+  const Hypergraph h = factory();
+  util::ImprovementTrace<size_t> trace;
+  util::Budget<size_t> budget;
+  budget.max_num_runs = 20;
+  budget.on_improvement = trace.recorder();
+
+  util::ContractionStats stats;
+  const auto cut = kk::anytime_minimum_cut(h, 2, budget, stats, 1);
+  const auto &improvements = trace.improvements();
+  ASSERT_FALSE(improvements.empty());
+  EXPECT_FALSE(trace.best_within(improvements.front().elapsed - std::chrono::nanoseconds(1)).has_value());
+  for (const auto &improvement : improvements) {
+    // Later improvements may have been found within the same tick of the clock
+    ASSERT_TRUE(trace.best_within(improvement.elapsed).has_value());
+    EXPECT_LE(trace.best_within(improvement.elapsed).value(), improvement.value);
+  }
+  EXPECT_EQ(trace.best_within(std::chrono::hours(1)), cut.value);
+}
+
+TEST(Anytime, StopsAtDeadline) {
+  const Hypergraph h = factory();
+  util::Budget<size_t> budget;
+  budget.deadline = std::chrono::steady_clock::now();
+
+  util::ContractionStats stats;
+  const auto cut = fpz::anytime_minimum_cut(h, 2, budget, stats);
+  EXPECT_EQ(stats.num_runs, 0);
+  EXPECT_EQ(cut.value, std::numeric_limits<size_t>::max());
+}
+
+TEST(Anytime, StopsWhenCancelled) {
+  const Hypergraph h = factory();
+  for (const size_t num_threads : {1, 2}) {
+    std::atomic<bool> cancelled = false;
+    util::Budget<size_t> budget;
+    // Without a run budget the search only ends when it is cancelled
+    budget.cancelled = &cancelled;
+
+    std::thread canceller([&cancelled] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      cancelled = true;
+    });
+    util::ContractionStats stats;
+    const auto cxy_cut = cxy::anytime_minimum_cut(h, 2, budget, stats, 0, num_threads);
+    canceller.join();
+    EXPECT_GT(stats.num_runs, 0);
+    EXPECT_EQ(cxy_cut.value, 3);
+
+    // Already cancelled, so FPZ stops before it starts
+    const auto fpz_cut = fpz::anytime_minimum_cut(h, 2, budget, stats, 0, num_threads);
+    EXPECT_EQ(stats.num_runs, 0);
+    EXPECT_EQ(fpz_cut.value, std::numeric_limits<size_t>::max());
+  }
+}
+
+TEST(Anytime, FpzPrunesBranchesBeatenByTheBound) {
+  const Hypergraph h = factory();
+  for (const size_t num_threads : {1, 2}) {
+    util::Budget<size_t> budget;
+    budget.max_num_runs = 5;
+    util::ContractionStats stats;
+    EXPECT_EQ(fpz::anytime_minimum_cut(h, 2, budget, stats, 1, num_threads).value, 3);
+
+    // Another search has found the minimum cut, so every branch is pruned before it gives a cut
+    std::atomic<size_t> bound = 3;
+    budget.bound = &bound;
+    EXPECT_EQ(fpz::anytime_minimum_cut(h, 2, budget, stats, 1, num_threads).value, std::numeric_limits<size_t>::max());
+
+    bound = 4;
+    EXPECT_EQ(fpz::anytime_minimum_cut(h, 2, budget, stats, 1, num_threads).value, 3);
+  }
+}
+
+TEST(Instrument, CountsContractionWork) {
+  using instrument::Counter;
+  const Hypergraph h = factory();
+  for (const size_t num_threads : {1, 2}) {
+    util::ContractionStats cxy_stats;
+    cxy::discover(h, 2, 3, cxy_stats, 1, num_threads);
+    util::ContractionStats fpz_stats;
+    fpz::discover(h, 2, 3, fpz_stats, 1, num_threads);
+
+    if constexpr (instrument::enabled) {
+      EXPECT_GT(cxy_stats.counters[Counter::PinsTouched], 0);
+      // The context keeps one copy of the hypergraph
+      EXPECT_EQ(cxy_stats.counters[Counter::HypergraphCopies], 1);
+      EXPECT_GE(fpz_stats.counters[Counter::Branches], fpz_stats.num_runs);
+      EXPECT_GT(fpz_stats.counters[Counter::MaxBranchDepth], 0);
+      if (num_threads == 1) {
+        // Branches are rolled back rather than copied
+        EXPECT_EQ(fpz_stats.counters[Counter::EngineCopies], 0);
+      } else {
+        EXPECT_GE(fpz_stats.counters[Counter::EngineCopies], fpz_stats.counters[Counter::Branches]);
+      }
+    } else {
+      EXPECT_EQ(cxy_stats.counters[Counter::PinsTouched], 0);
+      EXPECT_EQ(fpz_stats.counters[Counter::Branches], 0);
+    }
+  }
+}
+
+TEST(Instrument, SectionCountsHeapOperations) {
+  Hypergraph h = factory();
+  instrument::Counters counters;
+  {
+    const instrument::Section section;
+    MW_min_cut(h);
+    counters = section.collect();
+  }
+  if constexpr (instrument::enabled) {
+    EXPECT_GE(counters[instrument::Counter::HeapOperations], h.num_vertices() - 1);
+    // The counts are still there after the section ends
+    EXPECT_GE(instrument::local()[instrument::Counter::HeapOperations],
+              counters[instrument::Counter::HeapOperations]);
+  } else {
+    EXPECT_EQ(counters[instrument::Counter::HeapOperations], 0);
+  }
+}
+
+TEST(CXY, DeltaTableMatchesCxyDelta) {
+  for (const size_t k : {2, 3, 5}) {
+    const cxy::DeltaTable delta(200, k);
+    for (size_t n = k; n <= 200; n += 7) {
+      for (size_t size = 2; size <= n; size += 3) {
+        EXPECT_NEAR(delta(n, size), cxy::cxy_delta(n, size, k), 1e-9) << "n = " << n << ", size = " << size;
+      }
+    }
+  }
+}
+
+TEST(CXY, FixedKDeltaMatchesCxyDelta) {
+  const auto check = [](const auto K) {
+    constexpr size_t k = decltype(K)::value;
+    for (size_t n = k; n <= 200; n += 7) {
+      for (size_t size = 2; size <= n; size += 3) {
+        EXPECT_NEAR(cxy::fixed_k_delta<k>(n, size), cxy::cxy_delta(n, size, k), 1e-9)
+                  << "k = " << k << ", n = " << n << ", size = " << size;
+      }
+    }
+  };
+  check(std::integral_constant<size_t, 2>{});
+  check(std::integral_constant<size_t, 3>{});
+  check(std::integral_constant<size_t, 4>{});
+  EXPECT_DOUBLE_EQ(cxy::fixed_k_delta<2>(10, 3), 0.7);
+}
+
+TEST(Arena, ResetReusesBlocks) {
+  Arena arena(256);
+  const auto run = [&arena] {
+    arena.reset();
+    std::pmr::vector<std::pmr::vector<int>> partitions(&arena);
+    for (int i = 0; i < 50; ++i) {
+      auto &partition = partitions.emplace_back();
+      for (int v = 0; v < i; ++v) {
+        partition.push_back(v);
+      }
+    }
+    EXPECT_EQ(partitions.back().size(), 49);
+  };
+
+  run();
+  const size_t num_blocks = arena.num_blocks();
+  const size_t capacity = arena.capacity();
+  EXPECT_GT(num_blocks, 1);
+  for (int i = 0; i < 5; ++i) {
+    run();
+  }
+  EXPECT_EQ(arena.num_blocks(), num_blocks);
+  EXPECT_EQ(arena.capacity(), capacity);
+}
+
+TEST(Arena, AllocationsAreAligned) {
+  Arena arena(64);
+  for (const size_t alignment : {1, 2, 8, 16, 64}) {
+    // Leave the arena at an odd offset
+    EXPECT_NE(arena.allocate(3, 1), nullptr);
+    const void *p = arena.allocate(100, alignment);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+  }
+}
+
+TEST(Memory, UsageGrowsWithTheHypergraph) {
+  const Hypergraph small = factory();
+  std::vector<int> vertices;
+  std::vector<std::vector<int>> edges;
+  for (int v = 0; v < 200; ++v) {
+    vertices.push_back(v);
+    edges.push_back({v, (v + 1) % 200, (v + 7) % 200});
+  }
+  const Hypergraph large(vertices, edges);
+  EXPECT_GT(small.memory_usage(), sizeof(Hypergraph));
+  EXPECT_GT(large.memory_usage(), small.memory_usage());
+  EXPECT_GT(CompactHypergraph(large).memory_usage(), CompactHypergraph(small).memory_usage());
+  EXPECT_GT(KTrimmedCertificate(large).memory_usage(), large.memory_usage());
+
+  const ContractionEngine<Hypergraph> engine(large);
+  EXPECT_GT(engine.memory_usage(), sizeof(engine));
+  EXPECT_GT(engine.shared_memory_usage(), ContractionEngine<Hypergraph>(small).shared_memory_usage());
+}
+
+TEST(Memory, TrackerKeepsThePeak) {
+  const auto tracker = std::make_shared<MemoryTracker>();
+  {
+    MemoryTracker::Allocation first(tracker, 100);
+    MemoryTracker::Allocation second(tracker);
+    second.grow(50);
+    EXPECT_EQ(tracker->current(), 150);
+    first.resize(20);
+    EXPECT_EQ(tracker->current(), 70);
+  }
+  EXPECT_EQ(tracker->current(), 0);
+  EXPECT_EQ(tracker->peak(), 150);
+}
+
+TEST(Memory, FpzFindsTheMinimumCutWithinALimit) {
+  const Hypergraph h = factory();
+  Hypergraph copy = h;
+  const size_t expected = MW_min_cut_value(copy);
+
+  util::Budget<size_t> budget;
+  budget.max_num_runs = 20;
+  util::ContractionStats unlimited_stats;
+  fpz::anytime_minimum_cut(h, 2, budget, unlimited_stats, 1, 4);
+  EXPECT_GT(unlimited_stats.peak_memory_bytes, h.memory_usage());
+
+  // Every branch is explored on the engine it starts on, since even one more engine would go over the limit
+  budget.memory_limit = 1;
+  util::ContractionStats stats;
+  const auto cut = fpz::anytime_minimum_cut(h, 2, budget, stats, 1, 4);
+  EXPECT_EQ(cut.value, expected);
+  std::string error;
+  EXPECT_TRUE(cut_is_valid(cut, h, 2, error)) << error;
+  EXPECT_LE(stats.peak_memory_bytes, unlimited_stats.peak_memory_bytes);
+}
+
+TEST(CutEvaluator, MatchesCutIsValid) {
+  const WeightedHypergraph<int> hypergraph({2, 3, 5, 7, 8}, {{{2, 3}, 1}, {{3, 5, 7}, 2}, {{7, 8}, 4}, {{8}, 8},
+                                                            {{2, 8, 5}, 16}});
+  const std::vector<std::vector<std::vector<int>>> cuts = {
+      {{2, 3}, {5, 7, 8}},
+      {{2}, {3, 5, 7, 8}},
+      {{2, 3, 5}, {7}, {8}},
+      {{2, 3, 5, 7, 8}},
+  };
+  const std::vector<int> expected = {18, 17, 22, 0};
+
+  const CutEvaluator evaluator(hypergraph);
+  std::vector<int> labels;
+  for (size_t i = 0; i < cuts.size(); ++i) {
+    ASSERT_TRUE(evaluator.label(std::begin(cuts[i]), std::end(cuts[i]), labels));
+    EXPECT_EQ(evaluator.value(labels), expected[i]);
+
+    std::string error;
+    const HypergraphCut<int> cut(std::begin(cuts[i]), std::end(cuts[i]), expected[i]);
+    EXPECT_TRUE(cut_is_valid(cut, hypergraph, cuts[i].size(), error)) << error;
+  }
+  EXPECT_EQ(evaluator.values(std::begin(cuts), std::end(cuts)), expected);
+
+  const std::vector<std::vector<int>> overlapping = {{2, 3, 5}, {5, 7, 8}};
+  EXPECT_FALSE(evaluator.label(std::begin(overlapping), std::end(overlapping), labels));
+  const std::vector<std::vector<int>> unknown = {{2, 3, 4}, {5, 7, 8}};
+  EXPECT_FALSE(evaluator.label(std::begin(unknown), std::end(unknown), labels));
+}
+
+TEST(CutCache, HashDependsOnlyOnContent) {
+  const Hypergraph a({1, 2, 3, 4}, {{1, 2}, {2, 3, 4}, {1, 4}});
+  const Hypergraph reordered({4, 3, 2, 1}, {{4, 1}, {4, 3, 2}, {2, 1}});
+  const Hypergraph different({1, 2, 3, 4}, {{1, 2}, {2, 3, 4}, {1, 3}});
+  EXPECT_EQ(content_hash(a), content_hash(reordered));
+  EXPECT_NE(content_hash(a), content_hash(different));
+
+  const WeightedHypergraph<size_t> light({1, 2, 3}, {{{1, 2}, 1}, {{2, 3}, 2}});
+  const WeightedHypergraph<size_t> heavy({1, 2, 3}, {{{1, 2}, 2}, {{2, 3}, 1}});
+  EXPECT_NE(content_hash(light), content_hash(heavy));
+}
+
+TEST(CutCache, StoresAndFindsCuts) {
+  const auto directory = std::filesystem::temp_directory_path() / "hypergraph_test_cut_cache";
+  std::filesystem::remove_all(directory);
+  const CutCache cache(directory);
+
+  const Hypergraph hypergraph({1, 2, 3, 4}, {{1, 2}, {2, 3, 4}, {1, 4}});
+  const std::vector<std::vector<int>> partitions = {{1, 2}, {3, 4}};
+  const HypergraphCut<size_t> cut(std::begin(partitions), std::end(partitions), 2);
+  EXPECT_FALSE(cache.find(hypergraph, "MW", 2).has_value());
+  ASSERT_TRUE(cache.store(hypergraph, "MW", 2, cut));
+
+  const auto found = cache.find(Hypergraph({4, 3, 2, 1}, {{4, 1}, {4, 3, 2}, {2, 1}}), "MW", 2);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->value, 2);
+  EXPECT_EQ(found->partitions, partitions);
+  EXPECT_FALSE(cache.find(hypergraph, "Q", 2).has_value());
+  EXPECT_FALSE(cache.find(hypergraph, "MW", 3).has_value());
+
+  std::filesystem::remove_all(directory);
+}
+
+// The k-core found by removing vertices of degree less than k one at a time
+Hypergraph peel_naively(const Hypergraph &hypergraph, const size_t k) {
+  Hypergraph copy(hypergraph);
+  while (true) {
+    const auto &vertices = copy.vertices();
+    const auto it = std::find_if(std::begin(vertices), std::end(vertices), [&copy, k](const int v) {
+      return copy.degree(v) < k;
+    });
+    if (copy.num_vertices() == 0) {
+      return {};
+    }
+    if (it == std::end(vertices)) {
+      return normalize(copy);
+    }
+    copy.remove_vertex(*it);
+  }
+}
+
+std::multiset<std::vector<int>> edge_set(const Hypergraph &hypergraph) {
+  std::multiset<std::vector<int>> edges;
+  for (const auto &[id, edge] : hypergraph.edges()) {
+    edges.emplace(std::begin(edge), std::end(edge));
+  }
+  return edges;
+}
+
+TEST(CoreDecomposition, MatchesNaivePeeling) {
+  std::mt19937_64 rng(3);
+  for (const int stride : {1, 3}) {
+    // Vertex IDs are not contiguous with a stride of 3
+    std::vector<int> vertices(60);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      vertices[i] = stride * static_cast<int>(i);
+    }
+    std::vector<std::vector<int>> edges;
+    std::uniform_int_distribution<size_t> size(1, 5);
+    for (size_t i = 0; i < 150; ++i) {
+      std::vector<int> edge;
+      std::sample(std::begin(vertices), std::end(vertices), std::back_inserter(edge), size(rng), rng);
+      edges.push_back(edge);
+    }
+    const Hypergraph hypergraph(vertices, edges);
+
+    const CoreDecomposition decomposition(hypergraph);
+    for (size_t k = 0; k <= decomposition.max_core() + 1; ++k) {
+      const Hypergraph expected = peel_naively(hypergraph, k);
+      const Hypergraph core = decomposition.core(k);
+      EXPECT_EQ(core.num_vertices(), expected.num_vertices()) << "k = " << k;
+      EXPECT_EQ(decomposition.num_vertices(k), expected.num_vertices()) << "k = " << k;
+      EXPECT_EQ(edge_set(core), edge_set(expected)) << "k = " << k;
+    }
+    EXPECT_GT(peel_naively(hypergraph, decomposition.max_core()).num_vertices(), 0);
+    EXPECT_EQ(peel_naively(hypergraph, decomposition.max_core() + 1).num_vertices(), 0);
+  }
+}
+
+TEST(CoreDecomposition, CoreNumbers) {
+  // A triangle of 2-edges with a pendant vertex and a singleton edge
+  const Hypergraph hypergraph({0, 1, 2, 3}, {{0, 1}, {1, 2}, {2, 0}, {2, 3}, {3}});
+  const CoreDecomposition decomposition(hypergraph);
+  EXPECT_EQ(decomposition.core_number(0), 2);
+  EXPECT_EQ(decomposition.core_number(2), 2);
+  EXPECT_EQ(decomposition.core_number(3), 2);
+  EXPECT_EQ(decomposition.max_core(), 2);
+  EXPECT_EQ(kCoreDecomposition(hypergraph, 3).num_vertices(), 0);
+}
+
+TEST(FenwickTree, FindIsProportionalToValues) {
+  FenwickTree<size_t> tree({3, 0, 2, 5});
+  EXPECT_EQ(tree.total(), 10);
+  EXPECT_EQ(tree.find(0), 0);
+  EXPECT_EQ(tree.find(2), 0);
+  EXPECT_EQ(tree.find(3), 2);
+  EXPECT_EQ(tree.find(4), 2);
+  EXPECT_EQ(tree.find(5), 3);
+  EXPECT_EQ(tree.find(9), 3);
+}
+
+TEST(FenwickTree, UpdatesKeepPrefixSums) {
+  std::vector<size_t> values;
+  for (size_t i = 0; i < 37; ++i) {
+    values.push_back(i % 5);
+  }
+  FenwickTree<size_t> tree(values);
+  tree.add(3, 7);
+  values[3] += 7;
+  tree.subtract(20, values[20]);
+  values[20] = 0;
+
+  size_t sum = 0;
+  for (size_t i = 0; i <= values.size(); ++i) {
+    EXPECT_EQ(tree.prefix(i), sum);
+    if (i < values.size()) {
+      EXPECT_EQ(tree.value(i), values[i]);
+      sum += values[i];
+    }
+  }
+  EXPECT_EQ(tree.total(), sum);
+}
+
+TEST(ContractionEngine, ContractMergesVertices) {
+  Hypergraph h = {
+      {1, 2, 3, 4, 5},
+      {
+          {1, 2},
+          {1, 2, 3},
+          {2, 4, 5},
+          {2, 3}
+      }
+  };
+  ContractionEngine<Hypergraph> engine(h);
+  EXPECT_EQ(engine.num_vertices(), 5);
+  EXPECT_EQ(engine.num_edges(), 4);
+
+  engine.contract(0);
+  EXPECT_EQ(engine.num_vertices(), 4);
+  EXPECT_EQ(engine.find(0), engine.find(1));
+  EXPECT_TRUE(engine.is_loop(0));
+  EXPECT_EQ(engine.edge_size(1), 2);
+  EXPECT_EQ(engine.edge_size(2), 3);
+
+  // The loop is dropped, the other edges are all cut
+  EXPECT_EQ(engine.num_edges(), 3);
+  EXPECT_EQ(engine.cut_value(), 3);
+}
+
+TEST(ContractionEngine, ResetUndoesContractions) {
+  Hypergraph h = {
+      {1, 2, 3, 4},
+      {
+          {1, 2},
+          {3, 4},
+          {1, 4}
+      }
+  };
+  ContractionEngine<Hypergraph> engine(h);
+  engine.contract(0);
+  engine.contract(1);
+  engine.remove_edge(2);
+  EXPECT_EQ(engine.num_vertices(), 2);
+  EXPECT_EQ(engine.num_edges(), 0);
+
+  engine.reset();
+  EXPECT_EQ(engine.num_vertices(), 4);
+  EXPECT_EQ(engine.num_edges(), 3);
+  EXPECT_EQ(engine.cut_value(), 3);
+}
+
+TEST(ContractionEngine, RollbackRestoresCheckpoint) {
+  const Hypergraph h = factory();
+  ContractionEngine<Hypergraph> engine(h);
+  std::mt19937_64 rand(11);
+  engine.record_changes(true);
+
+  const auto state = [&] {
+    std::vector<int> roots;
+    for (size_t v = 0; v < h.num_vertices(); ++v) {
+      roots.push_back(engine.find(static_cast<int>(v)));
+    }
+    std::vector<int> edges(std::begin(engine.edges()), std::end(engine.edges()));
+    std::sort(std::begin(edges), std::end(edges));
+    return std::make_tuple(engine.num_vertices(), engine.cut_value(), roots, edges);
+  };
+
+  engine.contract(engine.sample_edge(rand));
+  const auto checkpoint = engine.checkpoint();
+  const auto before = state();
+  while (engine.num_vertices() > 2) {
+    const int e = engine.sample_edge(rand);
+    ASSERT_NE(e, ContractionEngine<Hypergraph>::kNone);
+    engine.contract(e);
+  }
+  engine.merge_down_to(1);
+  EXPECT_NE(state(), before);
+
+  engine.rollback(checkpoint);
+  EXPECT_EQ(state(), before);
+
+  // The sampler is restored as well, so contracting again only samples edges that are live
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(engine.is_loop(engine.sample_edge(rand)));
+  }
+}
+
+TEST(ContractionEngine, RemovesLargeEdgesTogether) {
+  const Hypergraph h = factory();
+  std::mt19937_64 rand(5);
+  const auto sorted_edges = [](const ContractionEngine<Hypergraph> &engine) {
+    std::vector<int> edges(std::begin(engine.edges()), std::end(engine.edges()));
+    std::sort(std::begin(edges), std::end(edges));
+    return edges;
+  };
+
+  for (int contractions = 0; contractions < 6; ++contractions) {
+    for (size_t size = 0; size <= 8; ++size) {
+      ContractionEngine<Hypergraph> engine(h);
+      for (int i = 0; i < contractions && engine.num_vertices() > 2; ++i) {
+        engine.contract(engine.sample_edge(rand));
+      }
+      ContractionEngine<Hypergraph> one_at_a_time = engine;
+      size_t expected = 0;
+      while (one_at_a_time.num_edges() > 0 && one_at_a_time.edge_size(one_at_a_time.edges().back()) >= size) {
+        expected += one_at_a_time.edge_weight(one_at_a_time.edges().back());
+        one_at_a_time.remove_edge(one_at_a_time.edges().back());
+      }
+
+      engine.record_changes(true);
+      const auto checkpoint = engine.checkpoint();
+      const auto before = sorted_edges(engine);
+      EXPECT_EQ(engine.remove_edges_of_size_at_least(size), expected);
+      EXPECT_EQ(sorted_edges(engine), sorted_edges(one_at_a_time));
+      EXPECT_EQ(engine.cut_value(), one_at_a_time.cut_value());
+      for (size_t i = 1; i < engine.edges().size(); ++i) {
+        EXPECT_LE(engine.edge_size(engine.edges()[i - 1]), engine.edge_size(engine.edges()[i]));
+      }
+      for (int e = 0; e < static_cast<int>(h.num_edges()); ++e) {
+        EXPECT_EQ(engine.is_live(e), one_at_a_time.is_live(e));
+      }
+      // The sampler only has the weights of the edges that are left
+      for (int i = 0; i < 10 && engine.num_edges() > 0; ++i) {
+        EXPECT_TRUE(engine.is_live(engine.sample_edge(rand)));
+      }
+
+      engine.rollback(checkpoint);
+      EXPECT_EQ(sorted_edges(engine), before);
+    }
+  }
+}
+
+TEST(ContractionEngine, SampleSkipsLoops) {
+  WeightedHypergraph<size_t> h = {
+      {1, 2, 3},
+      {
+          {{1, 2}, 5},
+          {{1, 2, 3}, 1},
+          {{1}, 4}
+      }
+  };
+  ContractionEngine<WeightedHypergraph<size_t>> engine(h);
+  // Edges of size one are never live
+  EXPECT_EQ(engine.num_edges(), 2);
+
+  std::mt19937_64 rand;
+  engine.contract(0);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(engine.sample_edge(rand), 1);
+  }
+  engine.contract(1);
+  EXPECT_EQ(engine.sample_edge(rand), ContractionEngine<WeightedHypergraph<size_t>>::kNone);
+  EXPECT_EQ(engine.cut_value(), 0);
+}
+
+TEST(ContractionEngine, PartitionsExpandContractedVertices) {
+  Hypergraph h = {
+      {1, 2, 3, 4, 5},
+      {
+          {1, 2},
+          {3, 4},
+          {4, 5}
+      }
+  };
+  h = h.contract(0);
+  ContractionEngine<Hypergraph> engine(h);
+  EXPECT_EQ(engine.num_vertices(), 4);
+
+  // Edges are numbered in the order of their IDs, and the first edge was contracted away
+  engine.contract(0);
+  engine.contract(1);
+  EXPECT_EQ(engine.num_vertices(), 2);
+
+  std::vector<std::vector<int>> partitions = engine.partitions();
+  for (auto &partition : partitions) {
+    std::sort(std::begin(partition), std::end(partition));
+  }
+  std::sort(std::begin(partitions), std::end(partitions));
+  EXPECT_THAT(partitions, testing::ElementsAre(std::vector<int>{1, 2}, std::vector<int>{3, 4, 5}));
+}
+
+namespace {
+
 using UnweightedTestCase = std::pair<const Hypergraph, std::map<size_t, Hypergraph::EdgeWeight>>;
 using WeightedTestCase = std::pair<const WeightedHypergraph<size_t>, std::map<size_t, size_t>>;
 
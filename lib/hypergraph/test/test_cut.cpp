@@ -4,6 +4,7 @@
 #include "testutil.hpp"
 
 #include "hypergraph/hypergraph.hpp"
+#include "hypergraph/compact.hpp"
 #include "hypergraph/cxy.hpp"
 #include "hypergraph/fpz.hpp"
 #include "hypergraph/approx.hpp"
@@ -21,6 +22,62 @@ CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE(MW)
 CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE(Q)
 CREATE_HYPERGRAPH_MIN_CUT_TEST_SUITE(KW)
 
+// The same algorithms should run unchanged on the compact representation
+CREATE_COMPACT_HYPERGRAPH_K_CUT_TEST_SUITE(CXYCompact, cxy)
+CREATE_COMPACT_HYPERGRAPH_K_CUT_TEST_SUITE(FPZCompact, fpz)
+
+CREATE_COMPACT_HYPERGRAPH_MIN_CUT_TEST_SUITE(MWCompact, MW)
+CREATE_COMPACT_HYPERGRAPH_MIN_CUT_TEST_SUITE(QCompact, Q)
+CREATE_COMPACT_HYPERGRAPH_MIN_CUT_TEST_SUITE(KWCompact, KW)
+
+// Runs a contraction algorithm on several threads, with the same interface as the algorithm itself. The default number
+// of runs is scaled by the number of threads, so that the seeded runs are at least as likely to find the minimum cut as
+// a single thread is.
+template<typename ContractImpl, size_t NumThreads>
+struct InParallel {
+  template<typename HypergraphType, bool ReturnPartitions>
+  static auto run(const HypergraphType &hypergraph,
+                  size_t k,
+                  std::optional<typename HypergraphType::EdgeWeight> discovery_value) {
+    util::ContractionStats stats{};
+    return util::repeat_contraction<HypergraphType, ContractImpl, ReturnPartitions, 0>(
+        hypergraph,
+        k,
+        std::mt19937_64(),
+        stats,
+        NumThreads * ContractImpl::default_num_runs(hypergraph, k),
+        discovery_value,
+        std::nullopt,
+        NumThreads);
+  }
+
+  template<typename HypergraphType>
+  static auto minimum_cut(const HypergraphType &hypergraph, size_t k) {
+    return run<HypergraphType, true>(hypergraph, k, std::nullopt);
+  }
+
+  template<typename HypergraphType>
+  static auto minimum_cut_value(const HypergraphType &hypergraph, size_t k) {
+    return run<HypergraphType, false>(hypergraph, k, std::nullopt);
+  }
+
+  template<typename HypergraphType>
+  static auto discover(const HypergraphType &hypergraph, size_t k, typename HypergraphType::EdgeWeight value) {
+    return run<HypergraphType, true>(hypergraph, k, value);
+  }
+
+  template<typename HypergraphType>
+  static auto discover_value(const HypergraphType &hypergraph, size_t k, typename HypergraphType::EdgeWeight value) {
+    return run<HypergraphType, false>(hypergraph, k, value);
+  }
+};
+
+using ParallelCXY = InParallel<cxy, 4>;
+using ParallelFPZ = InParallel<fpz, 4>;
+
+CREATE_HYPERGRAPH_K_CUT_TEST_SUITE(CXYParallel, ParallelCXY)
+CREATE_HYPERGRAPH_K_CUT_TEST_SUITE(FPZParallel, ParallelFPZ)
+
 template<typename HypergraphType>
 hypergraphlib::HypergraphCut<typename HypergraphType::EdgeWeight> KK_min_cut(const HypergraphType &hypergraph) {
   return hypergraphlib::kk::minimum_cut(hypergraph, 2);
@@ -46,6 +103,11 @@ hypergraphlib::HypergraphCut<typename HypergraphType::EdgeWeight> MW_certificate
   return hypergraphlib::certificate_minimum_cut<HypergraphType>(hypergraph, hypergraphlib::MW_min_cut<HypergraphType>);
 }
 
-// Certificate min cut only works for unweighted as of now
 CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(
-    Certificate, MW_certificate, hypergraphlib::Hypergraph, min_cut_instances(small_unweighted_tests()));
\ No newline at end of file
+    Certificate, MW_certificate, hypergraphlib::Hypergraph, min_cut_instances(small_unweighted_tests()));
+CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(
+    CertificateWeightedIntegral, MW_certificate, hypergraphlib::WeightedHypergraph<size_t>,
+    min_cut_instances(small_weighted_tests<size_t>()));
+CREATE_HYPERGRAPH_MIN_CUT_TEST_FIXTURE(
+    CertificateWeightedFloating, MW_certificate, hypergraphlib::WeightedHypergraph<double>,
+    min_cut_instances(small_weighted_tests<double>()));
\ No newline at end of file
@@ -141,6 +141,18 @@ inline std::vector<TestCaseInstance<hypergraphlib::WeightedHypergraph<EdgeWeight
                                                                           "instances/misc/smallrank/weighted"});
 }
 
+// The small unweighted or weighted instances, loaded as the given hypergraph type
+template<typename HypergraphType>
+inline std::vector<TestCaseInstance<HypergraphType>> small_tests() {
+  if constexpr (hypergraphlib::is_unweighted<HypergraphType>) {
+    return tests_in_folders<HypergraphType>({"instances/misc/small/unweighted",
+                                             "instances/misc/smallrank/unweighted"});
+  } else {
+    return tests_in_folders<HypergraphType>({"instances/misc/small/weighted",
+                                             "instances/misc/smallrank/weighted"});
+  }
+}
+
 template<typename HypergraphType>
 inline std::vector<MinCutTestCaseInstance<HypergraphType>> min_cut_instances(const std::vector<TestCaseInstance<
     HypergraphType>> &instances) {